@@ -53,6 +53,7 @@
 
 #include "fa_node.h"
 #include "hash_lookup.h"
+#include "dtree_lookup.h"
 
 acl_main_t acl_main;
 
@@ -1763,14 +1764,29 @@ acl_set_timeout_sec(int timeout_type, u32 value)
 {
   acl_main_t *am = &acl_main;
   clib_time_t *ct = &am->vlib_main->clib_time;
+  acl_fa_per_worker_data_t *pw;
+  u32 old_value;
 
   if (timeout_type < ACL_N_TIMEOUTS) {
+    old_value = am->session_timeout_sec[timeout_type];
     am->session_timeout_sec[timeout_type] = value;
   } else {
     clib_warning("Unknown timeout type %d", timeout_type);
     return;
   }
   am->session_timeout[timeout_type] = (u64)(((f64)value)/ct->seconds_per_clock);
+  /*
+   * The session timers which fire too early are restarted lazily,
+   * but with a shorter timeout the already running timers would fire
+   * too late - ask the workers to restart them all.
+   */
+  if (value < old_value) {
+    vec_foreach(pw, am->per_worker_data) {
+      pw->rearm_requested = 1;
+    }
+    vlib_process_signal_event (am->vlib_main, am->fa_cleaner_node_index,
+                               ACL_FA_CLEANER_RESCHEDULE, 0);
+  }
 }
 
 static void
@@ -1834,6 +1850,11 @@ acl_set_aclplugin_fn (vlib_main_t * vm,
       am->use_hash_acl_matching = (val !=0);
       goto done;
     }
+  if (unformat (input, "use-tree-acl-matching %u", &val))
+    {
+      acl_dtree_enable_disable(am, val);
+      goto done;
+    }
   if (unformat (input, "l4-match-nonfirst-fragment %u", &val))
     {
       am->l4_match_nonfirst_fragment = (val != 0);
@@ -1956,19 +1977,18 @@ acl_show_aclplugin_fn (vlib_main_t * vm,
       for (wk = 0; wk < vec_len (am->per_worker_data); wk++) {
         acl_fa_per_worker_data_t *pw = &am->per_worker_data[wk];
 	out0 = format(out0, "Worker #%d:\n", wk);
-	out0 = format(out0, "  Next expiry time: %lu\n", pw->next_expiry_time);
-	out0 = format(out0, "  Requeue until time: %lu\n", pw->requeue_until_time);
-	out0 = format(out0, "  Current time wait interval: %lu\n", pw->current_time_wait_interval);
+	out0 = format(out0, "  Timer wheel next run time: %.3f\n", pw->timer_wheel.next_run_time);
+	out0 = format(out0, "  Sessions: %u\n", pool_elts (pw->fa_sessions_pool));
 	out0 = format(out0, "  Count of deleted sessions: %lu\n", pw->cnt_deleted_sessions);
 	out0 = format(out0, "  Delete already deleted: %lu\n", pw->cnt_already_deleted_sessions);
 	out0 = format(out0, "  Session timers restarted: %lu\n", pw->cnt_session_timer_restarted);
-	out0 = format(out0, "  Swipe until this time: %lu\n", pw->swipe_end_time);
+	out0 = format(out0, "  swipe in progress: %u\n", pw->swipe_in_process);
 	out0 = format(out0, "  sw_if_index serviced bitmap: %U\n", format_bitmap_hex, pw->serviced_sw_if_index_bitmap);
 	out0 = format(out0, "  pending clear intfc bitmap : %U\n", format_bitmap_hex, pw->pending_clear_sw_if_index_bitmap);
 	out0 = format(out0, "  clear in progress: %u\n", pw->clear_in_process);
+	out0 = format(out0, "  timer rearm requested: %u\n", pw->rearm_requested);
 	out0 = format(out0, "  interrupt is pending: %d\n", pw->interrupt_is_pending);
 	out0 = format(out0, "  interrupt is needed: %d\n", pw->interrupt_is_needed);
-	out0 = format(out0, "  interrupt is unwanted: %d\n", pw->interrupt_is_unwanted);
       }
       out0 = format(out0, "\n\nConn cleaner thread counters:\n");
 #define _(cnt, desc) out0 = format(out0, "             %20lu: %s\n", am->cnt, desc);
@@ -1976,9 +1996,8 @@ acl_show_aclplugin_fn (vlib_main_t * vm,
 #undef _
       vec_terminate_c_string(out0);
       vlib_cli_output(vm, "\n\n%s\n\n", out0);
-      vlib_cli_output(vm, "Sessions per interval: min %lu max %lu increment: %f ms current: %f ms",
-              am->fa_min_deleted_sessions_per_interval, am->fa_max_deleted_sessions_per_interval,
-              am->fa_cleaner_wait_time_increment * 1000.0, ((f64)am->fa_current_cleaner_timer_wait_interval) * 1000.0/(f64)vm->clib_time.clocks_per_second);
+      vlib_cli_output(vm, "Sessions per interval: max %lu, timer interval: %.3f sec",
+              am->fa_max_deleted_sessions_per_interval, ACL_FA_TIMER_INTERVAL);
 
       vec_free(out0);
       show_fa_sessions_hash(vm, show_bihash_verbose);
@@ -2082,6 +2101,7 @@ acl_show_aclplugin_fn (vlib_main_t * vm,
       int show_applied_info = 0;
       int show_mask_type = 0;
       int show_bihash = 0;
+      int show_dtree = 0;
       u32 show_bihash_verbose = 0;
 
       if (unformat (input, "acl")) {
@@ -2097,14 +2117,18 @@ acl_show_aclplugin_fn (vlib_main_t * vm,
       } else if (unformat (input, "hash")) {
         show_bihash = 1;
         unformat (input, "verbose %u", &show_bihash_verbose);
+      } else if (unformat (input, "tree")) {
+        show_dtree = 1;
+        unformat (input, "sw_if_index %u", &sw_if_index);
       }
 
-      if ( ! (show_mask_type || show_acl_hash_info || show_applied_info || show_bihash) ) {
+      if ( ! (show_mask_type || show_acl_hash_info || show_applied_info || show_bihash || show_dtree) ) {
         /* if no qualifiers specified, show all */
         show_mask_type = 1;
         show_acl_hash_info = 1;
         show_applied_info = 1;
         show_bihash = 1;
+        show_dtree = 1;
       }
 
       if (show_mask_type) {
@@ -2162,6 +2186,13 @@ acl_show_aclplugin_fn (vlib_main_t * vm,
           if (swi < vec_len(am->input_applied_hash_acl_info_by_sw_if_index)) {
             applied_hash_acl_info_t *pal = &am->input_applied_hash_acl_info_by_sw_if_index[swi];
             out0 = format(out0, "  input lookup mask_type_index_bitmap: %U\n", format_bitmap_hex, pal->mask_type_index_bitmap);
+            out0 = format(out0, "  input lookup mask type order:\n");
+            for(j=0; j<vec_len(pal->mask_info_vec); j++) {
+              applied_hash_mask_info_t *minfo = &pal->mask_info_vec[j];
+              out0 = format(out0, "    mask type %d first entry %d min entry %d hits %lu\n",
+                                       minfo->mask_type_index, minfo->first_applied_entry_index,
+                                       minfo->min_applied_entry_index, minfo->hits);
+            }
           }
           if (swi < vec_len(am->input_hash_entry_vec_by_sw_if_index)) {
             out0 = format(out0, "  input lookup applied entries:\n");
@@ -2176,6 +2207,13 @@ acl_show_aclplugin_fn (vlib_main_t * vm,
           if (swi < vec_len(am->output_applied_hash_acl_info_by_sw_if_index)) {
             applied_hash_acl_info_t *pal = &am->output_applied_hash_acl_info_by_sw_if_index[swi];
             out0 = format(out0, "  output lookup mask_type_index_bitmap: %U\n", format_bitmap_hex, pal->mask_type_index_bitmap);
+            out0 = format(out0, "  output lookup mask type order:\n");
+            for(j=0; j<vec_len(pal->mask_info_vec); j++) {
+              applied_hash_mask_info_t *minfo = &pal->mask_info_vec[j];
+              out0 = format(out0, "    mask type %d first entry %d min entry %d hits %lu\n",
+                                       minfo->mask_type_index, minfo->first_applied_entry_index,
+                                       minfo->min_applied_entry_index, minfo->hits);
+            }
           }
           if (swi < vec_len(am->output_hash_entry_vec_by_sw_if_index)) {
             out0 = format(out0, "  output lookup applied entries:\n");
@@ -2196,6 +2234,10 @@ acl_show_aclplugin_fn (vlib_main_t * vm,
       if (show_bihash) {
         show_hash_acl_hash(vm, am, show_bihash_verbose);
       }
+
+      if (show_dtree) {
+        show_dtree_acl(vm, am, sw_if_index);
+      }
     }
   return error;
 }
@@ -2212,6 +2254,236 @@ acl_clear_aclplugin_fn (vlib_main_t * vm,
   return error;
 }
 
+/*
+ * Make a ClassBench-like IPv4 rule: a mix of prefix lengths, protocols
+ * and port specifications, which yields dozens of distinct mask types.
+ */
+static void
+acl_test_make_rule (vl_api_acl_rule_t * r, u32 * seed)
+{
+  static u8 plens[] = { 0, 8, 12, 16, 20, 24, 28, 32 };
+  static u16 well_known_ports[] = { 22, 25, 53, 80, 123, 443, 3306, 8080 };
+  u32 v;
+
+  memset (r, 0, sizeof (*r));
+  r->is_permit = (random_u32 (seed) % 4) != 0;
+  r->src_ip_prefix_len = plens[random_u32 (seed) % ARRAY_LEN (plens)];
+  r->dst_ip_prefix_len = plens[random_u32 (seed) % ARRAY_LEN (plens)];
+  v = random_u32 (seed);
+  clib_memcpy (r->src_ip_addr, &v, 4);
+  v = random_u32 (seed);
+  clib_memcpy (r->dst_ip_addr, &v, 4);
+
+  v = random_u32 (seed) % 10;
+  r->proto = v < 4 ? IPPROTO_TCP : v < 7 ? IPPROTO_UDP : 0;
+  r->srcport_or_icmptype_last = htons (65535);
+  r->dstport_or_icmpcode_last = htons (65535);
+  if (r->proto == 0)
+    return;
+
+  v = random_u32 (seed) % 10;
+  if (v < 5)
+    {
+      u16 port = well_known_ports[random_u32 (seed) %
+				  ARRAY_LEN (well_known_ports)];
+      r->dstport_or_icmpcode_first = r->dstport_or_icmpcode_last =
+	htons (port);
+    }
+  else if (v < 7)
+    r->dstport_or_icmpcode_first = htons (1024);
+  if (random_u32 (seed) % 5 == 0)
+    r->srcport_or_icmptype_first = htons (1024);
+}
+
+/*
+ * Make a packet 5-tuple which falls within the given rule, or a random
+ * one if the rule is null.
+ */
+static void
+acl_test_make_5tuple (fa_5tuple_t * pkt, vl_api_acl_rule_t * r,
+		      u32 sw_if_index, u32 * seed)
+{
+  u32 src = random_u32 (seed);
+  u32 dst = random_u32 (seed);
+  u16 sport = 1024 + random_u32 (seed) % (65536 - 1024);
+  u16 dport = random_u32 (seed);
+  u8 proto = (random_u32 (seed) & 1) ? IPPROTO_TCP : IPPROTO_UDP;
+
+  if (r)
+    {
+      u32 m, a;
+      m = r->src_ip_prefix_len ?
+	clib_host_to_net_u32 (~0U << (32 - r->src_ip_prefix_len)) : 0;
+      clib_memcpy (&a, r->src_ip_addr, 4);
+      src = (a & m) | (src & ~m);
+      m = r->dst_ip_prefix_len ?
+	clib_host_to_net_u32 (~0U << (32 - r->dst_ip_prefix_len)) : 0;
+      clib_memcpy (&a, r->dst_ip_addr, 4);
+      dst = (a & m) | (dst & ~m);
+      if (r->proto)
+	proto = r->proto;
+      if (ntohs (r->dstport_or_icmpcode_first) > dport)
+	dport = ntohs (r->dstport_or_icmpcode_first);
+      if (ntohs (r->dstport_or_icmpcode_last) < dport)
+	dport = ntohs (r->dstport_or_icmpcode_last);
+    }
+
+  memset (pkt, 0, sizeof (*pkt));
+  pkt->addr[0].ip4.as_u32 = src;
+  pkt->addr[1].ip4.as_u32 = dst;
+  pkt->l4.proto = proto;
+  pkt->l4.port[0] = sport;
+  pkt->l4.port[1] = dport;
+  pkt->pkt.l4_valid = 1;
+  pkt->pkt.is_input = 1;
+  pkt->pkt.sw_if_index = sw_if_index;
+}
+
+static f64
+acl_test_hash_lookup_run (fa_5tuple_t * pkts, u32 sw_if_index,
+			  u32 iterations, u32 * n_matched)
+{
+  vlib_main_t *vm = vlib_get_main ();
+  u32 acl_match, rule_match, trace_bitmap;
+  f64 before, delta;
+  int i, j;
+
+  *n_matched = 0;
+  before = vlib_time_now (vm);
+  for (i = 0; i < iterations; i++)
+    for (j = 0; j < vec_len (pkts); j++)
+      {
+	acl_match = ~0;
+	hash_multi_acl_match_5tuple (sw_if_index, &pkts[j], 0, 0, 1,
+				     &acl_match, &rule_match, &trace_bitmap);
+	*n_matched += (acl_match != ~0);
+      }
+  delta = vlib_time_now (vm) - before;
+
+  return delta > 0 ? (f64) iterations * vec_len (pkts) / delta : 0;
+}
+
+static clib_error_t *
+acl_test_hash_lookup_fn (vlib_main_t * vm,
+			 unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  acl_main_t *am = &acl_main;
+  vnet_main_t *vnm = am->vnet_main;
+  clib_error_t *error = 0;
+  u32 sw_if_index = ~0;
+  u32 n_rules = 0;
+  u32 n_packets = 10000;
+  u32 iterations = 10;
+  u32 seed = 0xdeadbeef;
+  u32 *rule_counts = 0, *n;
+  vl_api_acl_rule_t *rules = 0;
+  fa_5tuple_t *pkts = 0;
+  u8 tag[64];
+  int i, rv;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "%U", unformat_vnet_sw_interface, vnm,
+		    &sw_if_index))
+	;
+      else if (unformat (input, "rules %u", &n_rules))
+	vec_add1 (rule_counts, n_rules);
+      else if (unformat (input, "packets %u", &n_packets))
+	;
+      else if (unformat (input, "iterations %u", &iterations))
+	;
+      else if (unformat (input, "seed %u", &seed))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input `%U'",
+				     format_unformat_error, input);
+	  goto done;
+	}
+    }
+
+  if (sw_if_index == ~0)
+    {
+      error = clib_error_return (0, "interface required");
+      goto done;
+    }
+  if (vec_len (am->input_acl_vec_by_sw_if_index) > sw_if_index &&
+      vec_len (am->input_acl_vec_by_sw_if_index[sw_if_index]))
+    {
+      error = clib_error_return (0, "interface already has input ACLs");
+      goto done;
+    }
+  if (n_packets == 0 || iterations == 0)
+    {
+      error = clib_error_return (0, "packets and iterations must be > 0");
+      goto done;
+    }
+  if (vec_len (rule_counts) == 0)
+    {
+      vec_add1 (rule_counts, 1000);
+      vec_add1 (rule_counts, 10000);
+    }
+
+  memset (tag, 0, sizeof (tag));
+  clib_memcpy (tag, "hash-lookup-test", sizeof ("hash-lookup-test"));
+
+  vec_foreach (n, rule_counts)
+  {
+    u32 acl_index = ~0;
+    u32 n_matched, n_mask_types;
+    f64 rate_before, rate_after;
+
+    vec_validate (rules, clib_max (*n, 1) - 1);
+    for (i = 0; i < *n; i++)
+      acl_test_make_rule (&rules[i], &seed);
+
+    /* nine in ten of the packets fall within one of the rules */
+    vec_validate (pkts, n_packets - 1);
+    for (i = 0; i < n_packets; i++)
+      acl_test_make_5tuple (&pkts[i], (*n && (i % 10)) ?
+			    &rules[random_u32 (&seed) % *n] : 0,
+			    sw_if_index, &seed);
+
+    rv = acl_add_list (*n, rules, &acl_index, tag);
+    if (rv)
+      {
+	error = clib_error_return (0, "acl_add_list returned %d", rv);
+	goto done;
+      }
+    rv = acl_interface_add_del_inout_acl (sw_if_index, 1, 1, acl_index);
+    if (rv)
+      {
+	acl_del_list (acl_index);
+	error = clib_error_return (0, "applying the ACL returned %d", rv);
+	goto done;
+      }
+    n_mask_types =
+      vec_len (am->input_applied_hash_acl_info_by_sw_if_index
+	       [sw_if_index].mask_info_vec);
+
+    /* first pass in the initial mask type order, then re-sort by hits */
+    rate_before = acl_test_hash_lookup_run (pkts, sw_if_index, iterations,
+					    &n_matched);
+    hash_acl_reorder_mask_types (am);
+    rate_after = acl_test_hash_lookup_run (pkts, sw_if_index, iterations,
+					   &n_matched);
+
+    vlib_cli_output (vm, "%u rules, %u mask types, %u/%u packets matched",
+		     *n, n_mask_types, n_matched / iterations, n_packets);
+    vlib_cli_output (vm, "  %.2f lookups/sec initial order, "
+		     "%.2f lookups/sec by hit rate", rate_before, rate_after);
+
+    acl_interface_add_del_inout_acl (sw_if_index, 0, 1, acl_index);
+    acl_del_list (acl_index);
+  }
+
+done:
+  vec_free (rule_counts);
+  vec_free (rules);
+  vec_free (pkts);
+  return error;
+}
+
  /* *INDENT-OFF* */
 VLIB_CLI_COMMAND (aclplugin_set_command, static) = {
     .path = "set acl-plugin",
@@ -2230,6 +2502,24 @@ VLIB_CLI_COMMAND (aclplugin_clear_command, static) = {
     .short_help = "clear acl-plugin sessions",
     .function = acl_clear_aclplugin_fn,
 };
+
+/*?
+ * Measure the rate of the hash-based ACL lookups, i.e. the rate at which
+ * new sessions can be classified, for synthetic rule sets of the given
+ * sizes (1000 and 10000 rules by default). The ACL is temporarily
+ * applied inbound on the interface, which must not have input ACLs.
+ *
+ * @cliexpar
+ * @cliexstart{test acl-plugin hash-lookup}
+ * test acl-plugin hash-lookup pg0 rules 1000 rules 10000 packets 10000
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (aclplugin_test_hash_lookup_command, static) = {
+    .path = "test acl-plugin hash-lookup",
+    .short_help = "test acl-plugin hash-lookup <interface> [rules <n>]... "
+                  "[packets <n>] [iterations <n>] [seed <n>]",
+    .function = acl_test_hash_lookup_fn,
+};
 /* *INDENT-ON* */
 
 
@@ -2268,21 +2558,20 @@ acl_init (vlib_main_t * vm)
   vec_validate(am->per_worker_data, tm->n_vlib_mains-1);
   {
     u16 wk;
-    u8 tt;
     for (wk = 0; wk < vec_len (am->per_worker_data); wk++) {
       acl_fa_per_worker_data_t *pw = &am->per_worker_data[wk];
-      vec_validate(pw->fa_conn_list_head, ACL_N_TIMEOUTS-1);
-      vec_validate(pw->fa_conn_list_tail, ACL_N_TIMEOUTS-1);
-      for(tt = 0; tt < ACL_N_TIMEOUTS; tt++) {
-        pw->fa_conn_list_head[tt] = ~0;
-        pw->fa_conn_list_tail[tt] = ~0;
-      }
+      tw_timer_wheel_init_1t_3w_1024sl_ov (&pw->timer_wheel, 0 /* no callback */,
+                                           ACL_FA_TIMER_INTERVAL,
+                                           ACL_FA_DEFAULT_MAX_DELETED_SESSIONS_PER_INTERVAL);
+      /* the wheels run on the CPU clock, see acl_fa_wheel_time () */
+      pw->timer_wheel.last_run_time = clib_cpu_time_now () * vm->clib_time.seconds_per_clock;
+      pw->timer_wheel.next_run_time = pw->timer_wheel.last_run_time + ACL_FA_TIMER_INTERVAL;
+      pw->transient_head_index = ~0;
+      pw->transient_tail_index = ~0;
     }
   }
 
-  am->fa_min_deleted_sessions_per_interval = ACL_FA_DEFAULT_MIN_DELETED_SESSIONS_PER_INTERVAL;
   am->fa_max_deleted_sessions_per_interval = ACL_FA_DEFAULT_MAX_DELETED_SESSIONS_PER_INTERVAL;
-  am->fa_cleaner_wait_time_increment = ACL_FA_DEFAULT_CLEANER_WAIT_TIME_INCREMENT;
 
   am->fa_cleaner_cnt_delete_by_sw_index = 0;
   am->fa_cleaner_cnt_delete_by_sw_index_ok = 0;
@@ -28,6 +28,7 @@
 #include "bihash_40_8.h"
 #include "fa_node.h"
 #include "hash_lookup_types.h"
+#include "dtree_lookup_types.h"
 
 #define  ACL_PLUGIN_VERSION_MAJOR 1
 #define  ACL_PLUGIN_VERSION_MINOR 3
@@ -146,6 +147,17 @@ typedef struct {
 
   /* Do we use hash-based ACL matching or linear */
   int use_hash_acl_matching;
+  /* When to next check the order of the mask types in the hash lookups */
+  f64 hash_lookup_next_reorder_time;
+#define ACL_HASH_LOOKUP_REORDER_INTERVAL 1.0
+
+  /* Do we use the decision trees for the ACL matching */
+  int use_tree_acl_matching;
+  acl_dtree_t **input_dtree_by_sw_if_index;
+  acl_dtree_t **output_dtree_by_sw_if_index;
+  /* the interfaces whose trees the builder process is to rebuild */
+  uword *input_dtree_rebuild_bitmap;
+  uword *output_dtree_rebuild_bitmap;
 
   /* a pool of all mask types present in all ACEs */
   ace_mask_type_entry_t *ace_mask_type_pool;
@@ -204,26 +216,13 @@ typedef struct {
   u64 fa_conn_table_max_entries;
 
   /*
-   * If the cleaner has to delete more than this number
-   * of connections, it halves the sleep time.
+   * The maximum number of the expired session timers and swiped
+   * sessions processed by a worker in one time slice.
    */
 
 #define ACL_FA_DEFAULT_MAX_DELETED_SESSIONS_PER_INTERVAL 100
   u64 fa_max_deleted_sessions_per_interval;
 
-  /*
-   * If the cleaner deletes less than these connections,
-   * it increases the wait time by the "increment"
-   */
-
-#define ACL_FA_DEFAULT_MIN_DELETED_SESSIONS_PER_INTERVAL 1
-  u64 fa_min_deleted_sessions_per_interval;
-
-#define ACL_FA_DEFAULT_CLEANER_WAIT_TIME_INCREMENT 0.1
-  f64 fa_cleaner_wait_time_increment;
-
-  u64 fa_current_cleaner_timer_wait_interval;
-
   /* per-worker data related t conn management */
   acl_fa_per_worker_data_t *per_worker_data;
 
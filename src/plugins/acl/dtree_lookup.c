@@ -0,0 +1,730 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+/*
+ * Decision tree ACL matching, after HiCuts.
+ *
+ * The rules of all the ACLs applied to an interface in a direction are
+ * flattened in the priority order and turned into ranges of up to seven
+ * fields. The tree recursively cuts the space of the field values into
+ * equal power-of-two sized pieces, on the field which best tells the
+ * rules apart, until a piece has few enough rules to check them one by
+ * one. A packet descends by shifting and masking its field values and
+ * then checks the handful of rules in the leaf in order.
+ *
+ * The trees are compiled in a process node, not under the worker
+ * barrier. While the ACLs of an interface are changing its tree is
+ * marked stale and the packets use the hash based lookup.
+ * A change rebuilds the whole tree of each affected interface and
+ * direction rather than inserting or deleting the rules in place:
+ * the cuts depend on all the rules, so an in-place update would
+ * degrade the tree, and the hash lookup covers the build time.
+ *
+ * A packet classified by a tree sets 0x40000000 in the trace bitmap,
+ * with the depth of the leaf it reached in bits 24-29.
+ */
+
+#include <stddef.h>
+#include <netinet/in.h>
+
+#include <vlib/vlib.h>
+#include <vnet/vnet.h>
+#include <vppinfra/error.h>
+#include <acl/acl.h>
+#include <vppinfra/bihash_48_8.h>
+
+#include "hash_lookup.h"
+#include "dtree_lookup.h"
+
+/* a node with this many rules or less is a leaf */
+#define ACL_DTREE_LEAF_RULES 8
+/* at most 64 cuts of a node */
+#define ACL_DTREE_MAX_LOG2_CUTS 6
+/* the children may hold at most this times the rules of the node */
+#define ACL_DTREE_SPACE_FACTOR 4
+#define ACL_DTREE_MAX_DEPTH 24
+/* stop cutting once the leaves refer to this times the number of rules */
+#define ACL_DTREE_MAX_REFS_PER_RULE 64
+
+typedef enum {
+  ACL_DTREE_EVENT_REBUILD = 1,
+} acl_dtree_event_t;
+
+static u8 acl_dtree_field_width[] = {
+#define _(f, w, s) w,
+  foreach_acl_dtree_field
+#undef _
+};
+
+static char *acl_dtree_field_name[] = {
+#define _(f, w, s) s,
+  foreach_acl_dtree_field
+#undef _
+};
+
+/* The part of the field space a tree node covers */
+typedef struct {
+  u32 lo[ACL_DTREE_N_FIELDS];
+  u8 log2_size[ACL_DTREE_N_FIELDS];
+} acl_dtree_region_t;
+
+vlib_node_registration_t acl_dtree_builder_process_node;
+
+static_always_inline u32
+prefix_range_lo (u32 v, int plen)
+{
+  if (plen <= 0)
+    return 0;
+  if (plen >= 32)
+    return v;
+  return v & (~0U << (32 - plen));
+}
+
+static_always_inline u32
+prefix_range_hi (u32 v, int plen)
+{
+  if (plen <= 0)
+    return ~0U;
+  if (plen >= 32)
+    return v;
+  return v | ~(~0U << (32 - plen));
+}
+
+static void
+dtree_rule_from_acl_rule (acl_dtree_rule_t * dr, acl_rule_t * r,
+                          u32 acl_index, u32 ace_index)
+{
+  int w;
+
+  memset (dr, 0, sizeof (*dr));
+  if (r->is_ipv6)
+    {
+      for (w = 0; w < 2; w++)
+        {
+          dr->lo[ACL_DTREE_FIELD_SRC0 + w] =
+            prefix_range_lo (clib_net_to_host_u32 (r->src.ip6.as_u32[w]),
+                             r->src_prefixlen - 32 * w);
+          dr->hi[ACL_DTREE_FIELD_SRC0 + w] =
+            prefix_range_hi (clib_net_to_host_u32 (r->src.ip6.as_u32[w]),
+                             r->src_prefixlen - 32 * w);
+          dr->lo[ACL_DTREE_FIELD_DST0 + w] =
+            prefix_range_lo (clib_net_to_host_u32 (r->dst.ip6.as_u32[w]),
+                             r->dst_prefixlen - 32 * w);
+          dr->hi[ACL_DTREE_FIELD_DST0 + w] =
+            prefix_range_hi (clib_net_to_host_u32 (r->dst.ip6.as_u32[w]),
+                             r->dst_prefixlen - 32 * w);
+        }
+      dr->need_addr_check = (r->src_prefixlen > 64) || (r->dst_prefixlen > 64);
+      dr->is_ip6 = 1;
+    }
+  else
+    {
+      /* the lower fields are always zero for IPv4 */
+      dr->lo[ACL_DTREE_FIELD_SRC0] =
+        prefix_range_lo (clib_net_to_host_u32 (r->src.ip4.as_u32),
+                         r->src_prefixlen);
+      dr->hi[ACL_DTREE_FIELD_SRC0] =
+        prefix_range_hi (clib_net_to_host_u32 (r->src.ip4.as_u32),
+                         r->src_prefixlen);
+      dr->lo[ACL_DTREE_FIELD_DST0] =
+        prefix_range_lo (clib_net_to_host_u32 (r->dst.ip4.as_u32),
+                         r->dst_prefixlen);
+      dr->hi[ACL_DTREE_FIELD_DST0] =
+        prefix_range_hi (clib_net_to_host_u32 (r->dst.ip4.as_u32),
+                         r->dst_prefixlen);
+    }
+
+  if (r->proto)
+    {
+      dr->lo[ACL_DTREE_FIELD_PROTO] = dr->hi[ACL_DTREE_FIELD_PROTO] = r->proto;
+      dr->lo[ACL_DTREE_FIELD_SPORT] = r->src_port_or_type_first;
+      dr->hi[ACL_DTREE_FIELD_SPORT] = r->src_port_or_type_last;
+      dr->lo[ACL_DTREE_FIELD_DPORT] = r->dst_port_or_code_first;
+      dr->hi[ACL_DTREE_FIELD_DPORT] = r->dst_port_or_code_last;
+      dr->is_l4 = 1;
+      /* the same as the hash lookup: only TCP rules look at the flags */
+      if ((r->proto == IPPROTO_TCP) && (r->tcp_flags_mask != 0))
+        {
+          dr->tcp_flags_mask = r->tcp_flags_mask;
+          dr->tcp_flags_value = r->tcp_flags_value;
+        }
+    }
+  else
+    {
+      dr->hi[ACL_DTREE_FIELD_PROTO] = 255;
+      dr->hi[ACL_DTREE_FIELD_SPORT] = 65535;
+      dr->hi[ACL_DTREE_FIELD_DPORT] = 65535;
+    }
+  dr->acl_index = acl_index;
+  dr->ace_index = ace_index;
+  dr->action = r->is_permit;
+}
+
+static_always_inline u64
+region_hi (acl_dtree_region_t * region, int f)
+{
+  return (u64) region->lo[f] + (1ULL << region->log2_size[f]) - 1;
+}
+
+/* The number of distinct rule ranges within the region on the field */
+static u32
+dtree_count_distinct (acl_dtree_t * t, u32 * rule_indices,
+                      acl_dtree_region_t * region, int f)
+{
+  uword *h = hash_create (0, sizeof (uword));
+  u64 rlo = region->lo[f], rhi = region_hi (region, f);
+  u32 *ri, n;
+
+  vec_foreach (ri, rule_indices)
+  {
+    acl_dtree_rule_t *dr = t->rules + *ri;
+    u64 lo = clib_max (rlo, dr->lo[f]);
+    u64 hi = clib_min (rhi, dr->hi[f]);
+    hash_set (h, (lo << 32) | (hi - rlo), 1);
+  }
+  n = hash_elts (h);
+  hash_free (h);
+  return n;
+}
+
+/* The rule references after cutting the region on the field */
+static u64
+dtree_space_measure (acl_dtree_t * t, u32 * rule_indices,
+                     acl_dtree_region_t * region, int f, int log2_n_cuts)
+{
+  int shift = region->log2_size[f] - log2_n_cuts;
+  u64 rlo = region->lo[f], rhi = region_hi (region, f);
+  u64 sum = 1 << log2_n_cuts;
+  u32 *ri;
+
+  vec_foreach (ri, rule_indices)
+  {
+    acl_dtree_rule_t *dr = t->rules + *ri;
+    u64 lo = clib_max (rlo, dr->lo[f]);
+    u64 hi = clib_min (rhi, dr->hi[f]);
+    sum += ((hi - rlo) >> shift) - ((lo - rlo) >> shift) + 1;
+  }
+  return sum;
+}
+
+/* Every rule covers the whole of both of the pieces on the field */
+static int
+dtree_rules_cover (acl_dtree_t * t, u32 * rule_indices, int f, u64 lo,
+                   u64 hi)
+{
+  u32 *ri;
+
+  vec_foreach (ri, rule_indices)
+  {
+    acl_dtree_rule_t *dr = t->rules + *ri;
+    if (dr->lo[f] > lo || dr->hi[f] < hi)
+      return 0;
+  }
+  return 1;
+}
+
+static u32
+dtree_build_node (acl_dtree_t * t, u32 * rule_indices,
+                  acl_dtree_region_t * region, u32 depth, u32 max_refs)
+{
+  acl_dtree_node_t *n;
+  acl_dtree_region_t child_region;
+  u32 node_index, children_index, prev_child = ~0;
+  u32 *child_rules = 0, *prev_rules = 0, *tmp;
+  u32 n_distinct, best_distinct = 1;
+  int f, best_field = -1, log2_n_cuts, shift, j;
+  u64 limit, child_lo, child_hi, prev_lo = 0;
+
+  vec_add2 (t->nodes, n, 1);
+  node_index = n - t->nodes;
+  t->max_depth = clib_max (t->max_depth, depth);
+
+  if (vec_len (rule_indices) > ACL_DTREE_LEAF_RULES
+      && depth < ACL_DTREE_MAX_DEPTH && vec_len (t->leaf_rules) < max_refs)
+    {
+      for (f = 0; f < ACL_DTREE_N_FIELDS; f++)
+        {
+          if (region->log2_size[f] == 0)
+            continue;
+          n_distinct = dtree_count_distinct (t, rule_indices, region, f);
+          if (n_distinct > best_distinct)
+            {
+              best_distinct = n_distinct;
+              best_field = f;
+            }
+        }
+    }
+
+  if (best_field < 0)
+    {
+      n = t->nodes + node_index;
+      n->is_leaf = 1;
+      n->index = vec_len (t->leaf_rules);
+      n->n_rules = vec_len (rule_indices);
+      vec_append (t->leaf_rules, rule_indices);
+      t->n_leaves++;
+      t->max_leaf_rules = clib_max (t->max_leaf_rules, n->n_rules);
+      return node_index;
+    }
+
+  /* the most cuts that keep the rule references within the space factor */
+  f = best_field;
+  limit = (u64) ACL_DTREE_SPACE_FACTOR *vec_len (rule_indices);
+  log2_n_cuts = 1;
+  while (log2_n_cuts < clib_min (ACL_DTREE_MAX_LOG2_CUTS,
+                                 region->log2_size[f])
+         && dtree_space_measure (t, rule_indices, region, f,
+                                 log2_n_cuts + 1) <= limit)
+    log2_n_cuts++;
+  shift = region->log2_size[f] - log2_n_cuts;
+
+  children_index = vec_len (t->children);
+  vec_resize (t->children, 1 << log2_n_cuts);
+  n = t->nodes + node_index;
+  n->field = f;
+  n->shift = shift;
+  n->log2_n_cuts = log2_n_cuts;
+  n->index = children_index;
+
+  child_region = *region;
+  child_region.log2_size[f] = shift;
+  for (j = 0; j < (1 << log2_n_cuts); j++)
+    {
+      u32 *ri;
+
+      child_lo = region->lo[f] + ((u64) j << shift);
+      child_hi = child_lo + (1ULL << shift) - 1;
+      child_region.lo[f] = child_lo;
+
+      vec_reset_length (child_rules);
+      vec_foreach (ri, rule_indices)
+      {
+        acl_dtree_rule_t *dr = t->rules + *ri;
+        if (dr->lo[f] <= child_hi && dr->hi[f] >= child_lo)
+          vec_add1 (child_rules, *ri);
+      }
+
+      /*
+       * Neighbours may share the subtree if they have the same rules
+       * and none of them tells the two pieces apart.
+       */
+      if (prev_child != ~0 && vec_len (child_rules) == vec_len (prev_rules)
+          && 0 == memcmp (child_rules, prev_rules,
+                          vec_len (child_rules) * sizeof (u32))
+          && dtree_rules_cover (t, child_rules, f, prev_lo, child_hi))
+        {
+          t->children[children_index + j] = prev_child;
+          continue;
+        }
+      prev_child = dtree_build_node (t, child_rules, &child_region,
+                                     depth + 1, max_refs);
+      t->children[children_index + j] = prev_child;
+      prev_lo = child_lo;
+      tmp = prev_rules;
+      prev_rules = child_rules;
+      child_rules = tmp;
+    }
+  vec_free (child_rules);
+  vec_free (prev_rules);
+  return node_index;
+}
+
+static acl_dtree_t *
+acl_dtree_build (acl_main_t * am, u32 * acl_vec)
+{
+  acl_dtree_t *t = clib_mem_alloc (sizeof (*t));
+  acl_dtree_region_t region;
+  acl_dtree_rule_t *dr;
+  u32 *rule_indices = 0;
+  u32 *pacl, i, max_refs;
+  int f, is_ip6;
+  f64 start = vlib_time_now (am->vlib_main);
+
+  memset (t, 0, sizeof (*t));
+  vec_foreach (pacl, acl_vec)
+  {
+    acl_list_t *a;
+    if (pool_is_free_index (am->acls, *pacl))
+      continue;
+    a = am->acls + *pacl;
+    for (i = 0; i < vec_len (a->rules); i++)
+      {
+        vec_add2 (t->rules, dr, 1);
+        dtree_rule_from_acl_rule (dr, a->rules + i, *pacl, i);
+      }
+  }
+
+  max_refs = ACL_DTREE_MAX_REFS_PER_RULE * (vec_len (t->rules) + 1);
+  for (is_ip6 = 0; is_ip6 < 2; is_ip6++)
+    {
+      vec_reset_length (rule_indices);
+      for (i = 0; i < vec_len (t->rules); i++)
+        {
+          dr = t->rules + i;
+          if (dr->is_ip6 != is_ip6)
+            continue;
+          /* an empty port range never matches, leave it out */
+          for (f = 0; f < ACL_DTREE_N_FIELDS; f++)
+            if (dr->lo[f] > dr->hi[f])
+              break;
+          if (f == ACL_DTREE_N_FIELDS)
+            vec_add1 (rule_indices, i);
+        }
+      if (vec_len (rule_indices) == 0)
+        {
+          t->root[is_ip6] = ~0;
+          continue;
+        }
+      for (f = 0; f < ACL_DTREE_N_FIELDS; f++)
+        {
+          region.lo[f] = 0;
+          region.log2_size[f] = acl_dtree_field_width[f];
+        }
+      /* there is nothing to cut in the lower address halves of IPv4 */
+      if (!is_ip6)
+        region.log2_size[ACL_DTREE_FIELD_SRC1] =
+          region.log2_size[ACL_DTREE_FIELD_DST1] = 0;
+      t->root[is_ip6] = dtree_build_node (t, rule_indices, &region, 1,
+                                          max_refs);
+    }
+  vec_free (rule_indices);
+  t->build_time = vlib_time_now (am->vlib_main) - start;
+  return t;
+}
+
+static void
+acl_dtree_free (acl_dtree_t * t)
+{
+  vec_free (t->nodes);
+  vec_free (t->children);
+  vec_free (t->leaf_rules);
+  vec_free (t->rules);
+  clib_mem_free (t);
+}
+
+static void
+acl_dtree_rebuild (acl_main_t * am, u32 sw_if_index, u8 is_input)
+{
+  vlib_main_t *vm = am->vlib_main;
+  acl_dtree_t **trees = is_input ? am->input_dtree_by_sw_if_index :
+    am->output_dtree_by_sw_if_index;
+  u32 **acl_vecs = is_input ? am->input_acl_vec_by_sw_if_index :
+    am->output_acl_vec_by_sw_if_index;
+  acl_dtree_t *old, *new = 0;
+
+  if (!am->use_tree_acl_matching || sw_if_index >= vec_len (trees))
+    return;
+
+  old = trees[sw_if_index];
+  if (sw_if_index < vec_len (acl_vecs) && vec_len (acl_vecs[sw_if_index]))
+    new = acl_dtree_build (am, acl_vecs[sw_if_index]);
+
+  /* the tree must be complete before the workers can see it */
+  CLIB_MEMORY_BARRIER ();
+  trees[sw_if_index] = new;
+  if (old)
+    {
+      /* make sure no worker is still walking the old tree */
+      vlib_worker_thread_barrier_sync (vm);
+      vlib_worker_thread_barrier_release (vm);
+      acl_dtree_free (old);
+    }
+}
+
+void
+acl_dtree_rebuild_request (acl_main_t * am, u32 sw_if_index, u8 is_input)
+{
+  acl_dtree_t ***ptrees = is_input ? &am->input_dtree_by_sw_if_index :
+    &am->output_dtree_by_sw_if_index;
+  uword **pbitmap = is_input ? &am->input_dtree_rebuild_bitmap :
+    &am->output_dtree_rebuild_bitmap;
+
+  if (!am->use_tree_acl_matching)
+    return;
+
+  /* the vector only ever grows here, with the workers stopped */
+  vec_validate (*ptrees, sw_if_index);
+  if ((*ptrees)[sw_if_index])
+    (*ptrees)[sw_if_index]->is_stale = 1;
+  *pbitmap = clib_bitmap_set (*pbitmap, sw_if_index, 1);
+  vlib_process_signal_event (am->vlib_main,
+                             acl_dtree_builder_process_node.index,
+                             ACL_DTREE_EVENT_REBUILD, 0);
+}
+
+void
+acl_dtree_enable_disable (acl_main_t * am, int enable)
+{
+  vlib_main_t *vm = am->vlib_main;
+  acl_dtree_t **pt;
+  u32 sw_if_index;
+
+  enable = (enable != 0);
+  if (enable == am->use_tree_acl_matching)
+    return;
+
+  vlib_worker_thread_barrier_sync (vm);
+  am->use_tree_acl_matching = enable;
+  if (enable)
+    {
+      for (sw_if_index = 0;
+           sw_if_index < vec_len (am->input_acl_vec_by_sw_if_index);
+           sw_if_index++)
+        if (vec_len (am->input_acl_vec_by_sw_if_index[sw_if_index]))
+          acl_dtree_rebuild_request (am, sw_if_index, 1);
+      for (sw_if_index = 0;
+           sw_if_index < vec_len (am->output_acl_vec_by_sw_if_index);
+           sw_if_index++)
+        if (vec_len (am->output_acl_vec_by_sw_if_index[sw_if_index]))
+          acl_dtree_rebuild_request (am, sw_if_index, 0);
+    }
+  else
+    {
+      vec_foreach (pt, am->input_dtree_by_sw_if_index)
+        if (*pt)
+          acl_dtree_free (*pt);
+      vec_foreach (pt, am->output_dtree_by_sw_if_index)
+        if (*pt)
+          acl_dtree_free (*pt);
+      vec_free (am->input_dtree_by_sw_if_index);
+      vec_free (am->output_dtree_by_sw_if_index);
+      clib_bitmap_free (am->input_dtree_rebuild_bitmap);
+      clib_bitmap_free (am->output_dtree_rebuild_bitmap);
+    }
+  vlib_worker_thread_barrier_release (vm);
+}
+
+static uword
+acl_dtree_builder_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+                           vlib_frame_t * f)
+{
+  acl_main_t *am = &acl_main;
+  uword *event_data = 0, *bitmap;
+  u32 sw_if_index;
+  int is_input;
+
+  while (1)
+    {
+      vlib_process_wait_for_event (vm);
+      vlib_process_get_events (vm, &event_data);
+      vec_reset_length (event_data);
+
+      /* everything requested so far, the builds do not suspend */
+      for (is_input = 0; is_input < 2; is_input++)
+        {
+          if (is_input)
+            {
+              bitmap = am->input_dtree_rebuild_bitmap;
+              am->input_dtree_rebuild_bitmap = 0;
+            }
+          else
+            {
+              bitmap = am->output_dtree_rebuild_bitmap;
+              am->output_dtree_rebuild_bitmap = 0;
+            }
+          /* *INDENT-OFF* */
+          clib_bitmap_foreach (sw_if_index, bitmap,
+          ({
+            acl_dtree_rebuild (am, sw_if_index, is_input);
+          }));
+          /* *INDENT-ON* */
+          clib_bitmap_free (bitmap);
+        }
+    }
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (acl_dtree_builder_process_node) = {
+  .function = acl_dtree_builder_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "acl-plugin-dtree-builder",
+};
+/* *INDENT-ON* */
+
+static_always_inline void
+dtree_fill_fields (fa_5tuple_t * pkt_5tuple, int is_ip6, u32 * v)
+{
+  if (is_ip6)
+    {
+      v[ACL_DTREE_FIELD_SRC0] =
+        clib_net_to_host_u32 (pkt_5tuple->addr[0].ip6.as_u32[0]);
+      v[ACL_DTREE_FIELD_SRC1] =
+        clib_net_to_host_u32 (pkt_5tuple->addr[0].ip6.as_u32[1]);
+      v[ACL_DTREE_FIELD_DST0] =
+        clib_net_to_host_u32 (pkt_5tuple->addr[1].ip6.as_u32[0]);
+      v[ACL_DTREE_FIELD_DST1] =
+        clib_net_to_host_u32 (pkt_5tuple->addr[1].ip6.as_u32[1]);
+    }
+  else
+    {
+      v[ACL_DTREE_FIELD_SRC0] =
+        clib_net_to_host_u32 (pkt_5tuple->addr[0].ip4.as_u32);
+      v[ACL_DTREE_FIELD_SRC1] = 0;
+      v[ACL_DTREE_FIELD_DST0] =
+        clib_net_to_host_u32 (pkt_5tuple->addr[1].ip4.as_u32);
+      v[ACL_DTREE_FIELD_DST1] = 0;
+    }
+  v[ACL_DTREE_FIELD_SPORT] = pkt_5tuple->l4.port[0];
+  v[ACL_DTREE_FIELD_DPORT] = pkt_5tuple->l4.port[1];
+  v[ACL_DTREE_FIELD_PROTO] = pkt_5tuple->l4.proto;
+}
+
+static int
+dtree_match_ip6_prefix (u64 addr0, u64 addr1, ip46_address_t * prefix,
+                        int prefixlen)
+{
+  ip6_address_t mask;
+
+  ip6_address_mask_from_width (&mask, prefixlen);
+  return (0 == ((addr0 ^ prefix->as_u64[0]) & mask.as_u64[0])
+          && 0 == ((addr1 ^ prefix->as_u64[1]) & mask.as_u64[1]));
+}
+
+static_always_inline int
+dtree_rule_match (acl_main_t * am, acl_dtree_rule_t * dr, u32 * v,
+                  fa_5tuple_t * pkt_5tuple)
+{
+  int f;
+
+  for (f = 0; f < ACL_DTREE_N_FIELDS; f++)
+    if (v[f] < dr->lo[f] || v[f] > dr->hi[f])
+      return 0;
+
+  if (dr->is_l4)
+    {
+      if (PREDICT_FALSE (!pkt_5tuple->pkt.l4_valid))
+        return 0;
+      if (dr->tcp_flags_mask
+          && (!pkt_5tuple->pkt.tcp_flags_valid
+              || (pkt_5tuple->pkt.tcp_flags & dr->tcp_flags_mask) !=
+              dr->tcp_flags_value))
+        return 0;
+    }
+
+  if (PREDICT_FALSE (dr->need_addr_check))
+    {
+      acl_rule_t *r = am->acls[dr->acl_index].rules + dr->ace_index;
+      if (!dtree_match_ip6_prefix (pkt_5tuple->addr[0].as_u64[0],
+                                   pkt_5tuple->addr[0].as_u64[1], &r->src,
+                                   r->src_prefixlen)
+          || !dtree_match_ip6_prefix (pkt_5tuple->addr[1].as_u64[0],
+                                      pkt_5tuple->addr[1].as_u64[1], &r->dst,
+                                      r->dst_prefixlen))
+        return 0;
+    }
+  return 1;
+}
+
+u8
+dtree_multi_acl_match_5tuple (u32 sw_if_index, fa_5tuple_t * pkt_5tuple,
+                              int is_l2, int is_ip6, int is_input,
+                              u32 * acl_match_p, u32 * rule_match_p,
+                              u32 * trace_bitmap)
+{
+  acl_main_t *am = &acl_main;
+  acl_dtree_t **trees = is_input ? am->input_dtree_by_sw_if_index :
+    am->output_dtree_by_sw_if_index;
+  acl_dtree_t *t;
+  acl_dtree_node_t *n;
+  acl_dtree_rule_t *dr;
+  u32 v[ACL_DTREE_N_FIELDS];
+  u32 root, i, depth, *leaf_rules;
+
+  if (PREDICT_FALSE (sw_if_index >= vec_len (trees)
+                     || 0 == (t = trees[sw_if_index]) || t->is_stale
+                     || pkt_5tuple->pkt.is_nonfirst_fragment))
+    return hash_multi_acl_match_5tuple (sw_if_index, pkt_5tuple, is_l2,
+                                        is_ip6, is_input, acl_match_p,
+                                        rule_match_p, trace_bitmap);
+
+  root = t->root[is_ip6 != 0];
+  if (root == ~0)
+    /* the ACLs have no rules for the address family: deny */
+    return 0;
+
+  dtree_fill_fields (pkt_5tuple, is_ip6, v);
+  n = t->nodes + root;
+  depth = 1;
+  while (!n->is_leaf)
+    {
+      n = t->nodes + t->children[n->index +
+                                 ((v[n->field] >> n->shift) &
+                                  ((1 << n->log2_n_cuts) - 1))];
+      depth++;
+    }
+  *trace_bitmap |= 0x40000000 + ((0x3f & depth) << 24);
+
+  leaf_rules = t->leaf_rules + n->index;
+  for (i = 0; i < n->n_rules; i++)
+    {
+      dr = t->rules + leaf_rules[i];
+      if (dtree_rule_match (am, dr, v, pkt_5tuple))
+        {
+          *acl_match_p = dr->acl_index;
+          *rule_match_p = dr->ace_index;
+          return dr->action;
+        }
+    }
+  /* no rule matched: deny by default */
+  return 0;
+}
+
+static void
+show_dtree (vlib_main_t * vm, acl_dtree_t * t, u32 sw_if_index, char *dir)
+{
+  u32 counts[ACL_DTREE_N_FIELDS] = { 0 };
+  acl_dtree_node_t *n;
+  int f;
+
+  vec_foreach (n, t->nodes)
+    if (!n->is_leaf)
+      counts[n->field]++;
+
+  vlib_cli_output (vm, "sw_if_index %d %s: %s", sw_if_index, dir,
+                   t->is_stale ? "stale, rebuild pending" : "active");
+  vlib_cli_output (vm,
+                   "  rules %d nodes %d leaves %d leaf rule refs %d "
+                   "max leaf rules %d max depth %d",
+                   vec_len (t->rules), vec_len (t->nodes), t->n_leaves,
+                   vec_len (t->leaf_rules), t->max_leaf_rules, t->max_depth);
+  vlib_cli_output (vm, "  memory %d bytes, built in %.6f sec",
+                   vec_bytes (t->nodes) + vec_bytes (t->children) +
+                   vec_bytes (t->leaf_rules) + vec_bytes (t->rules),
+                   t->build_time);
+  for (f = 0; f < ACL_DTREE_N_FIELDS; f++)
+    if (counts[f])
+      vlib_cli_output (vm, "  cuts on %s: %d nodes", acl_dtree_field_name[f],
+                       counts[f]);
+}
+
+void
+show_dtree_acl (vlib_main_t * vm, acl_main_t * am, u32 sw_if_index)
+{
+  u32 swi;
+
+  vlib_cli_output (vm, "Decision tree ACL matching: %s",
+                   am->use_tree_acl_matching ? "enabled" : "disabled");
+  for (swi = 0; swi < vec_len (am->input_dtree_by_sw_if_index); swi++)
+    if ((sw_if_index == ~0 || sw_if_index == swi)
+        && am->input_dtree_by_sw_if_index[swi])
+      show_dtree (vm, am->input_dtree_by_sw_if_index[swi], swi, "input");
+  for (swi = 0; swi < vec_len (am->output_dtree_by_sw_if_index); swi++)
+    if ((sw_if_index == ~0 || sw_if_index == swi)
+        && am->output_dtree_by_sw_if_index[swi])
+      show_dtree (vm, am->output_dtree_by_sw_if_index[swi], swi, "output");
+}
@@ -0,0 +1,51 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef _ACL_DTREE_LOOKUP_H_
+#define _ACL_DTREE_LOOKUP_H_
+
+#include <stddef.h>
+#include "acl.h"
+
+/*
+ * The ACLs applied to the interface have changed: stop using its
+ * decision tree and have it rebuilt in the background.
+ */
+
+void acl_dtree_rebuild_request(acl_main_t *am, u32 sw_if_index, u8 is_input);
+
+/* Turn the decision tree matching on or off, building or freeing the trees */
+
+void acl_dtree_enable_disable(acl_main_t *am, int enable);
+
+/*
+ * Match the 5-tuple using the decision tree of the interface. While the
+ * tree is being rebuilt, and for the non-initial fragments, the hash
+ * based matching is used instead.
+ */
+
+u8
+dtree_multi_acl_match_5tuple (u32 sw_if_index, fa_5tuple_t * pkt_5tuple, int is_l2,
+                       int is_ip6, int is_input, u32 * acl_match_p,
+                       u32 * rule_match_p, u32 * trace_bitmap);
+
+/*
+ * The debug function to show the shape of the decision trees
+ */
+void show_dtree_acl(vlib_main_t * vm, acl_main_t *am, u32 sw_if_index);
+
+#endif
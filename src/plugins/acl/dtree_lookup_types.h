@@ -0,0 +1,91 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef _ACL_DTREE_LOOKUP_TYPES_H_
+#define _ACL_DTREE_LOOKUP_TYPES_H_
+
+/*
+ * The fields the decision tree cuts on. Each is at most 32 bits wide,
+ * IPv6 addresses contribute their upper 64 bits as two fields.
+ */
+#define foreach_acl_dtree_field \
+  _(SRC0, 32, "src")            \
+  _(SRC1, 32, "src-lo")         \
+  _(DST0, 32, "dst")            \
+  _(DST1, 32, "dst-lo")         \
+  _(SPORT, 16, "sport")         \
+  _(DPORT, 16, "dport")         \
+  _(PROTO, 8, "proto")
+
+typedef enum {
+#define _(f, w, s) ACL_DTREE_FIELD_##f,
+  foreach_acl_dtree_field
+#undef _
+  ACL_DTREE_N_FIELDS,
+} acl_dtree_field_t;
+
+/* A rule of the applied ACLs, as ranges of the field values */
+typedef struct {
+  u32 lo[ACL_DTREE_N_FIELDS];
+  u32 hi[ACL_DTREE_N_FIELDS];
+  /* the original ACL# and rule# within that ACL */
+  u32 acl_index;
+  u32 ace_index;
+  /* the bits not covered by the fields need checking, IPv6 only */
+  u8 need_addr_check;
+  u8 is_ip6;
+  /* the rule has a protocol, so the L4 info must be valid */
+  u8 is_l4;
+  u8 tcp_flags_mask;
+  u8 tcp_flags_value;
+  u8 action;
+} acl_dtree_rule_t;
+
+typedef struct {
+  u8 is_leaf;
+  /* inner node: the field to cut on, and how */
+  u8 field;
+  u8 shift;
+  u8 log2_n_cuts;
+  /* inner node: index into children; leaf: index into leaf_rules */
+  u32 index;
+  /* leaf: the number of rules, in priority order */
+  u32 n_rules;
+} acl_dtree_node_t;
+
+/*
+ * The decision tree compiled from the ACLs applied to an interface in
+ * a direction. Once built it is never modified, a rebuild makes a new one.
+ */
+typedef struct {
+  acl_dtree_node_t *nodes;
+  u32 *children;
+  u32 *leaf_rules;
+  acl_dtree_rule_t *rules;
+  /* root node per address family, ~0 if there are no rules */
+  u32 root[2];
+  /* set when the ACLs change, until the replacement is swapped in */
+  volatile u32 is_stale;
+
+  /* build statistics */
+  u32 max_depth;
+  u32 n_leaves;
+  u32 max_leaf_rules;
+  f64 build_time;
+} acl_dtree_t;
+
+#endif
@@ -27,6 +27,7 @@
 
 #include "fa_node.h"
 #include "hash_lookup.h"
+#include "dtree_lookup.h"
 
 typedef struct
 {
@@ -310,7 +311,10 @@ multi_acl_match_5tuple (u32 sw_if_index, fa_5tuple_t * pkt_5tuple, int is_l2,
                        u32 * rule_match_p, u32 * trace_bitmap)
 {
   acl_main_t *am = &acl_main;
-  if (am->use_hash_acl_matching) {
+  if (am->use_tree_acl_matching) {
+    return dtree_multi_acl_match_5tuple(sw_if_index, pkt_5tuple, is_l2, is_ip6,
+                                 is_input, acl_match_p, rule_match_p, trace_bitmap);
+  } else if (am->use_hash_acl_matching) {
     return hash_multi_acl_match_5tuple(sw_if_index, pkt_5tuple, is_l2, is_ip6,
                                  is_input, acl_match_p, rule_match_p, trace_bitmap);
   } else {
@@ -556,46 +560,27 @@ fa_session_get_timeout_type (acl_main_t * am, fa_session_t * sess)
 }
 
 
-static u64
-fa_session_get_shortest_timeout(acl_main_t * am)
-{
-  int timeout_type;
-  u64 timeout = ~0LL;
-  for(timeout_type = 0; timeout_type < ACL_N_TIMEOUTS; timeout_type++) {
-    if (timeout > am->session_timeout_sec[timeout_type]) {
-      timeout = am->session_timeout_sec[timeout_type];
-    }
-  }
-  return timeout;
-}
-
 /*
- * Get the timeout of the session in a list since its enqueue time.
+ * Get the idle timeout of a session.
  */
 
 static u64
-fa_session_get_list_timeout (acl_main_t * am, fa_session_t * sess)
+fa_session_get_timeout (acl_main_t * am, fa_session_t * sess)
 {
   u64 timeout = am->vlib_main->clib_time.clocks_per_second;
-  /*
-   * we have the shortest possible timeout type in all the lists
-   * (see README-multicore for the rationale)
-   */
-  timeout *= fa_session_get_shortest_timeout(am);
+  int timeout_type = fa_session_get_timeout_type (am, sess);
+  timeout *= am->session_timeout_sec[timeout_type];
   return timeout;
 }
 
 /*
- * Get the idle timeout of a session.
+ * The timer wheels of all the threads run on the CPU clock,
+ * in the seconds of the main thread.
  */
-
-static u64
-fa_session_get_timeout (acl_main_t * am, fa_session_t * sess)
+always_inline f64
+acl_fa_wheel_time (acl_main_t * am, u64 now)
 {
-  u64 timeout = am->vlib_main->clib_time.clocks_per_second;
-  int timeout_type = fa_session_get_timeout_type (am, sess);
-  timeout *= am->session_timeout_sec[timeout_type];
-  return timeout;
+  return now * am->vlib_main->clib_time.seconds_per_clock;
 }
 
 static void
@@ -622,93 +607,108 @@ static inline fa_session_t *get_session_ptr(acl_main_t *am, u16 thread_index, u3
   return sess;
 }
 
+/*
+ * Start the idle timer of the session so it fires when the session
+ * would time out if there is no more activity.
+ */
 static void
-acl_fa_conn_list_add_session (acl_main_t * am, fa_full_session_id_t sess_id, u64 now)
+acl_fa_session_timer_start (acl_main_t * am, fa_full_session_id_t sess_id, u64 now)
 {
   fa_session_t *sess = get_session_ptr(am, sess_id.thread_index, sess_id.session_index);
-  u8 list_id = fa_session_get_timeout_type(am, sess);
-  uword thread_index = os_get_thread_index ();
-  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
-  /* the retrieved session thread index must be necessarily the same as the one in the key */
-  ASSERT (sess->thread_index == sess_id.thread_index);
-  /* the retrieved session thread index must be the same as current thread */
-  ASSERT (sess->thread_index == thread_index);
-  sess->link_enqueue_time = now;
-  sess->link_list_id = list_id;
-  sess->link_next_idx = ~0;
-  sess->link_prev_idx = pw->fa_conn_list_tail[list_id];
-  if (~0 != pw->fa_conn_list_tail[list_id]) {
-    fa_session_t *prev_sess = get_session_ptr(am, thread_index, pw->fa_conn_list_tail[list_id]);
-    prev_sess->link_next_idx = sess_id.session_index;
-    /* We should never try to link with a session on another thread */
-    ASSERT(prev_sess->thread_index == sess->thread_index);
-  }
-  pw->fa_conn_list_tail[list_id] = sess_id.session_index;
-  pw->serviced_sw_if_index_bitmap = clib_bitmap_set(pw->serviced_sw_if_index_bitmap, sess->sw_if_index, 1);
-
-  if (~0 == pw->fa_conn_list_head[list_id]) {
-    pw->fa_conn_list_head[list_id] = sess_id.session_index;
-    /* If it is a first conn in any list, kick the cleaner */
-    vlib_process_signal_event (am->vlib_main, am->fa_cleaner_node_index,
-                                 ACL_FA_CLEANER_RESCHEDULE, 0);
-  }
+  acl_fa_per_worker_data_t *pw = &am->per_worker_data[sess_id.thread_index];
+  u64 timeout_time = sess->last_active_time + fa_session_get_timeout (am, sess);
+  u64 ticks = 1;
+  /* the timer must be started by the thread which owns the session */
+  ASSERT (sess->thread_index == os_get_thread_index ());
+  ASSERT (sess->timer_handle == ~0);
+  /* round up, so the timer never fires before the timeout */
+  if (timeout_time > now)
+    ticks += (timeout_time - now) * am->vlib_main->clib_time.seconds_per_clock /
+	     ACL_FA_TIMER_INTERVAL;
+  sess->timer_handle = tw_timer_start_1t_3w_1024sl_ov (&pw->timer_wheel,
+						       sess_id.session_index,
+						       0, ticks);
 }
 
-static int
-acl_fa_conn_list_delete_session (acl_main_t *am, fa_full_session_id_t sess_id)
+static void
+acl_fa_session_timer_stop (acl_main_t * am, fa_full_session_id_t sess_id)
 {
-  uword thread_index = os_get_thread_index ();
-  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
-  if (thread_index != sess_id.thread_index) {
-    /* If another thread attempts to delete the session, fail it. */
-#ifdef FA_NODE_VERBOSE_DEBUG
-    clib_warning("thread id in key %d != curr thread index, not deleting");
-#endif
-    return 0;
-  }
   fa_session_t *sess = get_session_ptr(am, sess_id.thread_index, sess_id.session_index);
-  /* we should never try to delete the session with another thread index */
-  ASSERT(sess->thread_index == thread_index);
-  if (~0 != sess->link_prev_idx) {
-    fa_session_t *prev_sess = get_session_ptr(am, thread_index, sess->link_prev_idx);
-    /* the previous session must be in the same list as this one */
-    ASSERT(prev_sess->link_list_id == sess->link_list_id);
-    prev_sess->link_next_idx = sess->link_next_idx;
-  }
-  if (~0 != sess->link_next_idx) {
-    fa_session_t *next_sess = get_session_ptr(am, thread_index, sess->link_next_idx);
-    /* The next session must be in the same list as the one we are deleting */
-    ASSERT(next_sess->link_list_id == sess->link_list_id);
-    next_sess->link_prev_idx = sess->link_prev_idx;
-  }
-  if (pw->fa_conn_list_head[sess->link_list_id] == sess_id.session_index) {
-    pw->fa_conn_list_head[sess->link_list_id] = sess->link_next_idx;
-  }
-  if (pw->fa_conn_list_tail[sess->link_list_id] == sess_id.session_index) {
-    pw->fa_conn_list_tail[sess->link_list_id] = sess->link_prev_idx;
+  acl_fa_per_worker_data_t *pw = &am->per_worker_data[sess_id.thread_index];
+  if (~0 != sess->timer_handle) {
+    tw_timer_stop_1t_3w_1024sl_ov (&pw->timer_wheel, sess->timer_handle);
+    sess->timer_handle = ~0;
   }
-  return 1;
 }
 
 static int
 acl_fa_restart_timer_for_session (acl_main_t * am, u64 now, fa_full_session_id_t sess_id)
 {
-  if (acl_fa_conn_list_delete_session(am, sess_id)) {
-    acl_fa_conn_list_add_session(am, sess_id, now);
+  if (sess_id.thread_index == os_get_thread_index ()) {
+    acl_fa_session_timer_stop(am, sess_id);
+    acl_fa_session_timer_start(am, sess_id, now);
     return 1;
   } else {
     /*
-     * Our thread does not own this connection, so we can not delete
-     * The session. To avoid the complicated signaling, we simply
-     * pick the list waiting time to be the shortest of the timeouts.
-     * This way we do not have to do anything special, and let
-     * the regular requeue check take care of everything.
+     * Our thread does not own this connection, so we can not touch
+     * its timer. When the timer fires on the owner thread, the session
+     * is checked against its current timeout and either deleted
+     * or the timer is started again for the remaining time.
      */
     return 0;
   }
 }
 
 
+/*
+ * The FIFO of the transient sessions is only touched by the owner thread.
+ */
+static void
+acl_fa_transient_list_del (acl_main_t * am, fa_full_session_id_t sess_id)
+{
+  fa_session_t *sess = get_session_ptr(am, sess_id.thread_index, sess_id.session_index);
+  acl_fa_per_worker_data_t *pw = &am->per_worker_data[sess_id.thread_index];
+  ASSERT (sess->thread_index == os_get_thread_index ());
+  if (!sess->on_transient_list)
+    return;
+  if (~0 != sess->link_prev_idx)
+    get_session_ptr(am, sess_id.thread_index, sess->link_prev_idx)->link_next_idx = sess->link_next_idx;
+  else
+    pw->transient_head_index = sess->link_next_idx;
+  if (~0 != sess->link_next_idx)
+    get_session_ptr(am, sess_id.thread_index, sess->link_next_idx)->link_prev_idx = sess->link_prev_idx;
+  else
+    pw->transient_tail_index = sess->link_prev_idx;
+  sess->on_transient_list = 0;
+}
+
+/*
+ * Put the session at the tail of the transient FIFO if it is transient
+ * and not there yet, take it off if it is not transient anymore.
+ */
+static void
+acl_fa_transient_list_sync (acl_main_t * am, fa_full_session_id_t sess_id)
+{
+  fa_session_t *sess = get_session_ptr(am, sess_id.thread_index, sess_id.session_index);
+  acl_fa_per_worker_data_t *pw = &am->per_worker_data[sess_id.thread_index];
+  ASSERT (sess->thread_index == os_get_thread_index ());
+  if (ACL_TIMEOUT_TCP_TRANSIENT != fa_session_get_timeout_type (am, sess)) {
+    acl_fa_transient_list_del (am, sess_id);
+    return;
+  }
+  if (sess->on_transient_list)
+    return;
+  sess->link_prev_idx = pw->transient_tail_index;
+  sess->link_next_idx = ~0;
+  if (~0 != pw->transient_tail_index)
+    get_session_ptr(am, sess_id.thread_index, pw->transient_tail_index)->link_next_idx = sess_id.session_index;
+  else
+    pw->transient_head_index = sess_id.session_index;
+  pw->transient_tail_index = sess_id.session_index;
+  sess->on_transient_list = 1;
+}
+
+
 static u8
 acl_fa_track_session (acl_main_t * am, int is_input, u32 sw_if_index, u64 now,
 		      fa_session_t * sess, fa_5tuple_t * pkt_5tuple)
@@ -727,12 +727,12 @@ acl_fa_delete_session (acl_main_t * am, u32 sw_if_index, fa_full_session_id_t se
 {
   fa_session_t *sess = get_session_ptr(am, sess_id.thread_index, sess_id.session_index);
   ASSERT(sess->thread_index == os_get_thread_index ());
+  acl_fa_session_timer_stop(am, sess_id);
+  acl_fa_transient_list_del(am, sess_id);
   BV (clib_bihash_add_del) (&am->fa_sessions_hash,
 			    &sess->info.kv, 0);
   acl_fa_per_worker_data_t *pw = &am->per_worker_data[sess_id.thread_index];
   pool_put_index (pw->fa_sessions_pool, sess_id.session_index);
-  /* Deleting from timer structures not needed,
-     as the caller must have dealt with the timers. */
   vec_validate (am->fa_session_dels_by_sw_if_index, sw_if_index);
   am->fa_session_dels_by_sw_if_index[sw_if_index]++;
   clib_smp_atomic_add(&am->fa_session_total_dels, 1);
@@ -746,32 +746,14 @@ acl_fa_can_add_session (acl_main_t * am, int is_input, u32 sw_if_index)
   return (curr_sess_count < am->fa_conn_table_max_entries);
 }
 
-static u64
-acl_fa_get_list_head_expiry_time(acl_main_t *am, acl_fa_per_worker_data_t *pw, u64 now, u16 thread_index, int timeout_type)
-{
-  if (~0 == pw->fa_conn_list_head[timeout_type]) {
-    return ~0LL; // infinity.
-  } else {
-    fa_session_t *sess = get_session_ptr(am, thread_index, pw->fa_conn_list_head[timeout_type]);
-    u64 timeout_time =
-              sess->link_enqueue_time + fa_session_get_list_timeout (am, sess);
-    return timeout_time;
-  }
-}
-
-static int
-acl_fa_conn_time_to_check (acl_main_t *am, acl_fa_per_worker_data_t *pw, u64 now, u16 thread_index, u32 session_index)
-{
-  fa_session_t *sess = get_session_ptr(am, thread_index, session_index);
-  u64 timeout_time =
-              sess->link_enqueue_time + fa_session_get_list_timeout (am, sess);
-  return (timeout_time < now) || (sess->link_enqueue_time <= pw->swipe_end_time);
-}
-
 /*
- * see if there are sessions ready to be checked,
- * do the maintenance (requeue or delete), and
- * return the total number of sessions reclaimed.
+ * Advance the timer wheel if there is no backlog of the expired timers,
+ * do the maintenance (restart or delete) of at most
+ * fa_max_deleted_sessions_per_interval expired sessions,
+ * and return the number of sessions processed.
+ *
+ * The wheel expires all the timers of a slot at once, so the expired
+ * session indices are kept in a per-worker backlog and processed in slices.
  */
 static int
 acl_fa_check_idle_sessions(acl_main_t *am, u16 thread_index, u64 now)
@@ -781,47 +763,62 @@ acl_fa_check_idle_sessions(acl_main_t *am, u16 thread_index, u64 now)
   fsid.thread_index = thread_index;
   int total_expired = 0;
 
-  {
-    u8 tt = 0;
-    for(tt = 0; tt < ACL_N_TIMEOUTS; tt++) {
-      while((vec_len(pw->expired) < am->fa_max_deleted_sessions_per_interval)
-	    && (~0 != pw->fa_conn_list_head[tt])
-	    && (acl_fa_conn_time_to_check(am, pw, now, thread_index,
-					  pw->fa_conn_list_head[tt]))) {
-	fsid.session_index = pw->fa_conn_list_head[tt];
-	vec_add1(pw->expired, fsid.session_index);
-	acl_fa_conn_list_delete_session(am, fsid);
-      }
+  if (0 == pool_elts (pw->fa_sessions_pool)) {
+    /* no timers running, skip over the idle time in one step */
+    pw->timer_wheel.last_run_time = acl_fa_wheel_time (am, now);
+    pw->timer_wheel.next_run_time = pw->timer_wheel.last_run_time + ACL_FA_TIMER_INTERVAL;
+    if (pw->expired)
+      _vec_len (pw->expired) = 0;
+    return 0;
+  }
+  if (0 == vec_len (pw->expired)) {
+    u32 *psid = NULL;
+    pw->timer_wheel.max_expirations = am->fa_max_deleted_sessions_per_interval;
+    pw->expired = tw_timer_expire_timers_vec_1t_3w_1024sl_ov (&pw->timer_wheel,
+							    acl_fa_wheel_time (am, now),
+							    pw->expired);
+    /* the timers are gone, so their handles can not be stopped anymore */
+    vec_foreach (psid, pw->expired)
+    {
+      if (!pool_is_free_index (pw->fa_sessions_pool, *psid))
+        get_session_ptr(am, thread_index, *psid)->timer_handle = ~0;
     }
   }
 
-  u32 *psid = NULL;
-  vec_foreach (psid, pw->expired)
+  while (vec_len (pw->expired) && (total_expired < am->fa_max_deleted_sessions_per_interval))
   {
-    fsid.session_index = *psid;
+    fsid.session_index = vec_pop (pw->expired);
+    total_expired++;
     if (!pool_is_free_index (pw->fa_sessions_pool, fsid.session_index))
       {
 	fa_session_t *sess = get_session_ptr(am, thread_index, fsid.session_index);
 	u32 sw_if_index = sess->sw_if_index;
 	u64 sess_timeout_time =
 	  sess->last_active_time + fa_session_get_timeout (am, sess);
-	if ((now < sess_timeout_time) && (0 == clib_bitmap_get(pw->pending_clear_sw_if_index_bitmap, sw_if_index)))
+	if (~0 != sess->timer_handle)
+	  {
+	    /* the index has been reused by a new session while in the backlog */
+	    pw->cnt_already_deleted_sessions++;
+	  }
+	else if ((now < sess_timeout_time) && (0 == clib_bitmap_get(pw->pending_clear_sw_if_index_bitmap, sw_if_index)))
 	  {
 #ifdef FA_NODE_VERBOSE_DEBUG
 	    clib_warning ("ACL_FA_NODE_CLEAN: Restarting timer for session %d",
-	       (int) session_index);
+	       (int) fsid.session_index);
 #endif
 	    /* There was activity on the session, so the idle timeout
-	       has not passed. Enqueue for another time period. */
+	       has not passed. Wait for the remaining time. */
 
-	    acl_fa_conn_list_add_session(am, fsid, now);
+	    acl_fa_session_timer_start(am, fsid, now);
+	    /* catch up with the class changes made by the other threads */
+	    acl_fa_transient_list_sync(am, fsid);
 	    pw->cnt_session_timer_restarted++;
 	  }
 	else
 	  {
 #ifdef FA_NODE_VERBOSE_DEBUG
 	    clib_warning ("ACL_FA_NODE_CLEAN: Deleting session %d",
-	       (int) session_index);
+	       (int) fsid.session_index);
 #endif
 	    acl_fa_delete_session (am, sw_if_index, fsid);
 	    pw->cnt_deleted_sessions++;
@@ -832,30 +829,109 @@ acl_fa_check_idle_sessions(acl_main_t *am, u16 thread_index, u64 now)
 	pw->cnt_already_deleted_sessions++;
       }
   }
-  total_expired = vec_len(pw->expired);
-  /* zero out the vector which we have acted on */
-  if (pw->expired)
-    _vec_len (pw->expired) = 0;
-  /* if we were advancing and reached the end
-   * (no more sessions to recycle), reset the fast-forward timestamp */
-
-  if (pw->swipe_end_time && 0 == total_expired)
-    pw->swipe_end_time = 0;
   return (total_expired);
 }
 
+/*
+ * Walk a slice of the session pool, deleting the sessions of the
+ * interfaces being cleared and restarting the timers of the rest if
+ * the timeouts changed. Return non-zero if there is more work to do.
+ */
+static int
+acl_fa_swipe_sessions(acl_main_t *am, u16 thread_index, u64 now)
+{
+  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
+  fa_full_session_id_t fsid;
+  u32 n_done = 0, n_visited = 0;
+
+  if (!pw->swipe_in_process) {
+    if (!pw->clear_in_process && !pw->rearm_requested)
+      return 0;
+    pw->swipe_clear = pw->clear_in_process;
+    if (pw->swipe_clear) {
+      /*
+       * first filter the sw_if_index bitmap that they want from us, by
+       * a bitmap of sw_if_index for which we actually have connections.
+       */
+      if ((pw->pending_clear_sw_if_index_bitmap == 0)
+          || (pw->serviced_sw_if_index_bitmap == 0)) {
+	clib_bitmap_zero(pw->pending_clear_sw_if_index_bitmap);
+      } else {
+        pw->pending_clear_sw_if_index_bitmap = clib_bitmap_and(pw->pending_clear_sw_if_index_bitmap,
+							      pw->serviced_sw_if_index_bitmap);
+      }
+      if (clib_bitmap_is_zero(pw->pending_clear_sw_if_index_bitmap)) {
+        /* if the cross-section is a zero vector, no need to do anything. */
+#ifdef FA_NODE_VERBOSE_DEBUG
+        clib_warning("WORKER: clearing done - nothing to do");
+#endif
+        pw->swipe_clear = 0;
+        pw->clear_in_process = 0;
+      }
+    }
+    pw->swipe_rearm = pw->rearm_requested;
+    pw->rearm_requested = 0;
+    if (!pw->swipe_clear && !pw->swipe_rearm)
+      return 0;
+    pw->swipe_cursor = 0;
+    pw->swipe_in_process = 1;
+  }
+
+  fsid.thread_index = thread_index;
+  while ((pw->swipe_cursor < vec_len(pw->fa_sessions_pool))
+         && (n_done < am->fa_max_deleted_sessions_per_interval)
+         && (n_visited < 16 * am->fa_max_deleted_sessions_per_interval)) {
+    fsid.session_index = pw->swipe_cursor++;
+    n_visited++;
+    if (pool_is_free_index (pw->fa_sessions_pool, fsid.session_index))
+      continue;
+    fa_session_t *sess = get_session_ptr(am, thread_index, fsid.session_index);
+    if (pw->swipe_clear && clib_bitmap_get(pw->pending_clear_sw_if_index_bitmap, sess->sw_if_index)) {
+      acl_fa_delete_session (am, sess->sw_if_index, fsid);
+      pw->cnt_deleted_sessions++;
+      n_done++;
+    } else if (pw->swipe_rearm) {
+      acl_fa_restart_timer_for_session (am, now, fsid);
+      n_done++;
+    }
+  }
+
+  if (pw->swipe_cursor < vec_len(pw->fa_sessions_pool))
+    return 1;
+
+  pw->swipe_in_process = 0;
+  if (pw->swipe_clear) {
+    clib_bitmap_zero(pw->pending_clear_sw_if_index_bitmap);
+    CLIB_MEMORY_BARRIER ();
+    pw->clear_in_process = 0;
+#ifdef FA_NODE_VERBOSE_DEBUG
+    clib_warning("WORKER: clearing done, all done");
+#endif
+  }
+  /* another request might have come in while swiping */
+  return (pw->clear_in_process || pw->rearm_requested);
+}
+
 always_inline void
 acl_fa_try_recycle_session (acl_main_t * am, int is_input, u16 thread_index, u32 sw_if_index)
 {
-  /* try to recycle a TCP transient session */
+  /* try to recycle the oldest TCP transient session */
   acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
-  u8 timeout_type = ACL_TIMEOUT_TCP_TRANSIENT;
   fa_full_session_id_t sess_id;
-  sess_id.session_index = pw->fa_conn_list_head[timeout_type];
-  if (~0 != sess_id.session_index) {
-    sess_id.thread_index = thread_index;
-    acl_fa_conn_list_delete_session(am, sess_id);
-    acl_fa_delete_session(am, sw_if_index, sess_id);
+
+  sess_id.thread_index = thread_index;
+  while (~0 != pw->transient_head_index) {
+    sess_id.session_index = pw->transient_head_index;
+    fa_session_t *sess = get_session_ptr(am, thread_index, sess_id.session_index);
+    if (ACL_TIMEOUT_TCP_TRANSIENT == fa_session_get_timeout_type(am, sess)) {
+      acl_fa_delete_session(am, sess->sw_if_index, sess_id);
+      return;
+    }
+    /*
+     * Established by a packet on another thread, which can not touch
+     * our FIFO. Each such session is dropped from the FIFO only once.
+     */
+    acl_fa_transient_list_del(am, sess_id);
   }
 }
 
@@ -887,9 +963,8 @@ acl_fa_add_session (acl_main_t * am, int is_input, u32 sw_if_index, u64 now,
   sess->sw_if_index = sw_if_index;
   sess->tcp_flags_seen.as_u16 = 0;
   sess->thread_index = thread_index;
-  sess->link_list_id = ~0;
-  sess->link_prev_idx = ~0;
-  sess->link_next_idx = ~0;
+  sess->timer_handle = ~0;
+  sess->on_transient_list = 0;
 
 
 
@@ -900,7 +975,15 @@ acl_fa_add_session (acl_main_t * am, int is_input, u32 sw_if_index, u64 now,
 
   BV (clib_bihash_add_del) (&am->fa_sessions_hash,
 			    &kv, 1);
-  acl_fa_conn_list_add_session(am, f_sess_id, now);
+  acl_fa_session_timer_start(am, f_sess_id, now);
+  acl_fa_transient_list_sync(am, f_sess_id);
+  pw->serviced_sw_if_index_bitmap = clib_bitmap_set(pw->serviced_sw_if_index_bitmap, sw_if_index, 1);
+
+  if (1 == pool_elts (pw->fa_sessions_pool)) {
+    /* If it is the first session of this worker, kick the cleaner */
+    vlib_process_signal_event (am->vlib_main, am->fa_cleaner_node_index,
+                                 ACL_FA_CLEANER_RESCHEDULE, 0);
+  }
 
   vec_validate (am->fa_session_adds_by_sw_if_index, sw_if_index);
   am->fa_session_adds_by_sw_if_index[sw_if_index]++;
@@ -945,6 +1028,12 @@ acl_fa_node_fn (vlib_main_t * vm,
 
   error_node = vlib_node_get_runtime (vm, acl_fa_node->index);
 
+  /* Let the busy workers advance their session timer wheel themselves */
+  if (PREDICT_FALSE (acl_fa_wheel_time (am, now) >=
+		     am->per_worker_data[thread_index].timer_wheel.next_run_time
+		     || vec_len (am->per_worker_data[thread_index].expired)))
+    acl_fa_check_idle_sessions (am, thread_index, now);
+
   while (n_left_from > 0)
     {
       u32 n_left_to_next;
@@ -1033,7 +1122,8 @@ acl_fa_node_fn (vlib_main_t * vm,
 		  /* Tracking might have changed the session timeout type, e.g. from transient to established */
 		  if (PREDICT_FALSE (old_timeout_type != new_timeout_type))
 		    {
-		      acl_fa_restart_timer_for_session (am, now, f_sess_id);
+		      if (acl_fa_restart_timer_for_session (am, now, f_sess_id))
+			acl_fa_transient_list_sync (am, f_sess_id);
 		      pkts_restart_session_timer++;
 		      trace_bitmap |=
 			0x00010000 + ((0xff & old_timeout_type) << 8) +
@@ -1259,7 +1349,8 @@ static vlib_node_registration_t acl_fa_worker_session_cleaner_process_node;
 
 /*
  * Per-worker thread interrupt-driven cleaner thread
- * to clean idle connections if there are no packets
+ * to expire idle connections and to clear the interfaces
+ * if there are no packets
  */
 static uword
 acl_fa_worker_conn_cleaner_process(vlib_main_t * vm,
@@ -1275,81 +1366,22 @@ acl_fa_worker_conn_cleaner_process(vlib_main_t * vm,
 #endif
    /* allow another interrupt to be queued */
    pw->interrupt_is_pending = 0;
-   if (pw->clear_in_process) {
-     if (0 == pw->swipe_end_time) {
-       /*
-        * Someone has just set the flag to start clearing.
-        * we do this by combing through the connections up to a "time T"
-        * which is now, and requeueing everything except the expired
-        * connections and those matching the interface(s) being cleared.
-        */
-
-       /*
-        * first filter the sw_if_index bitmap that they want from us, by
-        * a bitmap of sw_if_index for which we actually have connections.
-        */
-       if ((pw->pending_clear_sw_if_index_bitmap == 0)
-           || (pw->serviced_sw_if_index_bitmap == 0)) {
-#ifdef FA_NODE_VERBOSE_DEBUG
-         clib_warning("WORKER-CLEAR: someone tried to call clear, but one of the bitmaps are empty");
-#endif
-	 clib_bitmap_zero(pw->pending_clear_sw_if_index_bitmap);
-       } else {
+   if (acl_fa_swipe_sessions(am, thread_index, now)) {
 #ifdef FA_NODE_VERBOSE_DEBUG
-         clib_warning("WORKER-CLEAR: (before and) swiping sw-if-index bitmap: %U, my serviced bitmap %U",
-                      format_bitmap_hex, pw->pending_clear_sw_if_index_bitmap,
-                      format_bitmap_hex, pw->serviced_sw_if_index_bitmap);
+     clib_warning("WORKER-CLEAR: more work to do, raising interrupt");
 #endif
-         pw->pending_clear_sw_if_index_bitmap = clib_bitmap_and(pw->pending_clear_sw_if_index_bitmap,
-							      pw->serviced_sw_if_index_bitmap);
-       }
-
-       if (clib_bitmap_is_zero(pw->pending_clear_sw_if_index_bitmap)) {
-         /* if the cross-section is a zero vector, no need to do anything. */
-#ifdef FA_NODE_VERBOSE_DEBUG
-         clib_warning("WORKER: clearing done - nothing to do");
-#endif
-         pw->clear_in_process = 0;
-       } else {
-#ifdef FA_NODE_VERBOSE_DEBUG
-         clib_warning("WORKER-CLEAR: swiping sw-if-index bitmap: %U, my serviced bitmap %U",
-                      format_bitmap_hex, pw->pending_clear_sw_if_index_bitmap,
-                      format_bitmap_hex, pw->serviced_sw_if_index_bitmap);
-#endif
-         /* swipe through the connection lists until enqueue timestamps become above "now" */
-         pw->swipe_end_time = now;
-       }
-     }
+     pw->interrupt_is_needed = 1;
    }
    num_expired = acl_fa_check_idle_sessions(am, thread_index, now);
-   // clib_warning("WORKER-CLEAR: checked %d sessions (clear_in_progress: %d)", num_expired, pw->clear_in_process);
-   if (pw->clear_in_process) {
-     if (0 == num_expired) {
-       /* we were clearing but we could not process any more connections. time to stop. */
-       clib_bitmap_zero(pw->pending_clear_sw_if_index_bitmap);
-       pw->clear_in_process = 0;
-#ifdef FA_NODE_VERBOSE_DEBUG
-       clib_warning("WORKER: clearing done, all done");
-#endif
-     } else {
-#ifdef FA_NODE_VERBOSE_DEBUG
-       clib_warning("WORKER-CLEAR: more work to do, raising interrupt");
-#endif
-       /* should continue clearing.. So could they please sent an interrupt again? */
-       pw->interrupt_is_needed = 1;
-     }
-   } else {
-     if (num_expired >= am->fa_max_deleted_sessions_per_interval) {
-       /* there was too much work, we should get an interrupt ASAP */
-       pw->interrupt_is_needed = 1;
-     } else if (num_expired <= am->fa_min_deleted_sessions_per_interval) {
-       /* signal that they should trigger us less */
-       pw->interrupt_is_unwanted = 1;
-     } else {
-       /* the current rate of interrupts is ok */
-       pw->interrupt_is_needed = 0;
-       pw->interrupt_is_unwanted = 0;
-     }
+   if (num_expired >= am->fa_max_deleted_sessions_per_interval) {
+     /* there was too much work, we should get an interrupt ASAP */
+     pw->interrupt_is_needed = 1;
+   }
+   if (pw->interrupt_is_needed) {
+     /* continue with the next slice on the next pass of the dispatch loop */
+     pw->interrupt_is_needed = 0;
+     pw->interrupt_is_pending = 1;
+     vlib_node_set_interrupt_pending (vm, rt->node_index);
    }
    return 0;
 }
@@ -1378,59 +1410,56 @@ send_interrupts_to_workers (vlib_main_t * vm, acl_main_t *am)
   }
 }
 
+/*
+ * Interrupt only the workers which have something to do:
+ * the ones which asked for it, the ones which have a clear or
+ * a timer rearm pending, and the ones whose timer wheel is lagging
+ * behind because they do not see any traffic to advance it.
+ * Return the number of workers which still have sessions.
+ */
+static int
+send_interrupts_to_idle_workers (vlib_main_t * vm, acl_main_t *am, u64 now)
+{
+  int i;
+  int n_threads = vec_len(vlib_mains);
+  int n_busy = 0;
+  f64 wheel_now = acl_fa_wheel_time (am, now);
+  for (i = n_threads > 1 ? 1 : 0; i < n_threads; i++) {
+    if (i >= vec_len(am->per_worker_data))
+      continue;
+    acl_fa_per_worker_data_t *pw = &am->per_worker_data[i];
+    if (pool_elts(pw->fa_sessions_pool))
+      n_busy++;
+    if (pw->interrupt_is_needed || pw->rearm_requested || pw->clear_in_process
+        || vec_len(pw->expired)
+        || (pool_elts(pw->fa_sessions_pool) &&
+            (wheel_now > pw->timer_wheel.next_run_time + ACL_FA_TIMER_INTERVAL))) {
+      send_one_worker_interrupt(vm, am, i);
+    }
+  }
+  return n_busy;
+}
+
 /* centralized process to drive per-worker cleaners */
 static uword
 acl_fa_session_cleaner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
 				vlib_frame_t * f)
 {
   acl_main_t *am = &acl_main;
-  u64 now;
-  f64 cpu_cps = vm->clib_time.clocks_per_second;
-  u64 next_expire;
-  /* We should check if there are connections to clean up - at least twice a second */
-  u64 max_timer_wait_interval = cpu_cps / 2;
   uword event_type, *event_data = 0;
   acl_fa_per_worker_data_t *pw0;
+  int has_pending_conns = 0;
 
-  am->fa_current_cleaner_timer_wait_interval = max_timer_wait_interval;
   am->fa_cleaner_node_index = acl_fa_session_cleaner_process_node.index;
 
   while (1)
     {
-      now = clib_cpu_time_now ();
-      next_expire = now + am->fa_current_cleaner_timer_wait_interval;
-      int has_pending_conns = 0;
-      u16 ti;
-      u8 tt;
-
       /*
-       * walk over all per-thread list heads of different timeouts,
-       * and see if there are any connections pending.
-       * If there aren't - we do not need to wake up until the
-       * worker code signals that it has added a connection.
-       *
-       * Also, while we are at it, calculate the earliest we need to wake up.
+       * If there are no sessions on any thread, we do not need
+       * to wake up until the worker code signals that it has
+       * added a session. Otherwise check once per timer tick
+       * that the timer wheels are moving.
        */
-      for(ti = 0; ti < vec_len(vlib_mains); ti++) {
-        if (ti >= vec_len(am->per_worker_data)) {
-          continue;
-        }
-        acl_fa_per_worker_data_t *pw = &am->per_worker_data[ti];
-        for(tt = 0; tt < vec_len(pw->fa_conn_list_head); tt++) {
-          u64 head_expiry = acl_fa_get_list_head_expiry_time(am, pw, now, ti, tt);
-          if ((head_expiry < next_expire) && !pw->interrupt_is_pending) {
-#ifdef FA_NODE_VERBOSE_DEBUG
-            clib_warning("Head expiry: %lu, now: %lu, next_expire: %lu (worker: %d, tt: %d)", head_expiry, now, next_expire, ti, tt);
-#endif
-            next_expire = head_expiry;
-	  }
-          if (~0 != pw->fa_conn_list_head[tt]) {
-            has_pending_conns = 1;
-          }
-        }
-      }
-
-      /* If no pending connections then no point in timing out */
       if (!has_pending_conns)
         {
           am->fa_cleaner_cnt_wait_without_timeout++;
@@ -1439,18 +1468,9 @@ acl_fa_session_cleaner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
         }
       else
 	{
-	  f64 timeout = ((i64) next_expire - (i64) now) / cpu_cps;
-	  if (timeout <= 0)
-	    {
-	      /* skip waiting altogether */
-	      event_type = ~0;
-	    }
-	  else
-	    {
-              am->fa_cleaner_cnt_wait_with_timeout++;
-	      (void) vlib_process_wait_for_event_or_clock (vm, timeout);
-	      event_type = vlib_process_get_events (vm, &event_data);
-	    }
+          am->fa_cleaner_cnt_wait_with_timeout++;
+	  (void) vlib_process_wait_for_event_or_clock (vm, ACL_FA_TIMER_INTERVAL);
+	  event_type = vlib_process_get_events (vm, &event_data);
 	}
 
       switch (event_type)
@@ -1558,34 +1578,18 @@ acl_fa_session_cleaner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
 	  break;
 	}
 
-      send_interrupts_to_workers(vm, am);
-
       if (event_data)
 	_vec_len (event_data) = 0;
 
+      has_pending_conns = send_interrupts_to_idle_workers(vm, am, clib_cpu_time_now ());
+      am->fa_cleaner_cnt_event_cycles++;
 
-      int interrupts_needed = 0;
-      int interrupts_unwanted = 0;
-
-      vec_foreach(pw0, am->per_worker_data) {
-        if (pw0->interrupt_is_needed) {
-          interrupts_needed++;
-          /* the per-worker value is reset when sending the interrupt */
-        }
-        if (pw0->interrupt_is_unwanted) {
-          interrupts_unwanted++;
-          pw0->interrupt_is_unwanted = 0;
-        }
-      }
-      if (interrupts_needed) {
-        /* they need more interrupts, do less waiting around next time */
-        am->fa_current_cleaner_timer_wait_interval /= 2;
-      } else if (interrupts_unwanted) {
-        /* slowly increase the amount of sleep up to a limit */
-        if (am->fa_current_cleaner_timer_wait_interval < max_timer_wait_interval)
-          am->fa_current_cleaner_timer_wait_interval += cpu_cps * am->fa_cleaner_wait_time_increment;
+      /* follow the traffic mix with the order of the hash lookups */
+      if (am->use_hash_acl_matching &&
+          vlib_time_now (vm) > am->hash_lookup_next_reorder_time) {
+        hash_acl_reorder_mask_types(am);
+        am->hash_lookup_next_reorder_time = vlib_time_now (vm) + ACL_HASH_LOOKUP_REORDER_INTERVAL;
       }
-      am->fa_cleaner_cnt_event_cycles++;
     }
   /* NOT REACHED */
   return 0;
@@ -1679,6 +1683,8 @@ VLIB_REGISTER_NODE (acl_in_l2_ip6_node) =
   }
 };
 
+VLIB_NODE_FUNCTION_MULTIARCH (acl_in_l2_ip6_node, acl_in_ip6_l2_node_fn)
+
 VLIB_REGISTER_NODE (acl_in_l2_ip4_node) =
 {
   .function = acl_in_ip4_l2_node_fn,
@@ -1695,6 +1701,8 @@ VLIB_REGISTER_NODE (acl_in_l2_ip4_node) =
   }
 };
 
+VLIB_NODE_FUNCTION_MULTIARCH (acl_in_l2_ip4_node, acl_in_ip4_l2_node_fn)
+
 VLIB_REGISTER_NODE (acl_out_l2_ip6_node) =
 {
   .function = acl_out_ip6_l2_node_fn,
@@ -1711,6 +1719,8 @@ VLIB_REGISTER_NODE (acl_out_l2_ip6_node) =
   }
 };
 
+VLIB_NODE_FUNCTION_MULTIARCH (acl_out_l2_ip6_node, acl_out_ip6_l2_node_fn)
+
 VLIB_REGISTER_NODE (acl_out_l2_ip4_node) =
 {
   .function = acl_out_ip4_l2_node_fn,
@@ -1727,6 +1737,8 @@ VLIB_REGISTER_NODE (acl_out_l2_ip4_node) =
   }
 };
 
+VLIB_NODE_FUNCTION_MULTIARCH (acl_out_l2_ip4_node, acl_out_ip4_l2_node_fn)
+
 
 VLIB_REGISTER_NODE (acl_in_fa_ip6_node) =
 {
@@ -1744,6 +1756,8 @@ VLIB_REGISTER_NODE (acl_in_fa_ip6_node) =
   }
 };
 
+VLIB_NODE_FUNCTION_MULTIARCH (acl_in_fa_ip6_node, acl_in_ip6_fa_node_fn)
+
 VNET_FEATURE_INIT (acl_in_ip6_fa_feature, static) =
 {
   .arc_name = "ip6-unicast",
@@ -1767,6 +1781,8 @@ VLIB_REGISTER_NODE (acl_in_fa_ip4_node) =
   }
 };
 
+VLIB_NODE_FUNCTION_MULTIARCH (acl_in_fa_ip4_node, acl_in_ip4_fa_node_fn)
+
 VNET_FEATURE_INIT (acl_in_ip4_fa_feature, static) =
 {
   .arc_name = "ip4-unicast",
@@ -1791,6 +1807,8 @@ VLIB_REGISTER_NODE (acl_out_fa_ip6_node) =
   }
 };
 
+VLIB_NODE_FUNCTION_MULTIARCH (acl_out_fa_ip6_node, acl_out_ip6_fa_node_fn)
+
 VNET_FEATURE_INIT (acl_out_ip6_fa_feature, static) =
 {
   .arc_name = "ip6-output",
@@ -1815,6 +1833,8 @@ VLIB_REGISTER_NODE (acl_out_fa_ip4_node) =
   }
 };
 
+VLIB_NODE_FUNCTION_MULTIARCH (acl_out_fa_ip4_node, acl_out_ip4_fa_node_fn)
+
 VNET_FEATURE_INIT (acl_out_ip4_fa_feature, static) =
 {
   .arc_name = "ip4-output",
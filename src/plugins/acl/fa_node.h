@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include "bihash_40_8.h"
+#include <vppinfra/tw_timer_1t_3w_1024sl_ov.h>
 
 #define TCP_FLAG_FIN    0x01
 #define TCP_FLAG_SYN    0x02
@@ -63,12 +64,13 @@ typedef struct {
     u16 as_u16;
   } tcp_flags_seen; ;     /* +2 bytes = 62 */
   u16 thread_index;          /* +2 bytes = 64 */
-  u64 link_enqueue_time;  /* 8 byte = 8 */
-  u32 link_prev_idx;      /* +4 bytes = 12 */
-  u32 link_next_idx;      /* +4 bytes = 16 */
-  u8 link_list_id;        /* +1 bytes = 17 */
-  u8 reserved1[7];        /* +7 bytes = 24 */
-  u64 reserved2[5];       /* +5*8 bytes = 64 */
+  u32 timer_handle;       /* 4 bytes = 4 */
+  u32 link_prev_idx;      /* +4 bytes = 8 */
+  u32 link_next_idx;      /* +4 bytes = 12 */
+  u8 on_transient_list;   /* +1 byte = 13 */
+  u8 reserved1;           /* +1 byte = 14 */
+  u16 reserved2;          /* +2 bytes = 16 */
+  u64 reserved3[6];       /* +6*8 bytes = 64 */
 } fa_session_t;
 
 
@@ -106,31 +108,40 @@ CT_ASSERT_EQUAL(fa_full_session_id_size_is_64, sizeof(fa_full_session_id_t), siz
 typedef struct {
   /* The pool of sessions managed by this worker */
   fa_session_t *fa_sessions_pool;
-  /* per-worker ACL_N_TIMEOUTS of conn lists */
-  u32 *fa_conn_list_head;
-  u32 *fa_conn_list_tail;
-  /* Vector of expired connections retrieved from lists */
+  /*
+   * The idle timers of the sessions in the pool, ticking on the CPU clock.
+   * A packet hit only updates the last active time of the session,
+   * the expired timers are restarted if the session was active since.
+   */
+  tw_timer_wheel_1t_3w_1024sl_ov_t timer_wheel;
+  /* Vector of expired connections retrieved from the timer wheel */
   u32 *expired;
-  /* the earliest next expiry time */
-  u64 next_expiry_time;
-  /* if not zero, look at all the elements until their enqueue timestamp is after below one */
-  u64 requeue_until_time;
-  /* Current time between the checks */
-  u64 current_time_wait_interval;
   /* Counter of how many sessions we did delete */
   u64 cnt_deleted_sessions;
   /* Counter of already deleted sessions being deleted - should not increment unless a bug */
   u64 cnt_already_deleted_sessions;
-  /* Number of times we requeued a session to a head of the list */
+  /* Number of times the timer of a still active session was restarted */
   u64 cnt_session_timer_restarted;
-  /* swipe up to this enqueue time, rather than following the timeouts */
-  u64 swipe_end_time;
   /* bitmap of sw_if_index serviced by this worker */
   uword *serviced_sw_if_index_bitmap;
   /* bitmap of sw_if_indices to clear. set by main thread, cleared by worker */
   uword *pending_clear_sw_if_index_bitmap;
   /* atomic, indicates that the swipe-deletion of connections is in progress */
   u32 clear_in_process;
+  /* set by main thread when the timeouts change, all timers get restarted */
+  u32 rearm_requested;
+  /* the swipe through the session pool, for clearing and rearming */
+  u32 swipe_in_process;
+  u32 swipe_cursor;
+  u8 swipe_clear;
+  u8 swipe_rearm;
+  /*
+   * FIFO of the TCP transient sessions owned by this worker, oldest at
+   * the head, linked through the sessions. The head is recycled when
+   * the session table is full.
+   */
+  u32 transient_head_index;
+  u32 transient_tail_index;
   /* Interrupt is pending from main thread */
   int interrupt_is_pending;
   /*
@@ -139,13 +150,11 @@ typedef struct {
    * core for too long.
    */
   int interrupt_is_needed;
-  /*
-   * Set to indicate that the interrupt node wants to get less interrupts
-   * because there is not enough work for the current rate.
-   */
-  int interrupt_is_unwanted;
 } acl_fa_per_worker_data_t;
 
+/* The tick of the session timer wheels, in seconds */
+#define ACL_FA_TIMER_INTERVAL 0.1
+
 
 typedef enum {
   ACL_FA_ERROR_DROP,
@@ -32,6 +32,7 @@
 
 #include "hash_lookup.h"
 #include "hash_lookup_private.h"
+#include "dtree_lookup.h"
 
 /*
  * This returns true if there is indeed a match on the portranges.
@@ -55,97 +56,120 @@ match_portranges(acl_main_t *am, fa_5tuple_t *match, u32 index)
            ((r->dst_port_or_code_first <= match->l4.port[1]) && r->dst_port_or_code_last >= match->l4.port[1]) );
 }
 
+/*
+ * The number of mask types whose keys are built and looked up together.
+ * The bihash lookups within a batch overlap their cache misses, while the
+ * check for an early exit happens between the batches.
+ */
+#define ACL_HASH_LOOKUP_MASK_BATCH 4
+
 static u32
 multi_acl_match_get_applied_ace_index(acl_main_t *am, fa_5tuple_t *match)
 {
-  clib_bihash_kv_48_8_t kv;
-  clib_bihash_kv_48_8_t result;
-  fa_5tuple_t *kv_key = (fa_5tuple_t *)kv.key;
-  hash_acl_lookup_value_t *result_val = (hash_acl_lookup_value_t *)&result.value;
-  u64 *pmatch = (u64 *)match;
-  u64 *pmask;
-  u64 *pkey;
-  int mask_type_index;
+  clib_bihash_kv_48_8_t kv[ACL_HASH_LOOKUP_MASK_BATCH];
+  int res[ACL_HASH_LOOKUP_MASK_BATCH];
+  hash_acl_lookup_value_t *result_val;
+  applied_hash_mask_info_t *minfo;
+  applied_hash_mask_info_t *curr_match_minfo = 0;
   u32 curr_match_index = ~0;
+  u8 curr_match_shadowed = 1;
+  int i, j, n, n_masks;
 
   u32 sw_if_index = match->pkt.sw_if_index;
   u8 is_input = match->pkt.is_input;
+  u32 thread_index = os_get_thread_index ();
   applied_hash_ace_entry_t **applied_hash_aces = is_input ? &am->input_hash_entry_vec_by_sw_if_index[sw_if_index] :
                                                     &am->output_hash_entry_vec_by_sw_if_index[sw_if_index];
   applied_hash_acl_info_t **applied_hash_acls = is_input ? &am->input_applied_hash_acl_info_by_sw_if_index :
                                                     &am->output_applied_hash_acl_info_by_sw_if_index;
+#ifdef CLIB_HAVE_VEC128
+  u64x2 m0 = u64x2_load_unaligned ((u64x2 *)match + 0);
+  u64x2 m1 = u64x2_load_unaligned ((u64x2 *)match + 1);
+  u64x2 m2 = u64x2_load_unaligned ((u64x2 *)match + 2);
+#endif
 
   DBG("TRYING TO MATCH: %016llx %016llx %016llx %016llx %016llx %016llx",
-	       pmatch[0], pmatch[1], pmatch[2], pmatch[3], pmatch[4], pmatch[5]);
+	       ((u64 *)match)[0], ((u64 *)match)[1], ((u64 *)match)[2],
+	       ((u64 *)match)[3], ((u64 *)match)[4], ((u64 *)match)[5]);
 
-  for(mask_type_index=0; mask_type_index < pool_len(am->ace_mask_type_pool); mask_type_index++) {
-    if (!clib_bitmap_get((*applied_hash_acls)[sw_if_index].mask_type_index_bitmap, mask_type_index)) {
-      /* This bit is not set. Avoid trying to match */
-      continue;
+  minfo = (*applied_hash_acls)[sw_if_index].mask_info_vec;
+  n_masks = vec_len(minfo);
+
+  for(i = 0; i < n_masks; i += n) {
+    if (curr_match_index < minfo[i].min_applied_entry_index) {
+      /* no entry with the remaining mask types is in front of the candidate */
+      break;
     }
-    ace_mask_type_entry_t *mte = &am->ace_mask_type_pool[mask_type_index];
-    pmatch = (u64 *)match;
-    pmask = (u64 *)&mte->mask;
-    pkey = (u64 *)kv.key;
-    /*
-    * unrolling the below loop results in a noticeable performance increase.
-    int i;
-    for(i=0; i<6; i++) {
-      kv.key[i] = pmatch[i] & pmask[i];
+    n = clib_min(ACL_HASH_LOOKUP_MASK_BATCH, n_masks - i);
+
+    /* Make the keys: the 5-tuple masked with each of the mask types */
+    for(j = 0; j < n; j++) {
+      u32 mask_type_index = minfo[i+j].mask_type_index;
+      ace_mask_type_entry_t *mte = &am->ace_mask_type_pool[mask_type_index];
+      fa_5tuple_t *kv_key = (fa_5tuple_t *)kv[j].key;
+#ifdef CLIB_HAVE_VEC128
+      u64x2 *pmask = (u64x2 *)&mte->mask;
+      u64x2_store_unaligned (m0 & u64x2_load_unaligned (pmask + 0), (u64x2 *)kv[j].key + 0);
+      u64x2_store_unaligned (m1 & u64x2_load_unaligned (pmask + 1), (u64x2 *)kv[j].key + 1);
+      u64x2_store_unaligned (m2 & u64x2_load_unaligned (pmask + 2), (u64x2 *)kv[j].key + 2);
+#else
+      u64 *pmatch = (u64 *)match;
+      u64 *pmask = (u64 *)&mte->mask;
+      u64 *pkey = (u64 *)kv[j].key;
+
+      *pkey++ = *pmatch++ & *pmask++;
+      *pkey++ = *pmatch++ & *pmask++;
+      *pkey++ = *pmatch++ & *pmask++;
+      *pkey++ = *pmatch++ & *pmask++;
+      *pkey++ = *pmatch++ & *pmask++;
+      *pkey++ = *pmatch++ & *pmask++;
+#endif
+      kv_key->pkt.mask_type_index_lsb = mask_type_index;
+      DBG("        KEY %3d: %016llx %016llx %016llx %016llx %016llx %016llx", mask_type_index,
+		kv[j].key[0], kv[j].key[1], kv[j].key[2], kv[j].key[3], kv[j].key[4], kv[j].key[5]);
     }
-    */
-
-    *pkey++ = *pmatch++ & *pmask++;
-    *pkey++ = *pmatch++ & *pmask++;
-    *pkey++ = *pmatch++ & *pmask++;
-    *pkey++ = *pmatch++ & *pmask++;
-    *pkey++ = *pmatch++ & *pmask++;
-    *pkey++ = *pmatch++ & *pmask++;
-
-    kv_key->pkt.mask_type_index_lsb = mask_type_index;
-    DBG("        KEY %3d: %016llx %016llx %016llx %016llx %016llx %016llx", mask_type_index,
-		kv.key[0], kv.key[1], kv.key[2], kv.key[3], kv.key[4], kv.key[5]);
-    int res = BV (clib_bihash_search) (&am->acl_lookup_hash, &kv, &result);
-    if (res == 0) {
+
+    BV (clib_bihash_search_inline_batch) (&am->acl_lookup_hash, kv, n, res);
+
+    for(j = 0; j < n; j++) {
+      if (res[j] != 0)
+        continue;
+      result_val = (hash_acl_lookup_value_t *)&kv[j].value;
       DBG("ACL-MATCH! result_val: %016llx", result_val->as_u64);
-      if (result_val->applied_entry_index < curr_match_index) {
-	if (PREDICT_FALSE(result_val->need_portrange_check)) {
-          /*
-           * This is going to be slow, since we can have multiple superset
-           * entries for narrow-ish portranges, e.g.:
-           * 0..42 100..400, 230..60000,
-           * so we need to walk linearly and check if they match.
-           */
-
-          u32 curr_index = result_val->applied_entry_index;
-          while ((curr_index != ~0) && !match_portranges(am, match, curr_index)) {
-            /* while no match and there are more entries, walk... */
-            applied_hash_ace_entry_t *pae = &((*applied_hash_aces)[curr_index]);
-            DBG("entry %d did not portmatch, advancing to %d", curr_index, pae->next_applied_entry_index);
-            curr_index = pae->next_applied_entry_index;
-          }
-          if (curr_index < curr_match_index) {
-            DBG("The index %d is the new candidate in portrange matches.", curr_index);
-            curr_match_index = result_val->applied_entry_index;
-	    if (!result_val->shadowed) {
-              /* new result is known to not be shadowed, so no point to look up further */
-              break;
-	    }
-          } else {
-            DBG("Curr portmatch index %d is too big vs. current matched one %d", curr_index, curr_match_index);
-          }
-        } else {
-          /* The usual path is here. Found an entry in front of the current candiate - so it's a new one */
-          DBG("This match is the new candidate");
-          curr_match_index = result_val->applied_entry_index;
-	  if (!result_val->shadowed) {
-          /* new result is known to not be shadowed, so no point to look up further */
-            break;
-	  }
+      if (result_val->applied_entry_index >= curr_match_index)
+        continue;
+
+      u32 curr_index = result_val->applied_entry_index;
+      if (PREDICT_FALSE(result_val->need_portrange_check)) {
+        /*
+         * This is going to be slow, since we can have multiple superset
+         * entries for narrow-ish portranges, e.g.:
+         * 0..42 100..400, 230..60000,
+         * so we need to walk linearly and check if they match.
+         */
+        while ((curr_index != ~0) && !match_portranges(am, match, curr_index)) {
+          /* while no match and there are more entries, walk... */
+          applied_hash_ace_entry_t *pae = &((*applied_hash_aces)[curr_index]);
+          DBG("entry %d did not portmatch, advancing to %d", curr_index, pae->next_applied_entry_index);
+          curr_index = pae->next_applied_entry_index;
         }
       }
+      if (curr_index < curr_match_index) {
+        /* Found an entry in front of the current candidate - so it's a new one */
+        DBG("The index %d is the new candidate", curr_index);
+        curr_match_index = curr_index;
+        curr_match_minfo = &minfo[i+j];
+        curr_match_shadowed = result_val->shadowed;
+      }
+    }
+    if (!curr_match_shadowed) {
+      /* the result is known to not be shadowed, so no point to look up further */
+      break;
     }
   }
+  if (curr_match_minfo) {
+    (*applied_hash_acls)[sw_if_index].hits_by_thread[thread_index][curr_match_minfo->mask_type_index]++;
+  }
   DBG("MATCH-RESULT: %d", curr_match_index);
   return curr_match_index;
 }
@@ -254,6 +278,107 @@ applied_hash_entries_analyze(acl_main_t *am, applied_hash_ace_entry_t **applied_
    */
 }
 
+static int
+mask_info_compare(void *a1, void *a2)
+{
+  applied_hash_mask_info_t *m1 = a1;
+  applied_hash_mask_info_t *m2 = a2;
+
+  if (m1->hits != m2->hits)
+    return (m1->hits < m2->hits) ? 1 : -1;
+  return (int)m1->first_applied_entry_index - (int)m2->first_applied_entry_index;
+}
+
+static void
+mask_info_vec_sort(applied_hash_mask_info_t *minfo)
+{
+  u32 min_index = ~0;
+  int i;
+
+  vec_sort_with_function(minfo, mask_info_compare);
+  /* fill in the lowest entry index reachable from each point in the order */
+  for(i = vec_len(minfo) - 1; i >= 0; i--) {
+    min_index = clib_min(min_index, minfo[i].first_applied_entry_index);
+    minfo[i].min_applied_entry_index = min_index;
+  }
+}
+
+static u64
+mask_type_hits_sum(applied_hash_acl_info_t *pal, u32 mask_type_index)
+{
+  u64 sum = 0;
+  int t;
+  for(t = 0; t < vec_len(pal->hits_by_thread); t++) {
+    sum += pal->hits_by_thread[t][mask_type_index];
+  }
+  return sum;
+}
+
+/*
+ * Rebuild the vector of the mask types to look up on this sw_if_index
+ * from the mask type bitmap and the applied entries, keeping the hit
+ * counts of the mask types which remain in use.
+ */
+static void
+hash_acl_build_applied_mask_info(acl_main_t *am, u32 sw_if_index, u8 is_input)
+{
+  applied_hash_ace_entry_t **applied_hash_aces = is_input ? &am->input_hash_entry_vec_by_sw_if_index[sw_if_index] :
+                                                    &am->output_hash_entry_vec_by_sw_if_index[sw_if_index];
+  applied_hash_acl_info_t **applied_hash_acls = is_input ? &am->input_applied_hash_acl_info_by_sw_if_index :
+                                                    &am->output_applied_hash_acl_info_by_sw_if_index;
+  applied_hash_acl_info_t *pal = &(*applied_hash_acls)[sw_if_index];
+  applied_hash_mask_info_t *old_minfo = pal->mask_info_vec;
+  applied_hash_mask_info_t *new_minfo = 0;
+  applied_hash_mask_info_t *m;
+  u32 *first_index_by_mask_type = 0;
+  u32 mask_type_index;
+  int i;
+
+  /* the lookups count the hits on the thread they run on */
+  vec_validate(pal->hits_by_thread, vlib_get_thread_main()->n_vlib_mains - 1);
+  for(i = 0; i < vec_len(pal->hits_by_thread); i++) {
+    vec_validate_aligned(pal->hits_by_thread[i], pool_len(am->ace_mask_type_pool),
+                         CLIB_CACHE_LINE_BYTES);
+  }
+
+  vec_validate_init_empty(first_index_by_mask_type, pool_len(am->ace_mask_type_pool), ~0);
+  for(i = 0; i < vec_len(*applied_hash_aces); i++) {
+    applied_hash_ace_entry_t *pae = &((*applied_hash_aces)[i]);
+    hash_acl_info_t *ha = &am->hash_acl_infos[pae->acl_index];
+    mask_type_index = ha->rules[pae->hash_ace_info_index].mask_type_index;
+    if (first_index_by_mask_type[mask_type_index] == ~0)
+      first_index_by_mask_type[mask_type_index] = i;
+  }
+
+  /* *INDENT-OFF* */
+  clib_bitmap_foreach(mask_type_index, pal->mask_type_index_bitmap,
+  ({
+    vec_add2(new_minfo, m, 1);
+    memset(m, 0, sizeof(*m));
+    m->mask_type_index = mask_type_index;
+    m->first_applied_entry_index = first_index_by_mask_type[mask_type_index];
+  }));
+  /* *INDENT-ON* */
+
+  vec_foreach(m, new_minfo) {
+    applied_hash_mask_info_t *old_m;
+    /* a mask type new to this sw_if_index starts from the current counts */
+    m->hits_merged = mask_type_hits_sum(pal, m->mask_type_index);
+    vec_foreach(old_m, old_minfo) {
+      if (old_m->mask_type_index == m->mask_type_index) {
+        m->hits = old_m->hits;
+        m->hits_merged = old_m->hits_merged;
+        break;
+      }
+    }
+  }
+  mask_info_vec_sort(new_minfo);
+
+  pal->mask_info_vec = new_minfo;
+  vec_free(old_minfo);
+  vec_free(first_index_by_mask_type);
+}
+
 void
 hash_acl_apply(acl_main_t *am, u32 sw_if_index, u8 is_input, int acl_index)
 {
@@ -317,6 +442,8 @@ hash_acl_apply(acl_main_t *am, u32 sw_if_index, u8 is_input, int acl_index)
     activate_applied_ace_hash_entry(am, sw_if_index, is_input, applied_hash_aces, new_index);
   }
   applied_hash_entries_analyze(am, applied_hash_aces);
+  hash_acl_build_applied_mask_info(am, sw_if_index, is_input);
+  acl_dtree_rebuild_request(am, sw_if_index, is_input);
 }
 
 static void
@@ -468,6 +595,8 @@ hash_acl_unapply(acl_main_t *am, u32 sw_if_index, u8 is_input, int acl_index)
 
   /* After deletion we might not need some of the mask-types anymore... */
   hash_acl_build_applied_lookup_bitmap(am, sw_if_index, is_input);
+  hash_acl_build_applied_mask_info(am, sw_if_index, is_input);
+  acl_dtree_rebuild_request(am, sw_if_index, is_input);
 }
 
 /*
@@ -755,6 +884,78 @@ hash_multi_acl_match_5tuple (u32 sw_if_index, fa_5tuple_t * pkt_5tuple, int is_l
 }
 
 
+static void
+mask_info_vec_merge_hits(applied_hash_acl_info_t *pal)
+{
+  applied_hash_mask_info_t *m;
+  u64 sum;
+  vec_foreach(m, pal->mask_info_vec) {
+    sum = mask_type_hits_sum(pal, m->mask_type_index);
+    m->hits += sum - m->hits_merged;
+    m->hits_merged = sum;
+  }
+}
+
+static int
+mask_info_vec_needs_sort(applied_hash_mask_info_t *minfo)
+{
+  int i;
+  for(i = 1; i < vec_len(minfo); i++) {
+    /* require a clear lead, so that near-equal counts do not flap */
+    if (minfo[i].hits > 2 * minfo[i-1].hits + 16)
+      return 1;
+  }
+  return 0;
+}
+
+static void
+mask_info_vec_age(applied_hash_mask_info_t *minfo)
+{
+  applied_hash_mask_info_t *m;
+  vec_foreach(m, minfo) {
+    m->hits >>= 1;
+  }
+}
+
+void
+hash_acl_reorder_mask_types(acl_main_t *am)
+{
+  vlib_main_t *vm = am->vlib_main;
+  applied_hash_acl_info_t *pal;
+  int need_sort = 0;
+
+  vec_foreach(pal, am->input_applied_hash_acl_info_by_sw_if_index) {
+    mask_info_vec_merge_hits(pal);
+    need_sort |= mask_info_vec_needs_sort(pal->mask_info_vec);
+  }
+  vec_foreach(pal, am->output_applied_hash_acl_info_by_sw_if_index) {
+    mask_info_vec_merge_hits(pal);
+    need_sort |= mask_info_vec_needs_sort(pal->mask_info_vec);
+  }
+
+  if (need_sort) {
+    /* the workers walk these vectors, so keep them out while sorting */
+    vlib_worker_thread_barrier_sync(vm);
+    vec_foreach(pal, am->input_applied_hash_acl_info_by_sw_if_index) {
+      if (mask_info_vec_needs_sort(pal->mask_info_vec))
+        mask_info_vec_sort(pal->mask_info_vec);
+    }
+    vec_foreach(pal, am->output_applied_hash_acl_info_by_sw_if_index) {
+      if (mask_info_vec_needs_sort(pal->mask_info_vec))
+        mask_info_vec_sort(pal->mask_info_vec);
+    }
+    vlib_worker_thread_barrier_release(vm);
+  }
+
+  /* let the old hits fade, so the order follows the traffic mix */
+  vec_foreach(pal, am->input_applied_hash_acl_info_by_sw_if_index) {
+    mask_info_vec_age(pal->mask_info_vec);
+  }
+  vec_foreach(pal, am->output_applied_hash_acl_info_by_sw_if_index) {
+    mask_info_vec_age(pal->mask_info_vec);
+  }
+}
+
 void
 show_hash_acl_hash (vlib_main_t * vm, acl_main_t *am, u32 verbose)
 {
@@ -52,6 +52,12 @@ hash_multi_acl_match_5tuple (u32 sw_if_index, fa_5tuple_t * pkt_5tuple, int is_l
                        u32 * rule_match_p, u32 * trace_bitmap);
 
 
+/*
+ * Re-sort the per-interface lookup order of the mask types by hit count,
+ * if it has drifted. Called periodically from the main thread.
+ */
+void hash_acl_reorder_mask_types(acl_main_t *am);
+
 /*
  * The debug function to show the contents of the ACL lookup hash
  */
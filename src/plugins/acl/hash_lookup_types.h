@@ -67,12 +67,46 @@ typedef struct {
   u8 action;
 } applied_hash_ace_entry_t;
 
+/*
+ * One of the mask types looked up for a given interface and direction.
+ */
+typedef struct {
+  u32 mask_type_index;
+  /* the lowest applied entry index with this mask type */
+  u32 first_applied_entry_index;
+  /*
+   * the lowest applied entry index with this or any of the mask types
+   * after it in the lookup order: once the current candidate is lower
+   * than that, the remaining lookups can not produce a better match.
+   */
+  u32 min_applied_entry_index;
+  u32 reserved;
+  /*
+   * the number of lookups won by an entry with this mask type, merged
+   * from the per thread counters and aged by the main thread.
+   */
+  u64 hits;
+  /* the sum of the per thread counters at the last merge */
+  u64 hits_merged;
+} applied_hash_mask_info_t;
+
 typedef struct {
    /*
     * A logical OR of all the applied_ace_hash_entry_t=>
     *                            hash_ace_info_t=>mask_type_index bits set
     */
    uword *mask_type_index_bitmap;
+   /*
+    * The same mask types, in the order they are looked up in:
+    * descending number of hits, then ascending first applied entry index.
+    */
+   applied_hash_mask_info_t *mask_info_vec;
+   /*
+    * The number of lookups won by each mask type, by thread and mask
+    * type index. Each thread only increments its own counters, the
+    * vectors are sized on the main thread.
+    */
+   u64 **hits_by_thread;
 } applied_hash_acl_info_t;
 
 
@@ -121,6 +121,8 @@ del_free_list (vlib_main_t * vm, vlib_buffer_free_list_t * f)
 
   vec_free (f->name);
   vec_free (f->buffers);
+  /* unused, the mempools are the shared level */
+  clib_mem_free (f->global_pool);
 }
 
 /* Add buffer free list. */
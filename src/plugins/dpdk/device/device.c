@@ -19,6 +19,8 @@
 #include <assert.h>
 
 #include <vnet/ethernet/ethernet.h>
+#include <vnet/ip/ip.h>
+#include <vnet/tcp/tcp_packet.h>
 #include <dpdk/device/dpdk.h>
 
 #include <dpdk/device/dpdk_priv.h>
@@ -177,6 +179,47 @@ dpdk_validate_rte_mbuf (vlib_main_t * vm, vlib_buffer_t * b,
     }
 }
 
+/*
+ * Have the NIC segment a GSO packet. It computes the checksums, the tcp
+ * one starting from the pseudo header sum, without the length.
+ */
+static_always_inline void
+dpdk_buffer_tx_gso (vlib_buffer_t * b, struct rte_mbuf *mb)
+{
+  vnet_buffer_opaque2_t *o2 = vnet_buffer2 (b);
+  ip4_header_t *ip4 = (ip4_header_t *) (b->data + o2->gso.l3_hdr_offset);
+  tcp_header_t *th = (tcp_header_t *) (b->data + o2->gso.l4_hdr_offset);
+  ip6_header_t *ip6;
+  ip_csum_t sum;
+  int i;
+
+  mb->l2_len = o2->gso.l3_hdr_offset - b->current_data;
+  mb->l3_len = o2->gso.l4_hdr_offset - o2->gso.l3_hdr_offset;
+  mb->l4_len = tcp_header_bytes (th);
+  mb->tso_segsz = o2->gso.gso_size;
+  mb->ol_flags |= PKT_TX_TCP_SEG;
+
+  sum = clib_host_to_net_u16 (IP_PROTOCOL_TCP);
+  if ((ip4->ip_version_and_header_length & 0xF0) == 0x40)
+    {
+      mb->ol_flags |= PKT_TX_IPV4 | PKT_TX_IP_CKSUM;
+      ip4->checksum = 0;
+      sum = ip_csum_with_carry (sum, ip4->src_address.as_u32);
+      sum = ip_csum_with_carry (sum, ip4->dst_address.as_u32);
+    }
+  else
+    {
+      ip6 = (ip6_header_t *) ip4;
+      mb->ol_flags |= PKT_TX_IPV6;
+      for (i = 0; i < ARRAY_LEN (ip6->src_address.as_u32); i++)
+	{
+	  sum = ip_csum_with_carry (sum, ip6->src_address.as_u32[i]);
+	  sum = ip_csum_with_carry (sum, ip6->dst_address.as_u32[i]);
+	}
+    }
+  th->checksum = ip_csum_fold (sum);
+}
+
 /*
  * This function calls the dpdk's tx_burst function to transmit the packets
  * on the tx_vector. It manages a lock per-device if the device does not
@@ -455,6 +498,18 @@ dpdk_interface_tx (vlib_main_t * vm,
       mb2 = rte_mbuf_from_vlib_buffer (b2);
       mb3 = rte_mbuf_from_vlib_buffer (b3);
 
+      if (PREDICT_FALSE (or_flags & VNET_BUFFER_GSO))
+	{
+	  if (b0->flags & VNET_BUFFER_GSO)
+	    dpdk_buffer_tx_gso (b0, mb0);
+	  if (b1->flags & VNET_BUFFER_GSO)
+	    dpdk_buffer_tx_gso (b1, mb1);
+	  if (b2->flags & VNET_BUFFER_GSO)
+	    dpdk_buffer_tx_gso (b2, mb2);
+	  if (b3->flags & VNET_BUFFER_GSO)
+	    dpdk_buffer_tx_gso (b3, mb3);
+	}
+
       if (PREDICT_FALSE (or_flags & VLIB_BUFFER_RECYCLE))
 	{
 	  dpdk_buffer_recycle (vm, node, b0, bi0, &mb0);
@@ -521,6 +576,8 @@ dpdk_interface_tx (vlib_main_t * vm,
       dpdk_validate_rte_mbuf (vm, b0, 1);
 
       mb0 = rte_mbuf_from_vlib_buffer (b0);
+      if (PREDICT_FALSE (b0->flags & VNET_BUFFER_GSO))
+	dpdk_buffer_tx_gso (b0, mb0);
       dpdk_buffer_recycle (vm, node, b0, bi0, &mb0);
 
       if (PREDICT_FALSE (node->flags & VLIB_NODE_FLAG_TRACE))
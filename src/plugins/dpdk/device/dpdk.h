@@ -282,6 +282,7 @@ typedef struct
 #define DPDK_DEVICE_VLAN_STRIP_DEFAULT 0
 #define DPDK_DEVICE_VLAN_STRIP_OFF 1
 #define DPDK_DEVICE_VLAN_STRIP_ON  2
+  u8 tso;
 
 #define _(x) uword x;
     foreach_dpdk_device_config_item
@@ -574,6 +574,23 @@ dpdk_lib_init (dpdk_main_t * dm)
 
       hi = vnet_get_hw_interface (dm->vnet_main, xd->hw_if_index);
 
+      /* Segment the GSO packets of the tcp stack in the NIC. They are
+       * chained, and need the tcp and ip4 checksum offloads */
+      if (devconf->tso)
+	{
+	  u32 tso_capa = DEV_TX_OFFLOAD_TCP_TSO | DEV_TX_OFFLOAD_TCP_CKSUM
+	    | DEV_TX_OFFLOAD_IPV4_CKSUM;
+
+	  if ((dev_info.tx_offload_capa & tso_capa) == tso_capa
+	      && !(xd->tx_conf.txq_flags & ETH_TXQ_FLAGS_NOMULTSEGS))
+	    {
+	      xd->tx_conf.txq_flags &= ~ETH_TXQ_FLAGS_NOXSUMTCP;
+	      hi->flags |= VNET_HW_INTERFACE_FLAG_SUPPORTS_GSO;
+	    }
+	  else
+	    clib_warning ("TSO not supported by interface %v", hi->name);
+	}
+
       dpdk_device_setup (xd);
 
       if (vec_len (xd->errors))
@@ -766,6 +783,10 @@ dpdk_device_config (dpdk_config_main_t * conf, vlib_pci_addr_t pci_addr,
 	devconf->vlan_strip_offload = DPDK_DEVICE_VLAN_STRIP_OFF;
       else if (unformat (input, "vlan-strip-offload on"))
 	devconf->vlan_strip_offload = DPDK_DEVICE_VLAN_STRIP_ON;
+      else if (unformat (input, "tso on"))
+	devconf->tso = 1;
+      else if (unformat (input, "tso off"))
+	devconf->tso = 0;
       else
 	if (unformat
 	    (input, "hqos %U", unformat_vlib_cli_sub_input, &sub_input))
@@ -115,6 +115,7 @@ typedef enum {
   SNAT_IN2OUT_NEXT_DROP,
   SNAT_IN2OUT_NEXT_ICMP_ERROR,
   SNAT_IN2OUT_NEXT_SLOW_PATH,
+  SNAT_IN2OUT_NEXT_OWNER_HANDOFF,
   SNAT_IN2OUT_N_NEXT,
 } snat_in2out_next_t;
 
@@ -191,7 +192,8 @@ snat_not_translate (snat_main_t * sm, vlib_node_runtime_t *node,
 
   /* NAT packet aimed at external address if */
   /* has active sessions */
-  if (clib_bihash_search_8_8 (&sm->out2in, &kv0, &value0))
+  if (clib_bihash_search_8_8 (snat_out2in_table_for_port (sm, key0.port),
+                              &kv0, &value0))
     {
       /* or is static mappings */
       if (!snat_static_mapping_match(sm, key0, &sm0, 1, 0))
@@ -236,13 +238,22 @@ static u32 slow_path (snat_main_t *sm, vlib_buffer_t *b0,
     }
   outside_fib_index = p[0];
 
+  /* With per-worker tables, out2in traffic of a static mapping goes to
+     the owner of its outside port, so must its sessions */
+  if (PREDICT_FALSE (sm->per_worker_tables && sm->num_workers > 1)
+      && !snat_static_mapping_match (sm, *key0, &key1, 0, 0)
+      && snat_port_owner_thread (sm, clib_net_to_host_u16 (key1.port))
+         != thread_index)
+    return SNAT_IN2OUT_NEXT_OWNER_HANDOFF;
+
   key1.protocol = key0->protocol;
   user_key.addr = ip0->src_address;
   user_key.fib_index = rx_fib_index0;
   kv0.key = user_key.as_u64;
   
   /* Ever heard of the "user" = src ip4 address before? */
-  if (clib_bihash_search_8_8 (&sm->user_hash, &kv0, &value0))
+  if (clib_bihash_search_8_8 (snat_user_hash (sm, thread_index), &kv0,
+                              &value0))
     {
       /* no, make a new one */
       pool_get (sm->per_thread_data[thread_index].users, u);
@@ -261,7 +272,8 @@ static u32 slow_path (snat_main_t *sm, vlib_buffer_t *b0,
       kv0.value = u - sm->per_thread_data[thread_index].users;
 
       /* add user */
-      clib_bihash_add_del_8_8 (&sm->user_hash, &kv0, 1 /* is_add */);
+      clib_bihash_add_del_8_8 (snat_user_hash (sm, thread_index), &kv0,
+                               1 /* is_add */);
     }
   else
     {
@@ -299,10 +311,12 @@ static u32 slow_path (snat_main_t *sm, vlib_buffer_t *b0,
 
       /* Remove in2out, out2in keys */
       kv0.key = s->in2out.as_u64;
-      if (clib_bihash_add_del_8_8 (&sm->in2out, &kv0, 0 /* is_add */))
+      if (clib_bihash_add_del_8_8 (snat_in2out_table (sm, thread_index),
+                                   &kv0, 0 /* is_add */))
           clib_warning ("in2out key delete failed");
       kv0.key = s->out2in.as_u64;
-      if (clib_bihash_add_del_8_8 (&sm->out2in, &kv0, 0 /* is_add */))
+      if (clib_bihash_add_del_8_8 (snat_out2in_table (sm, thread_index),
+                                   &kv0, 0 /* is_add */))
           clib_warning ("out2in key delete failed");
 
       /* log NAT event */
@@ -314,10 +328,11 @@ static u32 slow_path (snat_main_t *sm, vlib_buffer_t *b0,
                                           s->in2out.fib_index);
 
       snat_free_outside_address_and_port 
-        (sm, &s->out2in, s->outside_address_index);
+        (sm, thread_index, &s->out2in, s->outside_address_index);
       s->outside_address_index = ~0;
 
-      if (snat_alloc_outside_address_and_port (sm, rx_fib_index0, &key1,
+      if (snat_alloc_outside_address_and_port (sm, rx_fib_index0,
+                                               thread_index, &key1,
                                                &address_index))
         {
           ASSERT(0);
@@ -336,7 +351,8 @@ static u32 slow_path (snat_main_t *sm, vlib_buffer_t *b0,
         {
           static_mapping = 0;
           /* Try to create dynamic translation */
-          if (snat_alloc_outside_address_and_port (sm, rx_fib_index0, &key1,
+          if (snat_alloc_outside_address_and_port (sm, rx_fib_index0,
+                                                   thread_index, &key1,
                                                    &address_index))
             {
               b0->error = node->errors[SNAT_IN2OUT_ERROR_OUT_OF_PORTS];
@@ -388,22 +404,27 @@ static u32 slow_path (snat_main_t *sm, vlib_buffer_t *b0,
   /* Add to translation hashes */
   kv0.key = s->in2out.as_u64;
   kv0.value = s - sm->per_thread_data[thread_index].sessions;
-  if (clib_bihash_add_del_8_8 (&sm->in2out, &kv0, 1 /* is_add */))
+  if (clib_bihash_add_del_8_8 (snat_in2out_table (sm, thread_index), &kv0,
+                               1 /* is_add */))
       clib_warning ("in2out key add failed");
   
   kv0.key = s->out2in.as_u64;
   kv0.value = s - sm->per_thread_data[thread_index].sessions;
   
-  if (clib_bihash_add_del_8_8 (&sm->out2in, &kv0, 1 /* is_add */))
+  if (clib_bihash_add_del_8_8 (snat_out2in_table (sm, thread_index), &kv0,
+                               1 /* is_add */))
       clib_warning ("out2in key add failed");
 
-  /* Add to translated packets worker lookup */
-  worker_by_out_key.addr = s->out2in.addr;
-  worker_by_out_key.port = s->out2in.port;
-  worker_by_out_key.fib_index = s->out2in.fib_index;
-  kv0.key = worker_by_out_key.as_u64;
-  kv0.value = thread_index;
-  clib_bihash_add_del_8_8 (&sm->worker_by_out, &kv0, 1);
+  /* Add to translated packets worker lookup, unless the port tells */
+  if (!sm->per_worker_tables)
+    {
+      worker_by_out_key.addr = s->out2in.addr;
+      worker_by_out_key.port = s->out2in.port;
+      worker_by_out_key.fib_index = s->out2in.fib_index;
+      kv0.key = worker_by_out_key.as_u64;
+      kv0.value = thread_index;
+      clib_bihash_add_del_8_8 (&sm->worker_by_out, &kv0, 1);
+    }
 
   /* log NAT event */
   snat_ipfix_logging_nat44_ses_create(s->in2out.addr.as_u32,
@@ -506,7 +527,8 @@ u32 icmp_match_in2out_slow(snat_main_t *sm, vlib_node_runtime_t *node,
 
   kv0.key = key0.as_u64;
 
-  if (clib_bihash_search_8_8 (&sm->in2out, &kv0, &value0))
+  if (clib_bihash_search_8_8 (snat_in2out_table (sm, thread_index), &kv0,
+                              &value0))
     {
       if (PREDICT_FALSE(snat_not_translate(sm, node, sw_if_index0, ip0,
           IP_PROTOCOL_ICMP, rx_fib_index0)))
@@ -525,7 +547,8 @@ u32 icmp_match_in2out_slow(snat_main_t *sm, vlib_node_runtime_t *node,
       next0 = slow_path (sm, b0, ip0, rx_fib_index0, &key0,
                          &s0, node, next0, thread_index);
 
-      if (PREDICT_FALSE (next0 == SNAT_IN2OUT_NEXT_DROP))
+      if (PREDICT_FALSE (next0 == SNAT_IN2OUT_NEXT_DROP
+                         || next0 == SNAT_IN2OUT_NEXT_OWNER_HANDOFF))
         goto out;
     }
   else
@@ -664,7 +687,8 @@ static inline u32 icmp_in2out (snat_main_t *sm,
                                        &protocol, &sm0, &dont_translate, d, e);
   if (next0_tmp != ~0)
     next0 = next0_tmp;
-  if (next0 == SNAT_IN2OUT_NEXT_DROP || dont_translate)
+  if (next0 == SNAT_IN2OUT_NEXT_DROP || dont_translate
+      || next0 == SNAT_IN2OUT_NEXT_OWNER_HANDOFF)
     goto out;
 
   sum0 = ip_incremental_checksum (0, icmp0,
@@ -792,7 +816,8 @@ snat_hairpinning (snat_main_t *sm,
   kv0.key = key0.as_u64;
 
   /* Check if destination is in active sessions */
-  if (clib_bihash_search_8_8 (&sm->out2in, &kv0, &value0))
+  if (clib_bihash_search_8_8 (snat_out2in_table_for_port (sm, key0.port),
+                              &kv0, &value0))
     {
       /* or static mappings */
       if (!snat_static_mapping_match(sm, key0, &sm0, 1, 0))
@@ -805,7 +830,9 @@ snat_hairpinning (snat_main_t *sm,
   else
     {
       si = value0.value;
-      if (sm->num_workers > 1)
+      if (sm->per_worker_tables)
+        ti = snat_port_owner_thread (sm, clib_net_to_host_u16 (key0.port));
+      else if (sm->num_workers > 1)
         {
           k0.addr = ip0->dst_address;
           k0.port = udp0->dst_port;
@@ -902,7 +929,9 @@ static inline u32 icmp_in2out_slow_path (snat_main_t *sm,
           kv0.key = key0.as_u64;
 
           /* Check if destination is in active sessions */
-          if (clib_bihash_search_8_8 (&sm->out2in, &kv0, &value0))
+          if (clib_bihash_search_8_8 (snat_out2in_table_for_port (sm,
+                                                                  icmp_id0),
+                                      &kv0, &value0))
             {
               /* or static mappings */
               if (!snat_static_mapping_match(sm, key0, &sm0, 1, 0))
@@ -914,7 +943,10 @@ static inline u32 icmp_in2out_slow_path (snat_main_t *sm,
           else
             {
               si = value0.value;
-              if (sm->num_workers > 1)
+              if (sm->per_worker_tables)
+                ti = snat_port_owner_thread (sm,
+                                             clib_net_to_host_u16 (icmp_id0));
+              else if (sm->num_workers > 1)
                 {
                   k0.addr = ip0->dst_address;
                   k0.port = icmp_id0;
@@ -1143,7 +1175,9 @@ snat_in2out_node_fn_inline (vlib_main_t * vm,
           
           kv0.key = key0.as_u64;
 
-          if (PREDICT_FALSE (clib_bihash_search_8_8 (&sm->in2out, &kv0, &value0) != 0))
+          if (PREDICT_FALSE (clib_bihash_search_8_8
+                             (snat_in2out_table (sm, thread_index), &kv0,
+                              &value0) != 0))
             {
               if (is_slow_path)
                 {
@@ -1153,7 +1187,8 @@ snat_in2out_node_fn_inline (vlib_main_t * vm,
 
                   next0 = slow_path (sm, b0, ip0, rx_fib_index0, &key0,
                                      &s0, node, next0, thread_index);
-                  if (PREDICT_FALSE (next0 == SNAT_IN2OUT_NEXT_DROP))
+                  if (PREDICT_FALSE (next0 == SNAT_IN2OUT_NEXT_DROP
+                                     || next0 == SNAT_IN2OUT_NEXT_OWNER_HANDOFF))
                     goto trace00;
                 }
               else
@@ -1286,7 +1321,9 @@ snat_in2out_node_fn_inline (vlib_main_t * vm,
           
           kv1.key = key1.as_u64;
 
-            if (PREDICT_FALSE(clib_bihash_search_8_8 (&sm->in2out, &kv1, &value1) != 0))
+            if (PREDICT_FALSE(clib_bihash_search_8_8
+                              (snat_in2out_table (sm, thread_index), &kv1,
+                               &value1) != 0))
             {
               if (is_slow_path)
                 {
@@ -1296,7 +1333,8 @@ snat_in2out_node_fn_inline (vlib_main_t * vm,
 
                   next1 = slow_path (sm, b1, ip1, rx_fib_index1, &key1,
                                      &s1, node, next1, thread_index);
-                  if (PREDICT_FALSE (next1 == SNAT_IN2OUT_NEXT_DROP))
+                  if (PREDICT_FALSE (next1 == SNAT_IN2OUT_NEXT_DROP
+                                     || next1 == SNAT_IN2OUT_NEXT_OWNER_HANDOFF))
                     goto trace01;
                 }
               else
@@ -1464,7 +1502,8 @@ snat_in2out_node_fn_inline (vlib_main_t * vm,
           
           kv0.key = key0.as_u64;
 
-          if (clib_bihash_search_8_8 (&sm->in2out, &kv0, &value0))
+          if (clib_bihash_search_8_8 (snat_in2out_table (sm, thread_index),
+                                      &kv0, &value0))
             {
               if (is_slow_path)
                 {
@@ -1475,7 +1514,8 @@ snat_in2out_node_fn_inline (vlib_main_t * vm,
                   next0 = slow_path (sm, b0, ip0, rx_fib_index0, &key0,
                                      &s0, node, next0, thread_index);
 
-                  if (PREDICT_FALSE (next0 == SNAT_IN2OUT_NEXT_DROP))
+                  if (PREDICT_FALSE (next0 == SNAT_IN2OUT_NEXT_DROP
+                                     || next0 == SNAT_IN2OUT_NEXT_OWNER_HANDOFF))
                     goto trace0;
                 }
               else
@@ -1597,6 +1637,7 @@ VLIB_REGISTER_NODE (snat_in2out_node) = {
     [SNAT_IN2OUT_NEXT_LOOKUP] = "ip4-lookup",
     [SNAT_IN2OUT_NEXT_SLOW_PATH] = "snat-in2out-slowpath",
     [SNAT_IN2OUT_NEXT_ICMP_ERROR] = "ip4-icmp-error",
+    [SNAT_IN2OUT_NEXT_OWNER_HANDOFF] = "snat-in2out-worker-handoff",
   },
 };
 
@@ -1630,6 +1671,7 @@ VLIB_REGISTER_NODE (snat_in2out_slowpath_node) = {
     [SNAT_IN2OUT_NEXT_LOOKUP] = "ip4-lookup",
     [SNAT_IN2OUT_NEXT_SLOW_PATH] = "snat-in2out-slowpath",
     [SNAT_IN2OUT_NEXT_ICMP_ERROR] = "ip4-icmp-error",
+    [SNAT_IN2OUT_NEXT_OWNER_HANDOFF] = "snat-in2out-worker-handoff",
   },
 };
 
@@ -2746,6 +2788,7 @@ VLIB_REGISTER_NODE (snat_in2out_fast_node) = {
     [SNAT_IN2OUT_NEXT_LOOKUP] = "ip4-lookup",
     [SNAT_IN2OUT_NEXT_SLOW_PATH] = "snat-in2out-slowpath",
     [SNAT_IN2OUT_NEXT_ICMP_ERROR] = "ip4-icmp-error",
+    [SNAT_IN2OUT_NEXT_OWNER_HANDOFF] = "snat-in2out-worker-handoff",
   },
 };
 
@@ -125,6 +125,160 @@ snat_add_del_addr_to_fib (ip4_address_t * addr, u8 p_len, u32 sw_if_index,
                            FIB_SOURCE_PLUGIN_HI);
 }
 
+/**
+ * @brief Split the dynamic port space of an outside address between the
+ * threads, one slice of whole busy bitmap words per thread.
+ */
+static void
+snat_port_slices_init (snat_main_t * sm, snat_port_slice_t ** slicesp)
+{
+  u32 n_slices = clib_max (1, sm->num_workers);
+  snat_port_slice_t *ps;
+  u32 i;
+
+  vec_validate_aligned (*slicesp, n_slices - 1, CLIB_CACHE_LINE_BYTES);
+  for (i = 0; i < n_slices; i++)
+    {
+      ps = vec_elt_at_index (*slicesp, i);
+      ps->first_word = snat_port_slice_first_word (n_slices, i);
+      ps->n_words = snat_port_slice_first_word (n_slices, i + 1)
+        - ps->first_word;
+      ps->next_word = 0;
+      ps->random_seed = random_default_seed () + i;
+      clib_bitmap_alloc (ps->full_words, ps->n_words);
+    }
+}
+
+static void
+snat_port_slices_free (snat_port_slice_t ** slicesp)
+{
+  snat_port_slice_t *ps;
+
+  vec_foreach (ps, *slicesp)
+    clib_bitmap_free (ps->full_words);
+  vec_free (*slicesp);
+}
+
+/* Rebuild the full word summary of a slice from the busy bitmap */
+static void
+snat_port_slice_rescan (snat_port_slice_t * ps, uword * busy)
+{
+  u32 i;
+
+  for (i = 0; i < ps->n_words; i++)
+    clib_bitmap_set_no_check (ps->full_words, i,
+                              busy[ps->first_word + i] == ~0);
+}
+
+/* Find a word of the slice with a free port, starting at the hint */
+static inline uword
+snat_port_slice_find_word (snat_port_slice_t * ps)
+{
+  uword i;
+
+  i = clib_bitmap_next_clear (ps->full_words, ps->next_word);
+  if (i < ps->n_words && !clib_bitmap_get_no_check (ps->full_words, i))
+    return i;
+  return clib_bitmap_first_clear (ps->full_words);
+}
+
+/**
+ * @brief Allocate a free port from a slice.
+ *
+ * @returns 0 on success, 1 if the slice is exhausted.
+ */
+static int
+snat_port_slice_alloc (snat_port_slice_t * ps, uword * busy, u16 * port)
+{
+  uword i, w, bit;
+  int rescanned = 0;
+
+  while (1)
+    {
+      i = snat_port_slice_find_word (ps);
+      if (i >= ps->n_words)
+        {
+          /* Static mappings may have freed ports behind our back */
+          if (rescanned)
+            return 1;
+          snat_port_slice_rescan (ps, busy);
+          rescanned = 1;
+          continue;
+        }
+
+      w = ps->first_word + i;
+      if (PREDICT_FALSE (busy[w] == ~0))
+        {
+          /* Filled by a static mapping */
+          clib_bitmap_set_no_check (ps->full_words, i, 1);
+          continue;
+        }
+
+      count_trailing_zeros (bit, ~busy[w]);
+      busy[w] |= (uword) 1 << bit;
+      ps->next_word = i;
+      if (busy[w] == ~0)
+        {
+          clib_bitmap_set_no_check (ps->full_words, i, 1);
+          /* Continue at a random place to keep ports hard to predict */
+          ps->next_word = random_u32 (&ps->random_seed) % ps->n_words;
+        }
+
+      *port = w * BITS (uword) + bit;
+      return 0;
+    }
+}
+
+static void
+snat_port_slice_free (snat_port_slice_t * ps, uword * busy, u16 port)
+{
+  uword w = port / BITS (uword);
+
+  busy[w] &= ~((uword) 1 << (port % BITS (uword)));
+  if (w >= ps->first_word && w < ps->first_word + ps->n_words)
+    clib_bitmap_set_no_check (ps->full_words, w - ps->first_word, 0);
+}
+
+/**
+ * @brief Allocate a block of SNAT_PORT_BLOCK_SIZE ports, one whole free
+ * busy bitmap word, from a slice.
+ *
+ * @returns 0 on success, 1 if the slice has no free block.
+ */
+static int
+snat_port_slice_alloc_block (snat_port_slice_t * ps, uword * busy,
+                             u16 * first_port)
+{
+  u32 i, j;
+  uword w;
+
+  for (j = 0; j < ps->n_words; j++)
+    {
+      i = (ps->next_word + j) % ps->n_words;
+      w = ps->first_word + i;
+      if (busy[w] == 0)
+        {
+          busy[w] = ~0;
+          clib_bitmap_set_no_check (ps->full_words, i, 1);
+          *first_port = w * BITS (uword);
+          return 0;
+        }
+    }
+  return 1;
+}
+
+static void
+snat_port_slice_free_block (snat_port_slice_t * ps, uword * busy,
+                            u16 first_port)
+{
+  uword w = first_port / BITS (uword);
+
+  ASSERT (busy[w] == ~0);
+  busy[w] = 0;
+  if (w >= ps->first_word && w < ps->first_word + ps->n_words)
+    clib_bitmap_set_no_check (ps->full_words, w - ps->first_word, 0);
+}
+
 void snat_add_address (snat_main_t *sm, ip4_address_t *addr, u32 vrf_id)
 {
   snat_address_t * ap;
@@ -144,7 +298,8 @@ void snat_add_address (snat_main_t *sm, ip4_address_t *addr, u32 vrf_id)
   ap->addr = *addr;
   ap->fib_index = ip4_fib_index_from_table_id(vrf_id);
 #define _(N, i, n, s) \
-  clib_bitmap_alloc (ap->busy_##n##_port_bitmap, 65535);
+  clib_bitmap_alloc (ap->busy_##n##_port_bitmap, 65535); \
+  snat_port_slices_init (sm, &ap->n##_slices);
   foreach_snat_protocol
 #undef _
 
@@ -349,7 +504,7 @@ int snat_add_static_mapping(ip4_address_t l_addr, ip4_address_t e_addr,
       clib_bihash_add_del_8_8(&sm->static_mapping_by_external, &kv, 1);
 
       /* Assign worker */
-      if (sm->workers)
+      if (sm->workers && !sm->per_worker_tables)
         {
           snat_user_key_t w_key0;
           snat_worker_key_t w_key1;
@@ -434,17 +589,33 @@ int snat_add_static_mapping(ip4_address_t l_addr, ip4_address_t e_addr,
           u64 user_index;
           snat_session_t * s;
           snat_main_per_thread_data_t *tsm;
+          u32 thread_index, owner_thread_index = ~0;
 
           u_key.addr = m->local_addr;
           u_key.fib_index = m->fib_index;
           kv.key = u_key.as_u64;
-          if (!clib_bihash_search_8_8 (&sm->user_hash, &kv, &value))
+
+          /*
+           * The user lives on the thread it was assigned to, or with
+           * per-worker tables on any thread which has seen its traffic.
+           */
+          if (!sm->per_worker_tables)
             {
-              user_index = value.value;
               if (!clib_bihash_search_8_8 (&sm->worker_by_in, &kv, &value))
-                tsm = vec_elt_at_index (sm->per_thread_data, value.value);
+                owner_thread_index = value.value;
               else
-                tsm = vec_elt_at_index (sm->per_thread_data, sm->num_workers);
+                owner_thread_index = sm->num_workers;
+            }
+
+          vec_foreach (tsm, sm->per_thread_data)
+            {
+              thread_index = tsm - sm->per_thread_data;
+              if (!sm->per_worker_tables && thread_index != owner_thread_index)
+                continue;
+              if (clib_bihash_search_8_8 (snat_user_hash (sm, thread_index),
+                                          &kv, &value))
+                continue;
+              user_index = value.value;
               u = pool_elt_at_index (tsm->users, user_index);
               if (u->nstaticsessions)
                 {
@@ -477,9 +648,11 @@ int snat_add_static_mapping(ip4_address_t l_addr, ip4_address_t e_addr,
                                                           s->in2out.fib_index);
 
                       value.key = s->in2out.as_u64;
-                      clib_bihash_add_del_8_8 (&sm->in2out, &value, 0);
+                      clib_bihash_add_del_8_8
+                        (snat_in2out_table (sm, thread_index), &value, 0);
                       value.key = s->out2in.as_u64;
-                      clib_bihash_add_del_8_8 (&sm->out2in, &value, 0);
+                      clib_bihash_add_del_8_8
+                        (snat_out2in_table (sm, thread_index), &value, 0);
                       pool_put (tsm->sessions, s);
 
                       clib_dlist_remove (tsm->list_pool, del_elt_index);
@@ -492,7 +665,8 @@ int snat_add_static_mapping(ip4_address_t l_addr, ip4_address_t e_addr,
                   if (addr_only)
                     {
                       pool_put (tsm->users, u);
-                      clib_bihash_add_del_8_8 (&sm->user_hash, &kv, 0);
+                      clib_bihash_add_del_8_8
+                        (snat_user_hash (sm, thread_index), &kv, 0);
                     }
                 }
             }
@@ -581,14 +755,18 @@ int snat_del_address (snat_main_t *sm, ip4_address_t addr, u8 delete_sm)
                                                     ses->in2out.fib_index);
                 vec_add1 (ses_to_be_removed, ses - tsm->sessions);
                 kv.key = ses->in2out.as_u64;
-                clib_bihash_add_del_8_8 (&sm->in2out, &kv, 0);
+                clib_bihash_add_del_8_8
+                  (snat_in2out_table (sm, tsm - sm->per_thread_data), &kv, 0);
                 kv.key = ses->out2in.as_u64;
-                clib_bihash_add_del_8_8 (&sm->out2in, &kv, 0);
+                clib_bihash_add_del_8_8
+                  (snat_out2in_table (sm, tsm - sm->per_thread_data), &kv, 0);
                 clib_dlist_remove (tsm->list_pool, ses->per_user_index);
                 user_key.addr = ses->in2out.addr;
                 user_key.fib_index = ses->in2out.fib_index;
                 kv.key = user_key.as_u64;
-                if (!clib_bihash_search_8_8 (&sm->user_hash, &kv, &value))
+                if (!clib_bihash_search_8_8
+                    (snat_user_hash (sm, tsm - sm->per_thread_data),
+                     &kv, &value))
                   {
                     u = pool_elt_at_index (tsm->users, value.value);
                     u->nsessions--;
@@ -603,6 +781,12 @@ int snat_del_address (snat_main_t *sm, ip4_address_t addr, u8 delete_sm)
        }
     }
 
+#define _(N, j, n, s) \
+  snat_port_slices_free (&a->n##_slices); \
+  clib_bitmap_free (a->busy_##n##_port_bitmap);
+  foreach_snat_protocol
+#undef _
+
   vec_del1 (sm->addresses, i);
 
   /* Delete external address from FIB */
@@ -631,7 +815,13 @@ int snat_interface_add_del (u32 sw_if_index, u8 is_inside, int is_del)
     feature_name = is_inside ?  "snat-in2out-fast" : "snat-out2in-fast";
   else
     {
-      if (sm->num_workers > 1 && !sm->deterministic)
+      /* With per-worker tables inside traffic stays on the rx worker,
+         outside traffic goes to the worker owning the destination port */
+      if (sm->per_worker_tables && !is_inside && sm->num_workers > 1)
+        feature_name = "snat-out2in-worker-handoff";
+      else if (sm->per_worker_tables)
+        feature_name = is_inside ?  "snat-in2out" : "snat-out2in";
+      else if (sm->num_workers > 1 && !sm->deterministic)
         feature_name = is_inside ?  "snat-in2out-worker-handoff" : "snat-out2in-worker-handoff";
       else if (sm->deterministic)
         feature_name = is_inside ?  "snat-det-in2out" : "snat-det-out2in";
@@ -700,6 +890,10 @@ int snat_set_workers (uword * bitmap)
   if (sm->num_workers < 2)
     return VNET_API_ERROR_FEATURE_DISABLED;
 
+  /* Every worker owns a slice of the outside ports */
+  if (sm->per_worker_tables)
+    return VNET_API_ERROR_UNSUPPORTED;
+
   if (clib_bitmap_last_set (bitmap) >= sm->num_workers)
     return VNET_API_ERROR_INVALID_WORKER;
 
@@ -792,11 +986,13 @@ static clib_error_t * snat_init (vlib_main_t * vm)
 VLIB_INIT_FUNCTION (snat_init);
 
 void snat_free_outside_address_and_port (snat_main_t * sm, 
+                                         u32 thread_index,
                                          snat_session_key_t * k, 
                                          u32 address_index)
 {
   snat_address_t *a;
   u16 port_host_byte_order = clib_net_to_host_u16 (k->port);
+  u32 slice_index = snat_port_slice_index (sm, thread_index);
   
   ASSERT (address_index < vec_len (sm->addresses));
 
@@ -808,9 +1004,9 @@ void snat_free_outside_address_and_port (snat_main_t * sm,
     case SNAT_PROTOCOL_##N: \
       ASSERT (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, \
         port_host_byte_order) == 1); \
-      clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, \
-        port_host_byte_order, 0); \
-      a->busy_##n##_ports--; \
+      snat_port_slice_free (vec_elt_at_index (a->n##_slices, slice_index), \
+                            a->busy_##n##_port_bitmap, port_host_byte_order); \
+      __sync_fetch_and_sub (&a->busy_##n##_ports, 1); \
       break;
       foreach_snat_protocol
 #undef _
@@ -888,42 +1084,43 @@ int snat_static_mapping_match (snat_main_t * sm,
   return 0;
 }
 
+/**
+ * @brief Allocate an outside address and port for a dynamic translation.
+ *
+ * Ports come from the calling thread's slice of the address' port space,
+ * see snat_port_slice_t. Addresses are tried starting with the one the
+ * thread allocated from last.
+ *
+ * @returns 0 on success, 1 if all addresses are exhausted.
+ */
 int snat_alloc_outside_address_and_port (snat_main_t * sm, 
                                          u32 fib_index,
+                                         u32 thread_index,
                                          snat_session_key_t * k,
                                          u32 * address_indexp)
 {
-  int i;
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  u32 slice_index = snat_port_slice_index (sm, thread_index);
+  u32 n_addresses = vec_len (sm->addresses);
+  u32 i, j;
   snat_address_t *a;
-  u32 portnum;
+  u16 portnum;
 
-  for (i = 0; i < vec_len (sm->addresses); i++)
+  for (j = 0; j < n_addresses; j++)
     {
+      i = (tsm->next_address_index + j) % n_addresses;
       a = sm->addresses + i;
       if (sm->vrf_mode && a->fib_index != ~0 && a->fib_index != fib_index)
         continue;
       switch (k->protocol)
         {
-#define _(N, j, n, s) \
+#define _(N, p, n, s) \
         case SNAT_PROTOCOL_##N: \
-          if (a->busy_##n##_ports < (65535-1024)) \
-            { \
-              while (1) \
-                { \
-                  portnum = random_u32 (&sm->random_seed); \
-                  portnum &= 0xFFFF; \
-                  if (portnum < 1024) \
-                    continue; \
-                  if (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, portnum)) \
-                    continue; \
-                  clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, portnum, 1); \
-                  a->busy_##n##_ports++; \
-                  k->addr = a->addr; \
-                  k->port = clib_host_to_net_u16(portnum); \
-                  *address_indexp = i; \
-                  return 0; \
-                } \
-            } \
+          if (snat_port_slice_alloc (vec_elt_at_index (a->n##_slices, \
+                                                       slice_index), \
+                                     a->busy_##n##_port_bitmap, &portnum)) \
+            continue; \
+          __sync_fetch_and_add (&a->busy_##n##_ports, 1); \
           break;
           foreach_snat_protocol
 #undef _
@@ -932,12 +1129,97 @@ int snat_alloc_outside_address_and_port (snat_main_t * sm,
           return 1;
         }
 
+      k->addr = a->addr;
+      k->port = clib_host_to_net_u16 (portnum);
+      *address_indexp = i;
+      tsm->next_address_index = i;
+      return 0;
     }
   /* Totally out of translations to use... */
   snat_ipfix_logging_addresses_exhausted(0);
   return 1;
 }
 
+/**
+ * @brief Allocate a block of SNAT_PORT_BLOCK_SIZE consecutive outside
+ * ports, e.g. to give a user a range of ports which is logged once
+ * instead of per session.
+ *
+ * @returns 0 on success, 1 if no address has a free block left.
+ */
+int snat_alloc_outside_port_block (snat_main_t * sm,
+                                   u32 fib_index,
+                                   u32 thread_index,
+                                   snat_protocol_t proto,
+                                   u32 * address_indexp,
+                                   u16 * first_port)
+{
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  u32 slice_index = snat_port_slice_index (sm, thread_index);
+  u32 n_addresses = vec_len (sm->addresses);
+  u32 i, j;
+  snat_address_t *a;
+
+  for (j = 0; j < n_addresses; j++)
+    {
+      i = (tsm->next_address_index + j) % n_addresses;
+      a = sm->addresses + i;
+      if (sm->vrf_mode && a->fib_index != ~0 && a->fib_index != fib_index)
+        continue;
+      switch (proto)
+        {
+#define _(N, p, n, s) \
+        case SNAT_PROTOCOL_##N: \
+          if (snat_port_slice_alloc_block (vec_elt_at_index (a->n##_slices, \
+                                                             slice_index), \
+                                           a->busy_##n##_port_bitmap, \
+                                           first_port)) \
+            continue; \
+          __sync_fetch_and_add (&a->busy_##n##_ports, SNAT_PORT_BLOCK_SIZE); \
+          break;
+          foreach_snat_protocol
+#undef _
+        default:
+          clib_warning("unknown protocol");
+          return 1;
+        }
+
+      *address_indexp = i;
+      return 0;
+    }
+  snat_ipfix_logging_addresses_exhausted(0);
+  return 1;
+}
+
+void snat_free_outside_port_block (snat_main_t * sm,
+                                   u32 thread_index,
+                                   snat_protocol_t proto,
+                                   u32 address_index,
+                                   u16 first_port)
+{
+  snat_address_t *a;
+  u32 slice_index = snat_port_slice_index (sm, thread_index);
+
+  ASSERT (address_index < vec_len (sm->addresses));
+
+  a = sm->addresses + address_index;
+
+  switch (proto)
+    {
+#define _(N, i, n, s) \
+    case SNAT_PROTOCOL_##N: \
+      snat_port_slice_free_block (vec_elt_at_index (a->n##_slices, \
+                                                    slice_index), \
+                                  a->busy_##n##_port_bitmap, first_port); \
+      __sync_fetch_and_sub (&a->busy_##n##_ports, SNAT_PORT_BLOCK_SIZE); \
+      break;
+      foreach_snat_protocol
+#undef _
+    default:
+      clib_warning("unknown_protocol");
+      return;
+    }
+}
 
 static clib_error_t *
 add_address_command_fn (vlib_main_t * vm,
@@ -1298,6 +1580,10 @@ set_workers_command_fn (vlib_main_t * vm,
       error = clib_error_return (0,
         "Supported only if 2 or more workes available.");
       goto done;
+    case VNET_API_ERROR_UNSUPPORTED:
+      error = clib_error_return (0,
+        "Not supported with per-worker session tables.");
+      goto done;
     default:
       break;
     }
@@ -1322,6 +1608,132 @@ VLIB_CLI_COMMAND (set_workers_command, static) = {
     "set snat workers <workers-list>",
 };
 
+static clib_error_t *
+test_port_allocator_command_fn (vlib_main_t * vm,
+                                unformat_input_t * input,
+                                vlib_cli_command_t * cmd)
+{
+  snat_main_t *sm = &snat_main;
+  static const u32 occupancy[] = { 10, 50, 95 };
+  u32 n_iter = 100000, seed = random_default_seed ();
+  snat_port_slice_t *slices = 0, *ps;
+  uword *busy = 0;
+  u16 *ports = 0, port;
+  u32 i, j, k, first_port, n_ports, n_busy;
+  u64 t0, t1, clocks[2], worst[2];
+  clib_error_t *error = 0;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "iterations %u", &n_iter))
+        ;
+      else
+        return clib_error_return (0, "unknown input '%U'",
+                                  format_unformat_error, input);
+    }
+
+  if (n_iter == 0)
+    return clib_error_return (0, "iterations must be non-zero");
+
+  /* Benchmark the first thread's slice with the current worker count */
+  snat_port_slices_init (sm, &slices);
+  ps = vec_elt_at_index (slices, 0);
+  first_port = ps->first_word * BITS (uword);
+  n_ports = ps->n_words * BITS (uword);
+
+  vlib_cli_output (vm, "%u ports per thread, %u allocations per run",
+                   n_ports, n_iter);
+  vlib_cli_output (vm, "%-10s%24s%24s", "occupancy",
+                   "slice clocks avg/max", "random probe avg/max");
+
+  for (i = 0; i < ARRAY_LEN (occupancy); i++)
+    {
+      clib_bitmap_alloc (busy, 65535);
+
+      /* Fill the slice to the requested occupancy, at random ports */
+      n_busy = ((u64) n_ports * occupancy[i]) / 100;
+      vec_reset_length (ports);
+      while (vec_len (ports) < n_busy)
+        {
+          port = first_port + random_u32 (&seed) % n_ports;
+          if (clib_bitmap_get_no_check (busy, port))
+            continue;
+          clib_bitmap_set_no_check (busy, port, 1);
+          vec_add1 (ports, port);
+        }
+      snat_port_slice_rescan (ps, busy);
+      ps->next_word = 0;
+
+      memset (clocks, 0, sizeof (clocks));
+      memset (worst, 0, sizeof (worst));
+
+      /*
+       * Steady state churn at constant occupancy: allocate a port, then
+       * release a random busy one.
+       */
+      for (j = 0; j < n_iter; j++)
+        {
+          t0 = clib_cpu_time_now ();
+          if (snat_port_slice_alloc (ps, busy, &port))
+            {
+              error = clib_error_return (0, "slice exhausted");
+              goto done;
+            }
+          t1 = clib_cpu_time_now ();
+          clocks[0] += t1 - t0;
+          worst[0] = clib_max (worst[0], t1 - t0);
+
+          k = random_u32 (&seed) % vec_len (ports);
+          snat_port_slice_free (ps, busy, ports[k]);
+          ports[k] = port;
+        }
+
+      /* The same with the previous random probe search */
+      for (j = 0; j < n_iter; j++)
+        {
+          t0 = clib_cpu_time_now ();
+          do
+            port = first_port + random_u32 (&seed) % n_ports;
+          while (clib_bitmap_get_no_check (busy, port));
+          clib_bitmap_set_no_check (busy, port, 1);
+          t1 = clib_cpu_time_now ();
+          clocks[1] += t1 - t0;
+          worst[1] = clib_max (worst[1], t1 - t0);
+
+          k = random_u32 (&seed) % vec_len (ports);
+          clib_bitmap_set_no_check (busy, ports[k], 0);
+          ports[k] = port;
+        }
+
+      vlib_cli_output (vm, "%8u%%  %14.1f/%-9llu%14.1f/%-9llu",
+                       occupancy[i],
+                       (f64) clocks[0] / n_iter, worst[0],
+                       (f64) clocks[1] / n_iter, worst[1]);
+      clib_bitmap_free (busy);
+    }
+
+done:
+  clib_bitmap_free (busy);
+  vec_free (ports);
+  snat_port_slices_free (&slices);
+  return error;
+}
+
+/*?
+ * @cliexpar
+ * @cliexstart{test snat port-allocator}
+ * Measure the outside port allocation latency, in CPU clocks, at 10%, 50%
+ * and 95% occupancy of a thread's port slice, compared with a random
+ * probe search of the busy port bitmap:
+ *  vpp# test snat port-allocator iterations 1000000
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (test_port_allocator_command, static) = {
+  .path = "test snat port-allocator",
+  .function = test_port_allocator_command_fn,
+  .short_help = "test snat port-allocator [iterations <n>]",
+};
+
 static clib_error_t *
 snat_ipfix_logging_enable_disable_command_fn (vlib_main_t * vm,
                                               unformat_input_t * input,
@@ -1473,6 +1885,58 @@ snat_get_worker_out2in_cb (ip4_header_t * ip0, u32 rx_fib_index0)
   return next_worker_index;
 }
 
+static u32
+snat_get_worker_out2in_by_port_cb (ip4_header_t * ip0, u32 rx_fib_index0)
+{
+  snat_main_t *sm = &snat_main;
+  udp_header_t * udp0;
+  u16 port;
+
+  udp0 = ip4_next_header (ip0);
+  port = udp0->dst_port;
+
+  if (PREDICT_FALSE(ip0->protocol == IP_PROTOCOL_ICMP))
+    {
+      icmp46_header_t * icmp0 = (icmp46_header_t *) udp0;
+      icmp_echo_header_t *echo0 = (icmp_echo_header_t *)(icmp0+1);
+      port = echo0->identifier;
+    }
+
+  /* The port slice the outside port was allocated from names the owner */
+  return snat_port_owner_thread (sm, clib_net_to_host_u16 (port));
+}
+
+/*
+ * With per-worker tables in2out traffic stays on the rx worker, except
+ * that of static mappings, whose sessions live on the outside port owner.
+ */
+static u32
+snat_get_worker_in2out_static_cb (ip4_header_t * ip0, u32 rx_fib_index0)
+{
+  snat_main_t *sm = &snat_main;
+  snat_session_key_t key0, sm0;
+  udp_header_t * udp0;
+
+  udp0 = ip4_next_header (ip0);
+
+  key0.addr = ip0->src_address;
+  key0.port = udp0->src_port;
+  key0.protocol = ip_proto_to_snat_proto (ip0->protocol);
+  key0.fib_index = rx_fib_index0;
+
+  if (PREDICT_FALSE(ip0->protocol == IP_PROTOCOL_ICMP))
+    {
+      icmp46_header_t * icmp0 = (icmp46_header_t *) udp0;
+      icmp_echo_header_t *echo0 = (icmp_echo_header_t *)(icmp0+1);
+      key0.port = echo0->identifier;
+    }
+
+  if (snat_static_mapping_match (sm, key0, &sm0, 0, 0))
+    return vlib_get_thread_index ();
+
+  return snat_port_owner_thread (sm, clib_net_to_host_u16 (sm0.port));
+}
+
 static clib_error_t *
 snat_config (vlib_main_t * vm, unformat_input_t * input)
 {
@@ -1488,7 +1952,10 @@ snat_config (vlib_main_t * vm, unformat_input_t * input)
   u32 static_mapping_memory_size = 64<<20;
   u8 static_mapping_only = 0;
   u8 static_mapping_connection_tracking = 0;
+  u8 per_worker_tables = 0;
   vlib_thread_main_t *tm = vlib_get_thread_main ();
+  snat_main_per_thread_data_t * tsm;
+  u32 n_tables;
 
   sm->deterministic = 0;
 
@@ -1520,6 +1987,8 @@ snat_config (vlib_main_t * vm, unformat_input_t * input)
         }
       else if (unformat (input, "deterministic"))
         sm->deterministic = 1;
+      else if (unformat (input, "per-worker tables"))
+        per_worker_tables = 1;
       else
 	return clib_error_return (0, "unknown input '%U'",
 				  format_unformat_error, input);
@@ -1540,6 +2009,11 @@ snat_config (vlib_main_t * vm, unformat_input_t * input)
   sm->static_mapping_only = static_mapping_only;
   sm->static_mapping_connection_tracking = static_mapping_connection_tracking;
 
+  if (per_worker_tables && (sm->deterministic || static_mapping_only))
+    return clib_error_return (0, "per-worker tables not supported in "
+                              "deterministic or static mapping only mode");
+  sm->per_worker_tables = per_worker_tables;
+
   if (sm->deterministic)
     {
       sm->in2out_node_index = snat_det_in2out_node.index;
@@ -1559,22 +2033,52 @@ snat_config (vlib_main_t * vm, unformat_input_t * input)
           sm->icmp_match_in2out_cb = icmp_match_in2out_slow;
           sm->icmp_match_out2in_cb = icmp_match_out2in_slow;
 
-          clib_bihash_init_8_8 (&sm->worker_by_in, "worker-by-in", user_buckets,
-                                user_memory_size);
+          vec_validate (sm->per_thread_data, tm->n_vlib_mains - 1);
+
+          if (sm->per_worker_tables)
+            {
+              sm->worker_in2out_cb = snat_get_worker_in2out_static_cb;
+              sm->worker_out2in_cb = snat_get_worker_out2in_by_port_cb;
 
-          clib_bihash_init_8_8 (&sm->worker_by_out, "worker-by-out", user_buckets,
-                                user_memory_size);
+              /* Split the configured table sizes between the threads */
+              n_tables = clib_max (1, sm->num_workers);
+              vec_foreach (tsm, sm->per_thread_data)
+                {
+                  u32 ti = tsm - sm->per_thread_data;
+
+                  clib_bihash_init_8_8
+                    (&tsm->in2out, (char *) format (0, "in2out-%d%c", ti, 0),
+                     clib_max (1, translation_buckets / n_tables),
+                     translation_memory_size / n_tables);
+                  clib_bihash_init_8_8
+                    (&tsm->out2in, (char *) format (0, "out2in-%d%c", ti, 0),
+                     clib_max (1, translation_buckets / n_tables),
+                     translation_memory_size / n_tables);
+                  clib_bihash_init_8_8
+                    (&tsm->user_hash, (char *) format (0, "users-%d%c", ti, 0),
+                     clib_max (1, user_buckets / n_tables),
+                     user_memory_size / n_tables);
+                }
+            }
+          else
+            {
+              clib_bihash_init_8_8 (&sm->worker_by_in, "worker-by-in",
+                                    user_buckets, user_memory_size);
 
-          vec_validate (sm->per_thread_data, tm->n_vlib_mains - 1);
+              clib_bihash_init_8_8 (&sm->worker_by_out, "worker-by-out",
+                                    user_buckets, user_memory_size);
 
-          clib_bihash_init_8_8 (&sm->in2out, "in2out", translation_buckets,
-                                translation_memory_size);
+              clib_bihash_init_8_8 (&sm->in2out, "in2out",
+                                    translation_buckets,
+                                    translation_memory_size);
 
-          clib_bihash_init_8_8 (&sm->out2in, "out2in", translation_buckets,
-                                translation_memory_size);
+              clib_bihash_init_8_8 (&sm->out2in, "out2in",
+                                    translation_buckets,
+                                    translation_memory_size);
 
-          clib_bihash_init_8_8 (&sm->user_hash, "users", user_buckets,
-                                user_memory_size);
+              clib_bihash_init_8_8 (&sm->user_hash, "users", user_buckets,
+                                    user_memory_size);
+            }
         }
       else
         {
@@ -1795,6 +2299,11 @@ show_snat_command_fn (vlib_main_t * vm,
     {
       vlib_cli_output (vm, "SNAT mode: deterministic mapping");
     }
+  else if (sm->per_worker_tables)
+    {
+      vlib_cli_output (vm, "SNAT mode: dynamic translations enabled, "
+                       "per-worker tables");
+    }
   else
     {
       vlib_cli_output (vm, "SNAT mode: dynamic translations enabled");
@@ -1915,14 +2424,17 @@ show_snat_command_fn (vlib_main_t * vm,
 
           if (verbose > 0)
             {
-              vlib_cli_output (vm, "%U", format_bihash_8_8, &sm->in2out,
-                               verbose - 1);
-              vlib_cli_output (vm, "%U", format_bihash_8_8, &sm->out2in,
-                               verbose - 1);
-              vlib_cli_output (vm, "%U", format_bihash_8_8, &sm->worker_by_in,
-                               verbose - 1);
-              vlib_cli_output (vm, "%U", format_bihash_8_8, &sm->worker_by_out,
-                               verbose - 1);
+              if (!sm->per_worker_tables)
+                {
+                  vlib_cli_output (vm, "%U", format_bihash_8_8, &sm->in2out,
+                                   verbose - 1);
+                  vlib_cli_output (vm, "%U", format_bihash_8_8, &sm->out2in,
+                                   verbose - 1);
+                  vlib_cli_output (vm, "%U", format_bihash_8_8,
+                                   &sm->worker_by_in, verbose - 1);
+                  vlib_cli_output (vm, "%U", format_bihash_8_8,
+                                   &sm->worker_by_out, verbose - 1);
+                }
               vec_foreach_index (j, sm->per_thread_data)
                 {
                   tsm = vec_elt_at_index (sm->per_thread_data, j);
@@ -1933,6 +2445,13 @@ show_snat_command_fn (vlib_main_t * vm,
                   vlib_worker_thread_t *w = vlib_worker_threads + j;
                   vlib_cli_output (vm, "Thread %d (%s at lcore %u):", j, w->name,
                                    w->lcore_id);
+                  if (sm->per_worker_tables)
+                    {
+                      vlib_cli_output (vm, "%U", format_bihash_8_8,
+                                       &tsm->in2out, verbose - 1);
+                      vlib_cli_output (vm, "%U", format_bihash_8_8,
+                                       &tsm->out2in, verbose - 1);
+                    }
                   vlib_cli_output (vm, "  %d list pool elements",
                                    pool_elts (tsm->list_pool));
 
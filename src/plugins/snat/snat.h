@@ -154,12 +154,36 @@ typedef struct {
   u32 nstaticsessions;
 } snat_user_t;
 
+/* Dynamic translations use ports 1024-65535 */
+#define SNAT_PORT_DYNAMIC_FIRST 1024
+/* Ports handed out by a port block allocation */
+#define SNAT_PORT_BLOCK_SIZE BITS (uword)
+
+/*
+ * Per-thread slice of the dynamic port space of an outside address.
+ * Each thread allocates only from its own range of busy bitmap words,
+ * so threads never write the same word. full_words has a bit set for
+ * each word of the range which has no free port left; it may be stale
+ * after a static mapping changed the busy bitmap from the main thread,
+ * in which case the slice is rescanned when it looks exhausted.
+ */
+typedef struct {
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  u32 first_word;
+  u32 n_words;
+  /* word to continue scanning from */
+  u32 next_word;
+  u32 random_seed;
+  uword * full_words;
+} snat_port_slice_t;
+
 typedef struct {
   ip4_address_t addr;
   u32 fib_index;
 #define _(N, i, n, s) \
   u32 busy_##n##_ports; \
-  uword * busy_##n##_port_bitmap;
+  uword * busy_##n##_port_bitmap; \
+  snat_port_slice_t * n##_slices;
   foreach_snat_protocol
 #undef _
 } snat_address_t;
@@ -219,6 +243,14 @@ typedef struct {
 
   /* Pool of doubly-linked list elements */
   dlist_elt_t * list_pool;
+
+  /* Outside address to try first when allocating a port */
+  u32 next_address_index;
+
+  /* Worker-local lookup tables, used with per-worker tables */
+  clib_bihash_8_8_t in2out;
+  clib_bihash_8_8_t out2in;
+  clib_bihash_8_8_t user_hash;
 } snat_main_per_thread_data_t;
 
 struct snat_main_s;
@@ -301,6 +333,7 @@ typedef struct snat_main_s {
   u8 static_mapping_only;
   u8 static_mapping_connection_tracking;
   u8 deterministic;
+  u8 per_worker_tables;
   u32 translation_buckets;
   u32 translation_memory_size;
   u32 user_buckets;
@@ -342,14 +375,29 @@ extern vlib_node_registration_t snat_det_in2out_node;
 extern vlib_node_registration_t snat_det_out2in_node;
 
 void snat_free_outside_address_and_port (snat_main_t * sm, 
+                                         u32 thread_index,
                                          snat_session_key_t * k, 
                                          u32 address_index);
 
 int snat_alloc_outside_address_and_port (snat_main_t * sm, 
                                          u32 fib_index,
+                                         u32 thread_index,
                                          snat_session_key_t * k,
                                          u32 * address_indexp);
 
+int snat_alloc_outside_port_block (snat_main_t * sm,
+                                   u32 fib_index,
+                                   u32 thread_index,
+                                   snat_protocol_t proto,
+                                   u32 * address_indexp,
+                                   u16 * first_port);
+
+void snat_free_outside_port_block (snat_main_t * sm,
+                                   u32 thread_index,
+                                   snat_protocol_t proto,
+                                   u32 address_index,
+                                   u16 first_port);
+
 int snat_static_mapping_match (snat_main_t * sm,
                                snat_session_key_t match,
                                snat_session_key_t * mapping,
@@ -368,6 +416,100 @@ typedef struct {
   u32 cached_ip4_address;
 } snat_runtime_t;
 
+/** \brief Port slice used by a thread.
+    @param sm SNAT main
+    @param thread_index thread index
+    @return index of the thread's slice of the outside port space
+*/
+always_inline u32
+snat_port_slice_index (snat_main_t * sm, u32 thread_index)
+{
+  /* The main thread doesn't translate when there are workers */
+  if (sm->num_workers == 0 || thread_index < sm->first_worker_index)
+    return 0;
+  return thread_index - sm->first_worker_index;
+}
+
+/** \brief First busy bitmap word of a port slice.
+    @param n_slices number of slices
+    @param i slice index
+    @return busy bitmap word index
+*/
+always_inline u32
+snat_port_slice_first_word (u32 n_slices, u32 i)
+{
+  u32 first = SNAT_PORT_DYNAMIC_FIRST / BITS (uword);
+  u32 n_words = (1 << 16) / BITS (uword) - first;
+
+  return first + (i * n_words) / n_slices;
+}
+
+/** \brief Thread which allocates an outside port.
+    @param sm SNAT main
+    @param port port number in host byte order
+    @return thread index of the owner of the port's slice
+*/
+always_inline u32
+snat_port_owner_thread (snat_main_t * sm, u16 port)
+{
+  u32 n_slices = clib_max (1, sm->num_workers);
+  u32 first = SNAT_PORT_DYNAMIC_FIRST / BITS (uword);
+  u32 n_words = (1 << 16) / BITS (uword) - first;
+  u32 w = port / BITS (uword);
+  u32 i = 0;
+
+  /* Static mapping ports below the dynamic range go to the first slice */
+  if (w >= first)
+    {
+      i = ((w - first) * n_slices) / n_words;
+      if (i + 1 < n_slices && snat_port_slice_first_word (n_slices, i + 1) <= w)
+        i++;
+    }
+
+  return sm->num_workers ? sm->first_worker_index + i : 0;
+}
+
+/*
+ * Lookup tables. With per-worker tables each thread has its own, and an
+ * outside port's session lives in the table of the port's owner thread.
+ */
+always_inline clib_bihash_8_8_t *
+snat_in2out_table (snat_main_t * sm, u32 thread_index)
+{
+  if (sm->per_worker_tables)
+    return &sm->per_thread_data[thread_index].in2out;
+  return &sm->in2out;
+}
+
+always_inline clib_bihash_8_8_t *
+snat_out2in_table (snat_main_t * sm, u32 thread_index)
+{
+  if (sm->per_worker_tables)
+    return &sm->per_thread_data[thread_index].out2in;
+  return &sm->out2in;
+}
+
+always_inline clib_bihash_8_8_t *
+snat_user_hash (snat_main_t * sm, u32 thread_index)
+{
+  if (sm->per_worker_tables)
+    return &sm->per_thread_data[thread_index].user_hash;
+  return &sm->user_hash;
+}
+
+/** \brief out2in table which holds the session of an outside port.
+    @param sm SNAT main
+    @param port port number in network byte order
+*/
+always_inline clib_bihash_8_8_t *
+snat_out2in_table_for_port (snat_main_t * sm, u16 port)
+{
+  if (sm->per_worker_tables)
+    return snat_out2in_table
+      (sm, snat_port_owner_thread (sm, clib_net_to_host_u16 (port)));
+  return &sm->out2in;
+}
+
 /** \brief Check if SNAT session is created from static mapping.
     @param s SNAT session
     @return 1 if SNAT session is created from static mapping otherwise 0
@@ -746,33 +746,18 @@ static void
 }
 
 static void
-  vl_api_snat_user_session_dump_t_handler
-  (vl_api_snat_user_session_dump_t * mp)
+send_snat_user_sessions (snat_main_per_thread_data_t * tsm, u32 thread_index,
+			 clib_bihash_kv_8_8_t * key,
+			 unix_shared_memory_queue_t * q, u32 context)
 {
-  unix_shared_memory_queue_t *q;
   snat_main_t *sm = &snat_main;
-  snat_main_per_thread_data_t *tsm;
+  clib_bihash_kv_8_8_t value;
   snat_session_t *s;
-  clib_bihash_kv_8_8_t key, value;
-  snat_user_key_t ukey;
   snat_user_t *u;
   u32 session_index, head_index, elt_index;
   dlist_elt_t *head, *elt;
 
-  q = vl_api_client_index_to_input_queue (mp->client_index);
-  if (q == 0)
-    return;
-  if (!mp->is_ip4)
-    return;
-
-  clib_memcpy (&ukey.addr, mp->ip_address, 4);
-  ukey.fib_index = fib_table_find (FIB_PROTOCOL_IP4, ntohl (mp->vrf_id));
-  key.key = ukey.as_u64;
-  if (!clib_bihash_search_8_8 (&sm->worker_by_in, &key, &value))
-    tsm = vec_elt_at_index (sm->per_thread_data, value.value);
-  else
-    tsm = vec_elt_at_index (sm->per_thread_data, sm->num_workers);
-  if (clib_bihash_search_8_8 (&sm->user_hash, &key, &value))
+  if (clib_bihash_search_8_8 (snat_user_hash (sm, thread_index), key, &value))
     return;
   u = pool_elt_at_index (tsm->users, value.value);
   if (!u->nsessions && !u->nstaticsessions)
@@ -787,7 +772,7 @@ static void
     {
       s = pool_elt_at_index (tsm->sessions, session_index);
 
-      send_snat_user_session_details (s, q, mp->context);
+      send_snat_user_session_details (s, q, context);
 
       elt_index = elt->next;
       elt = pool_elt_at_index (tsm->list_pool, elt_index);
@@ -795,6 +780,44 @@ static void
     }
 }
 
+static void
+  vl_api_snat_user_session_dump_t_handler
+  (vl_api_snat_user_session_dump_t * mp)
+{
+  unix_shared_memory_queue_t *q;
+  snat_main_t *sm = &snat_main;
+  snat_main_per_thread_data_t *tsm;
+  clib_bihash_kv_8_8_t key, value;
+  snat_user_key_t ukey;
+  u32 thread_index;
+
+  q = vl_api_client_index_to_input_queue (mp->client_index);
+  if (q == 0)
+    return;
+  if (!mp->is_ip4)
+    return;
+
+  clib_memcpy (&ukey.addr, mp->ip_address, 4);
+  ukey.fib_index = fib_table_find (FIB_PROTOCOL_IP4, ntohl (mp->vrf_id));
+  key.key = ukey.as_u64;
+
+  /* With per-worker tables the user may have sessions on every thread */
+  if (sm->per_worker_tables)
+    {
+      vec_foreach (tsm, sm->per_thread_data)
+	send_snat_user_sessions (tsm, tsm - sm->per_thread_data, &key, q,
+				 mp->context);
+      return;
+    }
+
+  if (!clib_bihash_search_8_8 (&sm->worker_by_in, &key, &value))
+    thread_index = value.value;
+  else
+    thread_index = sm->num_workers;
+  tsm = vec_elt_at_index (sm->per_thread_data, thread_index);
+  send_snat_user_sessions (tsm, thread_index, &key, q, mp->context);
+}
+
 static void *vl_api_snat_user_session_dump_t_print
   (vl_api_snat_user_session_dump_t * mp, void *handle)
 {
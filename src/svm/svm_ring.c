@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <svm/svm_ring.h>
+#include <vppinfra/error.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <time.h>
+#include <errno.h>
+
+#define SVM_RING_WAIT_YIELDS 16
+
+/**
+ * Allocate a ring on the current heap
+ *
+ * Push the heap of a shared segment first for a ring other processes
+ * use. The number of elements is rounded up to a power of 2.
+ */
+svm_ring_t *
+svm_ring_init (u32 nels, u32 elsize)
+{
+  svm_ring_t *r;
+  u32 slot_size, i;
+
+  nels = max_pow2 (clib_max (nels, 2));
+  slot_size = round_pow2 (sizeof (svm_ring_slot_t) + elsize, sizeof (u32));
+
+  r = clib_mem_alloc_aligned (sizeof (*r) + nels * slot_size,
+			      CLIB_CACHE_LINE_BYTES);
+  r->nels = nels;
+  r->elsize = elsize;
+  r->slot_size = slot_size;
+  r->tail = 0;
+  r->head = 0;
+  r->consumer_waiting = 0;
+
+  for (i = 0; i < nels; i++)
+    svm_ring_slot (r, i)->seq = i;
+
+  return r;
+}
+
+void
+svm_ring_free (svm_ring_t * r)
+{
+  clib_mem_free (r);
+}
+
+static inline long
+svm_ring_futex (volatile u32 * addr, int op, u32 val, struct timespec *ts)
+{
+  /* Not FUTEX_PRIVATE_FLAG, the ring may be shared with other processes */
+  return syscall (SYS_futex, addr, op, val, ts, 0, 0);
+}
+
+/**
+ * Sleep until the ring is not empty, single consumer only
+ *
+ * @param timeout seconds, 0 to wait for ever
+ * @return 0 if the ring is not empty, -1 on timeout
+ */
+int
+svm_ring_wait (svm_ring_t * r, f64 timeout)
+{
+  struct timespec ts, *tsp = 0;
+  int i;
+
+  /* Producers usually follow up quickly, yield a few times before
+   * paying for a sleep and for their wake up */
+  for (i = 0; i < SVM_RING_WAIT_YIELDS; i++)
+    {
+      if (!svm_ring_is_empty (r))
+	return 0;
+      sched_yield ();
+    }
+
+  if (timeout > 0)
+    {
+      ts.tv_sec = timeout;
+      ts.tv_nsec = (timeout - ts.tv_sec) * 1e9;
+      tsp = &ts;
+    }
+
+  while (svm_ring_is_empty (r))
+    {
+      r->consumer_waiting = 1;
+      /* Pairs with the barrier in svm_ring_notify_consumer: either the
+       * producer sees the flag or we see its element */
+      CLIB_MEMORY_BARRIER ();
+      if (!svm_ring_is_empty (r))
+	break;
+      if (svm_ring_futex (&r->consumer_waiting, FUTEX_WAIT, 1, tsp) < 0
+	  && errno == ETIMEDOUT)
+	{
+	  r->consumer_waiting = 0;
+	  return -1;
+	}
+    }
+
+  r->consumer_waiting = 0;
+  return 0;
+}
+
+void
+svm_ring_wake (svm_ring_t * r)
+{
+  r->consumer_waiting = 0;
+  svm_ring_futex (&r->consumer_waiting, FUTEX_WAKE, 1, 0);
+}
+
+u8 *
+format_svm_ring (u8 * s, va_list * args)
+{
+  svm_ring_t *r = va_arg (*args, svm_ring_t *);
+
+  s = format (s, "nels %u elsize %u head %u tail %u elts %u%s",
+	      r->nels, r->elsize, r->head, r->tail, svm_ring_elts (r),
+	      r->consumer_waiting ? " consumer waiting" : "");
+  return s;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
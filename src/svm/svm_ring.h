@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Bounded, lock-free, multi-producer single-consumer ring of fixed size
+ * elements, usable across processes when allocated in shared memory.
+ *
+ * Each slot carries a sequence number. A producer reserves a slot by
+ * moving the tail with a compare-and-swap, copies its element and then
+ * publishes the slot by setting its sequence to position + 1. The
+ * consumer reads published slots in order and frees them by setting
+ * their sequence to position + nels, the position they will be written
+ * at the next time around. A consumer with nothing to do may sleep on
+ * a futex in the ring, producers wake it up only when it says it sleeps.
+ */
+#ifndef __included_svm_ring_h__
+#define __included_svm_ring_h__
+
+#include <vppinfra/clib.h>
+#include <vppinfra/mem.h>
+#include <vppinfra/format.h>
+#include <sched.h>
+
+typedef struct
+{
+  volatile u32 seq;
+  u8 data[0];
+} svm_ring_slot_t;
+
+typedef struct _svm_ring
+{
+  u32 nels;			/**< Number of slots, a power of 2 */
+  u32 elsize;
+  u32 slot_size;
+    CLIB_CACHE_LINE_ALIGN_MARK (producer);
+  volatile u32 tail;		/**< Next position producers reserve */
+    CLIB_CACHE_LINE_ALIGN_MARK (consumer);
+  volatile u32 head;		/**< Next position the consumer reads */
+  volatile u32 consumer_waiting;	/**< Futex the consumer sleeps on */
+    CLIB_CACHE_LINE_ALIGN_MARK (slots);
+  u8 data[0];
+} svm_ring_t;
+
+svm_ring_t *svm_ring_init (u32 nels, u32 elsize);
+void svm_ring_free (svm_ring_t * r);
+int svm_ring_wait (svm_ring_t * r, f64 timeout);
+void svm_ring_wake (svm_ring_t * r);
+format_function_t format_svm_ring;
+
+static inline svm_ring_slot_t *
+svm_ring_slot (svm_ring_t * r, u32 pos)
+{
+  return (svm_ring_slot_t *) (r->data + (pos & (r->nels - 1))
+			      * r->slot_size);
+}
+
+/** Approximate number of elements, exact if the ring is idle */
+static inline u32
+svm_ring_elts (svm_ring_t * r)
+{
+  return r->tail - r->head;
+}
+
+static inline int
+svm_ring_is_full (svm_ring_t * r)
+{
+  return svm_ring_elts (r) >= r->nels;
+}
+
+static inline int
+svm_ring_is_empty (svm_ring_t * r)
+{
+  svm_ring_slot_t *s = svm_ring_slot (r, r->head);
+  return __atomic_load_n (&s->seq, __ATOMIC_ACQUIRE) != r->head + 1;
+}
+
+static inline void
+svm_ring_notify_consumer (svm_ring_t * r)
+{
+  /* Order the publication before the read of the consumer's flag, the
+   * consumer sets the flag before it checks the ring one last time */
+  CLIB_MEMORY_BARRIER ();
+  if (PREDICT_FALSE (r->consumer_waiting))
+    svm_ring_wake (r);
+}
+
+/**
+ * Enqueue one element
+ *
+ * @param nowait if zero, yield until there is room, else fail if full
+ * @return 0 on success, -2 if the ring is full
+ */
+static inline int
+svm_ring_enqueue (svm_ring_t * r, void *elt, int nowait)
+{
+  svm_ring_slot_t *s;
+  u32 pos, seq;
+  i32 diff;
+
+  pos = r->tail;
+  while (1)
+    {
+      s = svm_ring_slot (r, pos);
+      seq = __atomic_load_n (&s->seq, __ATOMIC_ACQUIRE);
+      diff = (i32) (seq - pos);
+      if (diff == 0)
+	{
+	  if (__sync_bool_compare_and_swap (&r->tail, pos, pos + 1))
+	    break;
+	}
+      else if (diff < 0)
+	{
+	  /* Slot not consumed yet, i.e., the ring is full */
+	  if (nowait)
+	    return -2;
+	  sched_yield ();
+	}
+      pos = r->tail;
+    }
+
+  clib_memcpy (s->data, elt, r->elsize);
+  __atomic_store_n (&s->seq, pos + 1, __ATOMIC_RELEASE);
+  svm_ring_notify_consumer (r);
+  return 0;
+}
+
+/**
+ * Enqueue up to n elements with a single reservation
+ *
+ * @return number of elements enqueued, less than n if the ring filled up
+ */
+static inline u32
+svm_ring_enqueue_batch (svm_ring_t * r, void *elts, u32 n)
+{
+  svm_ring_slot_t *s;
+  u32 pos, n_free, i;
+
+  do
+    {
+      pos = r->tail;
+      /* The consumer frees the slots before it moves the head, so the
+       * slots below head + nels are free */
+      n_free = r->nels - (pos - __atomic_load_n (&r->head,
+						 __ATOMIC_ACQUIRE));
+      if ((i32) n_free <= 0)
+	return 0;
+      n = clib_min (n, n_free);
+    }
+  while (!__sync_bool_compare_and_swap (&r->tail, pos, pos + n));
+
+  for (i = 0; i < n; i++)
+    {
+      s = svm_ring_slot (r, pos + i);
+      clib_memcpy (s->data, (u8 *) elts + i * r->elsize, r->elsize);
+      __atomic_store_n (&s->seq, pos + i + 1, __ATOMIC_RELEASE);
+    }
+  svm_ring_notify_consumer (r);
+  return n;
+}
+
+/**
+ * Dequeue up to max elements, single consumer only
+ *
+ * @return number of elements dequeued
+ */
+static inline u32
+svm_ring_dequeue_batch (svm_ring_t * r, void *elts, u32 max)
+{
+  svm_ring_slot_t *s;
+  u32 pos = r->head, n;
+
+  for (n = 0; n < max; n++)
+    {
+      s = svm_ring_slot (r, pos + n);
+      if (__atomic_load_n (&s->seq, __ATOMIC_ACQUIRE) != pos + n + 1)
+	break;
+      clib_memcpy ((u8 *) elts + n * r->elsize, s->data, r->elsize);
+      __atomic_store_n (&s->seq, pos + n + r->nels, __ATOMIC_RELEASE);
+    }
+  __atomic_store_n (&r->head, pos + n, __ATOMIC_RELEASE);
+  return n;
+}
+
+/**
+ * Dequeue one element, single consumer only
+ *
+ * @param nowait if zero, sleep until an element is enqueued
+ * @return 0 on success, -2 if the ring is empty
+ */
+static inline int
+svm_ring_dequeue (svm_ring_t * r, void *elt, int nowait)
+{
+  while (svm_ring_dequeue_batch (r, elt, 1) == 0)
+    {
+      if (nowait)
+	return -2;
+      svm_ring_wait (r, 0);
+    }
+  return 0;
+}
+
+#endif /* __included_svm_ring_h__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Session event queue benchmark: producer threads send session events
+ * to a single consumer, as apps and vpp workers do to a vpp worker, over
+ * the mutex protected unix_shared_memory_queue and over the lock-free
+ * svm_ring. Reports events/second for each.
+ *
+ * uri_event_queue_test [producers <n>] [events <n>] [queue-size <n>]
+ *                      [batch <n>]
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <vppinfra/clib.h>
+#include <vppinfra/mem.h>
+#include <vppinfra/mheap.h>
+#include <vppinfra/time.h>
+#include <vppinfra/format.h>
+#include <vppinfra/error.h>
+#include <vlibmemory/unix_shared_memory_queue.h>
+#include <svm/svm_ring.h>
+#include <vnet/session/session.h>
+
+/* Satisfy external references when not linking with -lvlib */
+vlib_main_t vlib_global_main;
+vlib_main_t **vlib_mains;
+
+#define EVENT_QUEUE_TEST_MAX_BATCH 256
+
+typedef enum
+{
+  EVENT_QUEUE_TEST_SHM_QUEUE,
+  EVENT_QUEUE_TEST_RING,
+} event_queue_test_type_t;
+
+typedef struct
+{
+  /* Parameters */
+  u32 n_producers;
+  u64 n_events;			/**< Per producer */
+  u32 queue_size;
+  u32 batch;			/**< Producer enqueue batch, ring only */
+
+  event_queue_test_type_t type;
+  unix_shared_memory_queue_t *shm_queue;
+  svm_ring_t *ring;
+
+  clib_time_t clib_time;
+} event_queue_test_main_t;
+
+event_queue_test_main_t event_queue_test_main;
+
+static void *
+producer_thread_fn (void *arg)
+{
+  event_queue_test_main_t *eqm = &event_queue_test_main;
+  session_fifo_event_t evts[EVENT_QUEUE_TEST_MAX_BATCH];
+  u64 i, n_left;
+  u32 n, n_done;
+
+  for (i = 0; i < ARRAY_LEN (evts); i++)
+    {
+      evts[i].session_handle = pointer_to_uword (arg);
+      evts[i].event_type = FIFO_EVENT_APP_TX;
+      evts[i].event_id = i;
+    }
+
+  if (eqm->type == EVENT_QUEUE_TEST_SHM_QUEUE)
+    {
+      for (i = 0; i < eqm->n_events; i++)
+	unix_shared_memory_queue_add (eqm->shm_queue, (u8 *) evts,
+				      0 /* wait */ );
+      return 0;
+    }
+
+  n_left = eqm->n_events;
+  while (n_left > 0)
+    {
+      n = clib_min (n_left, eqm->batch);
+      if (n == 1)
+	{
+	  svm_ring_enqueue (eqm->ring, evts, 0 /* wait */ );
+	  n_left--;
+	  continue;
+	}
+      n_done = svm_ring_enqueue_batch (eqm->ring, evts, n);
+      if (n_done == 0)
+	sched_yield ();
+      n_left -= n_done;
+    }
+  return 0;
+}
+
+static f64
+event_queue_test_run (event_queue_test_main_t * eqm,
+		      event_queue_test_type_t type)
+{
+  session_fifo_event_t evts[EVENT_QUEUE_TEST_MAX_BATCH];
+  pthread_t *producers = 0;
+  u64 n_received = 0, n_expected;
+  f64 start, elapsed;
+  u32 i;
+
+  eqm->type = type;
+  n_expected = eqm->n_events * eqm->n_producers;
+  vec_validate (producers, eqm->n_producers - 1);
+
+  start = clib_time_now (&eqm->clib_time);
+  for (i = 0; i < eqm->n_producers; i++)
+    if (pthread_create (&producers[i], NULL, producer_thread_fn,
+			uword_to_pointer (i, void *)))
+      clib_unix_warning ("pthread_create");
+
+  if (type == EVENT_QUEUE_TEST_SHM_QUEUE)
+    {
+      /* One event per lock, as apps dequeue */
+      while (n_received < n_expected)
+	{
+	  unix_shared_memory_queue_sub (eqm->shm_queue, (u8 *) evts,
+					0 /* wait */ );
+	  n_received++;
+	}
+    }
+  else
+    {
+      while (n_received < n_expected)
+	{
+	  i = svm_ring_dequeue_batch (eqm->ring, evts, ARRAY_LEN (evts));
+	  if (i == 0)
+	    svm_ring_wait (eqm->ring, 0);
+	  n_received += i;
+	}
+    }
+  elapsed = clib_time_now (&eqm->clib_time) - start;
+
+  for (i = 0; i < eqm->n_producers; i++)
+    pthread_join (producers[i], NULL);
+  vec_free (producers);
+
+  return n_received / elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  event_queue_test_main_t *eqm = &event_queue_test_main;
+  unformat_input_t _argv, *a = &_argv;
+  u8 *heap;
+  mheap_t *h;
+  f64 shm_rate, ring_rate;
+
+  clib_mem_init (0, 256 << 20);
+
+  heap = clib_mem_get_per_cpu_heap ();
+  h = mheap_header (heap);
+
+  /* make the main heap thread-safe */
+  h->flags |= MHEAP_FLAG_THREAD_SAFE;
+
+  eqm->n_producers = 1;
+  eqm->n_events = 10 << 20;
+  eqm->queue_size = 2048;
+  eqm->batch = 1;
+
+  clib_time_init (&eqm->clib_time);
+  unformat_init_command_line (a, argv);
+
+  while (unformat_check_input (a) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (a, "producers %d", &eqm->n_producers))
+	;
+      else if (unformat (a, "events %lld", &eqm->n_events))
+	;
+      else if (unformat (a, "queue-size %d", &eqm->queue_size))
+	;
+      else if (unformat (a, "batch %d", &eqm->batch))
+	;
+      else
+	{
+	  fformat (stderr, "%s: usage [producers <n>] [events <n>] "
+		   "[queue-size <n>] [batch <n>]\n", argv[0]);
+	  exit (1);
+	}
+    }
+
+  if (eqm->n_producers == 0 || eqm->batch == 0
+      || eqm->batch > EVENT_QUEUE_TEST_MAX_BATCH)
+    {
+      fformat (stderr, "producers must be > 0, batch in [1, %d]\n",
+	       EVENT_QUEUE_TEST_MAX_BATCH);
+      exit (1);
+    }
+
+  eqm->shm_queue =
+    unix_shared_memory_queue_init (eqm->queue_size,
+				   sizeof (session_fifo_event_t),
+				   0 /* consumer pid */ ,
+				   0 /* signal when queue non-empty */ );
+  eqm->ring = svm_ring_init (eqm->queue_size, sizeof (session_fifo_event_t));
+
+  fformat (stdout, "%d producers, %lld events each, queue size %d, "
+	   "producer batch %d\n", eqm->n_producers, eqm->n_events,
+	   eqm->queue_size, eqm->batch);
+
+  shm_rate = event_queue_test_run (eqm, EVENT_QUEUE_TEST_SHM_QUEUE);
+  fformat (stdout, "unix_shared_memory_queue: %.2f Mevents/s\n",
+	   shm_rate / 1e6);
+
+  ring_rate = event_queue_test_run (eqm, EVENT_QUEUE_TEST_RING);
+  fformat (stdout, "svm_ring: %.2f Mevents/s (%.2fx)\n", ring_rate / 1e6,
+	   ring_rate / shm_rate);
+
+  unix_shared_memory_queue_free (eqm->shm_queue);
+  svm_ring_free (eqm->ring);
+  exit (0);
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
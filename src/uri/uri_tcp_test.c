@@ -36,6 +36,8 @@
 #include <vpp/api/vpe_all_api_h.h>
 #undef vl_printfun
 
+#define URI_TCP_TEST_EVT_BATCH 64
+
 /* Satisfy external references when not linking with -lvlib */
 vlib_main_t vlib_global_main;
 vlib_main_t **vlib_mains;
@@ -90,10 +92,10 @@ typedef struct
   int drop_packets;
 
   /* Our event queue */
-  unix_shared_memory_queue_t *our_event_queue;
+  svm_ring_t *our_event_queue;
 
   /* $$$ single thread only for the moment */
-  unix_shared_memory_queue_t *vpp_event_queue;
+  svm_ring_t *vpp_event_queue;
 
   pid_t my_pid;
 
@@ -253,7 +255,7 @@ vl_api_application_attach_reply_t_handler (vl_api_application_attach_reply_t *
   a->segment_name = (char *) mp->segment_name;
   a->segment_size = mp->segment_size;
 
-  ASSERT (mp->app_event_queue_address);
+  ASSERT (mp->app_event_ring_address);
 
   /* Attach to the segment vpp created */
   rv = svm_fifo_segment_attach (a);
@@ -265,8 +267,7 @@ vl_api_application_attach_reply_t_handler (vl_api_application_attach_reply_t *
     }
 
   utm->our_event_queue =
-    uword_to_pointer (mp->app_event_queue_address,
-		      unix_shared_memory_queue_t *);
+    uword_to_pointer (mp->app_event_ring_address, svm_ring_t *);
   utm->state = STATE_ATTACHED;
 }
 
@@ -481,8 +482,7 @@ client_handle_event_queue (uri_tcp_test_main_t * utm)
 {
   session_fifo_event_t _e, *e = &_e;;
 
-  unix_shared_memory_queue_sub (utm->our_event_queue, (u8 *) e,
-				0 /* nowait */ );
+  svm_ring_dequeue (utm->our_event_queue, e, 0 /* wait */ );
   switch (e->event_type)
     {
     case FIFO_EVENT_APP_RX:
@@ -507,8 +507,7 @@ client_rx_thread_fn (void *arg)
   utm->client_bytes_received = 0;
   while (1)
     {
-      unix_shared_memory_queue_sub (utm->our_event_queue, (u8 *) e,
-				    0 /* nowait */ );
+      svm_ring_dequeue (utm->our_event_queue, e, 0 /* wait */ );
       switch (e->event_type)
 	{
 	case FIFO_EVENT_APP_RX:
@@ -547,8 +546,7 @@ vl_api_connect_uri_reply_t_handler (vl_api_connect_uri_reply_t * mp)
     }
 
   utm->vpp_event_queue =
-    uword_to_pointer (mp->vpp_event_queue_address,
-		      unix_shared_memory_queue_t *);
+    uword_to_pointer (mp->vpp_event_ring_address, svm_ring_t *);
 
   /*
    * Setup session
@@ -621,9 +619,7 @@ send_test_chunk (uri_tcp_test_main_t * utm, svm_fifo_t * tx_fifo, int mypid,
 	      evt.event_type = FIFO_EVENT_APP_TX;
 	      evt.event_id = serial_number++;
 
-	      unix_shared_memory_queue_add (utm->vpp_event_queue,
-					    (u8 *) & evt,
-					    0 /* do wait for mutex */ );
+	      svm_ring_enqueue (utm->vpp_event_queue, &evt, 0 /* wait */ );
 	    }
 	}
     }
@@ -886,8 +882,7 @@ vl_api_accept_session_t_handler (vl_api_accept_session_t * mp)
   clib_warning ("Accepted session from: %s:%d", ip_str,
 		clib_net_to_host_u16 (mp->port));
   utm->vpp_event_queue =
-    uword_to_pointer (mp->vpp_event_queue_address,
-		      unix_shared_memory_queue_t *);
+    uword_to_pointer (mp->vpp_event_ring_address, svm_ring_t *);
 
   /* Allocate local session and set it up */
   pool_get (utm->sessions, session);
@@ -935,7 +930,6 @@ server_handle_fifo_event_rx (uri_tcp_test_main_t * utm,
   svm_fifo_t *rx_fifo, *tx_fifo;
   int n_read;
   session_fifo_event_t evt;
-  unix_shared_memory_queue_t *q;
   session_t *session;
   int rv;
   u32 max_dequeue, offset, max_transfer, rx_buf_len;
@@ -989,9 +983,7 @@ server_handle_fifo_event_rx (uri_tcp_test_main_t * utm,
 	      evt.event_type = FIFO_EVENT_APP_TX;
 	      evt.event_id = e->event_id;
 
-	      q = utm->vpp_event_queue;
-	      unix_shared_memory_queue_add (q, (u8 *) & evt,
-					    1 /* do wait for mutex */ );
+	      svm_ring_enqueue (utm->vpp_event_queue, &evt, 0 /* wait */ );
 	    }
 	}
     }
@@ -1001,24 +993,33 @@ server_handle_fifo_event_rx (uri_tcp_test_main_t * utm,
 void
 server_handle_event_queue (uri_tcp_test_main_t * utm)
 {
-  session_fifo_event_t _e, *e = &_e;;
+  session_fifo_event_t events[URI_TCP_TEST_EVT_BATCH], *e;
+  u32 i, n_events;
 
   while (1)
     {
-      unix_shared_memory_queue_sub (utm->our_event_queue, (u8 *) e,
-				    0 /* nowait */ );
-      switch (e->event_type)
+      /* Take all the events vpp queued, sleep if there are none */
+      n_events = svm_ring_dequeue_batch (utm->our_event_queue, events,
+					 ARRAY_LEN (events));
+      if (n_events == 0)
+	svm_ring_wait (utm->our_event_queue, 1.0 /* timeout */ );
+
+      for (i = 0; i < n_events; i++)
 	{
-	case FIFO_EVENT_APP_RX:
-	  server_handle_fifo_event_rx (utm, e);
-	  break;
+	  e = &events[i];
+	  switch (e->event_type)
+	    {
+	    case FIFO_EVENT_APP_RX:
+	      server_handle_fifo_event_rx (utm, e);
+	      break;
 
-	case FIFO_EVENT_DISCONNECT:
-	  return;
+	    case FIFO_EVENT_DISCONNECT:
+	      return;
 
-	default:
-	  clib_warning ("unknown event type %d", e->event_type);
-	  break;
+	    default:
+	      clib_warning ("unknown event type %d", e->event_type);
+	      break;
+	    }
 	}
       if (PREDICT_FALSE (utm->time_to_stop == 1))
 	break;
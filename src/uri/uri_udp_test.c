@@ -94,10 +94,10 @@ typedef struct
   int i_am_master;
 
   /* Our event queue */
-  unix_shared_memory_queue_t *our_event_queue;
+  svm_ring_t *our_event_queue;
 
   /* $$$ single thread only for the moment */
-  unix_shared_memory_queue_t *vpp_event_queue;
+  svm_ring_t *vpp_event_queue;
 
   /* $$$$ hack: cut-through session index */
   volatile u32 cut_through_session_index;
@@ -221,7 +221,7 @@ vl_api_application_attach_reply_t_handler (vl_api_application_attach_reply_t *
   a->segment_name = (char *) mp->segment_name;
   a->segment_size = mp->segment_size;
 
-  ASSERT (mp->app_event_queue_address);
+  ASSERT (mp->app_event_ring_address);
 
   /* Attach to the segment vpp created */
   rv = svm_fifo_segment_attach (a);
@@ -233,8 +233,7 @@ vl_api_application_attach_reply_t_handler (vl_api_application_attach_reply_t *
     }
 
   utm->our_event_queue =
-    uword_to_pointer (mp->app_event_queue_address,
-		      unix_shared_memory_queue_t *);
+    uword_to_pointer (mp->app_event_ring_address, svm_ring_t *);
 }
 
 static void
@@ -613,8 +612,7 @@ vl_api_accept_session_t_handler (vl_api_accept_session_t * mp)
     start_time = clib_time_now (&utm->clib_time);
 
   utm->vpp_event_queue =
-    uword_to_pointer (mp->vpp_event_queue_address,
-		      unix_shared_memory_queue_t *);
+    uword_to_pointer (mp->vpp_event_ring_address, svm_ring_t *);
 
   pool_get (utm->sessions, session);
 
@@ -795,7 +793,6 @@ server_handle_fifo_event_rx (uri_udp_test_main_t * utm,
   int nbytes;
 
   session_fifo_event_t evt;
-  unix_shared_memory_queue_t *q;
   int rv;
 
   rx_fifo = e->fifo;
@@ -819,11 +816,7 @@ server_handle_fifo_event_rx (uri_udp_test_main_t * utm,
   evt.event_id = e->event_id;
 
   if (svm_fifo_set_event (tx_fifo))
-    {
-      q = utm->vpp_event_queue;
-      unix_shared_memory_queue_add (q, (u8 *) & evt,
-				    0 /* do wait for mutex */ );
-    }
+    svm_ring_enqueue (utm->vpp_event_queue, &evt, 0 /* wait */ );
 }
 
 void
@@ -833,8 +826,7 @@ server_handle_event_queue (uri_udp_test_main_t * utm)
 
   while (1)
     {
-      unix_shared_memory_queue_sub (utm->our_event_queue, (u8 *) e,
-				    0 /* nowait */ );
+      svm_ring_dequeue (utm->our_event_queue, e, 0 /* wait */ );
       switch (e->event_type)
 	{
 	case FIFO_EVENT_APP_RX:
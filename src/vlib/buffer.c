@@ -389,6 +389,11 @@ vlib_buffer_create_free_list_helper (vlib_main_t * vm,
   f->buffer_init_template.free_list_index = f->index;
   f->buffer_init_template.n_add_refs = 0;
 
+  f->global_pool = clib_mem_alloc_aligned (sizeof (f->global_pool[0]),
+					   CLIB_CACHE_LINE_BYTES);
+  memset (f->global_pool, 0, sizeof (f->global_pool[0]));
+  f->global_pool->head = ~0U;
+
   if (is_public)
     {
       uword *p = hash_get (bm->free_list_by_size, f->n_data_bytes);
@@ -407,6 +412,8 @@ vlib_buffer_create_free_list_helper (vlib_main_t * vm,
       wf[0] = f[0];
       wf->buffers = 0;
       wf->n_alloc = 0;
+      wf->n_pool_gets = 0;
+      wf->n_pool_puts = 0;
     }
 
   return f->index;
@@ -453,6 +460,75 @@ vlib_buffer_get_or_create_free_list (vlib_main_t * vm, u32 n_data_bytes,
   return i;
 }
 
+/* Take a batch of buffers from the global pool, if any. */
+static_always_inline int
+vlib_buffer_pool_get_batch (vlib_main_t * vm, vlib_buffer_free_list_t * fl)
+{
+  vlib_buffer_global_pool_t *gp = fl->global_pool;
+  vlib_buffer_t *b;
+  u64 old, new;
+  u32 *bi;
+
+  do
+    {
+      old = gp->head;
+      if ((u32) old == ~0U)
+	return 0;
+      /*
+       * Another thread may take this batch and reuse the buffer before
+       * we swap, we then read garbage: the tag makes the swap fail.
+       */
+      b = vlib_get_buffer (vm, (u32) old);
+      new = (((old >> 32) + 1) << 32) | b->next_buffer;
+    }
+  while (!__sync_bool_compare_and_swap (&gp->head, old, new));
+
+  __sync_fetch_and_sub (&gp->n_buffers, VLIB_BUFFER_POOL_BATCH_SIZE);
+  fl->n_pool_gets++;
+
+  vec_add2_aligned (fl->buffers, bi, VLIB_BUFFER_POOL_BATCH_SIZE,
+		    CLIB_CACHE_LINE_BYTES);
+  clib_memcpy (bi, b->pre_data, VLIB_BUFFER_POOL_BATCH_SIZE * sizeof (u32));
+  return 1;
+}
+
+/* Give a batch of buffers from the end of the free list to the pool. */
+static_always_inline void
+vlib_buffer_pool_put_batch (vlib_main_t * vm, vlib_buffer_free_list_t * fl)
+{
+  vlib_buffer_global_pool_t *gp = fl->global_pool;
+  vlib_buffer_t *b;
+  u64 old, new;
+  u32 *bi;
+
+  ASSERT (vec_len (fl->buffers) >= VLIB_BUFFER_POOL_BATCH_SIZE);
+  bi = vec_end (fl->buffers) - VLIB_BUFFER_POOL_BATCH_SIZE;
+  b = vlib_get_buffer (vm, bi[0]);
+  clib_memcpy (b->pre_data, bi, VLIB_BUFFER_POOL_BATCH_SIZE * sizeof (u32));
+  _vec_len (fl->buffers) -= VLIB_BUFFER_POOL_BATCH_SIZE;
+
+  /* the swap is a full barrier: the batch is written before it is seen */
+  do
+    {
+      old = gp->head;
+      b->next_buffer = (u32) old;
+      new = (((old >> 32) + 1) << 32) | bi[0];
+    }
+  while (!__sync_bool_compare_and_swap (&gp->head, old, new));
+
+  __sync_fetch_and_add (&gp->n_buffers, VLIB_BUFFER_POOL_BATCH_SIZE);
+  fl->n_pool_puts++;
+}
+
+/* Bring a per thread free list back to its cache size. */
+static void
+vlib_buffer_cache_trim (vlib_main_t * vm, vlib_buffer_free_list_t * fl)
+{
+  while (vec_len (fl->buffers) >
+	 VLIB_BUFFER_CACHE_LOW + VLIB_BUFFER_POOL_BATCH_SIZE)
+    vlib_buffer_pool_put_batch (vm, fl);
+}
+
 static void
 del_free_list (vlib_main_t * vm, vlib_buffer_free_list_t * f)
 {
@@ -463,6 +539,7 @@ del_free_list (vlib_main_t * vm, vlib_buffer_free_list_t * f)
   vec_free (f->name);
   vec_free (f->buffer_memory_allocated);
   vec_free (f->buffers);
+  clib_mem_free (f->global_pool);
 }
 
 /* Add buffer free list. */
@@ -470,15 +547,39 @@ void
 vlib_buffer_delete_free_list_internal (vlib_main_t * vm, u32 free_list_index)
 {
   vlib_buffer_main_t *bm = vm->buffer_main;
-  vlib_buffer_free_list_t *f;
-  u32 merge_index;
+  vlib_buffer_free_list_t *f, *wf;
+  u32 merge_index, n_alloc;
+  void *oldheap;
   int i;
 
   ASSERT (vlib_get_thread_index () == 0);
 
   f = vlib_buffer_get_free_list (vm, free_list_index);
 
-  ASSERT (vec_len (f->buffers) == f->n_alloc);
+  /* the buffers parked in the global pool are ours again */
+  while (vlib_buffer_pool_get_batch (vm, f))
+    ;
+
+  /*
+   * So are the ones cached by the workers, which are held at the
+   * barrier. Buffers move between threads through the pool, so only
+   * the sum of what each thread allocated matches what we now hold.
+   */
+  n_alloc = f->n_alloc;
+  for (i = 1; i < vec_len (vlib_mains); i++)
+    {
+      wf = vlib_buffer_get_free_list (vlib_mains[i], free_list_index);
+      n_alloc += wf->n_alloc;
+      if (vec_len (wf->buffers))
+	vec_add_aligned (f->buffers, wf->buffers, vec_len (wf->buffers),
+			 CLIB_CACHE_LINE_BYTES);
+      /* the vector itself lives on the worker's heap */
+      oldheap = clib_mem_set_heap (vlib_mains[i]->heap_base);
+      vec_free (wf->buffers);
+      clib_mem_set_heap (oldheap);
+    }
+
+  ASSERT (vec_len (f->buffers) == n_alloc);
   merge_index = vlib_buffer_get_free_list_with_size (vm, f->n_data_bytes);
   if (merge_index != ~0 && merge_index != free_list_index)
     {
@@ -518,6 +619,15 @@ fill_free_list (vlib_main_t * vm,
   if (n <= 0)
     return min_free_buffers;
 
+  /* Buffers freed by the other threads first */
+  while (vec_len (fl->buffers) < min_free_buffers
+	 && vlib_buffer_pool_get_batch (vm, fl))
+    ;
+
+  n = min_free_buffers - vec_len (fl->buffers);
+  if (n <= 0)
+    return min_free_buffers;
+
   /* Always allocate round number of buffers. */
   n = round_pow2 (n, CLIB_CACHE_LINE_BYTES / sizeof (u32));
 
@@ -714,6 +824,9 @@ vlib_buffer_free_inline (vlib_main_t * vm,
 	      while (follow_buffer_next
 		     && (flags & VLIB_BUFFER_NEXT_PRESENT));
 
+	      if (PREDICT_FALSE (vec_len (fl->buffers) >
+				 VLIB_BUFFER_CACHE_HIGH))
+		vlib_buffer_cache_trim (vm, fl);
 	    }
 	}
     }
@@ -953,19 +1066,39 @@ format_vlib_buffer_free_list (u8 * s, va_list * va)
   uword bytes_alloc, bytes_free, n_free, size;
 
   if (!f)
-    return format (s, "%=7s%=30s%=12s%=12s%=12s%=12s%=12s%=12s",
+    return format (s, "%=7s%=30s%=12s%=12s%=12s%=12s%=12s%=12s%=12s%=12s",
 		   "Thread", "Name", "Index", "Size", "Alloc", "Free",
-		   "#Alloc", "#Free");
+		   "#Alloc", "#Free", "#Pool-get", "#Pool-put");
 
   size = sizeof (vlib_buffer_t) + f->n_data_bytes;
   n_free = vec_len (f->buffers);
   bytes_alloc = size * f->n_alloc;
   bytes_free = size * n_free;
 
-  s = format (s, "%7d%30s%12d%12d%=12U%=12U%=12d%=12d", threadnum,
-	      f->name, f->index, f->n_data_bytes,
+  s = format (s, "%7d%30s%12d%12d%=12U%=12U%=12d%=12d%=12llu%=12llu",
+	      threadnum, f->name, f->index, f->n_data_bytes,
 	      format_memory_size, bytes_alloc,
-	      format_memory_size, bytes_free, f->n_alloc, n_free);
+	      format_memory_size, bytes_free, f->n_alloc, n_free,
+	      f->n_pool_gets, f->n_pool_puts);
+
+  return s;
+}
+
+static u8 *
+format_vlib_buffer_global_pool (u8 * s, va_list * va)
+{
+  vlib_buffer_free_list_t *f = va_arg (*va, vlib_buffer_free_list_t *);
+  uword n_free, size;
+
+  if (!f)
+    return format (s, "%=7s%=30s%=12s%=12s%=12s%=12s%=12s",
+		   "", "Shared pool", "Index", "Size", "", "Free", "#Free");
+
+  size = sizeof (vlib_buffer_t) + f->n_data_bytes;
+  n_free = f->global_pool->n_buffers;
+
+  s = format (s, "%7s%30s%12d%12d%12s%=12U%=12d", "", f->name, f->index,
+	      f->n_data_bytes, "", format_memory_size, size * n_free, n_free);
 
   return s;
 }
@@ -996,6 +1129,18 @@ show_buffers (vlib_main_t * vm,
     }
   while (vm_index < vec_len (vlib_mains));
 
+  /* Shared by all the threads, hence in thread 0's free lists only */
+  if (vm->buffer_main->extern_buffer_mgmt == 0)
+    {
+      bm = vlib_mains[0]->buffer_main;
+      vlib_cli_output (vm, "%U", format_vlib_buffer_global_pool, 0);
+      /* *INDENT-OFF* */
+      pool_foreach (f, bm->buffer_free_list_pool, ({
+	vlib_cli_output (vm, "%U", format_vlib_buffer_global_pool, f);
+      }));
+      /* *INDENT-ON* */
+    }
+
   return 0;
 }
 
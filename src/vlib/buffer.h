@@ -323,6 +323,31 @@ vlib_buffer_pull (vlib_buffer_t * b, u8 size)
 /* Forward declaration. */
 struct vlib_main_t;
 
+/*
+ * The free buffers of a free list shared by all the threads, in batches.
+ * The per thread free lists are a cache in front of it: a thread takes
+ * a batch when its free list runs dry, before allocating new buffers,
+ * and gives batches back when its free list grows beyond
+ * VLIB_BUFFER_CACHE_HIGH, e.g. because it frees buffers allocated by
+ * another thread.
+ *
+ * The pool is a lock-free stack of batches. The indices of a batch are
+ * stored in the pre_data of its first buffer, the first buffer of the
+ * next batch in its next_buffer field.
+ */
+#define VLIB_BUFFER_POOL_BATCH_SIZE (VLIB_BUFFER_PRE_DATA_SIZE / sizeof (u32))
+#define VLIB_BUFFER_CACHE_HIGH (4 * VLIB_FRAME_SIZE)
+#define VLIB_BUFFER_CACHE_LOW (2 * VLIB_FRAME_SIZE)
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  /* ABA tag in the high 32 bits, first buffer of the top batch or ~0 */
+  volatile u64 head;
+  /* number of buffers in the pool */
+  volatile uword n_buffers;
+} vlib_buffer_global_pool_t;
+
 typedef struct vlib_buffer_free_list_t
 {
   /* Template buffer used to initialize first 16 bytes of buffers
@@ -345,6 +370,13 @@ typedef struct vlib_buffer_free_list_t
   /* Vector of free buffers.  Each element is a byte offset into I/O heap. */
   u32 *buffers;
 
+  /* Shared by the same free list of all the threads. */
+  vlib_buffer_global_pool_t *global_pool;
+
+  /* Batches this thread took from / gave to the global pool. */
+  u64 n_pool_gets;
+  u64 n_pool_puts;
+
   /* Memory chunks allocated for this free list
      recorded here so they can be freed when free list
      is deleted. */
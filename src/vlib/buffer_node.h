@@ -326,6 +326,119 @@ generic_buffer_node_inline (vlib_main_t * vm,
   return frame->n_vectors;
 }
 
+/**
+ * Hand buffers off to other threads through a frame queue.
+ *
+ * thread_indices[i] is the thread buffer_indices[i] goes to. Runs of
+ * buffers to the same thread are copied into one frame queue element;
+ * the elements filled up are published as they fill, the others once
+ * at the end, behind a single memory barrier.
+ *
+ * With the drop congestion policy, the buffers for a thread whose
+ * queue is congested are freed instead of waiting for room.
+ *
+ * @return the number of buffers handed off
+ */
+always_inline u32
+vlib_buffer_enqueue_to_thread (vlib_main_t * vm, u32 frame_queue_index,
+			       u32 * buffer_indices, u16 * thread_indices,
+			       u32 n_packets)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm;
+  vlib_frame_queue_per_thread_data_t *ptd;
+  vlib_frame_queue_counters_t *c;
+  vlib_frame_queue_elt_t *hf = 0;
+  u32 n_left_to_next_thread = 0, *to_next_thread = 0;
+  u32 next_thread_index, current_thread_index = ~0;
+  u32 drop_list[VLIB_FRAME_SIZE], n_drop = 0;
+  u32 n_left = n_packets;
+  int drop_on_congestion;
+  int i;
+
+  ASSERT (n_packets <= VLIB_FRAME_SIZE);
+
+  fqm = vec_elt_at_index (tm->frame_queue_mains, frame_queue_index);
+  ptd = vec_elt_at_index (fqm->per_thread_data, vm->thread_index);
+  drop_on_congestion =
+    (fqm->congestion_policy == VLIB_FRAME_QUEUE_CONGESTION_DROP);
+
+  while (n_left)
+    {
+      next_thread_index = thread_indices[0];
+
+      if (next_thread_index != current_thread_index)
+	{
+	  if (drop_on_congestion
+	      && is_vlib_frame_queue_congested
+	      (frame_queue_index, next_thread_index, fqm->queue_hi_thresh,
+	       ptd->congested_handoff_queue_by_thread_index))
+	    {
+	      ptd->counters_by_thread_index[next_thread_index].drops++;
+	      drop_list[n_drop++] = buffer_indices[0];
+	      goto next;
+	    }
+
+	  if (hf)
+	    hf->n_vectors = VLIB_FRAME_SIZE - n_left_to_next_thread;
+
+	  hf = vlib_get_worker_handoff_queue_elt
+	    (frame_queue_index, next_thread_index,
+	     ptd->handoff_queue_elt_by_thread_index);
+
+	  n_left_to_next_thread = VLIB_FRAME_SIZE - hf->n_vectors;
+	  to_next_thread = &hf->buffer_index[hf->n_vectors];
+	  current_thread_index = next_thread_index;
+	}
+
+      to_next_thread[0] = buffer_indices[0];
+      to_next_thread++;
+      n_left_to_next_thread--;
+
+      if (n_left_to_next_thread == 0)
+	{
+	  hf->n_vectors = VLIB_FRAME_SIZE;
+	  vlib_put_frame_queue_elt (hf);
+	  c = &ptd->counters_by_thread_index[current_thread_index];
+	  c->enqueues++;
+	  c->enqueue_vectors += VLIB_FRAME_SIZE;
+	  ptd->handoff_queue_elt_by_thread_index[current_thread_index] = 0;
+	  current_thread_index = ~0;
+	  hf = 0;
+	}
+
+    next:
+      thread_indices++;
+      buffer_indices++;
+      n_left--;
+    }
+
+  if (hf)
+    hf->n_vectors = VLIB_FRAME_SIZE - n_left_to_next_thread;
+
+  /* Ship the partially filled elements, one barrier for all of them */
+  CLIB_MEMORY_BARRIER ();
+  for (i = 0; i < vec_len (ptd->handoff_queue_elt_by_thread_index); i++)
+    {
+      hf = ptd->handoff_queue_elt_by_thread_index[i];
+      if (hf)
+	{
+	  c = &ptd->counters_by_thread_index[i];
+	  c->enqueues++;
+	  c->enqueue_vectors += hf->n_vectors;
+	  hf->valid = 1;
+	  ptd->handoff_queue_elt_by_thread_index[i] = 0;
+	}
+      ptd->congested_handoff_queue_by_thread_index[i] =
+	(vlib_frame_queue_t *) (~0);
+    }
+
+  if (n_drop)
+    vlib_buffer_free (vm, drop_list, n_drop);
+
+  return n_packets - n_drop;
+}
+
 #endif /* included_vlib_buffer_node_h */
 
 /*
@@ -583,7 +583,11 @@ vlib_cli_dispatch_sub_commands (vlib_main_t * vm,
 	  else
 	    {
 	      if (!c->is_mp_safe)
-		vlib_worker_thread_barrier_sync (vm);
+		{
+		  u8 *caller = format (0, "cli: %v%c", c->path, 0);
+		  vlib_worker_thread_barrier_sync_int (vm, (char *) caller);
+		  vec_free (caller);
+		}
 
 	      c_error = c->function (vm, si, c);
 
@@ -74,26 +74,101 @@ vlib_clear_combined_counters (vlib_combined_counter_main_t * cm)
     }
 }
 
+void *vlib_stats_push_heap (void) __attribute__ ((weak));
+void *
+vlib_stats_push_heap (void)
+{
+  return 0;
+}
+
+void vlib_stats_pop_heap (void *, void *, stat_directory_type_t)
+  __attribute__ ((weak));
+void
+vlib_stats_pop_heap (void *cm, void *oldheap, stat_directory_type_t type)
+{
+}
+
+void vlib_stats_pop_heap2 (u64 *, u32, void *) __attribute__ ((weak));
+void
+vlib_stats_pop_heap2 (u64 * error_vector, u32 thread_index, void *oldheap)
+{
+}
+
+void vlib_stats_register_error_index (u8 *, u64) __attribute__ ((weak));
+void
+vlib_stats_register_error_index (u8 * name, u64 index)
+{
+}
+
 void
 vlib_validate_simple_counter (vlib_simple_counter_main_t * cm, u32 index)
 {
   vlib_thread_main_t *tm = vlib_get_thread_main ();
+  void *oldheap = 0;
   int i;
 
+  if (cm->stat_segment_name)
+    oldheap = vlib_stats_push_heap ();
+
   vec_validate (cm->counters, tm->n_vlib_mains - 1);
   for (i = 0; i < tm->n_vlib_mains; i++)
     vec_validate_aligned (cm->counters[i], index, CLIB_CACHE_LINE_BYTES);
+
+  if (oldheap)
+    vlib_stats_pop_heap (cm, oldheap, STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE);
 }
 
 void
 vlib_validate_combined_counter (vlib_combined_counter_main_t * cm, u32 index)
 {
   vlib_thread_main_t *tm = vlib_get_thread_main ();
+  void *oldheap = 0;
   int i;
 
+  if (cm->stat_segment_name)
+    oldheap = vlib_stats_push_heap ();
+
   vec_validate (cm->counters, tm->n_vlib_mains - 1);
   for (i = 0; i < tm->n_vlib_mains; i++)
     vec_validate_aligned (cm->counters[i], index, CLIB_CACHE_LINE_BYTES);
+
+  if (oldheap)
+    vlib_stats_pop_heap (cm, oldheap, STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED);
+}
+
+int
+  vlib_validate_combined_counter_will_expand
+  (vlib_combined_counter_main_t * cm, u32 index)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  void *oldheap = 0;
+  int i, rv = 0;
+
+  /* the first validation allocates the per-thread vectors */
+  if (vec_len (cm->counters) < tm->n_vlib_mains)
+    return 1;
+
+  /* clib_mem_size () looks at the current heap */
+  if (cm->stat_segment_name)
+    oldheap = vlib_stats_push_heap ();
+
+  for (i = 0; i < tm->n_vlib_mains; i++)
+    {
+      if (index < vec_len (cm->counters[i]))
+	continue;
+      if (_vec_resize_will_expand (cm->counters[i],
+				   index - vec_len (cm->counters[i]) + 1,
+				   (index + 1) * sizeof (cm->counters[i][0]),
+				   0, CLIB_CACHE_LINE_BYTES))
+	{
+	  rv = 1;
+	  break;
+	}
+    }
+
+  if (oldheap)
+    vlib_stats_pop_heap (cm, oldheap, STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED);
+  return rv;
 }
 
 u32
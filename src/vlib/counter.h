@@ -63,6 +63,7 @@ typedef struct
                                            serialized incrementally. */
 
   char *name;			/**< The counter collection's name. */
+  char *stat_segment_name;	/**< Name in the stats segment, if any */
 } vlib_simple_counter_main_t;
 
 /** The number of counters (not the number of per-thread counters) */
@@ -183,6 +184,7 @@ typedef struct
   vlib_counter_t *value_at_last_serialize; /**< Counter values as of last serialize. */
   u32 last_incremental_serialize_index;	/**< Last counter index serialized incrementally. */
   char *name; /**< The counter collection's name. */
+  char *stat_segment_name; /**< Name in the stats segment, if any */
 } vlib_combined_counter_main_t;
 
 /** The number of counters (not the number of per-thread counters) */
@@ -304,6 +306,16 @@ void vlib_validate_simple_counter (vlib_simple_counter_main_t * cm,
 void vlib_validate_combined_counter (vlib_combined_counter_main_t * cm,
 				     u32 index);
 
+/** Check if vlib_validate_combined_counter would reallocate (and so
+    move) the counters, which the workers may be incrementing
+    @param cm - (vlib_combined_counter_main_t *) pointer to the counter
+    collection
+    @param index - (u32) index of the counter to validate
+    @returns 1 if the counters would move, 0 otherwise
+*/
+int vlib_validate_combined_counter_will_expand
+  (vlib_combined_counter_main_t * cm, u32 index);
+
 /** Obtain the number of simple or combined counters allocated.
     A macro which reduces to to vec_len(cm->maxi), the answer in either
     case.
@@ -314,6 +326,38 @@ void vlib_validate_combined_counter (vlib_combined_counter_main_t * cm,
 */
 #define vlib_counter_len(cm) vec_len((cm)->maxi)
 
+/** Types of the stats segment directory entries */
+typedef enum
+{
+  STAT_DIR_TYPE_ILLEGAL = 0,
+  STAT_DIR_TYPE_SCALAR_VALUE,		/**< f64 in the entry itself */
+  STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE,	/**< counter_t ** [thread][index] */
+  STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED,	/**< vlib_counter_t ** */
+  STAT_DIR_TYPE_ERROR_INDEX,		/**< index into the error vectors */
+  STAT_DIR_TYPE_NAME_VECTOR,		/**< u8 ** of C-strings */
+} stat_directory_type_t;
+
+/*
+ * Stats segment hooks. Counter collections with a stat_segment_name
+ * (and the error counters) are allocated from the stats segment heap,
+ * so that the external readers can map them directly.
+ * The defaults (weak) do nothing, vpp provides the real ones.
+ */
+
+/** Switch to the stats segment heap, returns 0 if there is none */
+void *vlib_stats_push_heap (void);
+
+/** Switch back and publish the counter collection under its name */
+void vlib_stats_pop_heap (void *cm, void *oldheap,
+			  stat_directory_type_t type);
+
+/** Switch back and publish the error counter vector of a thread */
+void vlib_stats_pop_heap2 (u64 * error_vector, u32 thread_index,
+			   void *oldheap);
+
+/** Publish an error counter under its name */
+void vlib_stats_register_error_index (u8 * name, u64 index);
+
 serialize_function_t serialize_vlib_simple_counter_main,
   unserialize_vlib_simple_counter_main;
 serialize_function_t serialize_vlib_combined_counter_main,
@@ -0,0 +1,534 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vlib/vlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+vlib_dispatch_profile_main_t vlib_dispatch_profile_main;
+
+static u32 vlib_dispatch_profile_perf_config[] = {
+#define _(E,n,s) [VLIB_DISPATCH_PROFILE_PERF_##E] = PERF_COUNT_HW_##E,
+  foreach_vlib_dispatch_profile_perf_event
+#undef _
+};
+
+static char *vlib_dispatch_profile_perf_names[] = {
+#define _(E,n,s) [VLIB_DISPATCH_PROFILE_PERF_##E] = s,
+  foreach_vlib_dispatch_profile_perf_event
+#undef _
+};
+
+/*
+ * Read a counter of the calling thread. From user space with rdpmc when
+ * the kernel allows it and the event is on a counter, else with read().
+ */
+static_always_inline u64
+vlib_dispatch_profile_perf_read (struct perf_event_mmap_page *pc, int fd)
+{
+  u64 count;
+
+#if defined (__x86_64__)
+  u32 seq, idx;
+  i64 pmc;
+
+  if (pc->cap_user_rdpmc)
+    {
+      do
+	{
+	  seq = pc->lock;
+	  asm volatile ("":::"memory");
+	  idx = pc->index;
+	  count = pc->offset;
+	  if (idx)
+	    {
+	      pmc = __builtin_ia32_rdpmc (idx - 1);
+	      /* sign extend the counter width */
+	      pmc <<= 64 - pc->pmc_width;
+	      pmc >>= 64 - pc->pmc_width;
+	      count += pmc;
+	    }
+	  asm volatile ("":::"memory");
+	}
+      while (pc->lock != seq);
+
+      if (idx)
+	return count;
+    }
+#endif
+
+  if (read (fd, &count, sizeof (count)) != sizeof (count))
+    return 0;
+  return count;
+}
+
+void
+vlib_dispatch_profile_before (vlib_main_t * vm)
+{
+  vlib_dispatch_profile_main_t *pm = &vlib_dispatch_profile_main;
+  vlib_dispatch_profile_thread_t *pt;
+  int i;
+
+  if (!pm->perf_enabled)
+    return;
+
+  pt = vec_elt_at_index (pm->threads, vm->thread_index);
+  for (i = 0; i < VLIB_DISPATCH_PROFILE_N_PERF; i++)
+    if (pt->perf_fd[i] >= 0)
+      pt->perf_before[i] =
+	vlib_dispatch_profile_perf_read (pt->perf_page[i], pt->perf_fd[i]);
+}
+
+void
+vlib_dispatch_profile_after (vlib_main_t * vm, u32 node_index,
+			     uword n_vectors, u64 n_clocks)
+{
+  vlib_dispatch_profile_main_t *pm = &vlib_dispatch_profile_main;
+  vlib_dispatch_profile_thread_t *pt;
+  vlib_dispatch_profile_node_t *pn;
+  u64 clocks_per_vector;
+  uword bucket;
+  int i;
+
+  pt = vec_elt_at_index (pm->threads, vm->thread_index);
+
+  /*
+   * Nodes created since the profiling was enabled. The vectors live on
+   * the main heap: only the main thread may grow its own, the workers
+   * count such nodes once the profiling is turned on again.
+   */
+  if (PREDICT_FALSE (node_index >= vec_len (pt->nodes)))
+    {
+      if (vm->thread_index != 0)
+	return;
+      vec_validate (pt->nodes, node_index);
+    }
+  pn = vec_elt_at_index (pt->nodes, node_index);
+
+  pn->calls++;
+  pn->vectors += n_vectors;
+  pn->clocks += n_clocks;
+
+  bucket = n_vectors ? 1 + min_log2 (n_vectors) : 0;
+  bucket = clib_min (bucket, VLIB_DISPATCH_PROFILE_N_VECTOR_BUCKETS - 1);
+  pn->vector_size[bucket]++;
+
+  /* a call which did nothing only has a vector size */
+  if (n_vectors)
+    {
+      clocks_per_vector = n_clocks / n_vectors;
+      bucket = clocks_per_vector < 2 ? 0 : min_log2 (clocks_per_vector);
+      bucket = clib_min (bucket, VLIB_DISPATCH_PROFILE_N_CLOCK_BUCKETS - 1);
+      pn->clocks_per_vector[bucket]++;
+      if (clocks_per_vector > pn->max_clocks_per_vector)
+	pn->max_clocks_per_vector = clocks_per_vector;
+    }
+
+  if (pm->perf_enabled)
+    for (i = 0; i < VLIB_DISPATCH_PROFILE_N_PERF; i++)
+      if (pt->perf_fd[i] >= 0)
+	pn->perf[i] +=
+	  vlib_dispatch_profile_perf_read (pt->perf_page[i],
+					   pt->perf_fd[i]) -
+	  pt->perf_before[i];
+}
+
+static void
+vlib_dispatch_profile_perf_close (void)
+{
+  vlib_dispatch_profile_main_t *pm = &vlib_dispatch_profile_main;
+  vlib_dispatch_profile_thread_t *pt;
+  int i;
+
+  pm->perf_enabled = 0;
+
+  vec_foreach (pt, pm->threads)
+  {
+    for (i = 0; i < VLIB_DISPATCH_PROFILE_N_PERF; i++)
+      {
+	if (pt->perf_page[i])
+	  munmap (pt->perf_page[i], clib_mem_get_page_size ());
+	if (pt->perf_fd[i] >= 0)
+	  close (pt->perf_fd[i]);
+	pt->perf_page[i] = 0;
+	pt->perf_fd[i] = -1;
+      }
+  }
+}
+
+/*
+ * The events of each thread count that thread, on whatever cpu it runs.
+ * The thread reads them itself, mapped to use rdpmc.
+ */
+static clib_error_t *
+vlib_dispatch_profile_perf_open (void)
+{
+  vlib_dispatch_profile_main_t *pm = &vlib_dispatch_profile_main;
+  vlib_dispatch_profile_thread_t *pt;
+  struct perf_event_attr pe;
+  clib_error_t *error = 0;
+  void *page;
+  int i, fd;
+
+  vec_foreach (pt, pm->threads)
+  {
+    for (i = 0; i < VLIB_DISPATCH_PROFILE_N_PERF; i++)
+      {
+	memset (&pe, 0, sizeof (pe));
+	pe.type = PERF_TYPE_HARDWARE;
+	pe.size = sizeof (pe);
+	pe.config = vlib_dispatch_profile_perf_config[i];
+	pe.exclude_kernel = 1;
+	pe.exclude_hv = 1;
+
+	fd = syscall (__NR_perf_event_open, &pe,
+		      vlib_worker_threads[pt - pm->threads].lwp,
+		      -1 /* any cpu */ , -1 /* group */ , 0 /* flags */ );
+	if (fd < 0)
+	  {
+	    error = clib_error_return_unix
+	      (0, "perf_event_open %s, thread %d",
+	       vlib_dispatch_profile_perf_names[i], pt - pm->threads);
+	    goto fail;
+	  }
+	pt->perf_fd[i] = fd;
+
+	page = mmap (0, clib_mem_get_page_size (), PROT_READ, MAP_SHARED,
+		     fd, 0);
+	if (page == MAP_FAILED)
+	  {
+	    error = clib_error_return_unix (0, "mmap perf event");
+	    goto fail;
+	  }
+	pt->perf_page[i] = page;
+      }
+  }
+
+  pm->perf_enabled = 1;
+  return 0;
+
+fail:
+  vlib_dispatch_profile_perf_close ();
+  return error;
+}
+
+static clib_error_t *
+set_dispatch_profile_command_fn (vlib_main_t * vm,
+				 unformat_input_t * input,
+				 vlib_cli_command_t * cmd)
+{
+  vlib_dispatch_profile_main_t *pm = &vlib_dispatch_profile_main;
+  vlib_dispatch_profile_thread_t *pt;
+  clib_error_t *error;
+  int enable = -1, perf = 0, i;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "on"))
+	enable = 1;
+      else if (unformat (input, "off"))
+	enable = 0;
+      else if (unformat (input, "perf"))
+	perf = 1;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (enable == -1)
+    return clib_error_return (0, "expecting on or off");
+
+  /* under the barrier: no thread is dispatching */
+  vlib_dispatch_profile_perf_close ();
+  pm->enabled = 0;
+
+  if (!enable)
+    return 0;
+
+  if (vec_len (pm->threads) < vec_len (vlib_mains))
+    {
+      i = vec_len (pm->threads);
+      vec_validate_aligned (pm->threads, vec_len (vlib_mains) - 1,
+			    CLIB_CACHE_LINE_BYTES);
+      for (; i < vec_len (pm->threads); i++)
+	memset (pm->threads[i].perf_fd, 0xff,
+		sizeof (pm->threads[i].perf_fd));
+    }
+
+  vec_foreach (pt, pm->threads)
+    vec_validate (pt->nodes, vec_len (vm->node_main.nodes) - 1);
+
+  if (perf && (error = vlib_dispatch_profile_perf_open ()))
+    {
+      vlib_cli_output (vm, "%U, profiling without perf counters",
+		       format_clib_error, error);
+      clib_error_free (error);
+    }
+
+  pm->enabled = 1;
+  return 0;
+}
+
+/*?
+ * Start or stop the profiling of the node dispatches on all the threads.
+ * With @c perf, also count the cache misses and the instructions of
+ * each node call, when perf_event_open() is permitted. The counts
+ * recorded so far are kept; see @c show @c dispatch-profile.
+ *
+ * @cliexpar
+ * @cliexcmd{set dispatch-profile on perf}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_dispatch_profile_command, static) = {
+  .path = "set dispatch-profile",
+  .short_help = "set dispatch-profile (on [perf] | off)",
+  .function = set_dispatch_profile_command_fn,
+};
+/* *INDENT-ON* */
+
+/* upper bound of the bucket holding the given fraction of the samples */
+static u64
+vlib_dispatch_profile_percentile (u64 * histogram, int n_buckets, f64 q)
+{
+  u64 total = 0, sum = 0;
+  int i;
+
+  for (i = 0; i < n_buckets; i++)
+    total += histogram[i];
+  if (total == 0)
+    return 0;
+
+  for (i = 0; i < n_buckets; i++)
+    {
+      sum += histogram[i];
+      if (sum >= q * total)
+	break;
+    }
+  return 2ULL << clib_min (i, n_buckets - 1);
+}
+
+static u8 *
+format_dispatch_profile_histogram (u8 * s, va_list * args)
+{
+  u64 *histogram = va_arg (*args, u64 *);
+  int n_buckets = va_arg (*args, int);
+  int is_vector_size = va_arg (*args, int);
+  int i;
+
+  for (i = 0; i < n_buckets; i++)
+    {
+      if (histogram[i] == 0)
+	continue;
+      if (is_vector_size)
+	s = format (s, " %u:%llu", i ? 1 << (i - 1) : 0, histogram[i]);
+      else if (i == 0)
+	s = format (s, " <2:%llu", histogram[i]);
+      else
+	s = format (s, " %llu:%llu", 1ULL << i, histogram[i]);
+    }
+  return s;
+}
+
+typedef struct
+{
+  vlib_dispatch_profile_node_t sum;
+  u32 node_index;
+} dispatch_profile_sum_t;
+
+static int
+dispatch_profile_p99_cmp (void *a1, void *a2)
+{
+  vlib_dispatch_profile_node_t *n1 = a1, *n2 = a2;
+  u64 p1, p2;
+
+  p1 = vlib_dispatch_profile_percentile
+    (n1->clocks_per_vector, VLIB_DISPATCH_PROFILE_N_CLOCK_BUCKETS, 0.99);
+  p2 = vlib_dispatch_profile_percentile
+    (n2->clocks_per_vector, VLIB_DISPATCH_PROFILE_N_CLOCK_BUCKETS, 0.99);
+
+  /* the worst tail first, then the busiest */
+  if (p1 != p2)
+    return p1 < p2 ? 1 : -1;
+  return n1->clocks < n2->clocks ? 1 : (n1->clocks > n2->clocks ? -1 : 0);
+}
+
+static clib_error_t *
+show_dispatch_profile_command_fn (vlib_main_t * vm,
+				  unformat_input_t * input,
+				  vlib_cli_command_t * cmd)
+{
+  vlib_dispatch_profile_main_t *pm = &vlib_dispatch_profile_main;
+  vlib_dispatch_profile_thread_t *pt;
+  vlib_dispatch_profile_node_t *pn, *sum;
+  dispatch_profile_sum_t *sums = 0, *ps;
+  u32 thread_index = ~0, node_index = ~0;
+  int verbose = 0, i, j;
+  u8 *line = 0;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "thread %u", &thread_index))
+	;
+      else if (unformat (input, "node %U", unformat_vlib_node, vm,
+			 &node_index))
+	verbose = 1;
+      else if (unformat (input, "verbose"))
+	verbose = 1;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (thread_index != ~0 && thread_index >= vec_len (pm->threads))
+    return clib_error_return (0, "no profile for thread %u", thread_index);
+
+  vlib_cli_output (vm, "Dispatch profile %s%s",
+		   pm->enabled ? "on" : "off",
+		   pm->perf_enabled ? ", perf counters on" : "");
+
+  /* sum over the threads */
+  vec_validate (sums, vec_len (vm->node_main.nodes) - 1);
+  vec_foreach (pt, pm->threads)
+  {
+    if (thread_index != ~0 && pt - pm->threads != thread_index)
+      continue;
+    vec_foreach (pn, pt->nodes)
+    {
+      if (pn - pt->nodes >= vec_len (sums))
+	break;
+      sum = &sums[pn - pt->nodes].sum;
+      sum->calls += pn->calls;
+      sum->vectors += pn->vectors;
+      sum->clocks += pn->clocks;
+      sum->max_clocks_per_vector = clib_max (sum->max_clocks_per_vector,
+					     pn->max_clocks_per_vector);
+      for (i = 0; i < VLIB_DISPATCH_PROFILE_N_PERF; i++)
+	sum->perf[i] += pn->perf[i];
+      for (i = 0; i < VLIB_DISPATCH_PROFILE_N_CLOCK_BUCKETS; i++)
+	sum->clocks_per_vector[i] += pn->clocks_per_vector[i];
+      for (i = 0; i < VLIB_DISPATCH_PROFILE_N_VECTOR_BUCKETS; i++)
+	sum->vector_size[i] += pn->vector_size[i];
+    }
+  }
+
+  /* only the nodes which ran */
+  for (i = j = 0; i < vec_len (sums); i++)
+    if (sums[i].sum.calls && (node_index == ~0 || node_index == i))
+      {
+	sums[j] = sums[i];
+	sums[j++].node_index = i;
+      }
+  _vec_len (sums) = j;
+  vec_sort_with_function (sums, dispatch_profile_p99_cmp);
+
+  line = format (line, "%-30s%12s%12s%10s%10s%10s%10s%10s",
+		 "Name", "Calls", "Vectors", "Vec/call", "Clk/vec",
+		 "p50", "p99", "Max");
+  if (pm->perf_enabled)
+    for (i = 0; i < VLIB_DISPATCH_PROFILE_N_PERF; i++)
+      line = format (line, "%16s", vlib_dispatch_profile_perf_names[i]);
+  vlib_cli_output (vm, "%v", line);
+
+  vec_foreach (ps, sums)
+  {
+    sum = &ps->sum;
+    vec_reset_length (line);
+    line = format (line, "%-30U%12llu%12llu%10.2f%10.2f%10llu%10llu%10llu",
+		   format_vlib_node_name, vm, ps->node_index,
+		   sum->calls, sum->vectors,
+		   (f64) sum->vectors / (f64) sum->calls,
+		   sum->vectors ? (f64) sum->clocks / (f64) sum->vectors : 0.0,
+		   vlib_dispatch_profile_percentile
+		   (sum->clocks_per_vector,
+		    VLIB_DISPATCH_PROFILE_N_CLOCK_BUCKETS, 0.50),
+		   vlib_dispatch_profile_percentile
+		   (sum->clocks_per_vector,
+		    VLIB_DISPATCH_PROFILE_N_CLOCK_BUCKETS, 0.99),
+		   sum->max_clocks_per_vector);
+    if (pm->perf_enabled)
+      for (i = 0; i < VLIB_DISPATCH_PROFILE_N_PERF; i++)
+	line = format (line, "%16.2f", sum->vectors ?
+		       (f64) sum->perf[i] / (f64) sum->vectors : 0.0);
+    vlib_cli_output (vm, "%v", line);
+
+    if (verbose)
+      {
+	vlib_cli_output (vm, "  clocks/vector:%U",
+			 format_dispatch_profile_histogram,
+			 sum->clocks_per_vector,
+			 VLIB_DISPATCH_PROFILE_N_CLOCK_BUCKETS, 0);
+	vlib_cli_output (vm, "  vector size:%U",
+			 format_dispatch_profile_histogram,
+			 sum->vector_size,
+			 VLIB_DISPATCH_PROFILE_N_VECTOR_BUCKETS, 1);
+      }
+  }
+
+  vec_free (line);
+  vec_free (sums);
+  return 0;
+}
+
+/*?
+ * Display the dispatch profile of the nodes which ran since it was
+ * enabled, summed over the threads or for the given thread, the worst
+ * p99 clocks per vector first. The percentiles and the histograms are
+ * in log2 buckets, each reported by its upper bound. The perf counts
+ * are per vector. @c verbose or @c node adds the histograms of the
+ * clocks per vector and of the vector sizes.
+ *
+ * @cliexpar
+ * @cliexstart{show dispatch-profile}
+ * Dispatch profile on
+ * Name                                 Calls     Vectors Vec/call   Clk/vec       p50       p99       Max
+ * ip4-rewrite                          39218     10039808  256.00     41.27        64       128      9312
+ * ip4-lookup                           39218     10039808  256.00     36.02        64        64      2104
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_dispatch_profile_command, static) = {
+  .path = "show dispatch-profile",
+  .short_help = "show dispatch-profile [thread <n>] [node <name>] [verbose]",
+  .function = show_dispatch_profile_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+clear_dispatch_profile_command_fn (vlib_main_t * vm,
+				   unformat_input_t * input,
+				   vlib_cli_command_t * cmd)
+{
+  vlib_dispatch_profile_main_t *pm = &vlib_dispatch_profile_main;
+  vlib_dispatch_profile_thread_t *pt;
+
+  vec_foreach (pt, pm->threads) vec_zero (pt->nodes);
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (clear_dispatch_profile_command, static) = {
+  .path = "clear dispatch-profile",
+  .short_help = "clear dispatch-profile",
+  .function = clear_dispatch_profile_command_fn,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Node dispatch profiling.
+ *
+ * "show runtime" only has the average and the maximum clocks of each
+ * node. When enabled, the profiler also records, per thread and per
+ * node, the distribution of the clocks per vector and of the vector
+ * sizes in log2 buckets, and optionally the cache misses and the
+ * instructions retired by each call, from perf events read with rdpmc.
+ *
+ * When disabled, it costs dispatch_node() one test of a read-mostly
+ * global.
+ */
+
+#ifndef included_vlib_dispatch_profile_h
+#define included_vlib_dispatch_profile_h
+
+#include <vlib/threads.h>
+
+/* clocks per vector: <2, 2-3, 4-7, ... */
+#define VLIB_DISPATCH_PROFILE_N_CLOCK_BUCKETS 24
+/* vector size: 0, 1, 2-3, ..., 256 */
+#define VLIB_DISPATCH_PROFILE_N_VECTOR_BUCKETS 10
+
+#define foreach_vlib_dispatch_profile_perf_event		\
+_(CACHE_MISSES, cache_misses, "cache misses")			\
+_(INSTRUCTIONS, instructions, "instructions")
+
+typedef enum
+{
+#define _(E,n,s) VLIB_DISPATCH_PROFILE_PERF_##E,
+  foreach_vlib_dispatch_profile_perf_event
+#undef _
+    VLIB_DISPATCH_PROFILE_N_PERF,
+} vlib_dispatch_profile_perf_t;
+
+typedef struct
+{
+  u64 calls;
+  u64 vectors;
+  u64 clocks;
+  u64 max_clocks_per_vector;
+  u64 perf[VLIB_DISPATCH_PROFILE_N_PERF];
+  u64 clocks_per_vector[VLIB_DISPATCH_PROFILE_N_CLOCK_BUCKETS];
+  u64 vector_size[VLIB_DISPATCH_PROFILE_N_VECTOR_BUCKETS];
+} vlib_dispatch_profile_node_t;
+
+typedef struct
+{
+  /* private to the thread, a cache line apart from the others */
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+
+  /* indexed by node index */
+  vlib_dispatch_profile_node_t *nodes;
+
+  /* perf events counting the thread, -1 if not open */
+  int perf_fd[VLIB_DISPATCH_PROFILE_N_PERF];
+  struct perf_event_mmap_page *perf_page[VLIB_DISPATCH_PROFILE_N_PERF];
+
+  /* counts read before the current node call */
+  u64 perf_before[VLIB_DISPATCH_PROFILE_N_PERF];
+} vlib_dispatch_profile_thread_t;
+
+typedef struct
+{
+  /* tested on every dispatch */
+  volatile u32 enabled;
+  u32 perf_enabled;
+
+  /* indexed by thread index */
+  vlib_dispatch_profile_thread_t *threads;
+} vlib_dispatch_profile_main_t;
+
+extern vlib_dispatch_profile_main_t vlib_dispatch_profile_main;
+
+void vlib_dispatch_profile_before (vlib_main_t * vm);
+void vlib_dispatch_profile_after (vlib_main_t * vm, u32 node_index,
+				  uword n_vectors, u64 n_clocks);
+
+#endif /* included_vlib_dispatch_profile_h */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -993,6 +993,9 @@ dispatch_node (vlib_main_t * vm,
 				 frame ? frame->n_vectors : 0,
 				 /* is_after */ 0);
 
+      if (PREDICT_FALSE (vlib_dispatch_profile_main.enabled))
+	vlib_dispatch_profile_before (vm);
+
       /*
        * Turn this on if you run into
        * "bad monkey" contexts, and you want to know exactly
@@ -1018,6 +1021,10 @@ dispatch_node (vlib_main_t * vm,
 
       t = clib_cpu_time_now ();
 
+      if (PREDICT_FALSE (vlib_dispatch_profile_main.enabled))
+	vlib_dispatch_profile_after (vm, node->node_index, n,
+				     t - last_time_stamp);
+
       vlib_elog_main_loop_event (vm, node->node_index, t, n,	/* is_after */
 				 1);
 
@@ -1461,6 +1468,8 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
   u64 cpu_time_now;
   vlib_frame_queue_main_t *fqm;
   u32 *last_node_runtime_indices = 0;
+  u64 cpu_time_loop_start;
+  int is_idle;
 
   /* Initialize pending node vector. */
   if (is_main)
@@ -1500,6 +1509,8 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
 					 cpu_time_now);
     }
 
+  cpu_time_loop_start = cpu_time_now;
+
   while (1)
     {
       vlib_node_runtime_t *n;
@@ -1507,6 +1518,8 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
       if (!is_main)
 	{
 	  vlib_worker_thread_barrier_check ();
+	  /* no references to control plane data held from here */
+	  vlib_rcu_quiescent (vm->thread_index);
 	  vec_foreach (fqm, tm->frame_queue_mains)
 	    vlib_frame_queue_dequeue (vm, fqm);
 	}
@@ -1633,11 +1646,21 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
       if (is_main && _vec_len (nm->data_from_advancing_timing_wheel) > 0)
 	goto processes_timing_wheel_data;
 
+      if (!is_main && PREDICT_FALSE (tm->worker_polling_mode ==
+				     VLIB_WORKER_POLLING_MODE_ADAPTIVE))
+	vlib_worker_idle_poll (vm, vm->main_loop_vectors_processed);
+
+      is_idle = vm->main_loop_vectors_processed == 0;
+
       vlib_increment_main_loop_counter (vm);
 
       /* Record time stamp in case there are no enabled nodes and above
          calls do not update time stamp. */
       cpu_time_now = clib_cpu_time_now ();
+
+      if (is_idle)
+	vm->cpu_time_idle += cpu_time_now - cpu_time_loop_start;
+      cpu_time_loop_start = cpu_time_now;
     }
 }
 
@@ -67,6 +67,9 @@ typedef struct vlib_main_t
   /* Time stamp when main loop was entered (time 0). */
   u64 cpu_time_main_loop_start;
 
+  /* Clocks spent in main loops which processed no vector. */
+  u64 cpu_time_idle;
+
   /* Incremented once for each main loop. */
   u32 main_loop_count;
 
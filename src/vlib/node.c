@@ -324,6 +324,7 @@ register_node (vlib_main_t * vm, vlib_node_registration_t * r)
 
   r->index = n->index;		/* save index in registration */
   n->function = r->function;
+  n->function_variants = r->function_variants;
 
   /* Node index of next sibling will be filled in by vlib_node_main_init. */
   n->sibling_of = r->sibling_of;
@@ -75,11 +75,23 @@ typedef enum
   VLIB_N_NODE_TYPE,
 } vlib_node_type_t;
 
+/* A cpu specific clone of a node function, see foreach_march_variant */
+typedef struct
+{
+  vlib_node_function_t *function;
+  char *name;
+  /* null for the default variant */
+  int (*cpu_supports) (void);
+} vlib_node_function_variant_t;
+
 typedef struct _vlib_node_registration
 {
   /* Vector processing function for this node. */
   vlib_node_function_t *function;
 
+  /* Variants of the function, null terminated, best first. */
+  vlib_node_function_variant_t *function_variants;
+
   /* Node name. */
   char *name;
 
@@ -170,12 +182,28 @@ __VA_ARGS__ vlib_node_registration_t x
 #define VLIB_NODE_FUNCTION_MULTIARCH_CLONE(fn)				\
   foreach_march_variant(VLIB_NODE_FUNCTION_CLONE_TEMPLATE, fn)
 
+#define VLIB_NODE_FUNCTION_VARIANT(arch, fn, tgt)			\
+  { & fn ## _ ## arch, #arch, clib_cpu_march_supports_ ## arch },
+
+/*
+ * The best variant this cpu supports runs; "set node function" picks
+ * another one, e.g. to compare them.
+ */
 #define VLIB_NODE_FUNCTION_MULTIARCH(node, fn)				\
   VLIB_NODE_FUNCTION_MULTIARCH_CLONE(fn)				\
   CLIB_MULTIARCH_SELECT_FN(fn, static inline)				\
+  static vlib_node_function_variant_t					\
+  __vlib_node_function_variants_##node[] = {				\
+    foreach_march_variant(VLIB_NODE_FUNCTION_VARIANT, fn)		\
+    { & fn, "default", 0 },						\
+    { 0 },								\
+  };									\
   static void __attribute__((__constructor__))				\
   __vlib_node_function_multiarch_select_##node (void)			\
-  { node.function = fn ## _multiarch_select(); }
+  {									\
+    node.function = fn ## _multiarch_select();				\
+    node.function_variants = __vlib_node_function_variants_##node;	\
+  }
 #endif
 
 always_inline vlib_node_registration_t *
@@ -217,6 +245,9 @@ typedef struct vlib_node_t
   /* Vector processing function for this node. */
   vlib_node_function_t *function;
 
+  /* Variants of the function, see vlib_node_registration_t. */
+  vlib_node_function_variant_t *function_variants;
+
   /* Node name. */
   u8 *name;
 
@@ -441,6 +441,134 @@ VLIB_CLI_COMMAND (clear_node_runtime_command, static) = {
 };
 /* *INDENT-ON* */
 
+static u8 *
+format_vlib_node_function_variants (u8 * s, va_list * va)
+{
+  vlib_node_t *n = va_arg (*va, vlib_node_t *);
+  vlib_node_function_variant_t *v;
+
+  s = format (s, "%-30v", n->name);
+  for (v = n->function_variants; v->function; v++)
+    s = format (s, " %s%s%s", v->function == n->function ? "*" : "",
+		v->name, v->cpu_supports
+		&& !v->cpu_supports ()? "(unsupported)" : "");
+  return s;
+}
+
+static clib_error_t *
+show_node_function (vlib_main_t * vm,
+		    unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  vlib_node_main_t *nm = &vm->node_main;
+  vlib_node_t *n;
+  u32 node_index = ~0;
+  int i;
+
+  (void) unformat (input, "%U", unformat_vlib_node, vm, &node_index);
+
+  if (node_index != ~0)
+    {
+      n = vlib_get_node (vm, node_index);
+      if (!n->function_variants)
+	return clib_error_return (0, "node `%v' has a single function",
+				  n->name);
+      vlib_cli_output (vm, "%U", format_vlib_node_function_variants, n);
+      return 0;
+    }
+
+  for (i = 0; i < vec_len (nm->nodes); i++)
+    {
+      n = nm->nodes[i];
+      if (n->function_variants)
+	vlib_cli_output (vm, "%U", format_vlib_node_function_variants, n);
+    }
+
+  return 0;
+}
+
+/*?
+ * Show the function variants of the nodes built for several
+ * micro-architectures. The variant in use is marked with a '*'.
+ *
+ * @cliexpar
+ * @cliexstart{show node function ip4-lookup}
+ * ip4-lookup                     avx512(unsupported) *avx2 default
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_node_function_command, static) = {
+  .path = "show node function",
+  .short_help = "show node function [<node-name>]",
+  .function = show_node_function,
+  .is_mp_safe = 1,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+set_node_function (vlib_main_t * vm,
+		   unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  vlib_node_function_variant_t *v;
+  vlib_node_t *n;
+  u32 node_index;
+  u8 *name = 0;
+  int i;
+
+  if (!unformat (input, "%U %s", unformat_vlib_node, vm, &node_index, &name))
+    return clib_error_return (0, "expected <node-name> <variant>, got `%U'",
+			      format_unformat_error, input);
+
+  n = vlib_get_node (vm, node_index);
+  if (!n->function_variants)
+    {
+      vec_free (name);
+      return clib_error_return (0, "node `%v' has a single function",
+				n->name);
+    }
+
+  vec_add1 (name, 0);
+  for (v = n->function_variants; v->function; v++)
+    if (!strcmp (v->name, (char *) name))
+      break;
+  vec_free (name);
+
+  if (!v->function)
+    return clib_error_return (0, "unknown variant, node `%v' has: %U",
+			      n->name, format_vlib_node_function_variants, n);
+  if (v->cpu_supports && !v->cpu_supports ())
+    return clib_error_return (0, "variant `%s' is not supported by this cpu",
+			      v->name);
+
+  /* the workers each have a copy of the node and of its runtime */
+  for (i = 0; i < vec_len (vlib_mains); i++)
+    {
+      vlib_main_t *this_vm = vlib_mains[i];
+      if (!this_vm)
+	continue;
+      vlib_get_node (this_vm, node_index)->function = v->function;
+      vlib_node_get_runtime (this_vm, node_index)->function = v->function;
+    }
+
+  return 0;
+}
+
+/*?
+ * Select the function variant a node dispatches to, e.g. to compare
+ * the clocks per packet of the avx2 and of the default variants of
+ * ip4-lookup in "show runtime". By default, a node uses the best
+ * variant the cpu supports.
+ *
+ * @cliexpar
+ * @cliexcmd{set node function ip4-lookup default}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_node_function_command, static) = {
+  .path = "set node function",
+  .short_help = "set node function <node-name> <variant>",
+  .function = set_node_function,
+};
+/* *INDENT-ON* */
+
 /* Dummy function to get us linked in. */
 void
 vlib_node_cli_reference (void)
@@ -201,6 +201,13 @@ vlib_node_set_interrupt_pending (vlib_main_t * vm, u32 node_index)
   clib_spinlock_lock_if_init (&nm->pending_interrupt_lock);
   vec_add1 (nm->pending_interrupt_node_runtime_indices, n->runtime_index);
   clib_spinlock_unlock_if_init (&nm->pending_interrupt_lock);
+
+  /* the worker may sleep, see vlib_worker_sleep_t */
+  if (vm->thread_index)
+    {
+      CLIB_MEMORY_BARRIER ();
+      vlib_worker_wakeup_if_sleeping (vm->thread_index);
+    }
 }
 
 always_inline vlib_process_t *
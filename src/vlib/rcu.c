@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vlib/vlib.h>
+
+vlib_rcu_main_t vlib_rcu_main;
+
+/* How often the pending callbacks are checked */
+#define VLIB_RCU_RECLAIM_INTERVAL 1e-3
+
+static vlib_node_registration_t vlib_rcu_process_node;
+
+static inline int
+vlib_rcu_workers_parked (void)
+{
+  /*
+   * No workers, or all of them held at the barrier: nobody can see
+   * what the main thread has just unpublished.
+   */
+  return (vec_len (vlib_mains) < 2
+	  || vlib_worker_threads[0].recursion_level > 0);
+}
+
+static u64
+vlib_rcu_min_epoch (void)
+{
+  vlib_rcu_main_t *rm = &vlib_rcu_main;
+  u64 min_epoch = rm->epoch;
+  int i;
+
+  for (i = 1; i < vec_len (vlib_mains); i++)
+    min_epoch = clib_min (min_epoch, rm->threads[i].epoch);
+
+  return min_epoch;
+}
+
+/*
+ * Run the callbacks whose grace period is over.
+ * Returns the number still pending.
+ */
+static uword
+vlib_rcu_reclaim (void)
+{
+  vlib_rcu_main_t *rm = &vlib_rcu_main;
+  vlib_rcu_deferred_t d;
+  u64 min_epoch;
+  uword n = 0;
+
+  min_epoch = vlib_rcu_workers_parked ()? ~0ULL : vlib_rcu_min_epoch ();
+  rm->reclaiming = 1;
+
+  while (n < vec_len (rm->deferred))
+    {
+      /* a callback may defer more work, which may move the vector */
+      d = rm->deferred[n];
+      if (d.epoch > min_epoch)
+	break;
+      d.function (d.opaque[0], d.opaque[1]);
+      n++;
+    }
+
+  rm->reclaiming = 0;
+  if (n)
+    {
+      vec_delete (rm->deferred, n, 0);
+      rm->n_reclaimed += n;
+    }
+
+  return vec_len (rm->deferred);
+}
+
+/**
+ * Call function (opaque0, opaque1) on the main thread once every
+ * worker has passed through a quiescent state. The caller must have
+ * made the data the callback reclaims unreachable beforehand.
+ */
+void
+vlib_rcu_call (vlib_rcu_callback_t * function, uword opaque0, uword opaque1)
+{
+  vlib_rcu_main_t *rm = &vlib_rcu_main;
+  vlib_rcu_deferred_t *d;
+
+  ASSERT (vlib_get_thread_index () == 0);
+
+  if (vlib_rcu_workers_parked () && !rm->reclaiming)
+    {
+      /* in order: what is pending may depend on what we reclaim */
+      vlib_rcu_reclaim ();
+      function (opaque0, opaque1);
+      return;
+    }
+
+  vec_add2 (rm->deferred, d, 1);
+  d->function = function;
+  d->opaque[0] = opaque0;
+  d->opaque[1] = opaque1;
+  /* full barrier: the unpublish is visible before the new epoch */
+  d->epoch = __sync_add_and_fetch (&rm->epoch, 1);
+  rm->n_deferred++;
+
+  if (vec_len (rm->deferred) == 1)
+    vlib_process_signal_event (vlib_get_main (),
+			       rm->process_node_index, 0 /* event */ , 0);
+}
+
+static void
+vlib_rcu_free_cb (uword p, uword heap)
+{
+  void *oldheap;
+
+  /* the memory goes back to the heap it came from */
+  oldheap = clib_mem_set_heap (uword_to_pointer (heap, void *));
+  clib_mem_free (uword_to_pointer (p, void *));
+  clib_mem_set_heap (oldheap);
+}
+
+/**
+ * clib_mem_free () the object, from the current heap, once no
+ * worker can see it.
+ */
+void
+vlib_rcu_free (void *p)
+{
+  if (p)
+    vlib_rcu_call (vlib_rcu_free_cb, pointer_to_uword (p),
+		   pointer_to_uword (clib_mem_get_heap ()));
+}
+
+/**
+ * Wait until every worker has passed through a quiescent state.
+ * Anything unpublished before the call can be freed right after it.
+ */
+void
+vlib_rcu_synchronize (vlib_main_t * vm)
+{
+  vlib_rcu_main_t *rm = &vlib_rcu_main;
+  f64 deadline;
+  u64 epoch;
+  int i;
+
+  ASSERT (vlib_get_thread_index () == 0);
+
+  if (vlib_rcu_workers_parked ())
+    return;
+
+  rm->n_synchronize++;
+  epoch = __sync_add_and_fetch (&rm->epoch, 1);
+  deadline = vlib_time_now (vm) + BARRIER_SYNC_TIMEOUT;
+
+  /* sleeping workers only pass a quiescent state when they wake up */
+  for (i = 1; i < vec_len (vlib_mains); i++)
+    vlib_worker_wakeup_if_sleeping (i);
+
+  while (vlib_rcu_min_epoch () < epoch)
+    {
+      if (vlib_time_now (vm) > deadline)
+	{
+	  fformat (stderr, "%s: worker thread deadlock\n", __FUNCTION__);
+	  os_panic ();
+	}
+    }
+}
+
+static uword
+vlib_rcu_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+		  vlib_frame_t * f)
+{
+  uword n_pending = 0;
+
+  while (1)
+    {
+      if (n_pending)
+	vlib_process_wait_for_event_or_clock (vm, VLIB_RCU_RECLAIM_INTERVAL);
+      else
+	vlib_process_wait_for_event (vm);
+
+      vlib_process_get_events (vm, 0);
+      n_pending = vlib_rcu_reclaim ();
+    }
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (vlib_rcu_process_node, static) = {
+  .function = vlib_rcu_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "rcu-process",
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_rcu_command_fn (vlib_main_t * vm,
+		     unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  vlib_rcu_main_t *rm = &vlib_rcu_main;
+  int i;
+
+  vlib_cli_output (vm, "epoch %llu, %d pending", rm->epoch,
+		   vec_len (rm->deferred));
+  vlib_cli_output (vm, "%llu deferred, %llu reclaimed, %llu synchronize",
+		   rm->n_deferred, rm->n_reclaimed, rm->n_synchronize);
+
+  for (i = 1; i < vec_len (vlib_mains); i++)
+    vlib_cli_output (vm, "  thread %d %v: epoch %llu", i,
+		     vlib_worker_threads[i].name, rm->threads[i].epoch);
+
+  return 0;
+}
+
+/*?
+ * Display the state of the deferred reclamation: the global epoch,
+ * the epoch last seen by each worker and the callbacks pending.
+ *
+ * @cliexpar
+ * @cliexstart{show rcu}
+ * epoch 1874, 0 pending
+ * 1874 deferred, 1874 reclaimed, 0 synchronize
+ *   thread 1 vpp_wk_0: epoch 1874
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_rcu_command, static) = {
+  .path = "show rcu",
+  .short_help = "show rcu",
+  .function = show_rcu_command_fn,
+  .is_mp_safe = 1,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+vlib_rcu_init (vlib_main_t * vm)
+{
+  vlib_rcu_main_t *rm = &vlib_rcu_main;
+
+  rm->process_node_index = vlib_rcu_process_node.index;
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (vlib_rcu_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
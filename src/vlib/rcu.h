@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Deferred reclamation of data shared with the worker threads,
+ * in the style of quiescent state based RCU.
+ *
+ * The workers hold no reference to shared control plane data between
+ * two iterations of their main loop. Each worker publishes the global
+ * epoch it has seen at the top of its loop (its quiescent state).
+ *
+ * The control plane, on the main thread, unpublishes an object (e.g.
+ * swaps the pointer to it for a pointer to its replacement) and then
+ * hands it to vlib_rcu_call() instead of freeing it. The callback runs
+ * on the main thread once every worker has passed through a quiescent
+ * state, i.e. when no worker can still see the old object.
+ *
+ * This lets the updates of the data structures read by the data plane
+ * proceed without vlib_worker_thread_barrier_sync(). Note that growing
+ * a vector or a pool still moves it; callers check with
+ * pool_get_will_expand() and friends and take the barrier only then.
+ */
+
+#ifndef included_vlib_rcu_h
+#define included_vlib_rcu_h
+
+#include <vlib/threads.h>
+
+typedef void (vlib_rcu_callback_t) (uword opaque0, uword opaque1);
+
+typedef struct
+{
+  vlib_rcu_callback_t *function;
+  uword opaque[2];
+  /* the epoch every worker must have seen before the callback runs */
+  u64 epoch;
+} vlib_rcu_deferred_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  /* the last global epoch seen by the thread in a quiescent state */
+  volatile u64 epoch;
+} vlib_rcu_thread_t;
+
+typedef struct
+{
+  /* bumped by every deferral */
+    CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  volatile u64 epoch;
+
+  /* written by the workers only, a cache line each */
+  vlib_rcu_thread_t threads[VLIB_MAX_CPUS];
+
+  /* callbacks waiting for their grace period, in epoch order */
+  vlib_rcu_deferred_t *deferred;
+
+  u32 process_node_index;
+  u8 reclaiming;
+
+  /* stats */
+  u64 n_deferred;
+  u64 n_reclaimed;
+  u64 n_synchronize;
+} vlib_rcu_main_t;
+
+extern vlib_rcu_main_t vlib_rcu_main;
+
+/* Called by each worker at the top of its main loop. */
+static_always_inline void
+vlib_rcu_quiescent (u32 thread_index)
+{
+  vlib_rcu_main_t *rm = &vlib_rcu_main;
+  u64 epoch = rm->epoch;
+
+  if (PREDICT_FALSE (rm->threads[thread_index].epoch != epoch))
+    {
+      /* all the reads of the previous iteration are done */
+      CLIB_MEMORY_BARRIER ();
+      rm->threads[thread_index].epoch = epoch;
+    }
+}
+
+void vlib_rcu_call (vlib_rcu_callback_t * function, uword opaque0,
+		    uword opaque1);
+void vlib_rcu_free (void *p);
+void vlib_rcu_synchronize (vlib_main_t * vm);
+
+/** Free a vector once no worker can see it */
+#define vlib_rcu_vec_free_h(V,H)			\
+do {							\
+  if (V)						\
+    {							\
+      vlib_rcu_free (vec_header ((V), (H)));		\
+      V = 0;						\
+    }							\
+} while (0)
+
+#define vlib_rcu_vec_free(V) vlib_rcu_vec_free_h(V,0)
+
+#endif /* included_vlib_rcu_h */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
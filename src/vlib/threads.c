@@ -16,6 +16,8 @@
 
 #include <signal.h>
 #include <math.h>
+#include <poll.h>
+#include <sys/eventfd.h>
 #include <vppinfra/format.h>
 #include <vlib/vlib.h>
 
@@ -516,6 +518,9 @@ start_workers (vlib_main_t * vm)
   w->elog_track.name = "main thread";
   elog_track_register (&vm->elog_main, &w->elog_track);
 
+  vlib_barrier_main.elog_track.name = "barrier";
+  elog_track_register (&vm->elog_main, &vlib_barrier_main.elog_track);
+
   if (vec_len (tm->thread_prefix))
     {
       w->name = format (0, "%v_main%c", tm->thread_prefix, '\0');
@@ -532,6 +537,19 @@ start_workers (vlib_main_t * vm)
     clib_mem_alloc_aligned (CLIB_CACHE_LINE_BYTES, CLIB_CACHE_LINE_BYTES);
   vm->elog_main.lock[0] = 0;
 
+  /* Adaptive polling wakeup eventfds, none for the main thread */
+  vec_validate_aligned (tm->worker_sleep, n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
+  tm->worker_sleep[0].wakeup_fd = -1;
+  for (i = 0; i < n_vlib_mains; i++)
+    tm->worker_sleep[i].clocks_since = clib_cpu_time_now ();
+  for (i = 1; i < n_vlib_mains; i++)
+    {
+      tm->worker_sleep[i].wakeup_fd = eventfd (0, EFD_NONBLOCK);
+      if (tm->worker_sleep[i].wakeup_fd < 0)
+	return clib_error_return_unix (0, "eventfd");
+    }
+
   if (n_vlib_mains > 1)
     {
       /* Replace hand-crafted length-1 vector with a real vector */
@@ -677,8 +695,14 @@ start_workers (vlib_main_t * vm)
 	      clib_mem_set_heap (oldheap);
 	      vec_add1_aligned (vlib_mains, vm_clone, CLIB_CACHE_LINE_BYTES);
 
-	      vm_clone->error_main.counters =
-		vec_dup (vlib_mains[0]->error_main.counters);
+	      {
+		void *stats_heap = vlib_stats_push_heap ();
+		vm_clone->error_main.counters =
+		  vec_dup (vlib_mains[0]->error_main.counters);
+		if (stats_heap)
+		  vlib_stats_pop_heap2 (vm_clone->error_main.counters,
+					vm_clone->thread_index, stats_heap);
+	      }
 	      vm_clone->error_main.counters_last_clear =
 		vec_dup (vlib_mains[0]->error_main.counters_last_clear);
 
@@ -700,6 +724,8 @@ start_workers (vlib_main_t * vm)
                             fl_clone[0] = fl_orig[0];
                             fl_clone->buffers = 0;
                             fl_clone->n_alloc = 0;
+                            fl_clone->n_pool_gets = 0;
+                            fl_clone->n_pool_puts = 0;
                           }));
 /* *INDENT-ON* */
 
@@ -846,7 +872,10 @@ vlib_worker_thread_node_runtime_update (void)
       clib_memcpy (&vm_clone->error_main, &vm->error_main,
 		   sizeof (vm->error_main));
       j = vec_len (vm->error_main.counters) - 1;
+      void *stats_heap = vlib_stats_push_heap ();
       vec_validate_aligned (old_counters, j, CLIB_CACHE_LINE_BYTES);
+      if (stats_heap)
+	vlib_stats_pop_heap2 (old_counters, i, stats_heap);
       vec_validate_aligned (old_counters_all_clear, j, CLIB_CACHE_LINE_BYTES);
       vm_clone->error_main.counters = old_counters;
       vm_clone->error_main.counters_last_clear = old_counters_all_clear;
@@ -988,6 +1017,37 @@ unformat_sched_policy (unformat_input_t * input, va_list * args)
   return 1;
 }
 
+u8 *
+format_vlib_worker_polling_mode (u8 * s, va_list * args)
+{
+  vlib_worker_polling_mode_t mode = va_arg (*args, u32);
+  char *t = 0;
+
+  switch (mode)
+    {
+#define _(f,n) case VLIB_WORKER_POLLING_MODE_##f: t = n; break;
+      foreach_vlib_worker_polling_mode
+#undef _
+    default:
+      return format (s, "unknown");
+    }
+  return format (s, "%s", t);
+}
+
+uword
+unformat_vlib_worker_polling_mode (unformat_input_t * input, va_list * args)
+{
+  u32 *r = va_arg (*args, u32 *);
+
+  if (0);
+#define _(f,s) else if (unformat (input, s)) *r = VLIB_WORKER_POLLING_MODE_##f;
+  foreach_vlib_worker_polling_mode
+#undef _
+    else
+    return 0;
+  return 1;
+}
+
 static clib_error_t *
 cpu_config (vlib_main_t * vm, unformat_input_t * input)
 {
@@ -1004,6 +1064,9 @@ cpu_config (vlib_main_t * vm, unformat_input_t * input)
   tm->n_thread_stacks = 1;	/* account for main thread */
   tm->sched_policy = ~0;
   tm->sched_priority = ~0;
+  tm->worker_polling_mode = VLIB_WORKER_POLLING_MODE_POLLING;
+  tm->worker_idle_polls = VLIB_WORKER_SLEEP_DEFAULT_IDLE_POLLS;
+  tm->worker_max_sleep_us = VLIB_WORKER_SLEEP_DEFAULT_MAX_US;
 
   tr = tm->next;
 
@@ -1064,6 +1127,20 @@ cpu_config (vlib_main_t * vm, unformat_input_t * input)
 	;
       else if (unformat (input, "scheduler-priority %u", &tm->sched_priority))
 	;
+      else if (unformat (input, "worker-polling %U",
+			 unformat_vlib_worker_polling_mode,
+			 &tm->worker_polling_mode))
+	;
+      else if (unformat (input, "worker-idle-polls %u",
+			 &tm->worker_idle_polls))
+	;
+      else if (unformat (input, "worker-max-sleep %u",
+			 &tm->worker_max_sleep_us))
+	{
+	  if (tm->worker_max_sleep_us < VLIB_WORKER_SLEEP_MIN_US)
+	    return clib_error_return (0, "worker-max-sleep must be at "
+				      "least %u us", VLIB_WORKER_SLEEP_MIN_US);
+	}
       else if (unformat (input, "%s %u", &name, &count))
 	{
 	  p = hash_get_mem (tm->thread_registrations_by_name, name);
@@ -1162,11 +1239,92 @@ vlib_worker_thread_fork_fixup (vlib_fork_fixup_t which)
   vlib_worker_thread_barrier_release (vm);
 }
 
+vlib_barrier_main_t vlib_barrier_main;
+
+static u32
+vlib_barrier_site_index (vlib_main_t * vm, const char *caller)
+{
+  vlib_barrier_main_t *bm = &vlib_barrier_main;
+  vlib_barrier_site_t *site;
+  uword *p;
+
+  if (PREDICT_FALSE (bm->site_by_caller == 0))
+    bm->site_by_caller = hash_create_string (0, sizeof (uword));
+
+  p = hash_get_mem (bm->site_by_caller, caller);
+  if (PREDICT_TRUE (p != 0))
+    return p[0];
+
+  pool_get (bm->sites, site);
+  memset (site, 0, sizeof (*site));
+  site->caller = format (0, "%s%c", caller, 0);
+  site->elog_string = elog_string (&vm->elog_main, "%s", caller);
+  hash_set_mem (bm->site_by_caller, site->caller, site - bm->sites);
+
+  return site - bm->sites;
+}
+
+static inline u32
+vlib_barrier_histogram_bucket (vlib_main_t * vm, u64 clocks)
+{
+  u64 usec = clocks * vm->clib_time.seconds_per_clock * 1e6;
+
+  if (usec == 0)
+    return 0;
+  return clib_min (min_log2 (usec) + 1, VLIB_BARRIER_N_HISTOGRAM_BUCKETS - 1);
+}
+
+static void
+vlib_barrier_record (vlib_main_t * vm, u64 t_open, u64 t_done)
+{
+  vlib_barrier_main_t *bm = &vlib_barrier_main;
+  vlib_barrier_site_t *site;
+  u64 wait, hold, release;
+
+  site = pool_elt_at_index (bm->sites, bm->site_index);
+  wait = bm->t_closed - bm->t_entry;
+  hold = t_open - bm->t_closed;
+  release = t_done - t_open;
+
+  site->count++;
+  site->wait_clocks += wait;
+  site->hold_clocks += hold;
+  site->release_clocks += release;
+  site->max_wait_clocks = clib_max (site->max_wait_clocks, wait);
+  site->max_hold_clocks = clib_max (site->max_hold_clocks, hold);
+  site->max_release_clocks = clib_max (site->max_release_clocks, release);
+  site->wait_histogram[vlib_barrier_histogram_bucket (vm, wait)]++;
+  site->hold_histogram[vlib_barrier_histogram_bucket (vm, hold)]++;
+
+  if (bm->elog_enable)
+    {
+      f64 usec_per_clock = vm->clib_time.seconds_per_clock * 1e6;
+      /* *INDENT-OFF* */
+      ELOG_TYPE_DECLARE (e) =
+        {
+          .format = "barrier %s: wait %dus hold %dus release %dus",
+          .format_args = "T4i4i4i4",
+        };
+      /* *INDENT-ON* */
+      struct
+      {
+	u32 caller, wait, hold, release;
+      } *ed;
+
+      ed = ELOG_TRACK_DATA (&vm->elog_main, e, bm->elog_track);
+      ed->caller = site->elog_string;
+      ed->wait = wait * usec_per_clock;
+      ed->hold = hold * usec_per_clock;
+      ed->release = release * usec_per_clock;
+    }
+}
+
 void
-vlib_worker_thread_barrier_sync (vlib_main_t * vm)
+vlib_worker_thread_barrier_sync_int (vlib_main_t * vm, const char *caller)
 {
+  vlib_barrier_main_t *bm = &vlib_barrier_main;
   f64 deadline;
-  u32 count;
+  u32 count, i;
 
   if (vec_len (vlib_mains) < 2)
     return;
@@ -1177,27 +1335,40 @@ vlib_worker_thread_barrier_sync (vlib_main_t * vm)
   if (++vlib_worker_threads[0].recursion_level > 1)
     return;
 
+  bm->t_entry = clib_cpu_time_now ();
   vlib_worker_threads[0].barrier_sync_count++;
 
   ASSERT (vlib_get_thread_index () == 0);
 
+  bm->site_index = vlib_barrier_site_index (vm, caller);
+
   deadline = vlib_time_now (vm) + BARRIER_SYNC_TIMEOUT;
 
   *vlib_worker_threads->wait_at_barrier = 1;
+
+  /* sleeping workers would only come to the barrier on their timeout */
+  CLIB_MEMORY_BARRIER ();
+  for (i = 1; i <= count; i++)
+    vlib_worker_wakeup_if_sleeping (i);
+
   while (*vlib_worker_threads->workers_at_barrier != count)
     {
       if (vlib_time_now (vm) > deadline)
 	{
-	  fformat (stderr, "%s: worker thread deadlock\n", __FUNCTION__);
+	  fformat (stderr, "%s: worker thread deadlock (%s)\n",
+		   __FUNCTION__, caller);
 	  os_panic ();
 	}
     }
+
+  bm->t_closed = clib_cpu_time_now ();
 }
 
 void
 vlib_worker_thread_barrier_release (vlib_main_t * vm)
 {
   f64 deadline;
+  u64 t_open;
 
   if (vec_len (vlib_mains) < 2)
     return;
@@ -1205,6 +1376,7 @@ vlib_worker_thread_barrier_release (vlib_main_t * vm)
   if (--vlib_worker_threads[0].recursion_level > 0)
     return;
 
+  t_open = clib_cpu_time_now ();
   deadline = vlib_time_now (vm) + BARRIER_SYNC_TIMEOUT;
 
   *vlib_worker_threads->wait_at_barrier = 0;
@@ -1217,6 +1389,119 @@ vlib_worker_thread_barrier_release (vlib_main_t * vm)
 	  os_panic ();
 	}
     }
+
+  vlib_barrier_record (vm, t_open, clib_cpu_time_now ());
+}
+
+void
+vlib_worker_wakeup (u32 thread_index)
+{
+  vlib_worker_sleep_t *ws =
+    vec_elt_at_index (vlib_thread_main.worker_sleep, thread_index);
+  u64 one = 1;
+
+  /* only the first waker writes */
+  if (clib_smp_swap (&ws->sleeping, 0) == 0)
+    return;
+
+  ws->wakeup_time = clib_cpu_time_now ();
+  if (write (ws->wakeup_fd, &one, sizeof (one)) != sizeof (one))
+    clib_unix_warning ("eventfd write");
+}
+
+/* Anything which came before the sleeping flag was visible */
+static int
+vlib_worker_has_work (vlib_main_t * vm)
+{
+  vlib_thread_main_t *tm = &vlib_thread_main;
+  vlib_rcu_main_t *rm = &vlib_rcu_main;
+  vlib_frame_queue_main_t *fqm;
+  vlib_frame_queue_t *fq;
+
+  if (*vlib_worker_threads->wait_at_barrier)
+    return 1;
+
+  if (_vec_len (vm->node_main.pending_interrupt_node_runtime_indices))
+    return 1;
+
+  if (rm->threads[vm->thread_index].epoch != rm->epoch)
+    return 1;
+
+  vec_foreach (fqm, tm->frame_queue_mains)
+  {
+    fq = fqm->vlib_frame_queues[vm->thread_index];
+    if (fq->tail > fq->head)
+      return 1;
+  }
+
+  return 0;
+}
+
+void
+vlib_worker_sleep (vlib_main_t * vm)
+{
+  vlib_thread_main_t *tm = &vlib_thread_main;
+  vlib_worker_sleep_t *ws =
+    vec_elt_at_index (tm->worker_sleep, vm->thread_index);
+  struct pollfd pfd;
+  struct timespec ts;
+  u64 t0, t1, count, latency;
+  uword bucket;
+  int rv, woken;
+
+  ws->sleeping = 1;
+  CLIB_MEMORY_BARRIER ();
+
+  if (vlib_worker_has_work (vm))
+    {
+      ws->sleeping = 0;
+      return;
+    }
+
+  /* back off while idle, up to the latency bound */
+  if (ws->sleep_us == 0)
+    ws->sleep_us = VLIB_WORKER_SLEEP_MIN_US;
+  ws->sleep_us = clib_min (ws->sleep_us, tm->worker_max_sleep_us);
+
+  ts.tv_sec = ws->sleep_us / 1000000;
+  ts.tv_nsec = (ws->sleep_us % 1000000) * 1000;
+  pfd.fd = ws->wakeup_fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+
+  t0 = clib_cpu_time_now ();
+  rv = ppoll (&pfd, 1, &ts, 0);
+  t1 = clib_cpu_time_now ();
+
+  /* a waker cleared the flag before us */
+  woken = clib_smp_swap (&ws->sleeping, 0) == 0;
+
+  if (rv > 0)
+    {
+      if (read (ws->wakeup_fd, &count, sizeof (count)) < 0
+	  && errno != EAGAIN)
+	clib_unix_warning ("eventfd read");
+    }
+
+  ws->sleeps++;
+  ws->clocks_asleep += t1 - t0;
+
+  if (woken && rv > 0)
+    {
+      ws->wakeups++;
+      latency = t1 > ws->wakeup_time ? t1 - ws->wakeup_time : 0;
+      ws->wakeup_latency_clocks += latency;
+      ws->max_wakeup_latency = clib_max (ws->max_wakeup_latency, latency);
+      latency = latency * vm->clib_time.seconds_per_clock * 1e6;
+      bucket = latency ? 1 + min_log2 (latency) : 0;
+      bucket = clib_min (bucket, VLIB_WORKER_SLEEP_N_LATENCY_BUCKETS - 1);
+      ws->wakeup_latency[bucket]++;
+    }
+  else
+    {
+      ws->timeouts++;
+      ws->sleep_us = clib_min (2 * ws->sleep_us, tm->worker_max_sleep_us);
+    }
 }
 
 /*
@@ -1283,19 +1568,11 @@ vlib_frame_queue_dequeue (vlib_main_t * vm, vlib_frame_queue_main_t * fqm)
 
   while (1)
     {
-      if (fq->head == fq->tail)
-	{
-	  fq->head_hint = fq->head;
-	  return processed;
-	}
-
       elt = fq->elts + ((fq->head + 1) & (fq->nelts - 1));
 
+      /* the producers mark an element valid once it is filled */
       if (!elt->valid)
-	{
-	  fq->head_hint = fq->head;
-	  return processed;
-	}
+	break;
 
       from = elt->buffer_index;
       msg_type = elt->msg_type;
@@ -1335,7 +1612,6 @@ vlib_frame_queue_dequeue (vlib_main_t * vm, vlib_frame_queue_main_t * fqm)
       elt->valid = 0;
       elt->n_vectors = 0;
       elt->msg_type = 0xfefefefe;
-      CLIB_MEMORY_BARRIER ();
       fq->head++;
       processed++;
 
@@ -1343,12 +1619,23 @@ vlib_frame_queue_dequeue (vlib_main_t * vm, vlib_frame_queue_main_t * fqm)
        * Limit the number of packets pushed into the graph
        */
       if (vectors >= fq->vector_threshold)
-	{
-	  fq->head_hint = fq->head;
-	  return processed;
-	}
+	break;
     }
-  ASSERT (0);
+
+  if (processed)
+    {
+      fq->dequeues += processed;
+      fq->dequeue_vectors += vectors;
+      fq->dequeue_batches++;
+
+      /*
+       * Hand the slots back to the producers, once for the whole batch:
+       * the elements must be read and cleared before they can be reused.
+       */
+      CLIB_MEMORY_BARRIER ();
+      fq->head_hint = fq->head;
+    }
+
   return processed;
 }
 
@@ -1391,6 +1678,7 @@ vlib_frame_queue_main_init (u32 node_index, u32 frame_queue_nelts)
 {
   vlib_thread_main_t *tm = vlib_get_thread_main ();
   vlib_frame_queue_main_t *fqm;
+  vlib_frame_queue_per_thread_data_t *ptd;
   vlib_frame_queue_t *fq;
   int i;
 
@@ -1401,6 +1689,9 @@ vlib_frame_queue_main_init (u32 node_index, u32 frame_queue_nelts)
 
   fqm->node_index = node_index;
 
+  fqm->congestion_policy = VLIB_FRAME_QUEUE_CONGESTION_WAIT;
+  fqm->queue_hi_thresh = frame_queue_nelts - 2;
+
   vec_validate (fqm->vlib_frame_queues, tm->n_vlib_mains - 1);
   _vec_len (fqm->vlib_frame_queues) = 0;
   for (i = 0; i < tm->n_vlib_mains; i++)
@@ -1409,6 +1700,20 @@ vlib_frame_queue_main_init (u32 node_index, u32 frame_queue_nelts)
       vec_add1 (fqm->vlib_frame_queues, fq);
     }
 
+  /* each producer only writes its own cache lines */
+  vec_validate_aligned (fqm->per_thread_data, tm->n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
+  vec_foreach (ptd, fqm->per_thread_data)
+  {
+    vec_validate (ptd->handoff_queue_elt_by_thread_index,
+		  tm->n_vlib_mains - 1);
+    vec_validate_init_empty (ptd->congested_handoff_queue_by_thread_index,
+			     tm->n_vlib_mains - 1,
+			     (vlib_frame_queue_t *) (~0));
+    vec_validate_aligned (ptd->counters_by_thread_index,
+			  tm->n_vlib_mains - 1, CLIB_CACHE_LINE_BYTES);
+  }
+
   return (fqm - tm->frame_queue_mains);
 }
 
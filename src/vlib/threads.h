@@ -110,26 +110,32 @@ typedef struct
 
 extern vlib_worker_thread_t *vlib_worker_threads;
 
+/*
+ * A multi-producer, single consumer ring of frame queue elements.
+ *
+ * The producers only write the tail and the elements, the consumer only
+ * writes the head, the head hint and clears the elements it has
+ * dequeued, each on its own cache line. The consumer never reads the
+ * tail: an element is ready once it is marked valid. The producers only
+ * read the head hint, which the consumer publishes once per batch of
+ * elements dequeued rather than once per element.
+ */
 typedef struct
 {
-  /* enqueue side */
+  /* producer side, bumped atomically by all the producers */
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
   volatile u64 tail;
-  u64 enqueues;
-  u64 enqueue_ticks;
-  u64 enqueue_vectors;
-  u32 enqueue_full_events;
 
-  /* dequeue side */
+  /* consumer side, private to the consumer */
     CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
   volatile u64 head;
   u64 dequeues;
-  u64 dequeue_ticks;
   u64 dequeue_vectors;
+  u64 dequeue_batches;
   u64 trace;
   u64 vector_threshold;
 
-  /* dequeue hint to enqueue side */
+  /* dequeue hint to enqueue side, written once per batch */
     CLIB_CACHE_LINE_ALIGN_MARK (cacheline2);
   volatile u64 head_hint;
 
@@ -140,11 +146,52 @@ typedef struct
 }
 vlib_frame_queue_t;
 
+/* What a producer does when the queue it hands off to is congested */
+#define foreach_vlib_frame_queue_congestion_policy	\
+_(WAIT, "wait")						\
+_(DROP, "drop")
+
+typedef enum
+{
+#define _(v,s) VLIB_FRAME_QUEUE_CONGESTION_##v,
+  foreach_vlib_frame_queue_congestion_policy
+#undef _
+} vlib_frame_queue_congestion_policy_t;
+
+/* Producer side counters, per producer thread and per queue */
+typedef struct
+{
+  u64 enqueues;
+  u64 enqueue_vectors;
+  /* the ring was full, the producer had to wait */
+  u64 full_events;
+  /* packets dropped because the queue was congested */
+  u64 drops;
+} vlib_frame_queue_counters_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  /* the element being filled for each destination thread */
+  vlib_frame_queue_elt_t **handoff_queue_elt_by_thread_index;
+  /* the queues found congested in the current frame */
+  vlib_frame_queue_t **congested_handoff_queue_by_thread_index;
+  /* indexed by destination thread */
+  vlib_frame_queue_counters_t *counters_by_thread_index;
+} vlib_frame_queue_per_thread_data_t;
+
 typedef struct
 {
   u32 node_index;
   vlib_frame_queue_t **vlib_frame_queues;
 
+  /* congestion: more than queue_hi_thresh elements in use */
+  vlib_frame_queue_congestion_policy_t congestion_policy;
+  u32 queue_hi_thresh;
+
+  /* indexed by producer thread */
+  vlib_frame_queue_per_thread_data_t *per_thread_data;
+
   /* for frame queue tracing */
   frame_queue_trace_t *frame_queue_traces;
   frame_queue_nelt_counter_t *frame_queue_histogram;
@@ -178,7 +225,58 @@ u32 vlib_frame_queue_main_init (u32 node_index, u32 frame_queue_nelts);
 #define BARRIER_SYNC_TIMEOUT (1.0)
 #endif
 
-void vlib_worker_thread_barrier_sync (vlib_main_t * vm);
+/* Barrier hold / wait histograms, log2 microseconds */
+#define VLIB_BARRIER_N_HISTOGRAM_BUCKETS 16
+
+/* Barrier stats, per call site */
+typedef struct
+{
+  /* caller name, NULL terminated; the key of site_by_caller */
+  u8 *caller;
+
+  /* caller, in the event log string table */
+  u32 elog_string;
+
+  u64 count;
+
+  /* cpu clocks, total and max */
+  u64 wait_clocks;
+  u64 hold_clocks;
+  u64 release_clocks;
+  u64 max_wait_clocks;
+  u64 max_hold_clocks;
+  u64 max_release_clocks;
+
+  u32 wait_histogram[VLIB_BARRIER_N_HISTOGRAM_BUCKETS];
+  u32 hold_histogram[VLIB_BARRIER_N_HISTOGRAM_BUCKETS];
+} vlib_barrier_site_t;
+
+typedef struct
+{
+  vlib_barrier_site_t *sites;
+  uword *site_by_caller;
+
+  /* the barrier in progress */
+  u32 site_index;
+  u64 t_entry;
+  u64 t_closed;
+
+  /* log each barrier in the event log */
+  u8 elog_enable;
+  elog_track_t elog_track;
+} vlib_barrier_main_t;
+
+extern vlib_barrier_main_t vlib_barrier_main;
+
+/*
+ * The barrier is instrumented per call site: the function name of the
+ * caller, unless it passes a better one (e.g. the API message name).
+ */
+#define vlib_worker_thread_barrier_sync(X) \
+  vlib_worker_thread_barrier_sync_int (X, __FUNCTION__)
+
+void vlib_worker_thread_barrier_sync_int (vlib_main_t * vm,
+					  const char *caller);
 void vlib_worker_thread_barrier_release (vlib_main_t * vm);
 
 static_always_inline uword
@@ -243,6 +341,58 @@ typedef enum
     SCHED_POLICY_N,
 } sched_policy_t;
 
+/*
+ * Adaptive worker polling. In the adaptive mode a worker which ran
+ * idle-polls main loops without a vector sleeps on its wakeup eventfd,
+ * for at most the current sleep time. The sleep time doubles from
+ * VLIB_WORKER_SLEEP_MIN_US up to max-sleep while the worker stays idle,
+ * which bounds the latency of the polling mode input nodes. Anything
+ * giving the worker work wakes it up: a device interrupt, a frame queue
+ * enqueue, a barrier sync or an rcu grace period.
+ */
+#define foreach_vlib_worker_polling_mode	\
+_(POLLING, "polling")				\
+_(ADAPTIVE, "adaptive")
+
+typedef enum
+{
+#define _(f,s) VLIB_WORKER_POLLING_MODE_##f,
+  foreach_vlib_worker_polling_mode
+#undef _
+} vlib_worker_polling_mode_t;
+
+#define VLIB_WORKER_SLEEP_DEFAULT_IDLE_POLLS 1024
+#define VLIB_WORKER_SLEEP_DEFAULT_MAX_US 100
+#define VLIB_WORKER_SLEEP_MIN_US 10
+
+/* wakeup latency: <1us, 1-2us, 2-4us, ... */
+#define VLIB_WORKER_SLEEP_N_LATENCY_BUCKETS 12
+
+typedef struct
+{
+  /* shared with the wakers */
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  volatile u32 sleeping;
+  int wakeup_fd;
+  /* set by the waker which cleared sleeping */
+  u64 wakeup_time;
+
+  /* private to the worker */
+    CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
+  u32 n_idle_loops;
+  u32 sleep_us;
+
+  /* stats */
+  u64 sleeps;
+  u64 wakeups;
+  u64 timeouts;
+  u64 clocks_asleep;
+  u64 clocks_since;
+  u64 wakeup_latency_clocks;
+  u64 max_wakeup_latency;
+  u64 wakeup_latency[VLIB_WORKER_SLEEP_N_LATENCY_BUCKETS];
+} vlib_worker_sleep_t;
+
 typedef struct
 {
   clib_error_t *(*vlib_launch_thread_cb) (void *fp, vlib_worker_thread_t * w,
@@ -310,10 +460,52 @@ typedef struct
   /* callbacks */
   vlib_thread_callbacks_t cb;
   int extern_thread_mgmt;
+
+  /* adaptive worker polling, see vlib_worker_sleep_t */
+  vlib_worker_polling_mode_t worker_polling_mode;
+  u32 worker_idle_polls;
+  u32 worker_max_sleep_us;
+  vlib_worker_sleep_t *worker_sleep;
 } vlib_thread_main_t;
 
 extern vlib_thread_main_t vlib_thread_main;
 
+void vlib_worker_sleep (vlib_main_t * vm);
+void vlib_worker_wakeup (u32 thread_index);
+format_function_t format_vlib_worker_polling_mode;
+unformat_function_t unformat_vlib_worker_polling_mode;
+
+/*
+ * Wake up the thread if it sleeps. The caller must have made the work
+ * visible to it with a full barrier first.
+ */
+static_always_inline void
+vlib_worker_wakeup_if_sleeping (u32 thread_index)
+{
+  vlib_worker_sleep_t *ws = vlib_thread_main.worker_sleep + thread_index;
+
+  if (PREDICT_FALSE (ws->sleeping))
+    vlib_worker_wakeup (thread_index);
+}
+
+/* Called by the worker at the end of each main loop in adaptive mode */
+static_always_inline void
+vlib_worker_idle_poll (vlib_main_t * vm, u32 n_vectors)
+{
+  vlib_thread_main_t *tm = &vlib_thread_main;
+  vlib_worker_sleep_t *ws = tm->worker_sleep + vm->thread_index;
+
+  if (n_vectors)
+    {
+      ws->n_idle_loops = 0;
+      ws->sleep_us = 0;
+    }
+  else if (ws->n_idle_loops < tm->worker_idle_polls)
+    ws->n_idle_loops++;
+  else
+    vlib_worker_sleep (vm);
+}
+
 #include <vlib/global_funcs.h>
 
 #define VLIB_REGISTER_THREAD(x,...)                     \
@@ -398,6 +590,7 @@ vlib_get_frame_queue_elt (u32 frame_queue_index, u32 index)
   vlib_thread_main_t *tm = &vlib_thread_main;
   vlib_frame_queue_main_t *fqm =
     vec_elt_at_index (tm->frame_queue_mains, frame_queue_index);
+  vlib_frame_queue_per_thread_data_t *ptd;
   u64 new_tail;
 
   fq = fqm->vlib_frame_queues[index];
@@ -405,9 +598,17 @@ vlib_get_frame_queue_elt (u32 frame_queue_index, u32 index)
 
   new_tail = __sync_add_and_fetch (&fq->tail, 1);
 
+  /* the atomic add is a full barrier: the consumer sees the tail */
+  vlib_worker_wakeup_if_sleeping (index);
+
   /* Wait until a ring slot is available */
-  while (new_tail >= fq->head_hint + fq->nelts)
-    vlib_worker_thread_barrier_check ();
+  if (PREDICT_FALSE (new_tail >= fq->head_hint + fq->nelts))
+    {
+      ptd = vec_elt_at_index (fqm->per_thread_data, vlib_get_thread_index ());
+      ptd->counters_by_thread_index[index].full_events++;
+      while (new_tail >= fq->head_hint + fq->nelts)
+	vlib_worker_thread_barrier_check ();
+    }
 
   elt = fq->elts + (new_tail & (fq->nelts - 1));
 
@@ -446,7 +647,6 @@ is_vlib_frame_queue_congested (u32 frame_queue_index,
        * the specified threshold and is congested
        */
       handoff_queue_by_worker_index[index] = fq;
-      fq->enqueue_full_events++;
       return fq;
     }
 
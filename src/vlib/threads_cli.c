@@ -479,6 +479,7 @@ test_frame_queue_nelts (vlib_main_t * vm, unformat_input_t * input,
     {
       fqm->vlib_frame_queues[fqix]->nelts = nelts;
     }
+  fqm->queue_hi_thresh = nelts - 2;
 
 done:
   unformat_free (line_input);
@@ -573,6 +574,566 @@ VLIB_CLI_COMMAND (cmd_test_frame_queue_threshold,static) = {
 };
 /* *INDENT-ON* */
 
+static u8 *
+format_frame_queue_congestion_policy (u8 * s, va_list * args)
+{
+  vlib_frame_queue_congestion_policy_t policy = va_arg (*args, int);
+  char *t = 0;
+
+  switch (policy)
+    {
+#define _(v,str) case VLIB_FRAME_QUEUE_CONGESTION_##v: t = str; break;
+      foreach_vlib_frame_queue_congestion_policy
+#undef _
+    default:
+      return format (s, "unknown %d", policy);
+    }
+  return format (s, "%s", t);
+}
+
+/*
+ * Display the per queue occupancy and the producer / consumer counters.
+ * The producer counters are private to each producer, summed here.
+ */
+static clib_error_t *
+show_frame_queue_stats (vlib_main_t * vm, unformat_input_t * input,
+			vlib_cli_command_t * cmd)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm;
+  vlib_frame_queue_per_thread_data_t *ptd;
+  vlib_frame_queue_counters_t sum, *c;
+  vlib_frame_queue_t *fq;
+  u64 in_use;
+  u32 fqix;
+
+  vec_foreach (fqm, tm->frame_queue_mains)
+  {
+    vlib_cli_output (vm, "Worker handoff queue index %u (next node '%U'), "
+		     "congestion %U above %u elts:",
+		     fqm - tm->frame_queue_mains,
+		     format_vlib_node_name, vm, fqm->node_index,
+		     format_frame_queue_congestion_policy,
+		     fqm->congestion_policy, fqm->queue_hi_thresh);
+    vlib_cli_output (vm, "  %-20s%8s%12s%12s%8s%10s%12s%12s%12s",
+		     "Thread", "In use", "Enqueues", "Vectors", "Vec/elt",
+		     "Full", "Drops", "Dequeues", "Elts/batch");
+
+    for (fqix = 0; fqix < vec_len (fqm->vlib_frame_queues); fqix++)
+      {
+	fq = fqm->vlib_frame_queues[fqix];
+
+	memset (&sum, 0, sizeof (sum));
+	vec_foreach (ptd, fqm->per_thread_data)
+	{
+	  c = vec_elt_at_index (ptd->counters_by_thread_index, fqix);
+	  sum.enqueues += c->enqueues;
+	  sum.enqueue_vectors += c->enqueue_vectors;
+	  sum.full_events += c->full_events;
+	  sum.drops += c->drops;
+	}
+
+	/* reserved, including the elements being filled */
+	in_use = fq->tail - fq->head;
+	if (in_use > fq->nelts)
+	  in_use = fq->nelts;
+
+	vlib_cli_output (vm, "  %-20v%4llu/%-3u%12llu%12llu%8.1f%10llu"
+			 "%12llu%12llu%12.1f",
+			 vlib_worker_threads[fqix].name, in_use, fq->nelts,
+			 sum.enqueues, sum.enqueue_vectors,
+			 sum.enqueues ?
+			 (f64) sum.enqueue_vectors / (f64) sum.enqueues : 0.0,
+			 sum.full_events, sum.drops, fq->dequeues,
+			 fq->dequeue_batches ?
+			 (f64) fq->dequeues / (f64) fq->dequeue_batches : 0.0);
+      }
+  }
+  return 0;
+}
+
+/*?
+ * Display the worker handoff queues: the elements in use in each ring,
+ * the elements and vectors enqueued, how many times a producer found
+ * the ring full and had to wait, the packets dropped by the drop
+ * congestion policy and the average number of elements dequeued per
+ * batch.
+ *
+ * @cliexpar
+ * @cliexstart{show frame-queue stats}
+ * Worker handoff queue index 0 (next node 'handoff-dispatch'), congestion wait above 30 elts:
+ *   Thread                In use    Enqueues     Vectors Vec/elt      Full       Drops    Dequeues  Elts/batch
+ *   vpp_main               0/32            0           0     0.0         0           0           0         0.0
+ *   vpp_wk_0               2/32       412311    52775808   128.0        17           0      412309         1.6
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_show_frame_queue_stats,static) = {
+    .path = "show frame-queue stats",
+    .short_help = "show frame-queue stats",
+    .function = show_frame_queue_stats,
+    .is_mp_safe = 1,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+clear_frame_queue_stats (vlib_main_t * vm, unformat_input_t * input,
+			 vlib_cli_command_t * cmd)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm;
+  vlib_frame_queue_per_thread_data_t *ptd;
+  vlib_frame_queue_t *fq;
+  u32 fqix;
+
+  /* under the barrier: the workers do not update the counters */
+  vec_foreach (fqm, tm->frame_queue_mains)
+  {
+    vec_foreach (ptd, fqm->per_thread_data)
+      vec_zero (ptd->counters_by_thread_index);
+
+    for (fqix = 0; fqix < vec_len (fqm->vlib_frame_queues); fqix++)
+      {
+	fq = fqm->vlib_frame_queues[fqix];
+	fq->dequeues = fq->dequeue_vectors = fq->dequeue_batches = 0;
+      }
+  }
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_clear_frame_queue_stats,static) = {
+    .path = "clear frame-queue stats",
+    .short_help = "clear frame-queue stats",
+    .function = clear_frame_queue_stats,
+};
+/* *INDENT-ON* */
+
+/*
+ * What the producers do when a worker handoff queue is congested
+ */
+static clib_error_t *
+set_frame_queue_congestion (vlib_main_t * vm, unformat_input_t * input,
+			    vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm;
+  clib_error_t *error = NULL;
+  u32 policy = ~0;
+  u32 threshold = ~0;
+  u32 index = ~0;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "index %u", &index))
+	;
+      else if (unformat (line_input, "threshold %u", &threshold))
+	;
+#define _(v,s)								\
+      else if (unformat (line_input, s))				\
+	policy = VLIB_FRAME_QUEUE_CONGESTION_##v;
+      foreach_vlib_frame_queue_congestion_policy
+#undef _
+      else
+	{
+	  error = clib_error_return (0, "parse error: '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (index >= vec_len (tm->frame_queue_mains))
+    {
+      error = clib_error_return (0,
+				 "expecting valid worker handoff queue index");
+      goto done;
+    }
+
+  fqm = vec_elt_at_index (tm->frame_queue_mains, index);
+
+  if (threshold != ~0)
+    {
+      if (threshold == 0 || threshold >= fqm->vlib_frame_queues[0]->nelts)
+	{
+	  error = clib_error_return (0, "threshold must be 1 to %u",
+				     fqm->vlib_frame_queues[0]->nelts - 1);
+	  goto done;
+	}
+      fqm->queue_hi_thresh = threshold;
+    }
+
+  if (policy != ~0)
+    fqm->congestion_policy = policy;
+
+done:
+  unformat_free (line_input);
+
+  return error;
+}
+
+/*?
+ * Set what the threads handing packets off to a worker through the
+ * given queue do when the queue has more than the threshold elements
+ * in use: wait for the worker to make room (the default, lossless but
+ * the producer stalls), or drop the packets and count them.
+ *
+ * @cliexpar
+ * @cliexcmd{set frame-queue congestion index 0 drop threshold 24}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_set_frame_queue_congestion,static) = {
+    .path = "set frame-queue congestion",
+    .short_help = "set frame-queue congestion index <n> [wait|drop] "
+    "[threshold <nelts>]",
+    .function = set_frame_queue_congestion,
+};
+/* *INDENT-ON* */
+
+
+static int
+barrier_site_hold_cmp (void *a1, void *a2)
+{
+  vlib_barrier_site_t *s1 = a1, *s2 = a2;
+
+  /* the most expensive first */
+  return (s1->hold_clocks < s2->hold_clocks) ? 1 :
+    (s1->hold_clocks > s2->hold_clocks) ? -1 : 0;
+}
+
+static u8 *
+format_barrier_histogram (u8 * s, va_list * args)
+{
+  u32 *histogram = va_arg (*args, u32 *);
+  int i;
+
+  for (i = 0; i < VLIB_BARRIER_N_HISTOGRAM_BUCKETS; i++)
+    {
+      if (histogram[i] == 0)
+	continue;
+      if (i == 0)
+	s = format (s, " <1us:%u", histogram[i]);
+      else if (i == VLIB_BARRIER_N_HISTOGRAM_BUCKETS - 1)
+	s = format (s, " >=%uus:%u", 1 << (i - 1), histogram[i]);
+      else
+	s = format (s, " <%uus:%u", 1 << i, histogram[i]);
+    }
+  return s;
+}
+
+static clib_error_t *
+show_barrier_fn (vlib_main_t * vm,
+		 unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  vlib_barrier_main_t *bm = &vlib_barrier_main;
+  vlib_barrier_site_t *site, *sites = 0;
+  f64 usec_per_clock = vm->clib_time.seconds_per_clock * 1e6;
+  int verbose = 0;
+  u64 count = 0;
+
+  if (unformat (input, "verbose"))
+    verbose = 1;
+
+  /* *INDENT-OFF* */
+  pool_foreach (site, bm->sites,
+  ({
+    vec_add1 (sites, site[0]);
+    count += site->count;
+  }));
+  /* *INDENT-ON* */
+  vec_sort_with_function (sites, barrier_site_hold_cmp);
+
+  vlib_cli_output (vm, "%llu barrier syncs from %d call sites, "
+		   "event log %s", count, vec_len (sites),
+		   bm->elog_enable ? "on" : "off");
+  vlib_cli_output (vm, "%-40s%10s%20s%20s%20s", "Caller", "Count",
+		   "Wait avg/max us", "Hold avg/max us",
+		   "Release avg/max us");
+
+  vec_foreach (site, sites)
+  {
+    u64 n = clib_max (site->count, 1);
+
+    vlib_cli_output (vm, "%-40s%10llu%13.1f/%-6.0f%13.1f/%-6.0f%13.1f/%-6.0f",
+		     site->caller, site->count,
+		     site->wait_clocks * usec_per_clock / n,
+		     site->max_wait_clocks * usec_per_clock,
+		     site->hold_clocks * usec_per_clock / n,
+		     site->max_hold_clocks * usec_per_clock,
+		     site->release_clocks * usec_per_clock / n,
+		     site->max_release_clocks * usec_per_clock);
+    if (verbose)
+      {
+	vlib_cli_output (vm, "  wait:%U", format_barrier_histogram,
+			 site->wait_histogram);
+	vlib_cli_output (vm, "  hold:%U", format_barrier_histogram,
+			 site->hold_histogram);
+      }
+  }
+
+  vec_free (sites);
+  return 0;
+}
+
+/*?
+ * Show, per call site, how often the worker barrier is taken, how long
+ * the main thread waits for the workers to stop, how long it holds
+ * them and how long they take to resume. The most expensive call sites
+ * come first. With <em>verbose</em>, also show the log2 histograms of
+ * the wait and hold times.
+ *
+ * @cliexpar
+ * @cliexstart{show barrier}
+ * 1031 barrier syncs from 3 call sites, event log off
+ * Caller                                       Count     Wait avg/max us     Hold avg/max us  Release avg/max us
+ * cli: set interface ip address                  12          2.1/4            184.3/410            1.0/2
+ * sw_interface_add_del_address                  1017          1.9/6             11.2/95             0.9/3
+ * vl_api_rpc_call_t_handler                        2          2.3/3              4.5/5              0.8/1
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_show_barrier,static) = {
+    .path = "show barrier",
+    .short_help = "show barrier [verbose]",
+    .function = show_barrier_fn,
+    .is_mp_safe = 1,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+clear_barrier_fn (vlib_main_t * vm,
+		  unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  vlib_barrier_main_t *bm = &vlib_barrier_main;
+  vlib_barrier_site_t *site;
+
+  /* *INDENT-OFF* */
+  pool_foreach (site, bm->sites,
+  ({
+    u8 *caller = site->caller;
+    u32 elog_string = site->elog_string;
+
+    memset (site, 0, sizeof (*site));
+    site->caller = caller;
+    site->elog_string = elog_string;
+  }));
+  /* *INDENT-ON* */
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_clear_barrier,static) = {
+    .path = "clear barrier",
+    .short_help = "clear barrier",
+    .function = clear_barrier_fn,
+    .is_mp_safe = 1,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+trace_barrier_fn (vlib_main_t * vm,
+		  unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  vlib_barrier_main_t *bm = &vlib_barrier_main;
+
+  if (unformat (input, "on"))
+    bm->elog_enable = 1;
+  else if (unformat (input, "off"))
+    bm->elog_enable = 0;
+  else
+    return clib_error_return (0, "expecting on or off");
+
+  return 0;
+}
+
+/*?
+ * Log each worker barrier in the event log, on the "barrier" track:
+ * the caller, the wait, hold and release times. See
+ * <em>show event-logger</em>.
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_trace_barrier,static) = {
+    .path = "trace barrier",
+    .short_help = "trace barrier (on|off)",
+    .function = trace_barrier_fn,
+    .is_mp_safe = 1,
+};
+/* *INDENT-ON* */
+
+
+static u8 *
+format_worker_wakeup_histogram (u8 * s, va_list * args)
+{
+  u64 *histogram = va_arg (*args, u64 *);
+  int i;
+
+  for (i = 0; i < VLIB_WORKER_SLEEP_N_LATENCY_BUCKETS; i++)
+    {
+      if (histogram[i] == 0)
+	continue;
+      if (i == 0)
+	s = format (s, " <1us:%llu", histogram[i]);
+      else if (i == VLIB_WORKER_SLEEP_N_LATENCY_BUCKETS - 1)
+	s = format (s, " >=%uus:%llu", 1 << (i - 1), histogram[i]);
+      else
+	s = format (s, " <%uus:%llu", 1 << i, histogram[i]);
+    }
+  return s;
+}
+
+static clib_error_t *
+show_worker_polling_fn (vlib_main_t * vm,
+			unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_worker_sleep_t *ws;
+  f64 seconds_per_clock = vm->clib_time.seconds_per_clock;
+  u64 now = clib_cpu_time_now ();
+  int verbose = 0, i;
+
+  if (unformat (input, "verbose"))
+    verbose = 1;
+
+  vlib_cli_output (vm, "Worker polling %U, idle-polls %u, max-sleep %uus",
+		   format_vlib_worker_polling_mode, tm->worker_polling_mode,
+		   tm->worker_idle_polls, tm->worker_max_sleep_us);
+  vlib_cli_output (vm, "%-20s%12s%12s%12s%10s%14s%14s",
+		   "Thread", "Sleeps", "Wakeups", "Timeouts", "Asleep",
+		   "Avg wake(us)", "Max wake(us)");
+
+  for (i = 1; i < vec_len (tm->worker_sleep); i++)
+    {
+      ws = vec_elt_at_index (tm->worker_sleep, i);
+      vlib_cli_output (vm, "%-20v%12llu%12llu%12llu%9.1f%%%14.1f%14.1f",
+		       vlib_worker_threads[i].name, ws->sleeps, ws->wakeups,
+		       ws->timeouts,
+		       now > ws->clocks_since ?
+		       100.0 * (f64) ws->clocks_asleep /
+		       (f64) (now - ws->clocks_since) : 0.0,
+		       ws->wakeups ?
+		       ws->wakeup_latency_clocks * seconds_per_clock * 1e6 /
+		       ws->wakeups : 0.0,
+		       ws->max_wakeup_latency * seconds_per_clock * 1e6);
+      if (verbose)
+	vlib_cli_output (vm, "  wakeup latency:%U",
+			 format_worker_wakeup_histogram, ws->wakeup_latency);
+    }
+
+  return 0;
+}
+
+/*?
+ * Display the adaptive polling mode of the worker threads and, for each
+ * worker, how many times it went to sleep, was woken up by an event or
+ * by its timeout, the share of the time it spent asleep and the latency
+ * from the event to the worker running again.
+ *
+ * @cliexpar
+ * @cliexstart{show worker-polling}
+ * Worker polling adaptive, idle-polls 1024, max-sleep 100us
+ * Thread                    Sleeps     Wakeups    Timeouts    Asleep  Avg wake(us)  Max wake(us)
+ * vpp_wk_0                  181822        2311      179511     91.3%          12.0          87.4
+ * vpp_wk_1                  183090          14      183076     93.9%           6.0          19.2
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_show_worker_polling,static) = {
+    .path = "show worker-polling",
+    .short_help = "show worker-polling [verbose]",
+    .function = show_worker_polling_fn,
+    .is_mp_safe = 1,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+clear_worker_polling_fn (vlib_main_t * vm,
+			 unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_worker_sleep_t *ws;
+
+  /* under the barrier: no worker is asleep */
+  vec_foreach (ws, tm->worker_sleep)
+  {
+    ws->sleeps = ws->wakeups = ws->timeouts = 0;
+    ws->clocks_asleep = ws->wakeup_latency_clocks = 0;
+    ws->max_wakeup_latency = 0;
+    memset (ws->wakeup_latency, 0, sizeof (ws->wakeup_latency));
+    ws->clocks_since = clib_cpu_time_now ();
+  }
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_clear_worker_polling,static) = {
+    .path = "clear worker-polling",
+    .short_help = "clear worker-polling",
+    .function = clear_worker_polling_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+set_worker_polling_fn (vlib_main_t * vm,
+		       unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  u32 mode = ~0, idle_polls = ~0, max_sleep = ~0;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "%U", unformat_vlib_worker_polling_mode, &mode))
+	;
+      else if (unformat (input, "idle-polls %u", &idle_polls))
+	;
+      else if (unformat (input, "max-sleep %u", &max_sleep))
+	;
+      else
+	return clib_error_return (0, "parse error: '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (max_sleep != ~0 && max_sleep < VLIB_WORKER_SLEEP_MIN_US)
+    return clib_error_return (0, "max-sleep must be at least %uus",
+			      VLIB_WORKER_SLEEP_MIN_US);
+
+  /* under the barrier, the workers pick it up on their next loop */
+  if (idle_polls != ~0)
+    tm->worker_idle_polls = idle_polls;
+  if (max_sleep != ~0)
+    tm->worker_max_sleep_us = max_sleep;
+  if (mode != ~0)
+    tm->worker_polling_mode = mode;
+
+  return 0;
+}
+
+/*?
+ * Set how the worker threads poll their input nodes. In the polling
+ * mode, the default, they spin. In the adaptive mode, a worker which
+ * ran <em>idle-polls</em> main loops without a packet sleeps until a
+ * device interrupt, a handoff, a barrier sync or its timeout wakes it
+ * up. The timeout starts at 10us and doubles while the worker stays
+ * idle, up to <em>max-sleep</em>: the latency bound of the input nodes
+ * in polling rx mode, which cannot wake a worker up. The startup
+ * equivalent is <em>cpu { worker-polling adaptive worker-idle-polls
+ * <n> worker-max-sleep <usec> }</em>.
+ *
+ * @cliexpar
+ * @cliexcmd{set worker-polling adaptive idle-polls 1024 max-sleep 200}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_set_worker_polling,static) = {
+    .path = "set worker-polling",
+    .short_help = "set worker-polling [polling|adaptive] [idle-polls <n>] "
+    "[max-sleep <usec>]",
+    .function = set_worker_polling_fn,
+};
+/* *INDENT-ON* */
+
 
 /*
  * fd.io coding-style-patch-verification: ON
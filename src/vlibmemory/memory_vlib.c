@@ -1733,7 +1733,10 @@ vl_msg_api_process_file (vlib_main_t * vm, u8 * filename,
 	      handler = (void *) am->msg_handlers[msg_id];
 
 	      if (!am->is_mp_safe[msg_id])
-		vl_msg_api_barrier_sync ();
+		{
+		  vl_msg_api_barrier_trace_context (am->msg_names[msg_id]);
+		  vl_msg_api_barrier_sync ();
+		}
 	      (*handler) (tmpbuf + sizeof (uword));
 	      if (!am->is_mp_safe[msg_id])
 		vl_msg_api_barrier_release ();
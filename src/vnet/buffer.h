@@ -70,6 +70,11 @@
 #define LOG2_VNET_BUFFER_SPAN_CLONE LOG2_VLIB_BUFFER_FLAG_USER(8)
 #define VNET_BUFFER_SPAN_CLONE (1 << LOG2_VNET_BUFFER_SPAN_CLONE)
 
+/* TCP super-packet, to be segmented in gso_size chunks of payload by the
+   interface output path or the device. See vnet_buffer2 (b)->gso. */
+#define LOG2_VNET_BUFFER_GSO LOG2_VLIB_BUFFER_FLAG_USER(9)
+#define VNET_BUFFER_GSO (1 << LOG2_VNET_BUFFER_GSO)
+
 #define foreach_buffer_opaque_union_subtype     \
 _(ethernet)                                     \
 _(ip)                                           \
@@ -254,6 +259,15 @@ typedef struct
       u8 flags;			//See ip_frag.h
     } ip_frag;
 
+    /* IP reassembly */
+    struct
+    {
+      u32 owner_thread_index;	/**< thread owning the reassembly */
+      u16 fragment_first;	/**< offset of first payload byte */
+      u16 fragment_last;	/**< offset of last payload byte */
+      u16 ip6_frag_hdr_offset;	/**< fragment header offset, ip6 only */
+    } reass;
+
     /* COP - configurable junk filter(s) */
     struct
     {
@@ -307,9 +321,22 @@ typedef struct
 {
   union
   {
+    /* GSO, valid if VNET_BUFFER_GSO is set */
+    struct
+    {
+      u16 gso_size;		/**< payload bytes per segment */
+      i16 l3_hdr_offset;	/**< ip header, relative to b->data */
+      i16 l4_hdr_offset;	/**< tcp header, relative to b->data */
+    } gso;
   };
 } vnet_buffer_opaque2_t;
 
+STATIC_ASSERT (sizeof (vnet_buffer_opaque2_t) <=
+	       STRUCT_SIZE_OF (vlib_buffer_t, opaque2),
+	       "VNET buffer opaque2 meta-data too large for vlib_buffer");
+
+#define vnet_buffer2(b) ((vnet_buffer_opaque2_t *) vlib_get_buffer_opaque2 (b))
+
 
 
 #endif /* included_vnet_buffer_h */
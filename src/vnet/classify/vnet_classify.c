@@ -112,10 +112,25 @@ vnet_classify_new_table (vnet_classify_main_t *cm,
 {
   vnet_classify_table_t * t;
   void * oldheap;
+  vlib_main_t * vm = vlib_get_main ();
+  u8 need_barrier_sync;
     
   nbuckets = 1 << (max_log2 (nbuckets));
 
+  /* 
+   * The workers index the pool without a lock. Growing it moves it,
+   * so they must be held at the barrier, but only then.
+   */
+  pool_get_aligned_will_expand (cm->tables, need_barrier_sync,
+                                CLIB_CACHE_LINE_BYTES);
+  if (need_barrier_sync)
+    vlib_worker_thread_barrier_sync (vm);
+
   pool_get_aligned (cm->tables, t, CLIB_CACHE_LINE_BYTES);
+
+  if (need_barrier_sync)
+    vlib_worker_thread_barrier_release (vm);
+
   memset(t, 0, sizeof (*t));
   
   vec_validate_aligned (t->mask, match_n_vectors - 1, sizeof(u32x4));
@@ -141,9 +156,10 @@ vnet_classify_new_table (vnet_classify_main_t *cm,
   return (t);
 }
 
-void vnet_classify_delete_table_index (vnet_classify_main_t *cm, 
-                                       u32 table_index, int del_chain)
+static void
+vnet_classify_delete_table_rcu (uword table_index, uword unused)
 {
+  vnet_classify_main_t * cm = &vnet_classify_main;
   vnet_classify_table_t * t;
 
   /* Tolerate multiple frees, up to a point */
@@ -151,9 +167,6 @@ void vnet_classify_delete_table_index (vnet_classify_main_t *cm,
     return;
 
   t = pool_elt_at_index (cm->tables, table_index);
-  if (del_chain && t->next_table_index != ~0)
-    /* Recursively delete the entire chain */
-    vnet_classify_delete_table_index (cm, t->next_table_index, del_chain);
 
   vec_free (t->mask);
   vec_free (t->buckets);
@@ -162,6 +175,27 @@ void vnet_classify_delete_table_index (vnet_classify_main_t *cm,
   pool_put (cm->tables, t);
 }
 
+void vnet_classify_delete_table_index (vnet_classify_main_t *cm, 
+                                       u32 table_index, int del_chain)
+{
+  vnet_classify_table_t * t;
+
+  /* Tolerate multiple frees, up to a point */
+  if (pool_is_free_index (cm->tables, table_index))
+    return;
+
+  t = pool_elt_at_index (cm->tables, table_index);
+  if (del_chain && t->next_table_index != ~0)
+    /* Recursively delete the entire chain */
+    vnet_classify_delete_table_index (cm, t->next_table_index, del_chain);
+
+  /* 
+   * After the pages of the table already waiting to be recycled, and
+   * once no worker can be looking at the table.
+   */
+  vlib_rcu_call (vnet_classify_delete_table_rcu, table_index, 0);
+}
+
 static vnet_classify_entry_t *
 vnet_classify_entry_alloc (vnet_classify_table_t * t, u32 log2_pages)
 {
@@ -206,6 +240,39 @@ vnet_classify_entry_free (vnet_classify_table_t * t,
     t->freelists[log2_pages] = v;
 }
 
+/**
+ * Return pages to the free lists, once no worker can see them.
+ * Must be called without the writer lock.
+ */
+static void
+vnet_classify_entry_free_rcu (uword table_index, uword offset_and_log2_pages)
+{
+  vnet_classify_main_t * cm = &vnet_classify_main;
+  vnet_classify_table_t * t;
+  vnet_classify_entry_t * v;
+
+  t = pool_elt_at_index (cm->tables, table_index);
+  v = vnet_classify_get_entry (t, offset_and_log2_pages >> 8);
+
+  while (__sync_lock_test_and_set (t->writer_lock, 1))
+    ; 
+
+  vnet_classify_entry_free (t, v, offset_and_log2_pages & 0xff);
+
+  CLIB_MEMORY_BARRIER();
+  t->writer_lock[0] = 0;
+}
+
+static void
+vnet_classify_entry_free_deferred (vnet_classify_table_t * t,
+                                   vnet_classify_entry_t * v, u32 log2_pages)
+{
+  vnet_classify_main_t * cm = &vnet_classify_main;
+
+  vlib_rcu_call (vnet_classify_entry_free_rcu, t - cm->tables,
+                 ((uword) vnet_classify_get_offset (t, v) << 8) | log2_pages);
+}
+
 static inline void make_working_copy
 (vnet_classify_table_t * t, vnet_classify_bucket_t * b)
 {
@@ -214,7 +281,7 @@ static inline void make_working_copy
   void * oldheap;
   vnet_classify_entry_t * working_copy;
   u32 thread_index = vlib_get_thread_index();
-  int working_copy_length, required_length;
+  int required_length;
 
   if (thread_index >= vec_len (t->working_copies))
     {
@@ -228,27 +295,16 @@ static inline void make_working_copy
   /* 
    * working_copies are per-cpu so that near-simultaneous
    * updates from multiple threads will not result in sporadic, spurious
-   * lookup failures. 
+   * lookup failures. Each edit gets a fresh one: the workers may still
+   * be reading the previous one, which is recycled once they are done.
    */
-  working_copy = t->working_copies[thread_index];
-  working_copy_length = t->working_copy_lengths[thread_index];
   required_length = 
     (sizeof(vnet_classify_entry_t) + (t->match_n_vectors*sizeof(u32x4)))
     * t->entries_per_page * (1<<b->log2_pages);
 
   t->saved_bucket.as_u64 = b->as_u64;
-  oldheap = clib_mem_set_heap (t->mheap);
-
-  if (required_length > working_copy_length)
-    {
-      if (working_copy)
-        clib_mem_free (working_copy);
-      working_copy =
-        clib_mem_alloc_aligned (required_length, CLIB_CACHE_LINE_BYTES);
-      t->working_copies[thread_index] = working_copy;
-    }
-
-  clib_mem_set_heap (oldheap);
+  working_copy = vnet_classify_entry_alloc (t, b->log2_pages);
+  t->working_copy_lengths[thread_index] = b->log2_pages;
 
   v = vnet_classify_get_entry (t, b->offset);
   
@@ -407,6 +463,9 @@ int vnet_classify_add_del (vnet_classify_table_t * t,
   u8 * key_minus_skip;
   int resplit_once = 0;
   int mark_bucket_linear;
+  vnet_classify_entry_t * free_v[2];
+  u32 free_log2_pages[2];
+  int n_free = 0;
 
   ASSERT ((add_v->flags & VNET_CLASSIFY_ENTRY_FREE) == 0);
 
@@ -448,6 +507,10 @@ int vnet_classify_add_del (vnet_classify_table_t * t,
     }
   
   make_working_copy (t, b);
+
+  /* unpublished by the time we unlock, whatever happens */
+  free_v[n_free] = t->working_copies[thread_index];
+  free_log2_pages[n_free++] = t->saved_bucket.log2_pages;
   
   save_v = vnet_classify_get_entry (t, t->saved_bucket.offset);
   value_index = hash & ((1<<t->saved_bucket.log2_pages)-1);
@@ -608,12 +671,20 @@ int vnet_classify_add_del (vnet_classify_table_t * t,
   CLIB_MEMORY_BARRIER();
   b->as_u64 = tmp_b.as_u64;
   t->active_elements ++;
-  v = vnet_classify_get_entry (t, t->saved_bucket.offset);
-  vnet_classify_entry_free (t, v, old_log2_pages);
+  free_v[n_free] = vnet_classify_get_entry (t, t->saved_bucket.offset);
+  free_log2_pages[n_free++] = old_log2_pages;
 
  unlock:
   CLIB_MEMORY_BARRIER();
   t->writer_lock[0] = 0;
+
+  /* 
+   * The workers may still be reading the pages the bucket no longer
+   * points to. Recycle them once they are done.
+   */
+  for (i = 0; i < n_free; i++)
+    vnet_classify_entry_free_deferred (t, free_v[i], free_log2_pages[i]);
+
   return rv;
 }
 
@@ -317,6 +317,93 @@ vnet_hw_interface_get_rx_mode (vnet_main_t * vnm, u32 hw_if_index,
 }
 
 
+static void
+vnet_device_input_update_node_state (vlib_main_t * vm, u32 node_index,
+				     vnet_device_input_runtime_t * rt)
+{
+  vnet_device_and_queue_t *dq;
+
+  if (vec_len (rt->devices_and_queues) == 0)
+    {
+      vlib_node_set_state (vm, node_index, VLIB_NODE_STATE_DISABLED);
+      return;
+    }
+
+  rt->enabled_node_state = VLIB_NODE_STATE_INTERRUPT;
+  vec_foreach (dq, rt->devices_and_queues)
+    if (dq->mode == VNET_HW_INTERFACE_RX_MODE_POLLING)
+    rt->enabled_node_state = VLIB_NODE_STATE_POLLING;
+  vlib_node_set_state (vm, node_index, rt->enabled_node_state);
+}
+
+/*
+ * Move an rx queue to another thread within a single barrier sync.
+ * The old thread has dispatched everything it received from the queue
+ * before the new one polls it, so no packet is reordered, and the queue
+ * is not left unpolled between an unassign and an assign. It keeps its
+ * rx mode; in interrupt mode the new thread polls it once, in case an
+ * interrupt was pending on the old one.
+ */
+int
+vnet_hw_interface_move_rx_queue (vnet_main_t * vnm, u32 hw_if_index,
+				 u16 queue_id, uword thread_index)
+{
+  vnet_device_main_t *vdm = &vnet_device_main;
+  vnet_hw_interface_t *hw = vnet_get_hw_interface (vnm, hw_if_index);
+  vlib_main_t *vm0 = vlib_get_main (), *old_vm, *new_vm;
+  vnet_device_input_runtime_t *old_rt, *new_rt;
+  vnet_device_and_queue_t *dq, moved;
+  uword old_thread_index;
+
+  if (queue_id >= vec_len (hw->input_node_thread_index_by_queue))
+    return VNET_API_ERROR_INVALID_INTERFACE;
+
+  if (thread_index >= vec_len (vlib_mains) ||
+      (thread_index != 0 && (thread_index < vdm->first_worker_thread_index ||
+			     thread_index > vdm->last_worker_thread_index)))
+    return VNET_API_ERROR_INVALID_WORKER;
+
+  old_thread_index = hw->input_node_thread_index_by_queue[queue_id];
+  if (old_thread_index == thread_index)
+    return 0;
+
+  old_vm = vlib_mains[old_thread_index];
+  new_vm = vlib_mains[thread_index];
+  old_rt = vlib_node_get_runtime_data (old_vm, hw->input_node_index);
+  new_rt = vlib_node_get_runtime_data (new_vm, hw->input_node_index);
+
+  vlib_worker_thread_barrier_sync (vm0);
+
+  vec_foreach (dq, old_rt->devices_and_queues)
+    if (dq->hw_if_index == hw_if_index && dq->queue_id == queue_id)
+    break;
+
+  if (dq == vec_end (old_rt->devices_and_queues))
+    {
+      vlib_worker_thread_barrier_release (vm0);
+      return VNET_API_ERROR_INVALID_INTERFACE;
+    }
+
+  moved = dq[0];
+  moved.interrupt_pending = 0;
+  vec_del1 (old_rt->devices_and_queues, dq - old_rt->devices_and_queues);
+  vnet_device_queue_update (vnm, old_rt);
+  vnet_device_input_update_node_state (old_vm, hw->input_node_index,
+				       old_rt);
+
+  vec_add1 (new_rt->devices_and_queues, moved);
+  vnet_device_queue_update (vnm, new_rt);
+  hw->input_node_thread_index_by_queue[queue_id] = thread_index;
+  vnet_device_input_update_node_state (new_vm, hw->input_node_index,
+				       new_rt);
+
+  if (moved.mode != VNET_HW_INTERFACE_RX_MODE_POLLING)
+    vnet_device_input_set_interrupt_pending (vnm, hw_if_index, queue_id);
+
+  vlib_worker_thread_barrier_release (vm0);
+
+  return 0;
+}
 
 static clib_error_t *
 vnet_device_init (vlib_main_t * vm)
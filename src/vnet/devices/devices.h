@@ -86,6 +86,8 @@ void vnet_hw_interface_assign_rx_thread (vnet_main_t * vnm, u32 hw_if_index,
 					 u16 queue_id, uword thread_index);
 int vnet_hw_interface_unassign_rx_thread (vnet_main_t * vnm, u32 hw_if_index,
 					  u16 queue_id);
+int vnet_hw_interface_move_rx_queue (vnet_main_t * vnm, u32 hw_if_index,
+				     u16 queue_id, uword thread_index);
 int vnet_hw_interface_set_rx_mode (vnet_main_t * vnm, u32 hw_if_index,
 				   u16 queue_id,
 				   vnet_hw_interface_rx_mode mode);
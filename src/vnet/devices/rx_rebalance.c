@@ -0,0 +1,532 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Load aware rx queue placement.
+ *
+ * Every interval, the load of each worker is the share of its clocks
+ * spent in main loops which processed vectors. The load of a worker is
+ * split between its rx queues in proportion to the packets each queue
+ * received, from the per thread rx counters of the interfaces. When the
+ * busiest worker is above min-load and more than threshold above the
+ * least loaded one for two intervals in a row, the queue whose move
+ * best evens out the two is moved, if that gains at least half the
+ * threshold. A moved queue stays put for hold intervals.
+ */
+
+#include <vnet/vnet.h>
+#include <vnet/devices/devices.h>
+
+#define RX_REBALANCE_DEFAULT_INTERVAL 10.0
+#define RX_REBALANCE_DEFAULT_THRESHOLD 0.25
+#define RX_REBALANCE_DEFAULT_MIN_LOAD 0.50
+#define RX_REBALANCE_DEFAULT_HOLD 3
+/* consecutive imbalanced samples before a move */
+#define RX_REBALANCE_PERSIST 2
+#define RX_REBALANCE_HISTORY 32
+
+typedef struct
+{
+  u32 hw_if_index;
+  u16 queue_id;
+  u16 thread_index;
+  u64 packets;
+  f64 load;
+} rx_rebalance_queue_t;
+
+typedef struct
+{
+  u64 last_idle;
+  u64 *last_rx_packets;		/* by sw_if_index */
+  u64 packets;
+  f64 load;
+} rx_rebalance_thread_t;
+
+typedef struct
+{
+  f64 time;
+  u32 hw_if_index;
+  u16 queue_id;
+  u16 from, to;
+  f64 queue_load, from_load, to_load;
+} rx_rebalance_decision_t;
+
+typedef struct
+{
+  /* config */
+  u8 enabled;
+  f64 interval;
+  f64 threshold;
+  f64 min_load;
+  u32 hold;
+
+  u32 process_node_index;
+  u8 have_baseline;
+  u64 n_samples;
+  u64 last_sample_time;
+  u32 n_imbalanced;
+
+  rx_rebalance_thread_t *threads;
+  rx_rebalance_queue_t *queues;
+
+  /* (hw_if_index << 16 | queue_id) -> sample of the last move */
+  uword *moved_at;
+
+  rx_rebalance_decision_t *history;
+  u32 history_next;
+  u64 n_moves;
+} rx_rebalance_main_t;
+
+static rx_rebalance_main_t rx_rebalance_main;
+
+static void
+rx_rebalance_collect_queues (vlib_main_t * vm, u32 thread_index)
+{
+  rx_rebalance_main_t *rrm = &rx_rebalance_main;
+  vlib_node_t *pn = vlib_get_node_by_name (vm, (u8 *) "device-input");
+  vnet_device_input_runtime_t *rt;
+  vnet_device_and_queue_t *dq;
+  rx_rebalance_queue_t *q;
+  uword si;
+
+  /* *INDENT-OFF* */
+  clib_bitmap_foreach (si, pn->sibling_bitmap,
+  ({
+    rt = vlib_node_get_runtime_data (vlib_mains[thread_index], si);
+    vec_foreach (dq, rt->devices_and_queues)
+      {
+        vec_add2 (rrm->queues, q, 1);
+        q->hw_if_index = dq->hw_if_index;
+        q->queue_id = dq->queue_id;
+        q->thread_index = thread_index;
+      }
+  }));
+  /* *INDENT-ON* */
+}
+
+/*
+ * Sample the loads; returns 0 on the first sample, which only sets the
+ * baseline.
+ */
+static int
+rx_rebalance_sample (vlib_main_t * vm)
+{
+  rx_rebalance_main_t *rrm = &rx_rebalance_main;
+  vnet_device_main_t *vdm = &vnet_device_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  vlib_combined_counter_main_t *cm =
+    vnm->interface_main.combined_sw_if_counters + VNET_INTERFACE_COUNTER_RX;
+  rx_rebalance_thread_t *th;
+  rx_rebalance_queue_t *q, *q2;
+  vnet_hw_interface_t *hw;
+  u64 now, dt, idle, busy, n_rx, *last;
+  u32 t, n_same;
+  int first = !rrm->have_baseline;
+
+  now = clib_cpu_time_now ();
+  dt = now - rrm->last_sample_time;
+  rrm->last_sample_time = now;
+  rrm->have_baseline = 1;
+  rrm->n_samples++;
+
+  vec_validate (rrm->threads, vdm->last_worker_thread_index);
+  vec_reset_length (rrm->queues);
+
+  for (t = vdm->first_worker_thread_index;
+       t <= vdm->last_worker_thread_index; t++)
+    {
+      th = vec_elt_at_index (rrm->threads, t);
+      idle = vlib_mains[t]->cpu_time_idle - th->last_idle;
+      th->last_idle += idle;
+      busy = dt > idle ? dt - idle : 0;
+      th->load = first ? 0 : (f64) busy / (f64) dt;
+      th->packets = 0;
+      rx_rebalance_collect_queues (vm, t);
+    }
+
+  /* packets received by each queue since the last sample */
+  vec_foreach (q, rrm->queues)
+  {
+    th = vec_elt_at_index (rrm->threads, q->thread_index);
+    hw = vnet_get_hw_interface (vnm, q->hw_if_index);
+    vec_validate (th->last_rx_packets, hw->sw_if_index);
+    last = vec_elt_at_index (th->last_rx_packets, hw->sw_if_index);
+
+    n_rx = 0;
+    if (hw->sw_if_index < vec_len (cm->counters[q->thread_index]))
+      n_rx = cm->counters[q->thread_index][hw->sw_if_index].packets;
+
+    /* the per thread counters do not tell the queues apart */
+    n_same = 0;
+    vec_foreach (q2, rrm->queues)
+      n_same += (q2->hw_if_index == q->hw_if_index
+		 && q2->thread_index == q->thread_index);
+
+    q->packets = (n_rx >= last[0] ? n_rx - last[0] : n_rx) / n_same;
+    th->packets += q->packets;
+  }
+
+  /* the last sample is only taken once per interface and thread */
+  vec_foreach (q, rrm->queues)
+  {
+    th = vec_elt_at_index (rrm->threads, q->thread_index);
+    hw = vnet_get_hw_interface (vnm, q->hw_if_index);
+    if (hw->sw_if_index < vec_len (cm->counters[q->thread_index]))
+      th->last_rx_packets[hw->sw_if_index] =
+	cm->counters[q->thread_index][hw->sw_if_index].packets;
+  }
+
+  vec_foreach (q, rrm->queues)
+  {
+    th = vec_elt_at_index (rrm->threads, q->thread_index);
+    q->load = th->packets ? th->load * q->packets / th->packets : 0;
+  }
+
+  return !first;
+}
+
+static void
+rx_rebalance_record (vlib_main_t * vm, rx_rebalance_queue_t * q, u32 to,
+		     f64 from_load, f64 to_load)
+{
+  rx_rebalance_main_t *rrm = &rx_rebalance_main;
+  rx_rebalance_decision_t *d;
+
+  if (vec_len (rrm->history) < RX_REBALANCE_HISTORY)
+    vec_add2 (rrm->history, d, 1);
+  else
+    d = vec_elt_at_index (rrm->history, rrm->history_next);
+  rrm->history_next = (rrm->history_next + 1) % RX_REBALANCE_HISTORY;
+
+  d->time = vlib_time_now (vm);
+  d->hw_if_index = q->hw_if_index;
+  d->queue_id = q->queue_id;
+  d->from = q->thread_index;
+  d->to = to;
+  d->queue_load = q->load;
+  d->from_load = from_load;
+  d->to_load = to_load;
+
+  /* *INDENT-OFF* */
+  ELOG_TYPE_DECLARE (e) =
+    {
+      .format = "rx-rebalance: hw_if_index %d queue %d thread %d -> %d, "
+      "queue load %d%%",
+      .format_args = "i4i2i2i2i2",
+    };
+  /* *INDENT-ON* */
+  struct
+  {
+    u32 hw_if_index;
+    u16 queue_id, from, to, queue_load;
+  } *ed;
+
+  ed = ELOG_DATA (&vm->elog_main, e);
+  ed->hw_if_index = d->hw_if_index;
+  ed->queue_id = d->queue_id;
+  ed->from = d->from;
+  ed->to = d->to;
+  ed->queue_load = d->queue_load * 100;
+}
+
+static void
+rx_rebalance (vlib_main_t * vm)
+{
+  rx_rebalance_main_t *rrm = &rx_rebalance_main;
+  vnet_device_main_t *vdm = &vnet_device_main;
+  rx_rebalance_thread_t *th;
+  rx_rebalance_queue_t *q, *best = 0;
+  u32 t, busiest = ~0, idlest = ~0;
+  f64 la, lb, new_max, best_max;
+  uword *p, key;
+
+  if (!rx_rebalance_sample (vm))
+    return;
+
+  for (t = vdm->first_worker_thread_index;
+       t <= vdm->last_worker_thread_index; t++)
+    {
+      th = vec_elt_at_index (rrm->threads, t);
+      if (busiest == ~0 || th->load > rrm->threads[busiest].load)
+	busiest = t;
+      if (idlest == ~0 || th->load < rrm->threads[idlest].load)
+	idlest = t;
+    }
+
+  if (busiest == ~0 || busiest == idlest)
+    return;
+
+  la = rrm->threads[busiest].load;
+  lb = rrm->threads[idlest].load;
+
+  if (la < rrm->min_load || la - lb < rrm->threshold)
+    {
+      rrm->n_imbalanced = 0;
+      return;
+    }
+
+  /* hysteresis: a single busy interval is not worth a move */
+  if (++rrm->n_imbalanced < RX_REBALANCE_PERSIST)
+    return;
+
+  best_max = la;
+  vec_foreach (q, rrm->queues)
+  {
+    if (q->thread_index != busiest)
+      continue;
+
+    key = (uword) q->hw_if_index << 16 | q->queue_id;
+    p = hash_get (rrm->moved_at, key);
+    if (p && rrm->n_samples - p[0] <= rrm->hold)
+      continue;
+
+    new_max = clib_max (la - q->load, lb + q->load);
+    if (new_max < best_max)
+      {
+	best_max = new_max;
+	best = q;
+      }
+  }
+
+  if (best == 0 || la - best_max < rrm->threshold / 2)
+    return;
+
+  if (vnet_hw_interface_move_rx_queue (vnet_get_main (), best->hw_if_index,
+				       best->queue_id, idlest))
+    return;
+
+  rx_rebalance_record (vm, best, idlest, la, lb);
+  key = (uword) best->hw_if_index << 16 | best->queue_id;
+  hash_set (rrm->moved_at, key, rrm->n_samples);
+  rrm->n_imbalanced = 0;
+  rrm->n_moves++;
+}
+
+static uword
+rx_rebalance_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+		      vlib_frame_t * f)
+{
+  rx_rebalance_main_t *rrm = &rx_rebalance_main;
+
+  while (1)
+    {
+      if (rrm->enabled)
+	vlib_process_wait_for_event_or_clock (vm, rrm->interval);
+      else
+	vlib_process_wait_for_event (vm);
+
+      /* enabled or reconfigured: start over from a new baseline */
+      if (vlib_process_get_events (vm, 0) != ~0)
+	{
+	  rrm->have_baseline = 0;
+	  rrm->n_imbalanced = 0;
+	}
+
+      if (rrm->enabled)
+	rx_rebalance (vm);
+    }
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (rx_rebalance_process_node,static) = {
+  .function = rx_rebalance_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "rx-rebalance-process",
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+set_interface_rx_rebalance (vlib_main_t * vm, unformat_input_t * input,
+			    vlib_cli_command_t * cmd)
+{
+  rx_rebalance_main_t *rrm = &rx_rebalance_main;
+  vnet_device_main_t *vdm = &vnet_device_main;
+  int enable = -1;
+  f64 interval = rrm->interval;
+  u32 threshold = rrm->threshold * 100, min_load = rrm->min_load * 100;
+  u32 hold = rrm->hold;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "enable"))
+	enable = 1;
+      else if (unformat (input, "disable"))
+	enable = 0;
+      else if (unformat (input, "interval %f", &interval))
+	;
+      else if (unformat (input, "threshold %u", &threshold))
+	;
+      else if (unformat (input, "min-load %u", &min_load))
+	;
+      else if (unformat (input, "hold %u", &hold))
+	;
+      else
+	return clib_error_return (0, "parse error: '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (enable == 1 && vdm->first_worker_thread_index == 0)
+    return clib_error_return (0, "no worker threads");
+
+  if (interval < 1.0)
+    return clib_error_return (0, "the interval must be at least 1 second");
+
+  if (threshold == 0 || threshold > 100 || min_load > 100)
+    return clib_error_return (0, "threshold and min-load are percents");
+
+  rrm->interval = interval;
+  rrm->threshold = threshold / 100.0;
+  rrm->min_load = min_load / 100.0;
+  rrm->hold = hold;
+  if (enable != -1)
+    rrm->enabled = enable;
+
+  vlib_process_signal_event (vm, rrm->process_node_index, 0, 0);
+  return 0;
+}
+
+/*?
+ * Let a process move the rx queues between the workers according to
+ * their measured load. Every <em>interval</em> seconds (10 by default),
+ * if the busiest worker is above <em>min-load</em> percent (50) and at
+ * least <em>threshold</em> percent (25) busier than the least loaded
+ * one for two intervals in a row, the queue whose move best evens out
+ * the two moves to the least loaded worker. A moved queue stays there
+ * for at least <em>hold</em> intervals (3).
+ *
+ * @cliexpar
+ * @cliexcmd{set interface rx-rebalance enable interval 5 threshold 20}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_set_interface_rx_rebalance,static) = {
+    .path = "set interface rx-rebalance",
+    .short_help = "set interface rx-rebalance [enable|disable] "
+    "[interval <sec>] [threshold <percent>] [min-load <percent>] "
+    "[hold <intervals>]",
+    .function = set_interface_rx_rebalance,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_interface_rx_rebalance (vlib_main_t * vm, unformat_input_t * input,
+			     vlib_cli_command_t * cmd)
+{
+  rx_rebalance_main_t *rrm = &rx_rebalance_main;
+  vnet_device_main_t *vdm = &vnet_device_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  rx_rebalance_decision_t *d;
+  rx_rebalance_queue_t *q;
+  rx_rebalance_thread_t *th;
+  f64 now = vlib_time_now (vm);
+  u32 t, i;
+
+  vlib_cli_output (vm, "rx-rebalance %s, interval %.1fs, threshold %u%%, "
+		   "min-load %u%%, hold %u, %llu moves",
+		   rrm->enabled ? "enabled" : "disabled", rrm->interval,
+		   (u32) (rrm->threshold * 100 + 0.5),
+		   (u32) (rrm->min_load * 100 + 0.5), rrm->hold,
+		   rrm->n_moves);
+
+  if (vec_len (rrm->queues))
+    {
+      vlib_cli_output (vm, "Last sample:");
+      for (t = vdm->first_worker_thread_index;
+	   t <= vdm->last_worker_thread_index &&
+	   t < vec_len (rrm->threads); t++)
+	{
+	  th = vec_elt_at_index (rrm->threads, t);
+	  vlib_cli_output (vm, "  Thread %u (%v): load %.1f%%", t,
+			   vlib_worker_threads[t].name, th->load * 100);
+	  vec_foreach (q, rrm->queues)
+	    if (q->thread_index == t)
+	    vlib_cli_output (vm, "    %U queue %u: %llu packets, load %.1f%%",
+			     format_vnet_sw_if_index_name, vnm,
+			     vnet_get_hw_interface (vnm,
+						    q->hw_if_index)->sw_if_index,
+			     q->queue_id, q->packets,
+			     q->load * 100);
+	}
+    }
+
+  if (vec_len (rrm->history))
+    {
+      vlib_cli_output (vm, "Moves, the latest first:");
+      for (i = 1; i <= vec_len (rrm->history); i++)
+	{
+	  d = vec_elt_at_index (rrm->history,
+				(rrm->history_next + vec_len (rrm->history) -
+				 i) % vec_len (rrm->history));
+	  vlib_cli_output (vm, "  %.1fs ago: %U queue %u, thread %u (%.1f%%)"
+			   " -> %u (%.1f%%), queue load %.1f%%",
+			   now - d->time, format_vnet_sw_if_index_name, vnm,
+			   vnet_get_hw_interface (vnm,
+						  d->hw_if_index)->sw_if_index,
+			   d->queue_id, d->from,
+			   d->from_load * 100, d->to, d->to_load * 100,
+			   d->queue_load * 100);
+	}
+    }
+
+  return 0;
+}
+
+/*?
+ * Display the rx queue rebalancing configuration, the worker and queue
+ * loads of the last sample and the last moves.
+ *
+ * @cliexpar
+ * @cliexstart{show interface rx-rebalance}
+ * rx-rebalance enabled, interval 10.0s, threshold 25%, min-load 50%, hold 3, 1 moves
+ * Last sample:
+ *   Thread 1 (vpp_wk_0): load 61.2%
+ *     VirtualEthernet0/0/0 queue 0: 5841023 packets, load 61.2%
+ *   Thread 2 (vpp_wk_1): load 58.7%
+ *     VirtualEthernet0/0/1 queue 0: 5523310 packets, load 58.7%
+ * Moves, the latest first:
+ *   14.2s ago: VirtualEthernet0/0/1 queue 0, thread 1 (99.8%) -> 2 (0.4%), queue load 47.3%
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_show_interface_rx_rebalance,static) = {
+    .path = "show interface rx-rebalance",
+    .short_help = "show interface rx-rebalance",
+    .function = show_interface_rx_rebalance,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+rx_rebalance_init (vlib_main_t * vm)
+{
+  rx_rebalance_main_t *rrm = &rx_rebalance_main;
+
+  rrm->interval = RX_REBALANCE_DEFAULT_INTERVAL;
+  rrm->threshold = RX_REBALANCE_DEFAULT_THRESHOLD;
+  rrm->min_load = RX_REBALANCE_DEFAULT_MIN_LOAD;
+  rrm->hold = RX_REBALANCE_DEFAULT_HOLD;
+  rrm->process_node_index = rx_rebalance_process_node.index;
+  rrm->moved_at = hash_create (0, sizeof (uword));
+
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (rx_rebalance_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -52,7 +52,16 @@ load_balance_t *load_balance_pool;
 /**
  * The one instance of load-balance main
  */
-load_balance_main_t load_balance_main;
+load_balance_main_t load_balance_main = {
+    .lbm_to_counters = {
+        .name = "route-to",
+        .stat_segment_name = "/net/route/to",
+    },
+    .lbm_via_counters = {
+        .name = "route-via",
+        .stat_segment_name = "/net/route/via",
+    }
+};
 
 f64
 load_balance_get_multipath_tolerance (void)
@@ -82,17 +91,48 @@ load_balance_get_buckets (load_balance_t *lb)
 static load_balance_t *
 load_balance_alloc_i (void)
 {
+    vlib_main_t *vm;
     load_balance_t *lb;
+    u8 need_barrier_sync = 0;
+    index_t lbi;
+
+    /*
+     * The workers index the pool and the counters without a lock.
+     * Growing them moves them, so the workers must be held at the
+     * barrier, but only then. Everything else is RCU safe.
+     */
+    vm = vlib_get_main();
+    pool_get_aligned_will_expand(load_balance_pool, need_barrier_sync,
+                                 CLIB_CACHE_LINE_BYTES);
+    if (need_barrier_sync)
+        vlib_worker_thread_barrier_sync(vm);
 
     pool_get_aligned(load_balance_pool, lb, CLIB_CACHE_LINE_BYTES);
     memset(lb, 0, sizeof(*lb));
 
     lb->lb_map = INDEX_INVALID;
     lb->lb_urpf = INDEX_INVALID;
+    lbi = load_balance_get_index(lb);
+
+    if (!need_barrier_sync)
+    {
+        need_barrier_sync =
+            (vlib_validate_combined_counter_will_expand(
+                 &(load_balance_main.lbm_to_counters), lbi) ||
+             vlib_validate_combined_counter_will_expand(
+                 &(load_balance_main.lbm_via_counters), lbi));
+        if (need_barrier_sync)
+            vlib_worker_thread_barrier_sync(vm);
+    }
+
     vlib_validate_combined_counter(&(load_balance_main.lbm_to_counters),
                                    load_balance_get_index(lb));
     vlib_validate_combined_counter(&(load_balance_main.lbm_via_counters),
                                    load_balance_get_index(lb));
+
+    if (need_barrier_sync)
+        vlib_worker_thread_barrier_release(vm);
+
     vlib_zero_combined_counter(&(load_balance_main.lbm_to_counters),
                                load_balance_get_index(lb));
     vlib_zero_combined_counter(&(load_balance_main.lbm_via_counters),
@@ -471,6 +511,23 @@ load_balance_fill_buckets (load_balance_t *lb,
     }
 }
 
+/**
+ * Release the choices of a bucket array no longer visible to the workers
+ */
+static void
+load_balance_buckets_free_rcu (uword buckets_as_uword, uword unused)
+{
+    dpo_id_t *buckets, *tmp_dpo;
+
+    buckets = uword_to_pointer(buckets_as_uword, dpo_id_t *);
+
+    vec_foreach(tmp_dpo, buckets)
+    {
+        dpo_reset(tmp_dpo);
+    }
+    vec_free(buckets);
+}
+
 static inline void
 load_balance_set_n_buckets (load_balance_t *lb,
                             u32 n_buckets)
@@ -488,7 +545,6 @@ load_balance_multipath_update (const dpo_id_t *dpo,
     u32 sum_of_weights, n_buckets, ii;
     index_t lbmi, old_lbmi;
     load_balance_t *lb;
-    dpo_id_t *tmp_dpo;
 
     nhs = NULL;
 
@@ -570,8 +626,11 @@ load_balance_multipath_update (const dpo_id_t *dpo,
                 /*
                  * the new increased number of buckets is crossing the threshold
                  * from the inline storage to out-line. Alloc the outline buckets
-                 * first, then fixup the number. then reset the inlines.
+                 * first, then fixup the number. then reset the inlines, whose
+                 * choices are released once the workers are done with them.
                  */
+                dpo_id_t *unused = NULL;
+
                 ASSERT(NULL == lb->lb_buckets);
                 vec_validate_aligned(lb->lb_buckets,
                                      n_buckets - 1,
@@ -585,10 +644,14 @@ load_balance_multipath_update (const dpo_id_t *dpo,
 
                 CLIB_MEMORY_BARRIER();
 
+                vec_validate(unused, LB_NUM_INLINE_BUCKETS - 1);
                 for (ii = 0; ii < LB_NUM_INLINE_BUCKETS; ii++)
                 {
+                    dpo_copy(&unused[ii], &lb->lb_buckets_inline[ii]);
                     dpo_reset(&lb->lb_buckets_inline[ii]);
                 }
+                vlib_rcu_call(load_balance_buckets_free_rcu,
+                              pointer_to_uword(unused), 0);
             }
             else
             {
@@ -610,7 +673,7 @@ load_balance_multipath_update (const dpo_id_t *dpo,
                      * we are not crossing the threshold. We need a new bucket array to
                      * hold the increased number of choices.
                      */
-                    dpo_id_t *new_buckets, *old_buckets, *tmp_dpo;
+                    dpo_id_t *new_buckets, *old_buckets;
 
                     new_buckets = NULL;
                     old_buckets = load_balance_get_buckets(lb);
@@ -625,11 +688,11 @@ load_balance_multipath_update (const dpo_id_t *dpo,
                     CLIB_MEMORY_BARRIER();
                     load_balance_set_n_buckets(lb, n_buckets);
 
-                    vec_foreach(tmp_dpo, old_buckets)
-                    {
-                        dpo_reset(tmp_dpo);
-                    }
-                    vec_free(old_buckets);
+                    /*
+                     * the workers may still be reading the old array
+                     */
+                    vlib_rcu_call(load_balance_buckets_free_rcu,
+                                  pointer_to_uword(old_buckets), 0);
                 }
             }
 
@@ -659,7 +722,8 @@ load_balance_multipath_update (const dpo_id_t *dpo,
                  *   1 - Fill the inline buckets,
                  *   2 - fixup the number (and this point the inline buckets are
                  *       used).
-                 *   3 - free the outline buckets
+                 *   3 - free the outline buckets, once the workers are
+                 *       done with them
                  */
                 load_balance_fill_buckets(lb, nhs,
                                           lb->lb_buckets_inline,
@@ -668,11 +732,9 @@ load_balance_multipath_update (const dpo_id_t *dpo,
                 load_balance_set_n_buckets(lb, n_buckets);
                 CLIB_MEMORY_BARRIER();
 
-                vec_foreach(tmp_dpo, lb->lb_buckets)
-                {
-                    dpo_reset(tmp_dpo);
-                }
-                vec_free(lb->lb_buckets);
+                vlib_rcu_call(load_balance_buckets_free_rcu,
+                              pointer_to_uword(lb->lb_buckets), 0);
+                lb->lb_buckets = NULL;
             }
             else
             {
@@ -680,13 +742,16 @@ load_balance_multipath_update (const dpo_id_t *dpo,
                  * not crossing the threshold.
                  *  1 - update the number to the smaller size
                  *  2 - write the new buckets
-                 *  3 - reset those no longer used.
+                 *  3 - reset those no longer used. a worker which read
+                 *      the larger size may still choose them, so the
+                 *      objects they refer to are released once it is done.
                  */
-                dpo_id_t *buckets;
+                dpo_id_t *buckets, *unused;
                 u32 old_n_buckets;
 
                 old_n_buckets = lb->lb_n_buckets;
                 buckets = load_balance_get_buckets(lb);
+                unused = NULL;
 
                 load_balance_set_n_buckets(lb, n_buckets);
                 CLIB_MEMORY_BARRIER();
@@ -695,10 +760,14 @@ load_balance_multipath_update (const dpo_id_t *dpo,
                                           buckets,
                                           n_buckets);
 
+                vec_validate(unused, old_n_buckets - n_buckets - 1);
                 for (ii = n_buckets; ii < old_n_buckets; ii++)
                 {
+                    dpo_copy(&unused[ii - n_buckets], &buckets[ii]);
                     dpo_reset(&buckets[ii]);
                 }
+                vlib_rcu_call(load_balance_buckets_free_rcu,
+                              pointer_to_uword(unused), 0);
             }
         }
     }
@@ -748,6 +817,12 @@ load_balance_destroy (load_balance_t *lb)
     pool_put(load_balance_pool, lb);
 }
 
+static void
+load_balance_destroy_rcu (uword lbi, uword unused)
+{
+    load_balance_destroy(load_balance_get(lbi));
+}
+
 static void
 load_balance_unlock (dpo_id_t *dpo)
 {
@@ -759,7 +834,13 @@ load_balance_unlock (dpo_id_t *dpo)
 
     if (0 == lb->lb_locks)
     {
-        load_balance_destroy(lb);
+        /*
+         * the last parent has let go, but the workers may have the
+         * load-balance in flight. the index must not be reused before
+         * they are done with it.
+         */
+        vlib_rcu_call(load_balance_destroy_rcu,
+                      load_balance_get_index(lb), 0);
     }
 }
 
@@ -383,10 +383,26 @@ load_balance_map_fill (load_balance_map_t *lbm)
 static load_balance_map_t*
 load_balance_map_alloc (const load_balance_path_t *paths)
 {
+    vlib_main_t *vm;
     load_balance_map_t *lbm;
+    u8 need_barrier_sync;
     u32 ii;
 
+    /*
+     * the workers index the pool without a lock. growing it moves it,
+     * so they must be held at the barrier, but only then.
+     */
+    vm = vlib_get_main();
+    pool_get_aligned_will_expand(load_balance_map_pool, need_barrier_sync,
+                                 CLIB_CACHE_LINE_BYTES);
+    if (need_barrier_sync)
+        vlib_worker_thread_barrier_sync(vm);
+
     pool_get_aligned(load_balance_map_pool, lbm, CLIB_CACHE_LINE_BYTES);
+
+    if (need_barrier_sync)
+        vlib_worker_thread_barrier_release(vm);
+
     memset(lbm, 0, sizeof(*lbm));
 
     vec_validate(lbm->lbm_paths, vec_len(paths)-1);
@@ -423,6 +439,12 @@ load_balance_map_destroy (load_balance_map_t *lbm)
     pool_put(load_balance_map_pool, lbm);
 }
 
+static void
+load_balance_map_destroy_rcu (uword lbmi, uword unused)
+{
+    load_balance_map_destroy(load_balance_map_get(lbmi));
+}
+
 index_t
 load_balance_map_add_or_lock (u32 n_buckets,
                               u32 sum_of_weights,
@@ -477,7 +499,12 @@ load_balance_map_unlock (index_t lbmi)
     if (0 == lbm->lbm_locks)
     {
         load_balance_map_db_remove(lbm);
-        load_balance_map_destroy(lbm);
+        /*
+         * the workers may still be using the map through a load-balance
+         * whose map has just been replaced.
+         */
+        vlib_rcu_call(load_balance_map_destroy_rcu,
+                      load_balance_map_get_index(lbm), 0);
     }
 }
 
@@ -285,6 +285,328 @@ determine_next_node (ethernet_main_t * em,
     }
 }
 
+// Enqueue a run of packets going to the same next node with one copy
+// per next frame instead of one speculative enqueue per packet.
+static_always_inline void
+ethernet_input_enqueue_run (vlib_main_t * vm, vlib_node_runtime_t * node,
+			    u32 next_index, u32 * buffers, u32 n_buffers)
+{
+  u32 *to_next, n_left_to_next, n_copy;
+
+  while (n_buffers > 0)
+    {
+      vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
+      n_copy = clib_min (n_buffers, n_left_to_next);
+      clib_memcpy (to_next, buffers, n_copy * sizeof (buffers[0]));
+      buffers += n_copy;
+      n_buffers -= n_copy;
+      vlib_put_next_frame (vm, node, next_index, n_left_to_next - n_copy);
+    }
+}
+
+// Enqueue the packets of a frame by next node, keeping the order of
+// the packets going to each next node.
+static_always_inline void
+ethernet_input_enqueue_by_next (vlib_main_t * vm, vlib_node_runtime_t * node,
+				u32 * buffers, u16 * nexts, u32 n_left)
+{
+  u32 to[VLIB_FRAME_SIZE], n_to, i, j;
+  u16 next_index;
+
+  while (n_left > 0)
+    {
+      next_index = nexts[0];
+      n_to = j = 0;
+      for (i = 0; i < n_left; i++)
+	{
+	  if (nexts[i] == next_index)
+	    to[n_to++] = buffers[i];
+	  else
+	    {
+	      buffers[j] = buffers[i];
+	      nexts[j++] = nexts[i];
+	    }
+	}
+      n_left = j;
+
+      ethernet_input_enqueue_run (vm, node, next_index, to, n_to);
+    }
+}
+
+// Resolve the sub-interface of one packet with two or more tags, as the
+// per packet loop does, and return its next node.
+static_always_inline u16
+ethernet_input_frame_one (vlib_main_t * vm, vlib_node_runtime_t * error_node,
+			  vlib_buffer_t * b0, u32 thread_index)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  ethernet_main_t *em = &ethernet_main;
+  vnet_hw_interface_t *hi0;
+  main_intf_t *main_intf0;
+  vlan_intf_t *vlan_intf0;
+  qinq_intf_t *qinq_intf0;
+  u16 type0, orig_type0, outer_id0, inner_id0;
+  u32 match_flags0, old_sw_if_index0, new_sw_if_index0, is_l20, len0;
+  u8 error0 = ETHERNET_ERROR_NONE, next0;
+
+  parse_header (ETHERNET_INPUT_VARIANT_ETHERNET, b0, &type0, &orig_type0,
+		&outer_id0, &inner_id0, &match_flags0);
+
+  old_sw_if_index0 = vnet_buffer (b0)->sw_if_index[VLIB_RX];
+
+  eth_vlan_table_lookups (em, vnm, old_sw_if_index0, orig_type0, outer_id0,
+			  inner_id0, &hi0, &main_intf0, &vlan_intf0,
+			  &qinq_intf0);
+
+  identify_subint (hi0, b0, match_flags0, main_intf0, vlan_intf0,
+		   qinq_intf0, &new_sw_if_index0, &error0, &is_l20);
+
+  vnet_buffer (b0)->sw_if_index[VLIB_RX] =
+    error0 != ETHERNET_ERROR_NONE ? old_sw_if_index0 : new_sw_if_index0;
+
+  if ((new_sw_if_index0 != ~0) && (new_sw_if_index0 != old_sw_if_index0))
+    {
+      len0 = vlib_buffer_length_in_chain (vm, b0) + b0->current_data
+	- vnet_buffer (b0)->ethernet.start_of_ethernet_header;
+      vlib_increment_combined_counter
+	(vnm->interface_main.combined_sw_if_counters
+	 + VNET_INTERFACE_COUNTER_RX, thread_index, new_sw_if_index0, 1, len0);
+    }
+
+  determine_next_node (em, ETHERNET_INPUT_VARIANT_ETHERNET, is_l20, type0,
+		       b0, &error0, &next0);
+  b0->error = error_node->errors[error0];
+
+  return next0;
+}
+
+// Resolve a run of untagged or single tagged packets received on the
+// same interface with the same tag. The sub-interface, its admin state
+// and its L2/L3 mode are looked up once for the whole run, with the
+// same matching rules as identify_subint(). On return nexts[] holds the
+// next node of each packet of the run.
+static_always_inline void
+ethernet_input_frame_run (vlib_main_t * vm, vlib_node_runtime_t * error_node,
+			  vlib_buffer_t ** bufs, u16 * types, u16 * nexts,
+			  u8 * other, u32 n_tags, u32 n_packets,
+			  u32 thread_index)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  ethernet_main_t *em = &ethernet_main;
+  vnet_hw_interface_t *hi;
+  main_intf_t *main_intf;
+  vlan_intf_t *vlan_intf;
+  qinq_intf_t *qinq_intf;
+  vlib_buffer_t *b0;
+  ethernet_header_t *e0;
+  u32 old_sw_if_index, new_sw_if_index, match_flags, is_l2, hdr_len, i;
+  u32 is_new_sw_if_index, n_bytes = 0;
+  u16 orig_type = 0, outer_id = 0;
+  u8 run_error = ETHERNET_ERROR_NONE, error0, next0;
+
+  e0 = vlib_buffer_get_current (bufs[0]);
+  old_sw_if_index = vnet_buffer (bufs[0])->sw_if_index[VLIB_RX];
+  match_flags = SUBINT_CONFIG_VALID | SUBINT_CONFIG_MATCH_0_TAG;
+
+  if (n_tags)
+    {
+      ethernet_vlan_header_t *h0 = (ethernet_vlan_header_t *) (e0 + 1);
+
+      orig_type = clib_net_to_host_u16 (e0->type);
+      outer_id = clib_net_to_host_u16 (h0->priority_cfi_and_id) & 0xfff;
+      // as in parse_header, priority tagged packets match like untagged
+      match_flags = SUBINT_CONFIG_VALID;
+      if (outer_id)
+	match_flags |= SUBINT_CONFIG_MATCH_1_TAG;
+    }
+
+  eth_vlan_table_lookups (em, vnm, old_sw_if_index, orig_type, outer_id, 0,
+			  &hi, &main_intf, &vlan_intf, &qinq_intf);
+
+  if (eth_identify_subint (hi, bufs[0], match_flags, main_intf, vlan_intf,
+			   qinq_intf, &new_sw_if_index, &run_error, &is_l2)
+      && new_sw_if_index == ~0)
+    run_error = ETHERNET_ERROR_DOWN;
+
+  is_new_sw_if_index = ((new_sw_if_index != ~0)
+			&& (new_sw_if_index != old_sw_if_index));
+  hdr_len = sizeof (ethernet_header_t) +
+    n_tags * sizeof (ethernet_vlan_header_t);
+
+  for (i = 0; i < n_packets; i++)
+    {
+      b0 = bufs[i];
+      e0 = vlib_buffer_get_current (b0);
+      error0 = run_error;
+
+      vnet_buffer (b0)->ethernet.start_of_ethernet_header = b0->current_data;
+      ethernet_buffer_set_vlan_count (b0, n_tags);
+
+      if (PREDICT_FALSE (is_new_sw_if_index))
+	n_bytes += vlib_buffer_length_in_chain (vm, b0);
+
+      // L3 my-mac filter, a down sub-interface takes precedence
+      if (error0 == ETHERNET_ERROR_NONE && !is_l2
+	  && !ethernet_address_cast (e0->dst_address)
+	  && (hi->hw_address != 0)
+	  && !eth_mac_equal ((u8 *) e0, hi->hw_address))
+	error0 = ETHERNET_ERROR_L3_MAC_MISMATCH;
+
+      vnet_buffer (b0)->sw_if_index[VLIB_RX] =
+	error0 != ETHERNET_ERROR_NONE ? old_sw_if_index : new_sw_if_index;
+
+      if (PREDICT_TRUE (is_l2 && error0 == ETHERNET_ERROR_NONE))
+	{
+	  nexts[i] = em->l2_next;
+	  vnet_buffer (b0)->l2.l2_len = hdr_len;
+	}
+      else
+	{
+	  vlib_buffer_advance (b0, hdr_len);
+	  if (PREDICT_FALSE (other[i] || error0 != ETHERNET_ERROR_NONE))
+	    {
+	      determine_next_node (em, ETHERNET_INPUT_VARIANT_ETHERNET, 0,
+				   clib_net_to_host_u16 (types[i]), b0,
+				   &error0, &next0);
+	      nexts[i] = next0;
+	    }
+	}
+
+      b0->error = error_node->errors[error0];
+    }
+
+  // Interface counters include the packets of the sub-interfaces,
+  // only the sub-interface counters are incremented here
+  if (is_new_sw_if_index)
+    vlib_increment_combined_counter
+      (vnm->interface_main.combined_sw_if_counters
+       + VNET_INTERFACE_COUNTER_RX, thread_index, new_sw_if_index,
+       n_packets, n_bytes);
+}
+
+// Frame path of ethernet-input. The frame is split in runs of
+// consecutive packets received on the same interface with the same
+// VLAN tag, or none, which are resolved with one sub-interface lookup
+// each. The next nodes of the common L3 ethertypes are computed with
+// vector compares and the packets are enqueued in bulk by next node.
+// Packets with more than one tag are resolved one at a time.
+static_always_inline void
+ethernet_input_frame (vlib_main_t * vm,
+		      vlib_node_runtime_t * node,
+		      vlib_node_runtime_t * error_node,
+		      u32 * from, u32 n_packets)
+{
+  ethernet_main_t *em = &ethernet_main;
+  u32 thread_index = vlib_get_thread_index ();
+  vlib_buffer_t *bufs[VLIB_FRAME_SIZE], *b0;
+  u16 types[VLIB_FRAME_SIZE] __attribute__ ((aligned (16)));
+  u16 nexts[VLIB_FRAME_SIZE] __attribute__ ((aligned (16)));
+  u64 keys[VLIB_FRAME_SIZE];
+  u8 n_tags[VLIB_FRAME_SIZE];
+  u8 other[VLIB_FRAME_SIZE];
+  u32 buffers[VLIB_FRAME_SIZE];
+  u32 i, n_run;
+  ethernet_header_t *e0;
+  ethernet_vlan_header_t *h0;
+  u16 type0;
+
+  // types[] holds the ethertype after the tags, in network order, and
+  // keys[] the rx interface, outer ethertype and VLAN id of the packets
+  for (i = 0; i < n_packets; i++)
+    {
+      if (i + 4 < n_packets)
+	{
+	  vlib_buffer_t *p4 = vlib_get_buffer (vm, from[i + 4]);
+	  vlib_prefetch_buffer_header (p4, STORE);
+	  CLIB_PREFETCH (p4->data + p4->current_data,
+			 sizeof (ethernet_header_t) +
+			 sizeof (ethernet_vlan_header_t), LOAD);
+	}
+      b0 = bufs[i] = vlib_get_buffer (vm, from[i]);
+      e0 = vlib_buffer_get_current (b0);
+      type0 = clib_net_to_host_u16 (e0->type);
+      types[i] = e0->type;
+      keys[i] = vnet_buffer (b0)->sw_if_index[VLIB_RX];
+      n_tags[i] = 0;
+
+      if (PREDICT_FALSE (ethernet_frame_is_tagged (type0)))
+	{
+	  h0 = (ethernet_vlan_header_t *) (e0 + 1);
+	  types[i] = h0->type;
+	  n_tags[i] = h0->type == clib_host_to_net_u16 (ETHERNET_TYPE_VLAN) ?
+	    2 : 1;
+	  keys[i] |= ((u64) type0 << 32) |
+	    ((u64) (clib_net_to_host_u16 (h0->priority_cfi_and_id) & 0xfff)
+	     << 48);
+	}
+    }
+
+  // pad to whole vectors with a type which is not common
+  for (i = n_packets; i < round_pow2 (n_packets, 8); i++)
+    types[i] = 0;
+
+  // the next nodes of the common L3 ethertypes
+#ifdef CLIB_HAVE_VEC128
+  {
+    u16x8 ip4 = u16x8_splat (clib_host_to_net_u16 (ETHERNET_TYPE_IP4));
+    u16x8 ip6 = u16x8_splat (clib_host_to_net_u16 (ETHERNET_TYPE_IP6));
+    u16x8 mpls = u16x8_splat (clib_host_to_net_u16 (ETHERNET_TYPE_MPLS));
+    u16x8 next_ip4 = u16x8_splat (em->l3_next.input_next_ip4);
+    u16x8 next_ip6 = u16x8_splat (em->l3_next.input_next_ip6);
+    u16x8 next_mpls = u16x8_splat (em->l3_next.input_next_mpls);
+
+    for (i = 0; i < n_packets; i += 8)
+      {
+	u16x8 t = *(u16x8 *) (types + i);
+	u16x8 is_ip4 = t == ip4, is_ip6 = t == ip6, is_mpls = t == mpls;
+	u16x8 known = is_ip4 | is_ip6 | is_mpls;
+	int j;
+
+	*(u16x8 *) (nexts + i) = ((is_ip4 & next_ip4) | (is_ip6 & next_ip6)
+				  | (is_mpls & next_mpls));
+	for (j = 0; j < 8; j++)
+	  other[i + j] = known[j] == 0;
+      }
+  }
+#else
+  for (i = 0; i < n_packets; i++)
+    {
+      type0 = clib_net_to_host_u16 (types[i]);
+      other[i] = 0;
+      if (type0 == ETHERNET_TYPE_IP4)
+	nexts[i] = em->l3_next.input_next_ip4;
+      else if (type0 == ETHERNET_TYPE_IP6)
+	nexts[i] = em->l3_next.input_next_ip6;
+      else if (type0 == ETHERNET_TYPE_MPLS)
+	nexts[i] = em->l3_next.input_next_mpls;
+      else
+	other[i] = 1;
+    }
+#endif
+
+  for (i = 0; i < n_packets; i += n_run)
+    {
+      if (PREDICT_FALSE (n_tags[i] > 1))
+	{
+	  nexts[i] = ethernet_input_frame_one (vm, error_node, bufs[i],
+					       thread_index);
+	  n_run = 1;
+	  continue;
+	}
+
+      for (n_run = 1; i + n_run < n_packets; n_run++)
+	if (keys[i + n_run] != keys[i] || n_tags[i + n_run] != n_tags[i])
+	  break;
+
+      ethernet_input_frame_run (vm, error_node, bufs + i, types + i,
+				nexts + i, other + i, n_tags[i], n_run,
+				thread_index);
+    }
+
+  clib_memcpy (buffers, from, n_packets * sizeof (from[0]));
+  ethernet_input_enqueue_by_next (vm, node, buffers, nexts, n_packets);
+}
+
 static_always_inline uword
 ethernet_input_inline (vlib_main_t * vm,
 		       vlib_node_runtime_t * node,
@@ -297,9 +619,6 @@ ethernet_input_inline (vlib_main_t * vm,
   u32 n_left_from, next_index, *from, *to_next;
   u32 stats_sw_if_index, stats_n_packets, stats_n_bytes;
   u32 thread_index = vlib_get_thread_index ();
-  u32 cached_sw_if_index = ~0;
-  u32 cached_is_l2 = 0;		/* shut up gcc */
-  vnet_hw_interface_t *hi = NULL;	/* used for main interface only */
 
   if (variant != ETHERNET_INPUT_VARIANT_ETHERNET)
     error_node = vlib_node_get_runtime (vm, ethernet_input_node.index);
@@ -316,6 +635,12 @@ ethernet_input_inline (vlib_main_t * vm,
 				   sizeof (from[0]),
 				   sizeof (ethernet_input_trace_t));
 
+  if (variant == ETHERNET_INPUT_VARIANT_ETHERNET)
+    {
+      ethernet_input_frame (vm, node, error_node, from, n_left_from);
+      return from_frame->n_vectors;
+    }
+
   next_index = node->cached_next_index;
   stats_sw_if_index = node->runtime_data[0];
   stats_n_packets = stats_n_bytes = 0;
@@ -341,7 +666,6 @@ ethernet_input_inline (vlib_main_t * vm,
 	  vlan_intf_t *vlan_intf0, *vlan_intf1;
 	  qinq_intf_t *qinq_intf0, *qinq_intf1;
 	  u32 is_l20, is_l21;
-	  ethernet_header_t *e0, *e1;
 
 	  /* Prefetch next iteration. */
 	  {
@@ -370,72 +694,7 @@ ethernet_input_inline (vlib_main_t * vm,
 	  b1 = vlib_get_buffer (vm, bi1);
 
 	  error0 = error1 = ETHERNET_ERROR_NONE;
-	  e0 = vlib_buffer_get_current (b0);
-	  type0 = clib_net_to_host_u16 (e0->type);
-	  e1 = vlib_buffer_get_current (b1);
-	  type1 = clib_net_to_host_u16 (e1->type);
-
-	  /* Speed-path for the untagged case */
-	  if (PREDICT_TRUE (variant == ETHERNET_INPUT_VARIANT_ETHERNET
-			    && !ethernet_frame_is_tagged (type0)
-			    && !ethernet_frame_is_tagged (type1)))
-	    {
-	      main_intf_t *intf0;
-	      subint_config_t *subint0;
-	      u32 sw_if_index0, sw_if_index1;
-
-	      sw_if_index0 = vnet_buffer (b0)->sw_if_index[VLIB_RX];
-	      sw_if_index1 = vnet_buffer (b1)->sw_if_index[VLIB_RX];
-	      is_l20 = cached_is_l2;
-
-	      /* This is probably wholly unnecessary */
-	      if (PREDICT_FALSE (sw_if_index0 != sw_if_index1))
-		goto slowpath;
-
-	      /* Now sw_if_index0 == sw_if_index1  */
-	      if (PREDICT_FALSE (cached_sw_if_index != sw_if_index0))
-		{
-		  cached_sw_if_index = sw_if_index0;
-		  hi = vnet_get_sup_hw_interface (vnm, sw_if_index0);
-		  intf0 = vec_elt_at_index (em->main_intfs, hi->hw_if_index);
-		  subint0 = &intf0->untagged_subint;
-		  cached_is_l2 = is_l20 = subint0->flags & SUBINT_CONFIG_L2;
-		}
-
-	      vnet_buffer (b0)->ethernet.start_of_ethernet_header =
-		b0->current_data;
-	      vnet_buffer (b1)->ethernet.start_of_ethernet_header =
-		b1->current_data;
-
-	      if (PREDICT_TRUE (is_l20 != 0))
-		{
-		  next0 = em->l2_next;
-		  vnet_buffer (b0)->l2.l2_len = sizeof (ethernet_header_t);
-		  next1 = em->l2_next;
-		  vnet_buffer (b1)->l2.l2_len = sizeof (ethernet_header_t);
-		}
-	      else
-		{
-		  if (!ethernet_address_cast (e0->dst_address) &&
-		      (hi->hw_address != 0) &&
-		      !eth_mac_equal ((u8 *) e0, hi->hw_address))
-		    error0 = ETHERNET_ERROR_L3_MAC_MISMATCH;
-		  if (!ethernet_address_cast (e1->dst_address) &&
-		      (hi->hw_address != 0) &&
-		      !eth_mac_equal ((u8 *) e1, hi->hw_address))
-		    error1 = ETHERNET_ERROR_L3_MAC_MISMATCH;
-		  determine_next_node (em, variant, 0, type0, b0,
-				       &error0, &next0);
-		  vlib_buffer_advance (b0, sizeof (ethernet_header_t));
-		  determine_next_node (em, variant, 0, type1, b1,
-				       &error1, &next1);
-		  vlib_buffer_advance (b1, sizeof (ethernet_header_t));
-		}
-	      goto ship_it01;
-	    }
 
-	  /* Slow-path for the tagged case */
-	slowpath:
 	  parse_header (variant,
 			b0,
 			&type0,
@@ -555,7 +814,6 @@ ethernet_input_inline (vlib_main_t * vm,
 	  determine_next_node (em, variant, is_l21, type1, b1, &error1,
 			       &next1);
 
-	ship_it01:
 	  b0->error = error_node->errors[error0];
 	  b1->error = error_node->errors[error1];
 
@@ -578,7 +836,6 @@ ethernet_input_inline (vlib_main_t * vm,
 	  main_intf_t *main_intf0;
 	  vlan_intf_t *vlan_intf0;
 	  qinq_intf_t *qinq_intf0;
-	  ethernet_header_t *e0;
 	  u32 is_l20;
 
 	  // Prefetch next iteration
@@ -601,51 +858,7 @@ ethernet_input_inline (vlib_main_t * vm,
 	  b0 = vlib_get_buffer (vm, bi0);
 
 	  error0 = ETHERNET_ERROR_NONE;
-	  e0 = vlib_buffer_get_current (b0);
-	  type0 = clib_net_to_host_u16 (e0->type);
-
-	  /* Speed-path for the untagged case */
-	  if (PREDICT_TRUE (variant == ETHERNET_INPUT_VARIANT_ETHERNET
-			    && !ethernet_frame_is_tagged (type0)))
-	    {
-	      main_intf_t *intf0;
-	      subint_config_t *subint0;
-	      u32 sw_if_index0;
-
-	      sw_if_index0 = vnet_buffer (b0)->sw_if_index[VLIB_RX];
-	      is_l20 = cached_is_l2;
-
-	      if (PREDICT_FALSE (cached_sw_if_index != sw_if_index0))
-		{
-		  cached_sw_if_index = sw_if_index0;
-		  hi = vnet_get_sup_hw_interface (vnm, sw_if_index0);
-		  intf0 = vec_elt_at_index (em->main_intfs, hi->hw_if_index);
-		  subint0 = &intf0->untagged_subint;
-		  cached_is_l2 = is_l20 = subint0->flags & SUBINT_CONFIG_L2;
-		}
-
-	      vnet_buffer (b0)->ethernet.start_of_ethernet_header =
-		b0->current_data;
-
-	      if (PREDICT_TRUE (is_l20 != 0))
-		{
-		  next0 = em->l2_next;
-		  vnet_buffer (b0)->l2.l2_len = sizeof (ethernet_header_t);
-		}
-	      else
-		{
-		  if (!ethernet_address_cast (e0->dst_address) &&
-		      (hi->hw_address != 0) &&
-		      !eth_mac_equal ((u8 *) e0, hi->hw_address))
-		    error0 = ETHERNET_ERROR_L3_MAC_MISMATCH;
-		  determine_next_node (em, variant, 0, type0, b0,
-				       &error0, &next0);
-		  vlib_buffer_advance (b0, sizeof (ethernet_header_t));
-		}
-	      goto ship_it0;
-	    }
 
-	  /* Slow-path for the tagged case */
 	  parse_header (variant,
 			b0,
 			&type0,
@@ -724,7 +937,6 @@ ethernet_input_inline (vlib_main_t * vm,
 	  determine_next_node (em, variant, is_l20, type0, b0, &error0,
 			       &next0);
 
-	ship_it0:
 	  b0->error = error_node->errors[error0];
 
 	  // verify speculative enqueue
@@ -8171,6 +8171,149 @@ lfib_test (void)
     return (0);
 }
 
+/*
+ * The longest prefix in the routes that matches the address, the last
+ * added wins between equal prefixes, as it does in the mtrie.
+ */
+static u32
+fib_test_mtrie_ref_lookup (const ip4_address_t *pfxs,
+                           const u32 *lens,
+                           const ip4_address_t *addr)
+{
+    ip4_main_t *im = &ip4_main;
+    u32 ii, best_len, best;
+
+    best = 0;
+    best_len = 0;
+
+    vec_foreach_index(ii, pfxs)
+    {
+        if ((addr->as_u32 & im->fib_masks[lens[ii]]) == pfxs[ii].as_u32 &&
+            lens[ii] >= best_len)
+        {
+            best_len = lens[ii];
+            best = ii + 1;
+        }
+    }
+    return (best);
+}
+
+static u32
+fib_test_mtrie_lookup (const ip4_fib_mtrie_t *m,
+                       const ip4_address_t *addr)
+{
+    return (ip4_fib_mtrie_leaf_get_adj_index(ip4_fib_mtrie_lookup(m, addr)));
+}
+
+/*
+ * The steps the lookup nodes run while all the roots are 16 bit
+ */
+static u32
+fib_test_mtrie_16_lookup (const ip4_fib_mtrie_t *m,
+                          const ip4_address_t *addr)
+{
+    ip4_fib_mtrie_leaf_t leaf;
+
+    leaf = ip4_fib_mtrie_lookup_step_one_inline(m, addr, 1);
+    leaf = ip4_fib_mtrie_lookup_step_inline(m, leaf, addr, 2, 1);
+    leaf = ip4_fib_mtrie_lookup_step_inline(m, leaf, addr, 3, 1);
+
+    return (ip4_fib_mtrie_leaf_get_adj_index(leaf));
+}
+
+/*
+ * Add the same random routes to a trie with a 16 bit root and to one
+ * with a 24 bit root; lookups in both must agree with each other and
+ * with a linear longest prefix match.
+ */
+static int
+fib_test_mtrie (void)
+{
+    const u32 n_routes = 512, n_lookups = 1 << 16;
+    ip4_fib_mtrie_t m16, m24;
+    ip4_address_t *pfxs = 0, *addrs = 0, addr;
+    ip4_main_t *im = &ip4_main;
+    u32 *lens = 0, ii, seed, len, exp, r16, r16s, r24, n_24_bit_roots;
+
+    seed = 0xdeadbeef;
+    n_24_bit_roots = ip4_mtrie_n_24_bit_roots;
+    ip4_mtrie_init(&m16, 16);
+    ip4_mtrie_init(&m24, 24);
+
+    FIB_TEST((n_24_bit_roots + 1 == ip4_mtrie_n_24_bit_roots),
+             "24 bit roots counted");
+    FIB_TEST(!ip4_mtrie_all_roots_16(), "not all roots 16 bit");
+
+    FIB_TEST((16 == ip4_mtrie_root_bits(&m16)), "16 bit root");
+    FIB_TEST((24 == ip4_mtrie_root_bits(&m24)), "24 bit root");
+
+    for (ii = 0; ii < n_routes; ii++)
+    {
+        /*
+         * favour the lengths either side of the root strides
+         */
+        len = random_u32(&seed) % 4;
+        if (0 == len)
+            len = 1 + random_u32(&seed) % 32;
+        else
+            len = (8 * (1 + len)) + (random_u32(&seed) % 3) - 1;
+        len = clib_min(len, 32);
+
+        addr.as_u32 = random_u32(&seed) & im->fib_masks[len];
+
+        vec_add1(pfxs, addr);
+        vec_add1(lens, len);
+        ip4_fib_mtrie_route_add(&m16, &addr, len, ii + 1);
+        ip4_fib_mtrie_route_add(&m24, &addr, len, ii + 1);
+
+        /*
+         * the first and last address in each prefix
+         */
+        vec_add1(addrs, addr);
+        addr.as_u32 |= ~im->fib_masks[len];
+        vec_add1(addrs, addr);
+    }
+
+    addr.as_u32 = 0;
+    vec_add1(addrs, addr);
+    addr.as_u32 = ~0;
+    vec_add1(addrs, addr);
+
+    for (ii = 0; ii < n_lookups; ii++)
+    {
+        addr.as_u32 = random_u32(&seed);
+        vec_add1(addrs, addr);
+    }
+
+    vec_foreach_index(ii, addrs)
+    {
+        exp = fib_test_mtrie_ref_lookup(pfxs, lens, &addrs[ii]);
+        r16 = fib_test_mtrie_lookup(&m16, &addrs[ii]);
+        r16s = fib_test_mtrie_16_lookup(&m16, &addrs[ii]);
+        r24 = fib_test_mtrie_lookup(&m24, &addrs[ii]);
+
+        FIB_TEST((r16 == r24),
+                 "%U: 16 bit root %d, 24 bit root %d",
+                 format_ip4_address, &addrs[ii], r16, r24);
+        FIB_TEST((r16 == r16s),
+                 "%U: 16 bit root %d, 16 bit root steps %d",
+                 format_ip4_address, &addrs[ii], r16, r16s);
+        FIB_TEST((exp == r16),
+                 "%U: expected %d, got %d",
+                 format_ip4_address, &addrs[ii], exp, r16);
+    }
+
+    ip4_mtrie_free(&m16);
+    ip4_mtrie_free(&m24);
+    FIB_TEST((n_24_bit_roots == ip4_mtrie_n_24_bit_roots),
+             "24 bit roots uncounted");
+    vec_free(pfxs);
+    vec_free(lens);
+    vec_free(addrs);
+
+    return (0);
+}
+
 static clib_error_t *
 fib_test (vlib_main_t * vm, 
 	  unformat_input_t * input,
@@ -8211,6 +8354,10 @@ fib_test (vlib_main_t * vm,
     {
 	res += fib_test_bfd();
     }
+    else if (unformat (input, "mtrie"))
+    {
+	res += fib_test_mtrie();
+    }
     else
     {
 	res += fib_test_v4();
@@ -8219,6 +8366,7 @@ fib_test (vlib_main_t * vm,
 	res += fib_test_bfd();
 	res += fib_test_label();
 	res += lfib_test();
+	res += fib_test_mtrie();
 
         /*
          * fib-walk process must be disabled in order for the walk tests to work
@@ -66,6 +66,9 @@ extern fib_node_index_t ip4_fib_table_lookup_exact_match(const ip4_fib_t *fib,
 							 const ip4_address_t *addr,
 							 u32 len);
 
+extern void ip4_fib_table_set_mtrie_root_bits(u32 fib_index,
+                                              u32 root_bits);
+
 extern void ip4_fib_table_entry_remove(ip4_fib_t *fib,
 				       const ip4_address_t *addr,
 				       u32 len);
@@ -426,6 +426,9 @@ typedef struct vnet_hw_interface_t
   /* rx mode flags */
 #define VNET_HW_INTERFACE_FLAG_SUPPORTS_INT_MODE (1 << 10)
 
+  /* tx segments VNET_BUFFER_GSO packets itself */
+#define VNET_HW_INTERFACE_FLAG_SUPPORTS_GSO	(1 << 11)
+
   /* Hardware address as vector.  Zero (e.g. zero-length vector) if no
      address for this class (e.g. PPP). */
   u8 *hw_address;
@@ -668,6 +671,12 @@ typedef struct
 
   /* feature_arc_index */
   u8 output_feature_arc_index;
+
+  /* Set while someone may send VNET_BUFFER_GSO packets */
+  u8 gso_enabled;
+
+  /* Per thread scratch for the segments of GSO packets */
+  u32 **gso_buffers;
 } vnet_interface_main_t;
 
 static inline void
@@ -1418,15 +1418,12 @@ set_interface_rx_placement (vlib_main_t * vm, unformat_input_t * input,
   if (rv)
     return clib_error_return (0, "not found");
 
-  rv = vnet_hw_interface_unassign_rx_thread (vnm, hw_if_index, queue_id);
+  rv = vnet_hw_interface_move_rx_queue (vnm, hw_if_index, queue_id,
+					thread_index);
 
   if (rv)
     return clib_error_return (0, "not found");
 
-  vnet_hw_interface_assign_rx_thread (vnm, hw_if_index, queue_id,
-				      thread_index);
-  vnet_hw_interface_set_rx_mode (vnm, hw_if_index, queue_id, mode);
-
   return 0;
 }
 
@@ -304,6 +304,8 @@ typedef struct
 /* Interface output functions. */
 void *vnet_interface_output_node_multiarch_select (void);
 void *vnet_interface_output_node_flatten_multiarch_select (void);
+int vnet_gso_segment_buffer (vlib_main_t * vm, u32 bi, vlib_buffer_t * b,
+			     u32 ** to);
 
 word vnet_sw_interface_compare (vnet_main_t * vnm, uword sw_if_index0,
 				uword sw_if_index1);
@@ -328,6 +330,7 @@ typedef enum
 {
   VNET_INTERFACE_OUTPUT_ERROR_INTERFACE_DOWN,
   VNET_INTERFACE_OUTPUT_ERROR_INTERFACE_DELETED,
+  VNET_INTERFACE_OUTPUT_ERROR_GSO_HDR_TOO_LONG,
 } vnet_interface_output_error_t;
 
 /* Format for interface output traces. */
@@ -38,6 +38,8 @@
  */
 
 #include <vnet/vnet.h>
+#include <vnet/ip/ip.h>
+#include <vnet/tcp/tcp_packet.h>
 #include <vnet/feature/feature.h>
 
 typedef struct
@@ -190,6 +192,147 @@ slow_path (vlib_main_t * vm,
   return n_buffers;
 }
 
+/* Fix the headers of a segment cut from a GSO packet */
+static_always_inline void
+gso_fixup_segment (vlib_main_t * vm, vlib_buffer_t * b, u16 l3_offset,
+		   u16 l4_offset, u32 seq, u16 ip_id, int is_last)
+{
+  u8 *data = vlib_buffer_get_current (b);
+  ip4_header_t *ip4 = (ip4_header_t *) (data + l3_offset);
+  tcp_header_t *th = (tcp_header_t *) (data + l4_offset);
+  int bogus;
+
+  th->seq_number = clib_host_to_net_u32 (seq);
+  if (!is_last)
+    th->flags &= ~(TCP_FLAG_FIN | TCP_FLAG_PSH);
+  th->checksum = 0;
+
+  if ((ip4->ip_version_and_header_length & 0xF0) == 0x40)
+    {
+      ip4->length = clib_host_to_net_u16 (b->current_length - l3_offset);
+      ip4->fragment_id = clib_host_to_net_u16 (ip_id);
+      ip4->checksum = ip4_header_checksum (ip4);
+      th->checksum = ip4_tcp_udp_compute_checksum (vm, b, ip4);
+    }
+  else
+    {
+      ip6_header_t *ip6 = (ip6_header_t *) ip4;
+      ip6->payload_length = clib_host_to_net_u16 (b->current_length
+						  - l3_offset
+						  - sizeof (*ip6));
+      th->checksum = ip6_tcp_udp_icmp_compute_checksum (vm, b, ip6, &bogus);
+    }
+}
+
+/*
+ * Segment a GSO packet in software. The session layer puts a segment of
+ * payload in each buffer of the chain, so the head keeps the headers and
+ * the first segment, and the headers are copied in the pre-data of the
+ * other buffers. No payload is moved. Returns 0 if the headers do not
+ * fit the pre-data, the packet is then left alone.
+ */
+int
+vnet_gso_segment_buffer (vlib_main_t * vm, u32 bi, vlib_buffer_t * b,
+			 u32 ** to)
+{
+  vnet_buffer_opaque2_t *o2 = vnet_buffer2 (b);
+  u16 l3_offset = o2->gso.l3_hdr_offset - b->current_data;
+  u16 l4_offset = o2->gso.l4_hdr_offset - b->current_data;
+  u8 *hdr = vlib_buffer_get_current (b);
+  ip4_header_t *ip4 = (ip4_header_t *) (hdr + l3_offset);
+  tcp_header_t *th = (tcp_header_t *) (hdr + l4_offset);
+  u16 hdr_len = l4_offset + tcp_header_bytes (th);
+  u32 seq0 = clib_net_to_host_u32 (th->seq_number), seq;
+  u16 ip_id0 = clib_net_to_host_u16 (ip4->fragment_id), ip_id;
+  u32 next_bi, keep_flags;
+  vlib_buffer_t *sb;
+  int is_last;
+
+  /* Chained buffers start at current_data 0, no room for the headers */
+  if (PREDICT_FALSE (hdr_len > VLIB_BUFFER_PRE_DATA_SIZE))
+    return 0;
+
+  b->flags &= ~VNET_BUFFER_GSO;
+  vec_add1 (*to, bi);
+
+  seq = seq0 + b->current_length - hdr_len;
+  ip_id = ip_id0 + 1;
+  sb = b;
+
+  while (sb->flags & VLIB_BUFFER_NEXT_PRESENT)
+    {
+      next_bi = sb->next_buffer;
+      sb = vlib_get_buffer (vm, next_bi);
+      is_last = !(sb->flags & VLIB_BUFFER_NEXT_PRESENT);
+
+      ASSERT (sb->current_data - hdr_len >= -VLIB_BUFFER_PRE_DATA_SIZE);
+      vlib_buffer_advance (sb, -(word) hdr_len);
+      clib_memcpy (vlib_buffer_get_current (sb), hdr, hdr_len);
+
+      keep_flags = sb->flags & VLIB_BUFFER_EXT_HDR_VALID;
+      sb->flags = keep_flags | VLIB_BUFFER_TOTAL_LENGTH_VALID
+	| (b->flags & ~(VLIB_BUFFER_NEXT_PRESENT | VLIB_BUFFER_IS_TRACED
+			| VLIB_BUFFER_EXT_HDR_VALID));
+      sb->total_length_not_including_first_buffer = 0;
+      sb->error = b->error;
+      clib_memcpy (sb->opaque, b->opaque, sizeof (b->opaque));
+
+      gso_fixup_segment (vm, sb, l3_offset, l4_offset, seq, ip_id, is_last);
+      seq += sb->current_length - hdr_len;
+      ip_id += 1;
+      vec_add1 (*to, next_bi);
+    }
+
+  is_last = !(b->flags & VLIB_BUFFER_NEXT_PRESENT);
+  b->flags &= ~VLIB_BUFFER_NEXT_PRESENT;
+  b->flags |= VLIB_BUFFER_TOTAL_LENGTH_VALID;
+  b->total_length_not_including_first_buffer = 0;
+  gso_fixup_segment (vm, b, l3_offset, l4_offset, seq0, ip_id0, is_last);
+  return 1;
+}
+
+/*
+ * If the frame has GSO packets, returns a per thread vector with their
+ * segments in place of them, and the rest of the packets in order.
+ * Those which can not be segmented are dropped.
+ */
+static_always_inline u32 *
+gso_segment_frame (vlib_main_t * vm, vlib_node_runtime_t * node,
+		   u32 * from, u32 * n_buffers)
+{
+  vnet_interface_main_t *im = &vnet_get_main ()->interface_main;
+  u32 i, n = *n_buffers, *to;
+  vlib_buffer_t *b;
+
+  for (i = 0; i < n; i++)
+    if (vlib_get_buffer (vm, from[i])->flags & VNET_BUFFER_GSO)
+      break;
+
+  if (PREDICT_TRUE (i == n))
+    return from;
+
+  to = im->gso_buffers[vm->thread_index];
+  vec_reset_length (to);
+  vec_add (to, from, i);
+
+  for (; i < n; i++)
+    {
+      b = vlib_get_buffer (vm, from[i]);
+      if (!(b->flags & VNET_BUFFER_GSO))
+	vec_add1 (to, from[i]);
+      else if (PREDICT_FALSE
+	       (!vnet_gso_segment_buffer (vm, from[i], b, &to)))
+	vlib_error_drop_buffers (vm, node, from + i, /* buffer stride */ 1,
+				 1, VNET_INTERFACE_OUTPUT_NEXT_DROP,
+				 node->node_index,
+				 VNET_INTERFACE_OUTPUT_ERROR_GSO_HDR_TOO_LONG);
+    }
+
+  im->gso_buffers[vm->thread_index] = to;
+  *n_buffers = vec_len (to);
+  return to;
+}
+
 /*
  * Increment TX stats. Roll up consecutive increments to the same sw_if_index
  * into one increment.
@@ -276,6 +419,10 @@ vnet_interface_output_node_flatten (vlib_main_t * vm,
 				      VNET_INTERFACE_OUTPUT_ERROR_INTERFACE_DOWN);
     }
 
+  if (PREDICT_FALSE (vnm->interface_main.gso_enabled
+		     && !(hi->flags & VNET_HW_INTERFACE_FLAG_SUPPORTS_GSO)))
+    from = gso_segment_frame (vm, node, from, &n_buffers);
+
   from_end = from + n_buffers;
 
   /* Total byte count of all buffers. */
@@ -411,7 +558,7 @@ vnet_interface_output_node_flatten (vlib_main_t * vm,
   incr_output_stats (vnm, thread_index, 0, ~0,	/* ~0 will flush stats */
 		     &last_sw_if_index, &n_packets, &n_bytes);
 
-  return n_buffers;
+  return frame->n_vectors;
 }
 
 VLIB_NODE_FUNCTION_MULTIARCH_CLONE (vnet_interface_output_node_flatten);
@@ -469,6 +616,10 @@ vnet_interface_output_node (vlib_main_t * vm,
 				      VNET_INTERFACE_OUTPUT_ERROR_INTERFACE_DOWN);
     }
 
+  if (PREDICT_FALSE (im->gso_enabled
+		     && !(hi->flags & VNET_HW_INTERFACE_FLAG_SUPPORTS_GSO)))
+    from = gso_segment_frame (vm, node, from, &n_buffers);
+
   from_end = from + n_buffers;
 
   /* Total byte count of all buffers. */
@@ -636,7 +787,7 @@ vnet_interface_output_node (vlib_main_t * vm,
 				   + VNET_INTERFACE_COUNTER_TX,
 				   thread_index,
 				   rt->sw_if_index, n_packets, n_bytes);
-  return n_buffers;
+  return frame->n_vectors;
 }
 
 VLIB_NODE_FUNCTION_MULTIARCH_CLONE (vnet_interface_output_node);
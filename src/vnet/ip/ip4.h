@@ -122,6 +122,9 @@ typedef struct ip4_main_t
   /** Seed for Jenkins hash used to compute ip4 flow hash. */
   u32 flow_hash_seed;
 
+  /** Bits resolved by the root PLY of new tables' mtries, 16 or 24 */
+  u32 mtrie_root_bits;
+
   /** @brief Template information for VPP generated packets */
   struct
   {
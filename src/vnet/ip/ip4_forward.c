@@ -70,7 +70,8 @@ always_inline uword
 ip4_lookup_inline (vlib_main_t * vm,
 		   vlib_node_runtime_t * node,
 		   vlib_frame_t * frame,
-		   int lookup_for_responses_to_locally_received_packets)
+		   int lookup_for_responses_to_locally_received_packets,
+		   int all_roots_16)
 {
   ip4_main_t *im = &ip4_main;
   vlib_combined_counter_main_t *cm = &load_balance_main.lbm_to_counters;
@@ -182,26 +183,46 @@ ip4_lookup_inline (vlib_main_t * vm,
 	      mtrie2 = &ip4_fib_get (fib_index2)->mtrie;
 	      mtrie3 = &ip4_fib_get (fib_index3)->mtrie;
 
-	      leaf0 = ip4_fib_mtrie_lookup_step_one (mtrie0, dst_addr0);
-	      leaf1 = ip4_fib_mtrie_lookup_step_one (mtrie1, dst_addr1);
-	      leaf2 = ip4_fib_mtrie_lookup_step_one (mtrie2, dst_addr2);
-	      leaf3 = ip4_fib_mtrie_lookup_step_one (mtrie3, dst_addr3);
+	      leaf0 = ip4_fib_mtrie_lookup_step_one_inline (mtrie0, dst_addr0,
+							    all_roots_16);
+	      leaf1 = ip4_fib_mtrie_lookup_step_one_inline (mtrie1, dst_addr1,
+							    all_roots_16);
+	      leaf2 = ip4_fib_mtrie_lookup_step_one_inline (mtrie2, dst_addr2,
+							    all_roots_16);
+	      leaf3 = ip4_fib_mtrie_lookup_step_one_inline (mtrie3, dst_addr3,
+							    all_roots_16);
 	    }
 
 	  if (!lookup_for_responses_to_locally_received_packets)
 	    {
-	      leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, dst_addr0, 2);
-	      leaf1 = ip4_fib_mtrie_lookup_step (mtrie1, leaf1, dst_addr1, 2);
-	      leaf2 = ip4_fib_mtrie_lookup_step (mtrie2, leaf2, dst_addr2, 2);
-	      leaf3 = ip4_fib_mtrie_lookup_step (mtrie3, leaf3, dst_addr3, 2);
+	      leaf0 = ip4_fib_mtrie_lookup_step_inline (mtrie0, leaf0,
+							dst_addr0, 2,
+							all_roots_16);
+	      leaf1 = ip4_fib_mtrie_lookup_step_inline (mtrie1, leaf1,
+							dst_addr1, 2,
+							all_roots_16);
+	      leaf2 = ip4_fib_mtrie_lookup_step_inline (mtrie2, leaf2,
+							dst_addr2, 2,
+							all_roots_16);
+	      leaf3 = ip4_fib_mtrie_lookup_step_inline (mtrie3, leaf3,
+							dst_addr3, 2,
+							all_roots_16);
 	    }
 
 	  if (!lookup_for_responses_to_locally_received_packets)
 	    {
-	      leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, dst_addr0, 3);
-	      leaf1 = ip4_fib_mtrie_lookup_step (mtrie1, leaf1, dst_addr1, 3);
-	      leaf2 = ip4_fib_mtrie_lookup_step (mtrie2, leaf2, dst_addr2, 3);
-	      leaf3 = ip4_fib_mtrie_lookup_step (mtrie3, leaf3, dst_addr3, 3);
+	      leaf0 = ip4_fib_mtrie_lookup_step_inline (mtrie0, leaf0,
+							dst_addr0, 3,
+							all_roots_16);
+	      leaf1 = ip4_fib_mtrie_lookup_step_inline (mtrie1, leaf1,
+							dst_addr1, 3,
+							all_roots_16);
+	      leaf2 = ip4_fib_mtrie_lookup_step_inline (mtrie2, leaf2,
+							dst_addr2, 3,
+							all_roots_16);
+	      leaf3 = ip4_fib_mtrie_lookup_step_inline (mtrie3, leaf3,
+							dst_addr3, 3,
+							all_roots_16);
 	    }
 
 	  if (lookup_for_responses_to_locally_received_packets)
@@ -358,14 +379,17 @@ ip4_lookup_inline (vlib_main_t * vm,
 	    {
 	      mtrie0 = &ip4_fib_get (fib_index0)->mtrie;
 
-	      leaf0 = ip4_fib_mtrie_lookup_step_one (mtrie0, dst_addr0);
+	      leaf0 = ip4_fib_mtrie_lookup_step_one_inline (mtrie0, dst_addr0,
+							    all_roots_16);
 	    }
 
 	  if (!lookup_for_responses_to_locally_received_packets)
-	    leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, dst_addr0, 2);
+	    leaf0 = ip4_fib_mtrie_lookup_step_inline (mtrie0, leaf0, dst_addr0,
+						      2, all_roots_16);
 
 	  if (!lookup_for_responses_to_locally_received_packets)
-	    leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, dst_addr0, 3);
+	    leaf0 = ip4_fib_mtrie_lookup_step_inline (mtrie0, leaf0, dst_addr0,
+						      3, all_roots_16);
 
 	  if (lookup_for_responses_to_locally_received_packets)
 	    lbi0 = vnet_buffer (p0)->ip.adj_index[VLIB_RX];
@@ -468,10 +492,15 @@ static uword
 ip4_lookup (vlib_main_t * vm,
 	    vlib_node_runtime_t * node, vlib_frame_t * frame)
 {
+  /* Once per frame: while no table has a 24 bit root, the lookups skip
+   * the per step test for one */
+  if (PREDICT_TRUE (ip4_mtrie_all_roots_16 ()))
+    return ip4_lookup_inline (vm, node, frame,
+			      /* lookup_for_responses_to_locally_received_packets */
+			      0, 1 /* all_roots_16 */ );
   return ip4_lookup_inline (vm, node, frame,
 			    /* lookup_for_responses_to_locally_received_packets */
-			    0);
-
+			    0, 0 /* all_roots_16 */ );
 }
 
 static u8 *format_ip4_lookup_trace (u8 * s, va_list * args);
@@ -1533,7 +1562,8 @@ VNET_FEATURE_ARC_INIT (ip4_local) =
 static inline uword
 ip4_local_inline (vlib_main_t * vm,
 		  vlib_node_runtime_t * node,
-		  vlib_frame_t * frame, int head_of_feature_arc)
+		  vlib_frame_t * frame, int head_of_feature_arc,
+		  int all_roots_16)
 {
   ip4_main_t *im = &ip4_main;
   ip_lookup_main_t *lm = &im->lookup_main;
@@ -1607,8 +1637,12 @@ ip4_local_inline (vlib_main_t * vm,
 	  mtrie0 = &ip4_fib_get (fib_index0)->mtrie;
 	  mtrie1 = &ip4_fib_get (fib_index1)->mtrie;
 
-	  leaf0 = ip4_fib_mtrie_lookup_step_one (mtrie0, &ip0->src_address);
-	  leaf1 = ip4_fib_mtrie_lookup_step_one (mtrie1, &ip1->src_address);
+	  leaf0 = ip4_fib_mtrie_lookup_step_one_inline (mtrie0,
+							&ip0->src_address,
+							all_roots_16);
+	  leaf1 = ip4_fib_mtrie_lookup_step_one_inline (mtrie1,
+							&ip1->src_address,
+							all_roots_16);
 
 	  /* Treat IP frag packets as "experimental" protocol for now
 	     until support of IP frag reassembly is implemented */
@@ -1677,10 +1711,12 @@ ip4_local_inline (vlib_main_t * vm,
 	  good_tcp_udp0 &= len_diff0 >= 0;
 	  good_tcp_udp1 &= len_diff1 >= 0;
 
-	  leaf0 =
-	    ip4_fib_mtrie_lookup_step (mtrie0, leaf0, &ip0->src_address, 2);
-	  leaf1 =
-	    ip4_fib_mtrie_lookup_step (mtrie1, leaf1, &ip1->src_address, 2);
+	  leaf0 = ip4_fib_mtrie_lookup_step_inline (mtrie0, leaf0,
+						    &ip0->src_address, 2,
+						    all_roots_16);
+	  leaf1 = ip4_fib_mtrie_lookup_step_inline (mtrie1, leaf1,
+						    &ip1->src_address, 2,
+						    all_roots_16);
 
 	  error0 = error1 = IP4_ERROR_UNKNOWN_PROTOCOL;
 
@@ -1693,10 +1729,12 @@ ip4_local_inline (vlib_main_t * vm,
 	  error1 = (is_tcp_udp1 && !good_tcp_udp1
 		    ? IP4_ERROR_TCP_CHECKSUM + is_udp1 : error1);
 
-	  leaf0 =
-	    ip4_fib_mtrie_lookup_step (mtrie0, leaf0, &ip0->src_address, 3);
-	  leaf1 =
-	    ip4_fib_mtrie_lookup_step (mtrie1, leaf1, &ip1->src_address, 3);
+	  leaf0 = ip4_fib_mtrie_lookup_step_inline (mtrie0, leaf0,
+						    &ip0->src_address, 3,
+						    all_roots_16);
+	  leaf1 = ip4_fib_mtrie_lookup_step_inline (mtrie1, leaf1,
+						    &ip1->src_address, 3,
+						    all_roots_16);
 
 	  vnet_buffer (p0)->ip.adj_index[VLIB_RX] = lbi0 =
 	    ip4_fib_mtrie_leaf_get_adj_index (leaf0);
@@ -1800,7 +1838,9 @@ ip4_local_inline (vlib_main_t * vm,
 
 	  mtrie0 = &ip4_fib_get (fib_index0)->mtrie;
 
-	  leaf0 = ip4_fib_mtrie_lookup_step_one (mtrie0, &ip0->src_address);
+	  leaf0 = ip4_fib_mtrie_lookup_step_one_inline (mtrie0,
+							&ip0->src_address,
+							all_roots_16);
 
 	  /* Treat IP frag packets as "experimental" protocol for now
 	     until support of IP frag reassembly is implemented */
@@ -1847,8 +1887,9 @@ ip4_local_inline (vlib_main_t * vm,
 
 	  good_tcp_udp0 &= len_diff0 >= 0;
 
-	  leaf0 =
-	    ip4_fib_mtrie_lookup_step (mtrie0, leaf0, &ip0->src_address, 2);
+	  leaf0 = ip4_fib_mtrie_lookup_step_inline (mtrie0, leaf0,
+						    &ip0->src_address, 2,
+						    all_roots_16);
 
 	  error0 = IP4_ERROR_UNKNOWN_PROTOCOL;
 
@@ -1858,8 +1899,9 @@ ip4_local_inline (vlib_main_t * vm,
 	  error0 = (is_tcp_udp0 && !good_tcp_udp0
 		    ? IP4_ERROR_TCP_CHECKSUM + is_udp0 : error0);
 
-	  leaf0 =
-	    ip4_fib_mtrie_lookup_step (mtrie0, leaf0, &ip0->src_address, 3);
+	  leaf0 = ip4_fib_mtrie_lookup_step_inline (mtrie0, leaf0,
+						    &ip0->src_address, 3,
+						    all_roots_16);
 
 	  lbi0 = ip4_fib_mtrie_leaf_get_adj_index (leaf0);
 	  vnet_buffer (p0)->ip.adj_index[VLIB_TX] = lbi0;
@@ -1907,7 +1949,11 @@ ip4_local_inline (vlib_main_t * vm,
 static uword
 ip4_local (vlib_main_t * vm, vlib_node_runtime_t * node, vlib_frame_t * frame)
 {
-  return ip4_local_inline (vm, node, frame, 1 /* head of feature arc */ );
+  if (PREDICT_TRUE (ip4_mtrie_all_roots_16 ()))
+    return ip4_local_inline (vm, node, frame, 1 /* head of feature arc */ ,
+			     1 /* all_roots_16 */ );
+  return ip4_local_inline (vm, node, frame, 1 /* head of feature arc */ ,
+			   0 /* all_roots_16 */ );
 }
 
 /* *INDENT-OFF* */
@@ -1933,7 +1979,11 @@ static uword
 ip4_local_end_of_arc (vlib_main_t * vm,
 		      vlib_node_runtime_t * node, vlib_frame_t * frame)
 {
-  return ip4_local_inline (vm, node, frame, 0 /* head of feature arc */ );
+  if (PREDICT_TRUE (ip4_mtrie_all_roots_16 ()))
+    return ip4_local_inline (vm, node, frame, 0 /* head of feature arc */ ,
+			     1 /* all_roots_16 */ );
+  return ip4_local_inline (vm, node, frame, 0 /* head of feature arc */ ,
+			   0 /* all_roots_16 */ );
 }
 
 /* *INDENT-OFF* */
@@ -2512,13 +2562,13 @@ ip4_rewrite_inline (vlib_main_t * vm,
 	  /* Check MTU of outgoing interface. */
 	  error0 =
 	    (vlib_buffer_length_in_chain (vm, p0) >
-	     adj0[0].
-	     rewrite_header.max_l3_packet_bytes ? IP4_ERROR_MTU_EXCEEDED :
+	     adj0[0].rewrite_header.max_l3_packet_bytes
+	     && !(p0->flags & VNET_BUFFER_GSO) ? IP4_ERROR_MTU_EXCEEDED :
 	     error0);
 	  error1 =
 	    (vlib_buffer_length_in_chain (vm, p1) >
-	     adj1[0].
-	     rewrite_header.max_l3_packet_bytes ? IP4_ERROR_MTU_EXCEEDED :
+	     adj1[0].rewrite_header.max_l3_packet_bytes
+	     && !(p1->flags & VNET_BUFFER_GSO) ? IP4_ERROR_MTU_EXCEEDED :
 	     error1);
 
 	  /* Don't adjust the buffer for ttl issue; icmp-error node wants
@@ -2678,6 +2728,7 @@ ip4_rewrite_inline (vlib_main_t * vm,
 	  /* Check MTU of outgoing interface. */
 	  error0 = (vlib_buffer_length_in_chain (vm, p0)
 		    > adj0[0].rewrite_header.max_l3_packet_bytes
+		    && !(p0->flags & VNET_BUFFER_GSO)
 		    ? IP4_ERROR_MTU_EXCEEDED : error0);
 
 	  p0->error = error_node->errors[error0];
@@ -3310,6 +3361,31 @@ VLIB_CLI_COMMAND (set_ip_classify_command, static) =
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+ip4_config (vlib_main_t * vm, unformat_input_t * input)
+{
+  ip4_main_t *im = &ip4_main;
+  u32 root_bits = 16;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "mtrie-root-bits %d", &root_bits))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (root_bits != 16 && root_bits != 24)
+    return clib_error_return (0, "mtrie-root-bits must be 16 or 24");
+
+  im->mtrie_root_bits = root_bits;
+
+  return 0;
+}
+
+VLIB_EARLY_CONFIG_FUNCTION (ip4_config, "ip4");
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
@@ -47,6 +47,12 @@
  */
 ip4_fib_mtrie_8_ply_t *ip4_ply_pool;
 
+/**
+ * Mtries with a 24 bit root. A frame which started before a new one was
+ * counted sees the new table through its 16 bit root, which is empty.
+ */
+u32 ip4_mtrie_n_24_bit_roots;
+
 always_inline u32
 ip4_fib_mtrie_leaf_is_non_empty (ip4_fib_mtrie_8_ply_t * p, u8 dst_byte)
 {
@@ -176,10 +182,24 @@ ply_create (ip4_fib_mtrie_t * m,
 	    u32 leaf_prefix_len, u32 ply_base_len)
 {
   ip4_fib_mtrie_8_ply_t *p;
+  vlib_main_t *vm = vlib_get_main ();
+  u8 need_barrier_sync;
+
+  /*
+   * The workers walk the plies without a lock. Growing the pool moves
+   * it, so they must be held at the barrier, but only then.
+   */
+  pool_get_aligned_will_expand (ip4_ply_pool, need_barrier_sync,
+				CLIB_CACHE_LINE_BYTES);
+  if (need_barrier_sync)
+    vlib_worker_thread_barrier_sync (vm);
 
   /* Get cache aligned ply. */
   pool_get_aligned (ip4_ply_pool, p, CLIB_CACHE_LINE_BYTES);
 
+  if (need_barrier_sync)
+    vlib_worker_thread_barrier_release (vm);
+
   ply_8_init (p, init_leaf, leaf_prefix_len, ply_base_len);
   return ip4_fib_mtrie_leaf_set_next_ply_index (p - ip4_ply_pool);
 }
@@ -192,26 +212,87 @@ get_next_ply_for_leaf (ip4_fib_mtrie_t * m, ip4_fib_mtrie_leaf_t l)
   return pool_elt_at_index (ip4_ply_pool, n);
 }
 
+static void
+ply_free (ip4_fib_mtrie_t * m, ip4_fib_mtrie_8_ply_t * p)
+{
+  uword i;
+
+  for (i = 0; i < ARRAY_LEN (p->leaves); i++)
+    {
+      if (ip4_fib_mtrie_leaf_is_next_ply (p->leaves[i]))
+	ply_free (m, get_next_ply_for_leaf (m, p->leaves[i]));
+    }
+
+  pool_put (ip4_ply_pool, p);
+}
+
+static void
+ply_free_rcu (uword ply_index, uword unused)
+{
+  pool_put_index (ip4_ply_pool, ply_index);
+}
+
 void
 ip4_mtrie_free (ip4_fib_mtrie_t * m)
 {
-  /* the root ply is embedded so the is nothing to do,
-   * the assumption being that the IP4 FIB table has emptied the trie
-   * before deletion.
+  /*
+   * Normally the IP4 FIB table has emptied the trie before deletion,
+   * and there are no PLYs left to free. A table whose trie is being
+   * rebuilt with a different root is freed while populated.
    */
-#if CLIB_DEBUG > 0
-  int i;
-  for (i = 0; i < ARRAY_LEN (m->root_ply.leaves); i++)
+  uword i;
+
+  if (m->root_24_ply)
     {
-      ASSERT (!ip4_fib_mtrie_leaf_is_next_ply (m->root_ply.leaves[i]));
+      for (i = 0; i < ARRAY_LEN (m->root_24_ply->leaves); i++)
+	{
+	  ip4_fib_mtrie_leaf_t l = m->root_24_ply->leaves[i];
+
+	  if (ip4_fib_mtrie_leaf_is_next_ply (l))
+	    ply_free (m, get_next_ply_for_leaf (m, l));
+	}
+      clib_mem_vm_free (m->root_24_ply, sizeof (*m->root_24_ply));
+      m->root_24_ply = 0;
+      ip4_mtrie_n_24_bit_roots--;
+    }
+  else
+    {
+      for (i = 0; i < ARRAY_LEN (m->root_ply.leaves); i++)
+	{
+	  ip4_fib_mtrie_leaf_t l = m->root_ply.leaves[i];
+
+	  if (ip4_fib_mtrie_leaf_is_next_ply (l))
+	    ply_free (m, get_next_ply_for_leaf (m, l));
+	}
     }
-#endif
 }
 
 void
-ip4_mtrie_init (ip4_fib_mtrie_t * m)
+ip4_mtrie_init (ip4_fib_mtrie_t * m, u32 root_bits)
 {
+  ip4_fib_mtrie_leaf_t init = IP4_FIB_MTRIE_LEAF_EMPTY;
+  ip4_fib_mtrie_24_ply_t *p;
+
+  ASSERT (root_bits == 16 || root_bits == 24);
+
+  /*
+   * The 16 bit root is always initialised, a lookup in a table whose 24
+   * bit root is not yet published then sees an empty table.
+   */
   ply_16_init (&m->root_ply, IP4_FIB_MTRIE_LEAF_EMPTY, 0);
+  m->root_24_ply = 0;
+
+  if (root_bits == 24)
+    {
+      p = clib_mem_vm_alloc (sizeof (*p));
+      if (p == 0)
+	clib_panic ("failed to allocate 24 bit mtrie root ply");
+      PLY_INIT_LEAVES (p);
+      /* fresh anonymous pages, dst_address_bits_of_leaves are zero */
+      ip4_mtrie_n_24_bit_roots++;
+      CLIB_MEMORY_BARRIER ();
+      m->root_24_ply = p;
+    }
 }
 
 typedef struct
@@ -367,8 +448,7 @@ set_leaf (ip4_fib_mtrie_t * m,
 	    ip4_fib_mtrie_leaf_is_non_empty (old_ply, dst_byte);
 
 	  new_leaf = ply_create (m, old_leaf,
-				 clib_max (old_ply->dst_address_bits_of_leaves
-					   [dst_byte], ply_base_len),
+				 old_ply->dst_address_bits_of_leaves[dst_byte],
 				 ply_base_len);
 	  new_ply = get_next_ply_for_leaf (m, new_leaf);
 
@@ -391,6 +471,104 @@ set_leaf (ip4_fib_mtrie_t * m,
     }
 }
 
+always_inline u32
+ip4_fib_mtrie_24_slot (const ip4_address_t * a)
+{
+  return (clib_net_to_host_u32 (a->as_u32) >> 8);
+}
+
+static void
+set_root_24_leaf (ip4_fib_mtrie_t * m,
+		  const ip4_fib_mtrie_set_unset_leaf_args_t * a)
+{
+  ip4_fib_mtrie_leaf_t old_leaf, new_leaf;
+  ip4_fib_mtrie_24_ply_t *old_ply;
+  ip4_fib_mtrie_8_ply_t *new_ply;
+  i32 n_dst_bits_next_plies;
+  u32 dst_slot;
+
+  old_ply = m->root_24_ply;
+
+  ASSERT (a->dst_address_length <= 32);
+
+  /* how many bits of the destination address are in the next PLY */
+  n_dst_bits_next_plies = a->dst_address_length - 24;
+
+  dst_slot = ip4_fib_mtrie_24_slot (&a->dst_address);
+
+  /* Number of bits next plies <= 0 => insert leaves this ply. */
+  if (n_dst_bits_next_plies <= 0)
+    {
+      uword old_leaf_is_terminal;
+      u32 i, n_dst_bits_this_ply;
+
+      /* The number of bits, and hence slots/buckets, we will fill */
+      n_dst_bits_this_ply = 24 - a->dst_address_length;
+      ASSERT ((dst_slot & pow2_mask (n_dst_bits_this_ply)) == 0);
+
+      for (i = dst_slot; i < dst_slot + (1 << n_dst_bits_this_ply); i++)
+	{
+	  old_leaf = old_ply->leaves[i];
+	  old_leaf_is_terminal = ip4_fib_mtrie_leaf_is_terminal (old_leaf);
+
+	  if (a->dst_address_length >= old_ply->dst_address_bits_of_leaves[i])
+	    {
+	      /* The new leaf is more or equally specific than the one currently
+	       * occupying the slot */
+	      new_leaf = ip4_fib_mtrie_leaf_set_adj_index (a->adj_index);
+
+	      if (old_leaf_is_terminal)
+		{
+		  old_ply->dst_address_bits_of_leaves[i] =
+		    a->dst_address_length;
+		  __sync_val_compare_and_swap (&old_ply->leaves[i],
+					       old_leaf, new_leaf);
+		  ASSERT (old_ply->leaves[i] == new_leaf);
+		}
+	      else
+		{
+		  /* Existing leaf points to another ply.  We need to place
+		   * new_leaf into all more specific slots. */
+		  new_ply = get_next_ply_for_leaf (m, old_leaf);
+		  set_ply_with_more_specific_leaf (m, new_ply, new_leaf,
+						   a->dst_address_length);
+		}
+	    }
+	  else if (!old_leaf_is_terminal)
+	    {
+	      /* The current leaf is less specific and not termial (i.e. a ply),
+	       * recurse on down the trie */
+	      new_ply = get_next_ply_for_leaf (m, old_leaf);
+	      set_leaf (m, a, new_ply - ip4_ply_pool, 3);
+	    }
+	}
+    }
+  else
+    {
+      /* The address to insert requires us to move down at a lower level of
+       * the trie - recurse on down */
+      old_leaf = old_ply->leaves[dst_slot];
+
+      if (ip4_fib_mtrie_leaf_is_terminal (old_leaf))
+	{
+	  /* There is a leaf occupying the slot. Replace it with a new ply */
+	  new_leaf = ply_create (m, old_leaf,
+				 old_ply->dst_address_bits_of_leaves[dst_slot],
+				 24);
+	  new_ply = get_next_ply_for_leaf (m, new_leaf);
+
+	  __sync_val_compare_and_swap (&old_ply->leaves[dst_slot], old_leaf,
+				       new_leaf);
+	  ASSERT (old_ply->leaves[dst_slot] == new_leaf);
+	  old_ply->dst_address_bits_of_leaves[dst_slot] = 24;
+	}
+      else
+	new_ply = get_next_ply_for_leaf (m, old_leaf);
+
+      set_leaf (m, a, new_ply - ip4_ply_pool, 3);
+    }
+}
+
 static void
 set_root_leaf (ip4_fib_mtrie_t * m,
 	       const ip4_fib_mtrie_set_unset_leaf_args_t * a)
@@ -490,8 +668,7 @@ set_root_leaf (ip4_fib_mtrie_t * m,
 	{
 	  /* There is a leaf occupying the slot. Replace it with a new ply */
 	  new_leaf = ply_create (m, old_leaf,
-				 clib_max (old_ply->dst_address_bits_of_leaves
-					   [dst_byte], ply_base_len),
+				 old_ply->dst_address_bits_of_leaves[dst_byte],
 				 ply_base_len);
 	  new_ply = get_next_ply_for_leaf (m, new_leaf);
 
@@ -558,7 +735,11 @@ unset_leaf (ip4_fib_mtrie_t * m,
 	  ASSERT (old_ply->n_non_empty_leafs >= 0);
 	  if (old_ply->n_non_empty_leafs == 0 && dst_address_byte_index > 0)
 	    {
-	      pool_put (ip4_ply_pool, old_ply);
+	      /*
+	       * The caller unlinks it, and a worker may be walking it:
+	       * the index is reused only once no worker can see it.
+	       */
+	      vlib_rcu_call (ply_free_rcu, old_ply - ip4_ply_pool, 0);
 	      /* Old ply was deleted. */
 	      return 1;
 	    }
@@ -580,6 +761,44 @@ unset_leaf (ip4_fib_mtrie_t * m,
   return 0;
 }
 
+static void
+unset_root_24_leaf (ip4_fib_mtrie_t * m,
+		    const ip4_fib_mtrie_set_unset_leaf_args_t * a)
+{
+  ip4_fib_mtrie_leaf_t old_leaf, del_leaf;
+  i32 n_dst_bits_next_plies;
+  i32 n_dst_bits_this_ply, old_leaf_is_terminal;
+  u32 i, dst_slot;
+  ip4_fib_mtrie_24_ply_t *old_ply;
+
+  ASSERT (a->dst_address_length <= 32);
+
+  old_ply = m->root_24_ply;
+  n_dst_bits_next_plies = a->dst_address_length - 24;
+
+  dst_slot = ip4_fib_mtrie_24_slot (&a->dst_address);
+
+  n_dst_bits_this_ply = (n_dst_bits_next_plies <= 0 ?
+			 (24 - a->dst_address_length) : 0);
+
+  del_leaf = ip4_fib_mtrie_leaf_set_adj_index (a->adj_index);
+
+  for (i = dst_slot; i < dst_slot + (1 << n_dst_bits_this_ply); i++)
+    {
+      old_leaf = old_ply->leaves[i];
+      old_leaf_is_terminal = ip4_fib_mtrie_leaf_is_terminal (old_leaf);
+
+      if (old_leaf == del_leaf
+	  || (!old_leaf_is_terminal
+	      && unset_leaf (m, a, get_next_ply_for_leaf (m, old_leaf), 3)))
+	{
+	  old_ply->leaves[i] =
+	    ip4_fib_mtrie_leaf_set_adj_index (a->cover_adj_index);
+	  old_ply->dst_address_bits_of_leaves[i] = a->cover_address_length;
+	}
+    }
+}
+
 static void
 unset_root_leaf (ip4_fib_mtrie_t * m,
 		 const ip4_fib_mtrie_set_unset_leaf_args_t * a)
@@ -640,7 +859,10 @@ ip4_fib_mtrie_route_add (ip4_fib_mtrie_t * m,
   a.dst_address_length = dst_address_length;
   a.adj_index = adj_index;
 
-  set_root_leaf (m, &a);
+  if (m->root_24_ply)
+    set_root_24_leaf (m, &a);
+  else
+    set_root_leaf (m, &a);
 }
 
 void
@@ -662,7 +884,10 @@ ip4_fib_mtrie_route_del (ip4_fib_mtrie_t * m,
   a.cover_address_length = cover_address_length;
 
   /* the top level ply is never removed */
-  unset_root_leaf (m, &a);
+  if (m->root_24_ply)
+    unset_root_24_leaf (m, &a);
+  else
+    unset_root_leaf (m, &a);
 }
 
 /* Returns number of bytes of memory used by mtrie. */
@@ -689,6 +914,18 @@ mtrie_memory_usage (ip4_fib_mtrie_t * m)
   uword bytes, i;
 
   bytes = sizeof (*m);
+  if (m->root_24_ply)
+    {
+      bytes += sizeof (*m->root_24_ply);
+      for (i = 0; i < ARRAY_LEN (m->root_24_ply->leaves); i++)
+	{
+	  ip4_fib_mtrie_leaf_t l = m->root_24_ply->leaves[i];
+	  if (ip4_fib_mtrie_leaf_is_next_ply (l))
+	    bytes += mtrie_ply_memory_usage (m, get_next_ply_for_leaf (m, l));
+	}
+      return bytes;
+    }
+
   for (i = 0; i < ARRAY_LEN (m->root_ply.leaves); i++)
     {
       ip4_fib_mtrie_leaf_t l = m->root_ply.leaves[i];
@@ -699,6 +936,59 @@ mtrie_memory_usage (ip4_fib_mtrie_t * m)
   return bytes;
 }
 
+/*
+ * Accumulate the number of addresses whose lookup completes after
+ * depth dependent loads from the mtrie.
+ */
+static void
+mtrie_ply_lookup_depth (ip4_fib_mtrie_t * m, ip4_fib_mtrie_8_ply_t * p,
+			u32 depth, u64 n_addresses_per_leaf,
+			u64 * n_addresses_by_depth)
+{
+  uword i;
+
+  for (i = 0; i < ARRAY_LEN (p->leaves); i++)
+    {
+      ip4_fib_mtrie_leaf_t l = p->leaves[i];
+      if (ip4_fib_mtrie_leaf_is_next_ply (l))
+	mtrie_ply_lookup_depth (m, get_next_ply_for_leaf (m, l), depth + 1,
+				n_addresses_per_leaf >> 8,
+				n_addresses_by_depth);
+      else
+	n_addresses_by_depth[depth] += n_addresses_per_leaf;
+    }
+}
+
+static void
+mtrie_lookup_depth (ip4_fib_mtrie_t * m, u64 * n_addresses_by_depth)
+{
+  ip4_fib_mtrie_leaf_t *leaves;
+  u64 n_addresses_per_leaf;
+  uword i, n_leaves;
+
+  if (m->root_24_ply)
+    {
+      leaves = m->root_24_ply->leaves;
+      n_leaves = ARRAY_LEN (m->root_24_ply->leaves);
+    }
+  else
+    {
+      leaves = m->root_ply.leaves;
+      n_leaves = ARRAY_LEN (m->root_ply.leaves);
+    }
+  n_addresses_per_leaf = (1ULL << 32) / n_leaves;
+
+  for (i = 0; i < n_leaves; i++)
+    {
+      if (ip4_fib_mtrie_leaf_is_next_ply (leaves[i]))
+	mtrie_ply_lookup_depth (m, get_next_ply_for_leaf (m, leaves[i]), 2,
+				n_addresses_per_leaf >> 8,
+				n_addresses_by_depth);
+      else
+	n_addresses_by_depth[1] += n_addresses_per_leaf;
+    }
+}
+
 static u8 *
 format_ip4_fib_mtrie_leaf (u8 * s, va_list * va)
 {
@@ -760,17 +1050,67 @@ format_ip4_fib_mtrie_ply (u8 * s, va_list * va)
   return s;
 }
 
+static u8 *
+format_ip4_fib_mtrie_24_root (u8 * s, va_list * va)
+{
+  ip4_fib_mtrie_t *m = va_arg (*va, ip4_fib_mtrie_t *);
+  ip4_fib_mtrie_24_ply_t *p = m->root_24_ply;
+  int i;
+
+  s = format (s, "root-ply (24 bit)");
+
+  /*
+   * Only show the first slot of each run of slots filled by the same
+   * prefix, there are a lot of them.
+   */
+  for (i = 0; i < ARRAY_LEN (p->leaves); i++)
+    {
+      if (p->dst_address_bits_of_leaves[i] > 0 &&
+	  (i == 0 || ip4_fib_mtrie_leaf_is_next_ply (p->leaves[i]) ||
+	   p->leaves[i] != p->leaves[i - 1] ||
+	   p->dst_address_bits_of_leaves[i] !=
+	   p->dst_address_bits_of_leaves[i - 1]))
+	{
+	  FORMAT_PLY (s, p, i, 0, 24, 2);
+	}
+    }
+
+  return s;
+}
+
 u8 *
 format_ip4_fib_mtrie (u8 * s, va_list * va)
 {
   ip4_fib_mtrie_t *m = va_arg (*va, ip4_fib_mtrie_t *);
+  int verbose = va_arg (*va, int);
   ip4_fib_mtrie_16_ply_t *p;
+  u64 n_addresses_by_depth[4] = { 0 };
   u32 base_address = 0;
+  f64 average_depth = 0;
   int i;
 
-  s = format (s, "%d plies, memory usage %U\n",
+  mtrie_lookup_depth (m, n_addresses_by_depth);
+
+  s = format (s, "%d-8%s mtrie, %d plies, memory usage %U\n",
+	      ip4_mtrie_root_bits (m), m->root_24_ply ? "" : "-8",
 	      pool_elts (ip4_ply_pool),
 	      format_memory_size, mtrie_memory_usage (m));
+  s = format (s, "lookup depth:");
+  for (i = 1; i < ARRAY_LEN (n_addresses_by_depth); i++)
+    {
+      f64 fraction = (f64) n_addresses_by_depth[i] / (f64) (1ULL << 32);
+
+      s = format (s, " %d: %.2f%%", i, fraction * 100.0);
+      average_depth += fraction * i;
+    }
+  s = format (s, ", average %.3f loads\n", average_depth);
+
+  if (!verbose)
+    return s;
+
+  if (m->root_24_ply)
+    return (format (s, "%U", format_ip4_fib_mtrie_24_root, m));
+
   s = format (s, "root-ply");
   p = &m->root_ply;
 
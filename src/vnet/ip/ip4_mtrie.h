@@ -80,6 +80,33 @@ typedef struct ip4_fib_mtrie_16_ply_t_
   u8 dst_address_bits_of_leaves[PLY_16_SIZE];
 } ip4_fib_mtrie_16_ply_t;
 
+/**
+ * @brief the 24 way stride that is the top PLY of a 24-8 (DIR-24-8)
+ * mtrie. Slots are indexed by the top 24 bits of the address, in host
+ * byte order. At 80MB per table this is only worth it for large FIBs,
+ * where it saves one dependent load per lookup over the 16-8-8 layout.
+ */
+#define PLY_24_SIZE (1<<24)
+typedef struct ip4_fib_mtrie_24_ply_t_
+{
+  /**
+   * The leaves/slots/buckets to be filed with leafs
+   */
+  union
+  {
+    ip4_fib_mtrie_leaf_t leaves[PLY_24_SIZE];
+
+#ifdef CLIB_HAVE_VEC128
+    u32x4 leaves_as_u32x4[PLY_24_SIZE / 4];
+#endif
+  };
+
+  /**
+   * Prefix length for terminal leaves.
+   */
+  u8 dst_address_bits_of_leaves[PLY_24_SIZE];
+} ip4_fib_mtrie_24_ply_t;
+
 /**
  * @brief One ply of the 4 ply mtrie fib.
  */
@@ -128,6 +155,13 @@ STATIC_ASSERT (0 == sizeof (ip4_fib_mtrie_8_ply_t) % CLIB_CACHE_LINE_BYTES,
  */
 typedef struct
 {
+  /**
+   * The root PLY of a 24-8 mtrie. When set, the embedded 16 bit
+   * root PLY is unused. Kept in the same cacheline as the start of
+   * the 16 bit root, which the data-path reads anyway.
+   */
+  ip4_fib_mtrie_24_ply_t *root_24_ply;
+
   /**
    * Embed the PLY with the mtrie struct. This means that the Data-plane
    * 'get me the mtrie' returns the first ply, and not an indirect 'pointer'
@@ -137,15 +171,25 @@ typedef struct
 } ip4_fib_mtrie_t;
 
 /**
- * @brief Initialise an mtrie
+ * @brief Initialise an mtrie with a 16 bit (16-8-8) or a
+ * 24 bit (24-8) root PLY.
  */
-void ip4_mtrie_init (ip4_fib_mtrie_t * m);
+void ip4_mtrie_init (ip4_fib_mtrie_t * m, u32 root_bits);
 
 /**
- * @brief Free an mtrie, It must be emty when free'd
+ * @brief Free an mtrie, and any PLYs still in it.
  */
 void ip4_mtrie_free (ip4_fib_mtrie_t * m);
 
+/**
+ * @brief The number of address bits resolved by the mtrie's root PLY
+ */
+always_inline u32
+ip4_mtrie_root_bits (const ip4_fib_mtrie_t * m)
+{
+  return (m->root_24_ply ? 24 : 16);
+}
+
 /**
  * @brief Add a route/rntry to the mtrie
  */
@@ -171,6 +215,18 @@ format_function_t format_ip4_fib_mtrie;
  */
 extern ip4_fib_mtrie_8_ply_t *ip4_ply_pool;
 
+/**
+ * @brief The number of mtries with a 24 bit root. While there are none,
+ * the lookup nodes run the 16 bit root steps, which do not test the root.
+ */
+extern u32 ip4_mtrie_n_24_bit_roots;
+
+always_inline int
+ip4_mtrie_all_roots_16 (void)
+{
+  return (ip4_mtrie_n_24_bit_roots == 0);
+}
+
 /**
  * Is the leaf terminal (i.e. an LB index) or non-terminak (i.e. a PLY index)
  */
@@ -205,6 +261,13 @@ ip4_fib_mtrie_lookup_step (const ip4_fib_mtrie_t * m,
 
   if (!current_is_terminal)
     {
+      /*
+       * The 24 bit root has already consumed the 3rd byte, the next
+       * PLY is indexed by the 4th.
+       */
+      if (dst_address_byte_index == 2 && PREDICT_FALSE (m->root_24_ply != 0))
+	return current_leaf;
+
       ply = ip4_ply_pool + (current_leaf >> 1);
       return (ply->leaves[dst_address->as_u8[dst_address_byte_index]]);
     }
@@ -213,7 +276,8 @@ ip4_fib_mtrie_lookup_step (const ip4_fib_mtrie_t * m,
 }
 
 /**
- * @brief Lookup step number 1.  Processes 2 bytes of 4 byte ip4 address.
+ * @brief Lookup step number 1.  Processes 2 (or 3) bytes of 4 byte
+ * ip4 address.
  */
 always_inline ip4_fib_mtrie_leaf_t
 ip4_fib_mtrie_lookup_step_one (const ip4_fib_mtrie_t * m,
@@ -221,11 +285,90 @@ ip4_fib_mtrie_lookup_step_one (const ip4_fib_mtrie_t * m,
 {
   ip4_fib_mtrie_leaf_t next_leaf;
 
-  next_leaf = m->root_ply.leaves[dst_address->as_u16[0]];
+  if (PREDICT_FALSE (m->root_24_ply != 0))
+    next_leaf = m->root_24_ply->leaves
+      [clib_net_to_host_u32 (dst_address->as_u32) >> 8];
+  else
+    next_leaf = m->root_ply.leaves[dst_address->as_u16[0]];
 
   return next_leaf;
 }
 
+/**
+ * @brief Lookup step number 1 of an mtrie known to have a 16 bit root.
+ */
+always_inline ip4_fib_mtrie_leaf_t
+ip4_fib_mtrie_16_lookup_step_one (const ip4_fib_mtrie_t * m,
+				  const ip4_address_t * dst_address)
+{
+  return (m->root_ply.leaves[dst_address->as_u16[0]]);
+}
+
+/**
+ * @brief Lookup step of an mtrie known to have a 16 bit root.
+ */
+always_inline ip4_fib_mtrie_leaf_t
+ip4_fib_mtrie_16_lookup_step (ip4_fib_mtrie_leaf_t current_leaf,
+			      const ip4_address_t * dst_address,
+			      u32 dst_address_byte_index)
+{
+  ip4_fib_mtrie_8_ply_t *ply;
+
+  if (!ip4_fib_mtrie_leaf_is_terminal (current_leaf))
+    {
+      ply = ip4_ply_pool + (current_leaf >> 1);
+      return (ply->leaves[dst_address->as_u8[dst_address_byte_index]]);
+    }
+
+  return current_leaf;
+}
+
+/**
+ * @brief Lookup step number 1, of the 16 bit root steps if the caller
+ * found, once per frame, that all roots are 16 bit.
+ */
+always_inline ip4_fib_mtrie_leaf_t
+ip4_fib_mtrie_lookup_step_one_inline (const ip4_fib_mtrie_t * m,
+				      const ip4_address_t * dst_address,
+				      int all_roots_16)
+{
+  if (all_roots_16)
+    return (ip4_fib_mtrie_16_lookup_step_one (m, dst_address));
+  return (ip4_fib_mtrie_lookup_step_one (m, dst_address));
+}
+
+/**
+ * @brief Lookup step, of the 16 bit root steps if the caller found, once
+ * per frame, that all roots are 16 bit.
+ */
+always_inline ip4_fib_mtrie_leaf_t
+ip4_fib_mtrie_lookup_step_inline (const ip4_fib_mtrie_t * m,
+				  ip4_fib_mtrie_leaf_t current_leaf,
+				  const ip4_address_t * dst_address,
+				  u32 dst_address_byte_index,
+				  int all_roots_16)
+{
+  if (all_roots_16)
+    return (ip4_fib_mtrie_16_lookup_step (current_leaf, dst_address,
+					  dst_address_byte_index));
+  return (ip4_fib_mtrie_lookup_step (m, current_leaf, dst_address,
+				     dst_address_byte_index));
+}
+
+/**
+ * @brief Lookup an address, all steps in one.
+ */
+always_inline ip4_fib_mtrie_leaf_t
+ip4_fib_mtrie_lookup (const ip4_fib_mtrie_t * m,
+		      const ip4_address_t * dst_address)
+{
+  ip4_fib_mtrie_leaf_t leaf;
+
+  leaf = ip4_fib_mtrie_lookup_step_one (m, dst_address);
+  leaf = ip4_fib_mtrie_lookup_step (m, leaf, dst_address, 2);
+  return (ip4_fib_mtrie_lookup_step (m, leaf, dst_address, 3));
+}
+
 #endif /* included_ip_ip4_fib_h */
 
 /*
@@ -2100,13 +2100,13 @@ ip6_rewrite_inline (vlib_main_t * vm,
 	  /* Check MTU of outgoing interface. */
 	  error0 =
 	    (vlib_buffer_length_in_chain (vm, p0) >
-	     adj0[0].
-	     rewrite_header.max_l3_packet_bytes ? IP6_ERROR_MTU_EXCEEDED :
+	     adj0[0].rewrite_header.max_l3_packet_bytes
+	     && !(p0->flags & VNET_BUFFER_GSO) ? IP6_ERROR_MTU_EXCEEDED :
 	     error0);
 	  error1 =
 	    (vlib_buffer_length_in_chain (vm, p1) >
-	     adj1[0].
-	     rewrite_header.max_l3_packet_bytes ? IP6_ERROR_MTU_EXCEEDED :
+	     adj1[0].rewrite_header.max_l3_packet_bytes
+	     && !(p1->flags & VNET_BUFFER_GSO) ? IP6_ERROR_MTU_EXCEEDED :
 	     error1);
 
 	  /* Don't adjust the buffer for hop count issue; icmp-error node
@@ -2233,8 +2233,8 @@ ip6_rewrite_inline (vlib_main_t * vm,
 	  /* Check MTU of outgoing interface. */
 	  error0 =
 	    (vlib_buffer_length_in_chain (vm, p0) >
-	     adj0[0].
-	     rewrite_header.max_l3_packet_bytes ? IP6_ERROR_MTU_EXCEEDED :
+	     adj0[0].rewrite_header.max_l3_packet_bytes
+	     && !(p0->flags & VNET_BUFFER_GSO) ? IP6_ERROR_MTU_EXCEEDED :
 	     error0);
 
 	  /* Don't adjust the buffer for hop count issue; icmp-error node
@@ -0,0 +1,1220 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @file
+ * @brief IPv4 and IPv6 full reassembly.
+ *
+ * Fragments are kept in a per-thread reassembly context, sorted by
+ * offset. Overlapping fragments are not merged: a datagram with
+ * overlapping fragments is dropped as a whole, as required for IPv6 by
+ * RFC 5722, and exact duplicates are dropped individually. Once the
+ * payload is complete the fragments are linked into one buffer chain
+ * behind the first fragment.
+ */
+
+#include <vnet/vnet.h>
+#include <vnet/ip/ip.h>
+#include <vnet/ip/ip_reassembly.h>
+#include <vnet/feature/feature.h>
+#include <vlib/threads.h>
+
+ip_reass_main_t ip_reass_main;
+
+vlib_node_registration_t ip4_reass_node;
+vlib_node_registration_t ip6_reass_node;
+vlib_node_registration_t ip_reass_expire_node;
+
+#define IP_REASS_HASH_NBUCKETS (64 << 10)
+#define IP_REASS_HASH_MEMORY (64 << 20)
+
+#define foreach_ip_reass_error                                  \
+_(NONE, "fragments received")                                   \
+_(REASSEMBLED, "datagrams reassembled")                         \
+_(HANDOFF, "fragments handed off to owning thread")             \
+_(MALFORMED, "malformed fragments")                             \
+_(DUPLICATE, "duplicate fragments")                             \
+_(OVERLAP, "fragments dropped, overlapping fragments")          \
+_(TOO_MANY_REASSEMBLIES, "fragments dropped, too many reassemblies") \
+_(TOO_MANY_FRAGMENTS, "fragments dropped, too many fragments")  \
+_(TIMEOUT, "fragments dropped, reassembly timeout")
+
+typedef enum
+{
+#define _(sym,str) IP_REASS_ERROR_##sym,
+  foreach_ip_reass_error
+#undef _
+    IP_REASS_N_ERROR,
+} ip_reass_error_t;
+
+static char *ip_reass_error_strings[] = {
+#define _(sym,string) string,
+  foreach_ip_reass_error
+#undef _
+};
+
+typedef enum
+{
+  IP_REASS_NEXT_DROP,
+  IP_REASS_NEXT_HANDOFF,
+  IP_REASS_N_NEXT,
+} ip_reass_next_t;
+
+typedef enum
+{
+  IP_REASS_TRACE_PASS,
+  IP_REASS_TRACE_FRAGMENT,
+  IP_REASS_TRACE_REASSEMBLED,
+  IP_REASS_TRACE_HANDOFF,
+  IP_REASS_TRACE_DROP,
+} ip_reass_trace_action_t;
+
+typedef struct
+{
+  u32 owner_thread_index;
+  u16 fragment_first;
+  u16 fragment_last;
+  u8 action;
+} ip_reass_trace_t;
+
+static u8 *
+format_ip_reass_trace (u8 * s, va_list * args)
+{
+  CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
+  CLIB_UNUSED (vlib_node_t * node) = va_arg (*args, vlib_node_t *);
+  ip_reass_trace_t *t = va_arg (*args, ip_reass_trace_t *);
+
+  switch (t->action)
+    {
+    case IP_REASS_TRACE_PASS:
+      return format (s, "not a fragment");
+    case IP_REASS_TRACE_FRAGMENT:
+      s = format (s, "fragment [%u, %u]", t->fragment_first,
+		  t->fragment_last);
+      break;
+    case IP_REASS_TRACE_REASSEMBLED:
+      s = format (s, "fragment [%u, %u], reassembled", t->fragment_first,
+		  t->fragment_last);
+      break;
+    case IP_REASS_TRACE_HANDOFF:
+      s = format (s, "fragment [%u, %u], handoff to thread %u",
+		  t->fragment_first, t->fragment_last,
+		  t->owner_thread_index);
+      break;
+    case IP_REASS_TRACE_DROP:
+      s = format (s, "fragment [%u, %u], dropped", t->fragment_first,
+		  t->fragment_last);
+      break;
+    }
+  return s;
+}
+
+static u8 *
+format_ip_reass_key (u8 * s, va_list * args)
+{
+  ip_reass_key_t *k = va_arg (*args, ip_reass_key_t *);
+
+  if (k->is_ip6)
+    s = format (s, "%U -> %U",
+		format_ip6_address, &k->src.ip6,
+		format_ip6_address, &k->dst.ip6);
+  else
+    s = format (s, "%U -> %U",
+		format_ip4_address, &k->src.ip4,
+		format_ip4_address, &k->dst.ip4);
+
+  return format (s, " fib %u id %u proto %U", k->fib_index, k->frag_id,
+		 format_ip_protocol, k->proto);
+}
+
+/**
+ * Trim a buffer chain to len bytes, freeing trailing buffers, e.g.
+ * those holding only ethernet padding. Returns -1 if the chain is
+ * shorter than len.
+ */
+static int
+ip_reass_trim_chain (vlib_main_t * vm, vlib_buffer_t * first, u32 len)
+{
+  vlib_buffer_t *b = first;
+  u32 n_bytes = 0;
+
+  while (n_bytes + b->current_length < len)
+    {
+      n_bytes += b->current_length;
+      if (!(b->flags & VLIB_BUFFER_NEXT_PRESENT))
+	return -1;
+      b = vlib_get_buffer (vm, b->next_buffer);
+    }
+
+  b->current_length = len - n_bytes;
+  if (b->flags & VLIB_BUFFER_NEXT_PRESENT)
+    {
+      vlib_buffer_free_one (vm, b->next_buffer);
+      b->flags &= ~VLIB_BUFFER_NEXT_PRESENT;
+    }
+
+  first->total_length_not_including_first_buffer =
+    len - first->current_length;
+  first->flags |= VLIB_BUFFER_TOTAL_LENGTH_VALID;
+
+  return 0;
+}
+
+/**
+ * Find the fragment header of an IPv6 packet, walking the extension
+ * headers in the first buffer. Returns 0 if there is none, and sets
+ * next_hdr to the field which names the fragment header.
+ */
+static ip6_frag_hdr_t *
+ip6_reass_find_frag_hdr (vlib_buffer_t * b, ip6_header_t * ip, u8 ** next_hdr)
+{
+  ip6_ext_header_t *e;
+  u8 *end = (u8 *) vlib_buffer_get_current (b) + b->current_length;
+
+  *next_hdr = &ip->protocol;
+  e = (ip6_ext_header_t *) (ip + 1);
+
+  while (**next_hdr != IP_PROTOCOL_IPV6_FRAGMENTATION)
+    {
+      if (!ip6_ext_hdr (**next_hdr) || **next_hdr == IP_PROTOCOL_IPSEC_AH
+	  || (u8 *) (e + 1) > end)
+	return 0;
+      *next_hdr = &e->next_hdr;
+      e = ip6_ext_next_header (e);
+    }
+
+  if ((u8 *) e + sizeof (ip6_frag_hdr_t) > end)
+    return 0;
+
+  return (ip6_frag_hdr_t *) e;
+}
+
+static void
+ip_reass_free (ip_reass_main_t * rm, ip_reass_per_thread_t * rt,
+	       ip_reass_t * r, u32 thread_index)
+{
+  clib_bihash_kv_48_8_t kv;
+  ip_reass_val_t v;
+
+  /*
+   * Two threads may race to create a context for the same datagram,
+   * the loser's context then times out. Don't let it take the winner's
+   * hash entry with it.
+   */
+  clib_memcpy (kv.key, r->key.as_u64, sizeof (kv.key));
+  if (!clib_bihash_search_48_8 (&rm->hash, &kv, &kv))
+    {
+      v.as_u64 = kv.value;
+      if (v.thread_index == thread_index && v.reass_index == r - rt->pool)
+	clib_bihash_add_del_48_8 (&rm->hash, &kv, 0 /* is_add */ );
+    }
+
+  vec_free (r->fragments);
+  pool_put (rt->pool, r);
+}
+
+/** Drop a reassembly and all its fragments */
+static void
+ip_reass_drop (vlib_main_t * vm, vlib_node_runtime_t * node,
+	       ip_reass_main_t * rm, ip_reass_per_thread_t * rt,
+	       ip_reass_t * r, u32 thread_index, u32 error)
+{
+  vlib_node_increment_counter (vm, node->node_index, error,
+			       vec_len (r->fragments));
+  vlib_buffer_free (vm, r->fragments, vec_len (r->fragments));
+  tw_timer_stop_2t_1w_2048sl (&rt->timer_wheel, r->timer_handle);
+  ip_reass_free (rm, rt, r, thread_index);
+}
+
+/**
+ * Find the reassembly context for a key. If another thread owns it,
+ * return 0 and set owner_thread_index. If there is none, create one,
+ * unless this thread already has too many.
+ */
+static ip_reass_t *
+ip_reass_find_or_create (vlib_main_t * vm, ip_reass_main_t * rm,
+			 ip_reass_per_thread_t * rt, ip_reass_key_t * k,
+			 u32 thread_index, u32 * owner_thread_index,
+			 u32 * error)
+{
+  clib_bihash_kv_48_8_t kv;
+  ip_reass_val_t v;
+  ip_reass_t *r;
+
+  clib_memcpy (kv.key, k->as_u64, sizeof (kv.key));
+  if (!clib_bihash_search_48_8 (&rm->hash, &kv, &kv))
+    {
+      v.as_u64 = kv.value;
+      if (v.thread_index != thread_index)
+	{
+	  *owner_thread_index = v.thread_index;
+	  return 0;
+	}
+      if (!pool_is_free_index (rt->pool, v.reass_index))
+	{
+	  r = pool_elt_at_index (rt->pool, v.reass_index);
+	  if (!memcmp (&r->key, k, sizeof (*k)))
+	    return r;
+	}
+    }
+
+  if (pool_elts (rt->pool) >= rm->max_reassemblies)
+    {
+      *error = IP_REASS_ERROR_TOO_MANY_REASSEMBLIES;
+      return 0;
+    }
+
+  /* The expire node does not run while there is nothing to expire,
+   * skip over the idle time or the new timer would fire at once */
+  if (pool_elts (rt->pool) == 0)
+    {
+      rt->timer_wheel.last_run_time = vlib_time_now (vm);
+      rt->timer_wheel.next_run_time =
+	rt->timer_wheel.last_run_time + IP_REASS_TIMER_INTERVAL;
+    }
+
+  pool_get (rt->pool, r);
+  memset (r, 0, sizeof (*r));
+  r->key = *k;
+  r->last_octet = ~0;
+  r->first_seen = vlib_time_now (vm);
+  r->timer_handle = tw_timer_start_2t_1w_2048sl (&rt->timer_wheel,
+						  r - rt->pool, 0,
+						  1 + rm->timeout_ms * 1e-3 /
+						  IP_REASS_TIMER_INTERVAL);
+
+  v.reass_index = r - rt->pool;
+  v.thread_index = thread_index;
+  kv.value = v.as_u64;
+  clib_bihash_add_del_48_8 (&rm->hash, &kv, 1 /* is_add */ );
+
+  return r;
+}
+
+/**
+ * Add a fragment, whose offsets are in the buffer opaque, to a
+ * reassembly. Returns IP_REASS_ERROR_NONE if the fragment was taken,
+ * IP_REASS_ERROR_DUPLICATE if only the fragment is to be dropped, and
+ * another error if the whole reassembly is to be dropped.
+ */
+static u32
+ip_reass_add_fragment (vlib_main_t * vm, ip_reass_main_t * rm,
+		       ip_reass_t * r, u32 bi, int more_fragments)
+{
+  vlib_buffer_t *b = vlib_get_buffer (vm, bi);
+  u32 first = vnet_buffer (b)->reass.fragment_first;
+  u32 last = vnet_buffer (b)->reass.fragment_last;
+  vlib_buffer_t *prev, *next;
+  int i;
+
+  if (vec_len (r->fragments) >= rm->max_fragments)
+    return IP_REASS_ERROR_TOO_MANY_FRAGMENTS;
+
+  /* Fragments mostly arrive in order, look for the slot from the end */
+  for (i = vec_len (r->fragments); i > 0; i--)
+    {
+      prev = vlib_get_buffer (vm, r->fragments[i - 1]);
+      if (vnet_buffer (prev)->reass.fragment_first <= first)
+	break;
+    }
+
+  if (i > 0)
+    {
+      prev = vlib_get_buffer (vm, r->fragments[i - 1]);
+      if (vnet_buffer (prev)->reass.fragment_first == first
+	  && vnet_buffer (prev)->reass.fragment_last == last)
+	return IP_REASS_ERROR_DUPLICATE;
+      if (vnet_buffer (prev)->reass.fragment_last >= first)
+	return IP_REASS_ERROR_OVERLAP;
+    }
+  if (i < vec_len (r->fragments))
+    {
+      next = vlib_get_buffer (vm, r->fragments[i]);
+      if (vnet_buffer (next)->reass.fragment_first <= last)
+	return IP_REASS_ERROR_OVERLAP;
+    }
+
+  if (!more_fragments)
+    {
+      if (r->last_octet != ~0 && r->last_octet != last)
+	return IP_REASS_ERROR_MALFORMED;
+      /* i is the last slot iff no fragment lies beyond this one */
+      if (i != vec_len (r->fragments))
+	return IP_REASS_ERROR_MALFORMED;
+      r->last_octet = last;
+    }
+  else if (r->last_octet != ~0 && last >= r->last_octet)
+    return IP_REASS_ERROR_MALFORMED;
+
+  vec_insert_elts (r->fragments, &bi, 1, i);
+  r->data_len += last - first + 1;
+
+  return IP_REASS_ERROR_NONE;
+}
+
+always_inline int
+ip_reass_is_complete (ip_reass_t * r)
+{
+  /* fragments don't overlap, so the payload is complete iff it adds up */
+  return (r->last_octet != ~0 && r->data_len == r->last_octet + 1);
+}
+
+/**
+ * Link the fragments of a complete reassembly behind the first one
+ * and return the first fragment's buffer index. Its header is fixed up
+ * by the caller.
+ */
+static u32
+ip_reass_link_fragments (vlib_main_t * vm, ip_reass_t * r)
+{
+  vlib_buffer_t *first, *b, *last;
+  u32 i, n_bytes;
+
+  first = vlib_get_buffer (vm, r->fragments[0]);
+  n_bytes = vlib_buffer_length_in_chain (vm, first) - first->current_length;
+
+  last = first;
+  for (i = 1; i < vec_len (r->fragments); i++)
+    {
+      while (last->flags & VLIB_BUFFER_NEXT_PRESENT)
+	last = vlib_get_buffer (vm, last->next_buffer);
+
+      b = vlib_get_buffer (vm, r->fragments[i]);
+      n_bytes += vlib_buffer_length_in_chain (vm, b);
+
+      last->next_buffer = r->fragments[i];
+      last->flags |= VLIB_BUFFER_NEXT_PRESENT;
+      last = b;
+    }
+
+  first->total_length_not_including_first_buffer = n_bytes;
+  first->flags |= VLIB_BUFFER_TOTAL_LENGTH_VALID;
+
+  return r->fragments[0];
+}
+
+static u32
+ip4_reass_finalize (vlib_main_t * vm, ip_reass_t * r)
+{
+  vlib_buffer_t *b;
+  ip4_header_t *ip;
+  u32 bi;
+
+  bi = ip_reass_link_fragments (vm, r);
+  b = vlib_get_buffer (vm, bi);
+  ip = vlib_buffer_get_current (b);
+
+  ip->length = clib_host_to_net_u16 (ip4_header_bytes (ip) + r->data_len);
+  ip->flags_and_fragment_offset &=
+    clib_host_to_net_u16 (IP4_HEADER_FLAG_DONT_FRAGMENT);
+  ip->checksum = ip4_header_checksum (ip);
+
+  return bi;
+}
+
+static u32
+ip6_reass_finalize (vlib_main_t * vm, ip_reass_t * r)
+{
+  ip6_frag_hdr_t *frag;
+  vlib_buffer_t *b;
+  ip6_header_t *ip;
+  u8 *next_hdr;
+  u16 frag_hdr_offset;
+  u32 bi;
+
+  bi = ip_reass_link_fragments (vm, r);
+  b = vlib_get_buffer (vm, bi);
+  ip = vlib_buffer_get_current (b);
+  frag_hdr_offset = vnet_buffer (b)->reass.ip6_frag_hdr_offset;
+
+  /* Remove the fragment header: slide the unfragmentable part over it */
+  frag = ip6_reass_find_frag_hdr (b, ip, &next_hdr);
+  ASSERT ((u8 *) frag - (u8 *) ip == frag_hdr_offset);
+  *next_hdr = frag->next_hdr;
+  memmove ((u8 *) ip + sizeof (*frag), ip, frag_hdr_offset);
+  vlib_buffer_advance (b, sizeof (*frag));
+
+  ip = vlib_buffer_get_current (b);
+  ip->payload_length =
+    clib_host_to_net_u16 (frag_hdr_offset - sizeof (*ip) + r->data_len);
+
+  return bi;
+}
+
+/**
+ * Parse an IPv4 packet. Returns 0 if it's not a fragment, else fills in
+ * the key and the fragment offsets, and the number of header bytes to
+ * strip once the fragment is added to a reassembly (none for the first
+ * fragment). Sets error on malformed fragments.
+ */
+always_inline int
+ip4_reass_parse (vlib_main_t * vm, vlib_buffer_t * b, ip_reass_key_t * k,
+		 int *more_fragments, u32 * strip, u32 * error)
+{
+  ip4_header_t *ip = vlib_buffer_get_current (b);
+  u32 header_bytes, payload_bytes, first;
+
+  if (!ip4_is_fragment (ip))
+    return 0;
+
+  header_bytes = ip4_header_bytes (ip);
+  payload_bytes = clib_net_to_host_u16 (ip->length) - header_bytes;
+  first = ip4_get_fragment_offset_bytes (ip);
+  *more_fragments = ip4_get_fragment_more (ip) != 0;
+  vnet_buffer (b)->reass.fragment_first = first;
+  vnet_buffer (b)->reass.fragment_last = first + payload_bytes - 1;
+
+  if (clib_net_to_host_u16 (ip->length) <= header_bytes
+      || (*more_fragments && (payload_bytes & 7))
+      || first + payload_bytes > 0xffff - header_bytes
+      || ip_reass_trim_chain (vm, b, clib_net_to_host_u16 (ip->length)))
+    {
+      *error = IP_REASS_ERROR_MALFORMED;
+      return 1;
+    }
+
+  memset (k, 0, sizeof (*k));
+  k->src.ip4.as_u32 = ip->src_address.as_u32;
+  k->dst.ip4.as_u32 = ip->dst_address.as_u32;
+  k->fib_index = vec_elt (ip4_main.fib_index_by_sw_if_index,
+			  vnet_buffer (b)->sw_if_index[VLIB_RX]);
+  k->frag_id = ip->fragment_id;
+  k->proto = ip->protocol;
+
+  *strip = first ? header_bytes : 0;
+
+  return 1;
+}
+
+always_inline int
+ip6_reass_parse (vlib_main_t * vm, vlib_buffer_t * b, ip_reass_key_t * k,
+		 int *more_fragments, u32 * strip, u32 * error)
+{
+  ip6_header_t *ip = vlib_buffer_get_current (b);
+  u32 frag_hdr_offset, payload_bytes, first;
+  ip6_frag_hdr_t *frag;
+  u8 *next_hdr;
+
+  frag = ip6_reass_find_frag_hdr (b, ip, &next_hdr);
+  if (!frag)
+    return 0;
+
+  frag_hdr_offset = (u8 *) frag - (u8 *) ip;
+  payload_bytes = sizeof (*ip) + clib_net_to_host_u16 (ip->payload_length)
+    - frag_hdr_offset - sizeof (*frag);
+  first = ip6_frag_hdr_offset (frag) << 3;
+  *more_fragments = ip6_frag_hdr_more (frag);
+  vnet_buffer (b)->reass.fragment_first = first;
+  vnet_buffer (b)->reass.fragment_last = first + payload_bytes - 1;
+  vnet_buffer (b)->reass.ip6_frag_hdr_offset = frag_hdr_offset;
+
+  if (sizeof (*ip) + clib_net_to_host_u16 (ip->payload_length) <=
+      frag_hdr_offset + sizeof (*frag)
+      || (*more_fragments && (payload_bytes & 7))
+      || first + payload_bytes > 0xffff
+      || ip_reass_trim_chain (vm, b, sizeof (*ip) +
+			      clib_net_to_host_u16 (ip->payload_length)))
+    {
+      *error = IP_REASS_ERROR_MALFORMED;
+      return 1;
+    }
+
+  memset (k, 0, sizeof (*k));
+  k->src.ip6.as_u64[0] = ip->src_address.as_u64[0];
+  k->src.ip6.as_u64[1] = ip->src_address.as_u64[1];
+  k->dst.ip6.as_u64[0] = ip->dst_address.as_u64[0];
+  k->dst.ip6.as_u64[1] = ip->dst_address.as_u64[1];
+  k->fib_index = vec_elt (ip6_main.fib_index_by_sw_if_index,
+			  vnet_buffer (b)->sw_if_index[VLIB_RX]);
+  k->frag_id = frag->identification;
+  k->proto = frag->next_hdr;
+  k->is_ip6 = 1;
+
+  *strip = first ? frag_hdr_offset + sizeof (*frag) : 0;
+
+  return 1;
+}
+
+always_inline uword
+ip_reass_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
+		 vlib_frame_t * frame, int is_ip6)
+{
+  ip_reass_main_t *rm = &ip_reass_main;
+  u32 thread_index = vlib_get_thread_index ();
+  ip_reass_per_thread_t *rt = &rm->per_thread_data[thread_index];
+  u32 n_left_from, *from, *to_next, next_index;
+  u32 n_fragments = 0, n_reassembled = 0, n_handoff = 0;
+
+  from = vlib_frame_vector_args (frame);
+  n_left_from = frame->n_vectors;
+  next_index = node->cached_next_index;
+
+  while (n_left_from > 0)
+    {
+      u32 n_left_to_next;
+
+      vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
+
+      while (n_left_from > 0 && n_left_to_next > 0)
+	{
+	  u32 bi0, next0, error0 = IP_REASS_ERROR_NONE;
+	  u32 owner_thread_index0 = thread_index;
+	  u8 action0 = IP_REASS_TRACE_FRAGMENT;
+	  int is_fragment0, more_fragments0 = 0;
+	  u32 strip0 = 0;
+	  vlib_buffer_t *b0;
+	  ip_reass_key_t k0;
+	  ip_reass_t *r0;
+
+	  bi0 = from[0];
+	  from += 1;
+	  n_left_from -= 1;
+
+	  b0 = vlib_get_buffer (vm, bi0);
+
+	  if (is_ip6)
+	    is_fragment0 = ip6_reass_parse (vm, b0, &k0, &more_fragments0,
+					    &strip0, &error0);
+	  else
+	    is_fragment0 = ip4_reass_parse (vm, b0, &k0, &more_fragments0,
+					    &strip0, &error0);
+
+	  if (!is_fragment0)
+	    {
+	      action0 = IP_REASS_TRACE_PASS;
+	      vnet_feature_next (vnet_buffer (b0)->sw_if_index[VLIB_RX],
+				 &next0, b0);
+	      goto enqueue0;
+	    }
+
+	  n_fragments++;
+	  if (error0 != IP_REASS_ERROR_NONE)
+	    goto drop0;
+
+	  r0 = ip_reass_find_or_create (vm, rm, rt, &k0, thread_index,
+					&owner_thread_index0, &error0);
+	  if (!r0)
+	    {
+	      if (error0 != IP_REASS_ERROR_NONE)
+		goto drop0;
+
+	      /* The reassembly lives on another thread */
+	      vnet_buffer (b0)->reass.owner_thread_index =
+		owner_thread_index0;
+	      action0 = IP_REASS_TRACE_HANDOFF;
+	      next0 = IP_REASS_NEXT_HANDOFF;
+	      n_handoff++;
+	      goto enqueue0;
+	    }
+
+	  /* Only the first fragment keeps its header */
+	  vlib_buffer_advance (b0, strip0);
+	  error0 = ip_reass_add_fragment (vm, rm, r0, bi0, more_fragments0);
+	  if (error0 != IP_REASS_ERROR_NONE)
+	    {
+	      if (error0 != IP_REASS_ERROR_DUPLICATE)
+		ip_reass_drop (vm, node, rm, rt, r0, thread_index, error0);
+	      goto drop0;
+	    }
+
+	  if (!ip_reass_is_complete (r0))
+	    {
+	      /* the fragment is held by the reassembly */
+	      if (PREDICT_FALSE (b0->flags & VLIB_BUFFER_IS_TRACED))
+		{
+		  ip_reass_trace_t *t =
+		    vlib_add_trace (vm, node, b0, sizeof (*t));
+		  t->owner_thread_index = thread_index;
+		  t->fragment_first = vnet_buffer (b0)->reass.fragment_first;
+		  t->fragment_last = vnet_buffer (b0)->reass.fragment_last;
+		  t->action = IP_REASS_TRACE_FRAGMENT;
+		}
+	      continue;
+	    }
+
+	  /* Continue with the reassembled datagram in place of b0 */
+	  if (is_ip6)
+	    bi0 = ip6_reass_finalize (vm, r0);
+	  else
+	    bi0 = ip4_reass_finalize (vm, r0);
+	  tw_timer_stop_2t_1w_2048sl (&rt->timer_wheel, r0->timer_handle);
+	  ip_reass_free (rm, rt, r0, thread_index);
+	  n_reassembled++;
+
+	  b0 = vlib_get_buffer (vm, bi0);
+	  action0 = IP_REASS_TRACE_REASSEMBLED;
+	  vnet_feature_next (vnet_buffer (b0)->sw_if_index[VLIB_RX], &next0,
+			     b0);
+	  goto enqueue0;
+
+	drop0:
+	  action0 = IP_REASS_TRACE_DROP;
+	  b0->error = node->errors[error0];
+	  next0 = IP_REASS_NEXT_DROP;
+
+	enqueue0:
+	  if (PREDICT_FALSE (b0->flags & VLIB_BUFFER_IS_TRACED))
+	    {
+	      ip_reass_trace_t *t = vlib_add_trace (vm, node, b0, sizeof (*t));
+	      t->owner_thread_index = owner_thread_index0;
+	      t->fragment_first = vnet_buffer (b0)->reass.fragment_first;
+	      t->fragment_last = vnet_buffer (b0)->reass.fragment_last;
+	      t->action = action0;
+	    }
+
+	  to_next[0] = bi0;
+	  to_next += 1;
+	  n_left_to_next -= 1;
+	  vlib_validate_buffer_enqueue_x1 (vm, node, next_index, to_next,
+					   n_left_to_next, bi0, next0);
+	}
+
+      vlib_put_next_frame (vm, node, next_index, n_left_to_next);
+    }
+
+  vlib_node_increment_counter (vm, node->node_index, IP_REASS_ERROR_NONE,
+			       n_fragments);
+  vlib_node_increment_counter (vm, node->node_index,
+			       IP_REASS_ERROR_REASSEMBLED, n_reassembled);
+  vlib_node_increment_counter (vm, node->node_index, IP_REASS_ERROR_HANDOFF,
+			       n_handoff);
+
+  return frame->n_vectors;
+}
+
+static uword
+ip4_reass (vlib_main_t * vm, vlib_node_runtime_t * node, vlib_frame_t * frame)
+{
+  return ip_reass_inline (vm, node, frame, 0 /* is_ip6 */ );
+}
+
+static uword
+ip6_reass (vlib_main_t * vm, vlib_node_runtime_t * node, vlib_frame_t * frame)
+{
+  return ip_reass_inline (vm, node, frame, 1 /* is_ip6 */ );
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (ip4_reass_node) = {
+  .function = ip4_reass,
+  .name = "ip4-reassembly",
+  .vector_size = sizeof (u32),
+  .format_trace = format_ip_reass_trace,
+  .n_errors = ARRAY_LEN (ip_reass_error_strings),
+  .error_strings = ip_reass_error_strings,
+  .n_next_nodes = IP_REASS_N_NEXT,
+  .next_nodes = {
+    [IP_REASS_NEXT_DROP] = "error-drop",
+    [IP_REASS_NEXT_HANDOFF] = "ip4-reassembly-handoff",
+  },
+};
+
+VLIB_NODE_FUNCTION_MULTIARCH (ip4_reass_node, ip4_reass);
+
+VLIB_REGISTER_NODE (ip6_reass_node) = {
+  .function = ip6_reass,
+  .name = "ip6-reassembly",
+  .vector_size = sizeof (u32),
+  .format_trace = format_ip_reass_trace,
+  .n_errors = ARRAY_LEN (ip_reass_error_strings),
+  .error_strings = ip_reass_error_strings,
+  .n_next_nodes = IP_REASS_N_NEXT,
+  .next_nodes = {
+    [IP_REASS_NEXT_DROP] = "error-drop",
+    [IP_REASS_NEXT_HANDOFF] = "ip6-reassembly-handoff",
+  },
+};
+
+VLIB_NODE_FUNCTION_MULTIARCH (ip6_reass_node, ip6_reass);
+
+VNET_FEATURE_INIT (ip4_reass_feature, static) = {
+  .arc_name = "ip4-unicast",
+  .node_name = "ip4-reassembly",
+  .runs_before = VNET_FEATURES ("ip4-flow-classify"),
+};
+
+VNET_FEATURE_INIT (ip6_reass_feature, static) = {
+  .arc_name = "ip6-unicast",
+  .node_name = "ip6-reassembly",
+  .runs_before = VNET_FEATURES ("ip6-flow-classify"),
+};
+/* *INDENT-ON* */
+
+/**
+ * Ship fragments to the thread which owns their reassembly, where they
+ * re-enter the reassembly node.
+ */
+always_inline uword
+ip_reass_handoff_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
+			 vlib_frame_t * frame, int is_ip6)
+{
+  ip_reass_main_t *rm = &ip_reass_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  static __thread vlib_frame_queue_elt_t **handoff_queue_elt_by_thread_index;
+  vlib_frame_queue_elt_t *hf = 0;
+  u32 n_left_from, *from;
+  u32 n_left_to_next_thread = 0, *to_next_thread = 0;
+  u32 current_thread_index = ~0;
+  int i;
+
+  if (PREDICT_FALSE (handoff_queue_elt_by_thread_index == 0))
+    vec_validate (handoff_queue_elt_by_thread_index, tm->n_vlib_mains - 1);
+
+  from = vlib_frame_vector_args (frame);
+  n_left_from = frame->n_vectors;
+
+  while (n_left_from > 0)
+    {
+      u32 bi0, owner_thread_index0;
+      vlib_buffer_t *b0;
+
+      bi0 = from[0];
+      from += 1;
+      n_left_from -= 1;
+
+      b0 = vlib_get_buffer (vm, bi0);
+      owner_thread_index0 = vnet_buffer (b0)->reass.owner_thread_index;
+
+      if (owner_thread_index0 != current_thread_index)
+	{
+	  if (hf)
+	    hf->n_vectors = VLIB_FRAME_SIZE - n_left_to_next_thread;
+
+	  hf = vlib_get_worker_handoff_queue_elt (rm->fq_index[is_ip6],
+						  owner_thread_index0,
+						  handoff_queue_elt_by_thread_index);
+
+	  n_left_to_next_thread = VLIB_FRAME_SIZE - hf->n_vectors;
+	  to_next_thread = &hf->buffer_index[hf->n_vectors];
+	  current_thread_index = owner_thread_index0;
+	}
+
+      to_next_thread[0] = bi0;
+      to_next_thread++;
+      n_left_to_next_thread--;
+
+      if (n_left_to_next_thread == 0)
+	{
+	  hf->n_vectors = VLIB_FRAME_SIZE;
+	  vlib_put_frame_queue_elt (hf);
+	  current_thread_index = ~0;
+	  handoff_queue_elt_by_thread_index[owner_thread_index0] = 0;
+	  hf = 0;
+	}
+    }
+
+  if (hf)
+    hf->n_vectors = VLIB_FRAME_SIZE - n_left_to_next_thread;
+
+  /* Ship frames to the owning threads */
+  for (i = 0; i < vec_len (handoff_queue_elt_by_thread_index); i++)
+    {
+      if (handoff_queue_elt_by_thread_index[i])
+	{
+	  vlib_put_frame_queue_elt (handoff_queue_elt_by_thread_index[i]);
+	  handoff_queue_elt_by_thread_index[i] = 0;
+	}
+    }
+
+  return frame->n_vectors;
+}
+
+static uword
+ip4_reass_handoff (vlib_main_t * vm, vlib_node_runtime_t * node,
+		   vlib_frame_t * frame)
+{
+  return ip_reass_handoff_inline (vm, node, frame, 0 /* is_ip6 */ );
+}
+
+static uword
+ip6_reass_handoff (vlib_main_t * vm, vlib_node_runtime_t * node,
+		   vlib_frame_t * frame)
+{
+  return ip_reass_handoff_inline (vm, node, frame, 1 /* is_ip6 */ );
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (ip4_reass_handoff_node, static) = {
+  .function = ip4_reass_handoff,
+  .name = "ip4-reassembly-handoff",
+  .vector_size = sizeof (u32),
+  .n_next_nodes = 1,
+  .next_nodes = {
+    [0] = "error-drop",
+  },
+};
+
+VLIB_REGISTER_NODE (ip6_reass_handoff_node, static) = {
+  .function = ip6_reass_handoff,
+  .name = "ip6-reassembly-handoff",
+  .vector_size = sizeof (u32),
+  .n_next_nodes = 1,
+  .next_nodes = {
+    [0] = "error-drop",
+  },
+};
+/* *INDENT-ON* */
+
+/**
+ * Per-thread input node, run on interrupt from the expire walk
+ * process, which drops reassemblies whose timer has fired.
+ */
+static uword
+ip_reass_expire (vlib_main_t * vm, vlib_node_runtime_t * node,
+		 vlib_frame_t * frame)
+{
+  ip_reass_main_t *rm = &ip_reass_main;
+  u32 thread_index = vlib_get_thread_index ();
+  ip_reass_per_thread_t *rt = &rm->per_thread_data[thread_index];
+  u32 *expired, *handle, n_dropped = 0;
+  ip_reass_t *r;
+
+  expired = tw_timer_expire_timers_2t_1w_2048sl (&rt->timer_wheel,
+						 vlib_time_now (vm));
+
+  vec_foreach (handle, expired)
+  {
+    /* the top bit of the handle is the timer id */
+    u32 reass_index = *handle & 0x7fffffff;
+
+    if (pool_is_free_index (rt->pool, reass_index))
+      continue;
+
+    r = pool_elt_at_index (rt->pool, reass_index);
+    n_dropped += vec_len (r->fragments);
+    vlib_buffer_free (vm, r->fragments, vec_len (r->fragments));
+    ip_reass_free (rm, rt, r, thread_index);
+  }
+
+  vlib_node_increment_counter (vm, node->node_index, IP_REASS_ERROR_TIMEOUT,
+			       n_dropped);
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (ip_reass_expire_node) = {
+  .function = ip_reass_expire,
+  .name = "ip-reassembly-expire",
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_INTERRUPT,
+  .n_errors = ARRAY_LEN (ip_reass_error_strings),
+  .error_strings = ip_reass_error_strings,
+};
+/* *INDENT-ON* */
+
+/**
+ * Tick the timer wheels: interrupt the expire node on every thread
+ * which has reassemblies in progress.
+ */
+static uword
+ip_reass_walk_expired (vlib_main_t * vm, vlib_node_runtime_t * rt,
+		       vlib_frame_t * f)
+{
+  ip_reass_main_t *rm = &ip_reass_main;
+  f64 sleep_duration;
+  int i;
+
+  while (1)
+    {
+      sleep_duration = 100 * IP_REASS_TIMER_INTERVAL;
+
+      if (rm->initialized)
+	{
+	  for (i = 0; i < vec_len (rm->per_thread_data); i++)
+	    {
+	      vlib_main_t *this_vm = vlib_mains ? vlib_mains[i] : vm;
+
+	      if (!this_vm || !pool_elts (rm->per_thread_data[i].pool))
+		continue;
+
+	      vlib_node_set_interrupt_pending (this_vm,
+					       ip_reass_expire_node.index);
+	      sleep_duration = IP_REASS_TIMER_INTERVAL;
+	    }
+	}
+
+      vlib_process_suspend (vm, sleep_duration);
+    }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (ip_reass_walk_expired_node, static) = {
+  .function = ip_reass_walk_expired,
+  .name = "ip-reassembly-expire-walk",
+  .type = VLIB_NODE_TYPE_PROCESS,
+};
+/* *INDENT-ON* */
+
+static void
+ip_reass_init_data (ip_reass_main_t * rm)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  int i;
+
+  clib_bihash_init_48_8 (&rm->hash, "ip-reassembly",
+			 IP_REASS_HASH_NBUCKETS, IP_REASS_HASH_MEMORY);
+
+  /* never resized, the timer wheels must not move */
+  vec_validate_aligned (rm->per_thread_data, tm->n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
+  for (i = 0; i < vec_len (rm->per_thread_data); i++)
+    tw_timer_wheel_init_2t_1w_2048sl (&rm->per_thread_data[i].timer_wheel,
+				      0 /* no callback */ ,
+				      IP_REASS_TIMER_INTERVAL, ~0);
+
+  rm->initialized = 1;
+}
+
+int
+ip_reass_enable_disable (u32 sw_if_index, u8 is_ip6, int enable)
+{
+  ip_reass_main_t *rm = &ip_reass_main;
+
+  if (enable && !rm->initialized)
+    ip_reass_init_data (rm);
+
+  if (enable && rm->fq_index[is_ip6] == ~0 && vlib_num_workers ())
+    rm->fq_index[is_ip6] =
+      vlib_frame_queue_main_init (is_ip6 ? ip6_reass_node.index :
+				  ip4_reass_node.index, 0);
+
+  return vnet_feature_enable_disable (is_ip6 ? "ip6-unicast" : "ip4-unicast",
+				      is_ip6 ? "ip6-reassembly" :
+				      "ip4-reassembly", sw_if_index, enable,
+				      0, 0);
+}
+
+int
+ip_reass_set_params (u32 timeout_ms, u32 max_reassemblies, u32 max_fragments)
+{
+  ip_reass_main_t *rm = &ip_reass_main;
+
+  if (timeout_ms == 0 || timeout_ms > IP_REASS_TIMEOUT_MAX_MS
+      || max_reassemblies == 0 || max_fragments == 0)
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  rm->timeout_ms = timeout_ms;
+  rm->max_reassemblies = max_reassemblies;
+  rm->max_fragments = max_fragments;
+
+  return 0;
+}
+
+static clib_error_t *
+set_interface_reassembly_command_fn (vlib_main_t * vm,
+				     unformat_input_t * input,
+				     vlib_cli_command_t * cmd)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  unformat_input_t _line_input, *line_input = &_line_input;
+  u32 sw_if_index = ~0;
+  int ip4 = 0, ip6 = 0, enable = 1, rv = 0;
+  clib_error_t *error = 0;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "%U", unformat_vnet_sw_interface, vnm,
+		    &sw_if_index))
+	;
+      else if (unformat (line_input, "ip4"))
+	ip4 = 1;
+      else if (unformat (line_input, "ip6"))
+	ip6 = 1;
+      else if (unformat (line_input, "disable"))
+	enable = 0;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (sw_if_index == ~0)
+    {
+      error = clib_error_return (0, "interface required");
+      goto done;
+    }
+
+  if (!ip4 && !ip6)
+    ip4 = ip6 = 1;
+
+  if (ip4)
+    rv = ip_reass_enable_disable (sw_if_index, 0 /* is_ip6 */ , enable);
+  if (!rv && ip6)
+    rv = ip_reass_enable_disable (sw_if_index, 1 /* is_ip6 */ , enable);
+
+  if (rv)
+    error = clib_error_return (0, "failed to %s reassembly, error %d",
+			       enable ? "enable" : "disable", rv);
+
+done:
+  unformat_free (line_input);
+  return error;
+}
+
+/*?
+ * Enable or disable full reassembly of IPv4 and/or IPv6 fragments
+ * received on an interface. Reassembled datagrams continue down the
+ * unicast feature arc, so that features such as NAT or ACLs see whole
+ * datagrams. Both address families are affected unless one is named.
+ *
+ * @cliexpar
+ * @cliexcmd{set interface reassembly GigabitEthernet2/0/0 ip4}
+ * @cliexcmd{set interface reassembly GigabitEthernet2/0/0 disable}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_interface_reassembly_command, static) = {
+  .path = "set interface reassembly",
+  .short_help =
+    "set interface reassembly <interface> [ip4] [ip6] [disable]",
+  .function = set_interface_reassembly_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+set_ip_reassembly_command_fn (vlib_main_t * vm,
+			      unformat_input_t * input,
+			      vlib_cli_command_t * cmd)
+{
+  ip_reass_main_t *rm = &ip_reass_main;
+  u32 timeout_ms = rm->timeout_ms;
+  u32 max_reassemblies = rm->max_reassemblies;
+  u32 max_fragments = rm->max_fragments;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "timeout %u", &timeout_ms))
+	;
+      else if (unformat (input, "max-reassemblies %u", &max_reassemblies))
+	;
+      else if (unformat (input, "max-fragments %u", &max_fragments))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (ip_reass_set_params (timeout_ms, max_reassemblies, max_fragments))
+    return clib_error_return (0, "invalid value, timeout must be 1 to %u ms",
+			      IP_REASS_TIMEOUT_MAX_MS);
+
+  return 0;
+}
+
+/*?
+ * Set the IP reassembly parameters: the time, in milliseconds, after
+ * which an incomplete datagram is dropped, the maximum number of
+ * datagrams being reassembled per thread, and the maximum number of
+ * fragments per datagram.
+ *
+ * @cliexpar
+ * @cliexcmd{set ip reassembly timeout 200 max-reassemblies 4096}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_ip_reassembly_command, static) = {
+  .path = "set ip reassembly",
+  .short_help = "set ip reassembly [timeout <ms>] [max-reassemblies <n>] "
+    "[max-fragments <n>]",
+  .function = set_ip_reassembly_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_ip_reassembly_command_fn (vlib_main_t * vm,
+			       unformat_input_t * input,
+			       vlib_cli_command_t * cmd)
+{
+  ip_reass_main_t *rm = &ip_reass_main;
+  f64 now = vlib_time_now (vm);
+  int verbose = 0, i;
+  ip_reass_t *r;
+
+  if (unformat (input, "verbose"))
+    verbose = 1;
+
+  vlib_cli_output (vm, "timeout %u ms, max %u reassemblies per thread, "
+		   "max %u fragments per reassembly",
+		   rm->timeout_ms, rm->max_reassemblies, rm->max_fragments);
+
+  if (!rm->initialized)
+    return 0;
+
+  for (i = 0; i < vec_len (rm->per_thread_data); i++)
+    {
+      ip_reass_per_thread_t *rt = &rm->per_thread_data[i];
+
+      vlib_cli_output (vm, "thread %d: %u reassemblies in progress", i,
+		       pool_elts (rt->pool));
+      if (!verbose)
+	continue;
+
+      /* *INDENT-OFF* */
+      pool_foreach (r, rt->pool,
+      ({
+        vlib_cli_output (vm, "  [%u] %U: %u fragments, %u bytes, "
+                         "last octet %d, age %.3fs",
+                         r - rt->pool, format_ip_reass_key, &r->key,
+                         vec_len (r->fragments), r->data_len,
+                         r->last_octet, now - r->first_seen);
+      }));
+      /* *INDENT-ON* */
+    }
+
+  return 0;
+}
+
+/*?
+ * Show the IP reassembly parameters and the number of reassemblies in
+ * progress on each thread, with <em>verbose</em> also the reassemblies
+ * themselves.
+ *
+ * @cliexpar
+ * @cliexcmd{show ip reassembly verbose}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_ip_reassembly_command, static) = {
+  .path = "show ip reassembly",
+  .short_help = "show ip reassembly [verbose]",
+  .function = show_ip_reassembly_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+ip_reass_init (vlib_main_t * vm)
+{
+  ip_reass_main_t *rm = &ip_reass_main;
+
+  rm->timeout_ms = IP_REASS_TIMEOUT_DEFAULT_MS;
+  rm->max_reassemblies = IP_REASS_MAX_REASSEMBLIES_DEFAULT;
+  rm->max_fragments = IP_REASS_MAX_FRAGMENTS_DEFAULT;
+  rm->fq_index[0] = rm->fq_index[1] = ~0;
+
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (ip_reass_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * IPv4 and IPv6 Full Reassembly
+ *
+ * The ip4-reassembly and ip6-reassembly nodes sit on the ip4-unicast
+ * and ip6-unicast feature arcs. Non-fragmented packets pass straight
+ * through. Fragments are held until the whole datagram has arrived;
+ * the fragments are then chained, without copying, behind the first
+ * fragment, whose header is rewritten to describe the whole datagram,
+ * and the result continues down the feature arc.
+ *
+ * Reassembly contexts live in per-thread pools. A global bihash maps
+ * (fib index, src, dst, fragment id, protocol) to the owning thread
+ * and context, so that fragments which RSS delivers to another worker
+ * are handed off to the owner. Contexts expire via a per-thread timer
+ * wheel. The number of contexts per thread and of fragments per
+ * context is bounded.
+ */
+
+#ifndef included_ip_reassembly_h
+#define included_ip_reassembly_h
+
+#include <vnet/vnet.h>
+#include <vnet/ip/ip.h>
+#include <vppinfra/bihash_48_8.h>
+#include <vppinfra/tw_timer_2t_1w_2048sl.h>
+
+#define IP_REASS_TIMEOUT_DEFAULT_MS 100
+#define IP_REASS_TIMEOUT_MAX_MS 20000
+#define IP_REASS_MAX_REASSEMBLIES_DEFAULT 1024
+#define IP_REASS_MAX_FRAGMENTS_DEFAULT 64
+
+/* Timer wheel tick, seconds */
+#define IP_REASS_TIMER_INTERVAL 10e-3
+
+typedef union
+{
+  struct
+  {
+    ip46_address_t src;
+    ip46_address_t dst;
+    u32 fib_index;
+    u32 frag_id;
+    u8 proto;
+    u8 is_ip6;
+    u8 pad[6];
+  };
+  u64 as_u64[6];
+} ip_reass_key_t;
+
+typedef union
+{
+  struct
+  {
+    u32 reass_index;
+    u32 thread_index;
+  };
+  u64 as_u64;
+} ip_reass_val_t;
+
+typedef struct
+{
+  /* hash key, needed to remove the context from the hash */
+  ip_reass_key_t key;
+  /* fragment buffers, sorted by fragment offset */
+  u32 *fragments;
+  /* sum of the payload bytes of all fragments */
+  u32 data_len;
+  /* offset of the last payload byte, known once the last fragment
+     (the one without the more-fragments flag) has arrived, else ~0 */
+  u32 last_octet;
+  u32 timer_handle;
+  f64 first_seen;
+} ip_reass_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  ip_reass_t *pool;
+  tw_timer_wheel_2t_1w_2048sl_t timer_wheel;
+} ip_reass_per_thread_t;
+
+typedef struct
+{
+  /* configuration */
+  u32 timeout_ms;
+  u32 max_reassemblies;
+  u32 max_fragments;
+
+  /* (key) -> (thread, context), shared by all threads */
+  clib_bihash_48_8_t hash;
+
+  ip_reass_per_thread_t *per_thread_data;
+
+  /* worker handoff frame queues, per address family */
+  u32 fq_index[2];
+
+
+  u8 initialized;
+} ip_reass_main_t;
+
+extern ip_reass_main_t ip_reass_main;
+
+extern vlib_node_registration_t ip4_reass_node;
+extern vlib_node_registration_t ip6_reass_node;
+
+int ip_reass_enable_disable (u32 sw_if_index, u8 is_ip6, int enable);
+int ip_reass_set_params (u32 timeout_ms, u32 max_reassemblies,
+			 u32 max_fragments);
+
+#endif /* included_ip_reassembly_h */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -113,6 +113,9 @@ static_always_inline
 
   len = vlib_buffer_length_in_chain (vm, b);
   pol = &pm->policers[policer_index];
+  if (PREDICT_FALSE (pol->per_worker))
+    pol = policer_per_worker_bucket (pm, policer_index, vm->thread_index,
+				     len, time_in_policer_periods);
   col = vnet_police_packet (pol, len, packet_color, time_in_policer_periods);
   act = pol->action[col];
   if (PREDICT_TRUE (act == SSE2_QOS_ACTION_MARK_AND_TRANSMIT))
@@ -416,6 +419,10 @@ test_policer_add_del (u32 rx_sw_if_index, u8 * config_name, int is_add)
 
       policer[0] = template[0];
 
+      if (policer->per_worker)
+	policer_per_worker_enable (policer - pm->policers,
+				   pm->configs[p[0]].tolerance_pct);
+
       vec_validate (pm->policer_index_by_sw_if_index, rx_sw_if_index);
       pm->policer_index_by_sw_if_index[rx_sw_if_index]
 	= policer - pm->policers;
@@ -429,6 +436,8 @@ test_policer_add_del (u32 rx_sw_if_index, u8 * config_name, int is_add)
 
       pi = pm->policer_index_by_sw_if_index[rx_sw_if_index];
       pm->policer_index_by_sw_if_index[rx_sw_if_index] = ~0;
+      if (pm->policers[pi].per_worker)
+	policer_per_worker_disable (pi);
       pool_put_index (pm->policers, pi);
     }
 
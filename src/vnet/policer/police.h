@@ -53,6 +53,10 @@ typedef enum
 // The 64-bit last_update_time supports a 4Ghz CPU without rollover for 100 years
 //
 // The lock field should be used for a spin-lock on the struct.
+//
+// A per-worker policer avoids the sharing altogether: each thread polices
+// against a private copy of the struct, which draws its tokens from a
+// shared credit pool. See policer_per_worker_t in policer.h.
 
 #define POLICER_TICKS_PER_PERIOD_SHIFT 17
 #define POLICER_TICKS_PER_PERIOD       (1 << POLICER_TICKS_PER_PERIOD_SHIFT)
@@ -67,7 +71,8 @@ typedef struct
   u32 scale;			// power-of-2 shift amount for lower rates
   u8 action[3];
   u8 mark_dscp[3];
-  u8 pad[2];
+  u8 per_worker;		// tokens come from a policer_per_worker_t
+  u8 pad[1];
 
   // Fields are marked as 2R if they are only used for a 2-rate policer,
   // and MOD if they are modified as part of the update operation.
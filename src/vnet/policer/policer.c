@@ -39,6 +39,9 @@ policer_add_del (vlib_main_t * vm,
 	  return clib_error_return (0, "No such policer configuration");
 	}
       hash_unset_mem (pm->policer_config_by_name, name);
+      p = hash_get_mem (pm->policer_index_by_name, name);
+      if (p && pm->policers[p[0]].per_worker)
+	policer_per_worker_disable (p[0]);
       hash_unset_mem (pm->policer_index_by_name, name);
       vec_free (name);
       return 0;
@@ -65,11 +68,14 @@ policer_add_del (vlib_main_t * vm,
 
       clib_memcpy (cp, cfg, sizeof (*cp));
       clib_memcpy (pp, &test_policer, sizeof (*pp));
+      pp->per_worker = cfg->per_worker;
 
       hash_set_mem (pm->policer_config_by_name, name, cp - pm->configs);
       pool_get_aligned (pm->policers, policer, CLIB_CACHE_LINE_BYTES);
       policer[0] = pp[0];
       pi = policer - pm->policers;
+      if (policer->per_worker)
+	policer_per_worker_enable (pi, cfg->tolerance_pct);
       hash_set_mem (pm->policer_index_by_name, name, pi);
       *policer_index = pi;
     }
@@ -82,6 +88,81 @@ policer_add_del (vlib_main_t * vm,
   return 0;
 }
 
+void
+policer_per_worker_enable (u32 policer_index, u32 tolerance_pct)
+{
+  vnet_policer_main_t *pm = &vnet_policer_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_main_t *vm = vlib_get_main ();
+  policer_read_response_type_st *pol, *b;
+  policer_per_worker_t *pw;
+  u32 n_workers = clib_max (1, vlib_num_workers ());
+
+  if (tolerance_pct == 0)
+    tolerance_pct = POLICER_PER_WORKER_TOLERANCE_DEFAULT;
+
+  pol = pool_elt_at_index (pm->policers, policer_index);
+
+  /* The workers index pm->per_worker, hold them off if it moves */
+  if (policer_index >= vec_len (pm->per_worker)
+      && _vec_resize_will_expand (pm->per_worker,
+				  policer_index - vec_len (pm->per_worker) + 1,
+				  (policer_index + 1) *
+				  sizeof (pm->per_worker[0]), 0,
+				  CLIB_CACHE_LINE_BYTES))
+    {
+      vlib_worker_thread_barrier_sync (vm);
+      vec_validate_aligned (pm->per_worker, policer_index,
+			    CLIB_CACHE_LINE_BYTES);
+      vlib_worker_thread_barrier_release (vm);
+    }
+  else
+    vec_validate_aligned (pm->per_worker, policer_index,
+			  CLIB_CACHE_LINE_BYTES);
+  pw = vec_elt_at_index (pm->per_worker, policer_index);
+  memset (pw, 0, sizeof (*pw));
+
+  /* The pool starts out as full as the policer's own buckets */
+  pw->last_update_time = pol->last_update_time;
+  pw->current_credit = pol->current_bucket;
+  pw->extended_credit = pol->extended_bucket;
+  pw->tolerance_pct = tolerance_pct;
+  pw->current_quantum =
+    ((u64) pol->current_limit * tolerance_pct) / (100 * n_workers);
+  pw->extended_quantum =
+    ((u64) pol->extended_limit * tolerance_pct) / (100 * n_workers);
+
+  /* Thread buckets start empty and are never refilled by time */
+  vec_validate_aligned (pw->buckets, tm->n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
+  vec_foreach (b, pw->buckets)
+  {
+    b[0] = pol[0];
+    b->per_worker = 0;
+    b->cir_tokens_per_period = 0;
+    b->pir_tokens_per_period = 0;
+    b->current_bucket = 0;
+    b->extended_bucket = 0;
+  }
+}
+
+void
+policer_per_worker_disable (u32 policer_index)
+{
+  vnet_policer_main_t *pm = &vnet_policer_main;
+  vlib_main_t *vm = vlib_get_main ();
+  policer_per_worker_t *pw;
+
+  pw = vec_elt_at_index (pm->per_worker, policer_index);
+
+  /* A worker may be in the middle of its bucket */
+  vlib_worker_thread_barrier_sync (vm);
+  pm->policers[policer_index].per_worker = 0;
+  vec_free (pw->buckets);
+  memset (pw, 0, sizeof (*pw));
+  vlib_worker_thread_barrier_release (vm);
+}
+
 u8 *
 format_policer_instance (u8 * s, va_list * va)
 {
@@ -205,6 +286,10 @@ format_policer_config (u8 * s, va_list * va)
 	      format_policer_action_type, &c->conform_action,
 	      format_policer_action_type, &c->exceed_action,
 	      format_policer_action_type, &c->violate_action);
+  if (c->per_worker)
+    s = format (s, "per-worker buckets, tolerance %u%%\n",
+		c->tolerance_pct ? c->tolerance_pct :
+		POLICER_PER_WORKER_TOLERANCE_DEFAULT);
   return s;
 }
 
@@ -413,6 +498,8 @@ configure_policer_command_fn (vlib_main_t * vm,
   u8 is_add = 1;
   u8 *name = 0;
   u32 pi;
+  u32 tolerance = POLICER_PER_WORKER_TOLERANCE_DEFAULT;
+  u8 has_tolerance = 0;
   clib_error_t *error = NULL;
 
   /* Get a line of input. */
@@ -429,6 +516,10 @@ configure_policer_command_fn (vlib_main_t * vm,
 	;
       else if (unformat (line_input, "color-aware"))
 	c.color_aware = 1;
+      else if (unformat (line_input, "per-worker"))
+	c.per_worker = 1;
+      else if (unformat (line_input, "tolerance %u", &tolerance))
+	has_tolerance = 1;
 
 #define _(a) else if (unformat (line_input, "%U", unformat_policer_##a, &c)) ;
       foreach_config_param
@@ -441,6 +532,18 @@ configure_policer_command_fn (vlib_main_t * vm,
 	}
     }
 
+  if (has_tolerance && !c.per_worker)
+    {
+      error = clib_error_return (0, "tolerance requires per-worker");
+      goto done;
+    }
+  if (tolerance == 0 || tolerance > 100)
+    {
+      error = clib_error_return (0, "tolerance must be 1 to 100 percent");
+      goto done;
+    }
+  c.tolerance_pct = tolerance;
+
   error = policer_add_del (vm, name, &c, &pi, is_add);
 
 done:
@@ -452,7 +555,8 @@ done:
 /* *INDENT-OFF* */
 VLIB_CLI_COMMAND (configure_policer_command, static) = {
     .path = "configure policer",
-    .short_help = "configure policer name <name> <params> ",
+    .short_help = "configure policer name <name> <params> "
+                  "[per-worker [tolerance <pct>]]",
     .function = configure_policer_command_fn,
 };
 /* *INDENT-ON* */
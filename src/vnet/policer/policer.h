@@ -21,6 +21,38 @@
 #include <vnet/policer/xlate.h>
 #include <vnet/policer/police.h>
 
+/* Default share of the burst held in the per-worker buckets, percent */
+#define POLICER_PER_WORKER_TOLERANCE_DEFAULT 10
+
+/*
+ * Per-worker policer state.
+ *
+ * The refill of the configured rate goes into a shared credit pool,
+ * claimed with a compare-and-swap on last_update_time by whichever
+ * thread first notices that a period has passed. Each thread polices
+ * against its own bucket and only touches the pool when that bucket
+ * runs dry, taking at least a quantum of credit at a time. The long
+ * term rate is therefore exact, and the credit cached in the thread
+ * buckets - which is what may exceed the configured burst - is bounded
+ * by tolerance_pct percent of the burst.
+ */
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  volatile u64 last_update_time;
+  volatile u64 current_credit;
+  volatile u64 extended_credit;
+
+  /* read-mostly */
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
+  u32 current_quantum;
+  u32 extended_quantum;
+  u32 tolerance_pct;
+
+  /* per-thread buckets, one cache line each */
+  policer_read_response_type_st *buckets;
+} policer_per_worker_t;
+
 typedef struct
 {
   /* policer pool, aligned */
@@ -39,6 +71,9 @@ typedef struct
   /* Policer by sw_if_index vector */
   u32 *policer_index_by_sw_if_index;
 
+  /* Per-worker state, by policer index, valid if policer->per_worker */
+  policer_per_worker_t *per_worker;
+
   /* convenience */
   vlib_main_t *vlib_main;
   vnet_main_t *vnet_main;
@@ -90,7 +125,88 @@ typedef enum
 #undef _
 } vnet_dscp_t;
 
+/* Add credit to a shared pool, saturating at limit */
+static_always_inline void
+policer_credit_add (volatile u64 * credit, u64 n, u64 limit)
+{
+  u64 old, new;
+
+  do
+    {
+      old = *credit;
+      new = clib_min (old + n, limit);
+    }
+  while (!__sync_bool_compare_and_swap (credit, old, new));
+}
+
+/* Take up to n credits from a shared pool, returns the number taken */
+static_always_inline u64
+policer_credit_take (volatile u64 * credit, u64 n)
+{
+  u64 old, taken;
+
+  do
+    {
+      old = *credit;
+      if (old == 0)
+	return 0;
+      taken = clib_min (old, n);
+    }
+  while (!__sync_bool_compare_and_swap (credit, old, old - taken));
+
+  return taken;
+}
+
+/*
+ * Return the calling thread's bucket of a per-worker policer, topped
+ * up from the shared pool if it can't cover a (scaled) packet_length.
+ */
+static_always_inline policer_read_response_type_st *
+policer_per_worker_bucket (vnet_policer_main_t * pm, u32 policer_index,
+			   u32 thread_index, u32 packet_length, u64 time)
+{
+  policer_read_response_type_st *pol = &pm->policers[policer_index];
+  policer_per_worker_t *pw = &pm->per_worker[policer_index];
+  policer_read_response_type_st *b = &pw->buckets[thread_index];
+  u64 last;
+
+  packet_length <<= pol->scale;
+
+  if (PREDICT_TRUE (b->current_bucket >= packet_length
+		    && (b->extended_limit == 0
+			|| b->extended_bucket >= packet_length)))
+    return b;
+
+  last = pw->last_update_time;
+  if (time > last
+      && __sync_bool_compare_and_swap (&pw->last_update_time, last, time))
+    {
+      policer_credit_add (&pw->current_credit,
+			  (time - last) * pol->cir_tokens_per_period,
+			  pol->current_limit);
+      policer_credit_add (&pw->extended_credit,
+			  (time - last) * (pol->single_rate ?
+					   pol->cir_tokens_per_period :
+					   pol->pir_tokens_per_period),
+			  pol->extended_limit);
+    }
+
+  if (b->current_bucket < packet_length)
+    b->current_bucket +=
+      policer_credit_take (&pw->current_credit,
+			   clib_max (pw->current_quantum,
+				     packet_length - b->current_bucket));
+  if (b->extended_limit && b->extended_bucket < packet_length)
+    b->extended_bucket +=
+      policer_credit_take (&pw->extended_credit,
+			   clib_max (pw->extended_quantum,
+				     packet_length - b->extended_bucket));
+  return b;
+}
+
 u8 *format_policer_instance (u8 * s, va_list * va);
+void policer_per_worker_enable (u32 policer_index, u32 tolerance_pct);
+void policer_per_worker_disable (u32 policer_index);
 clib_error_t *policer_add_del (vlib_main_t * vm,
 			       u8 * name,
 			       sse2_qos_pol_cfg_params_st * cfg,
@@ -121,6 +121,12 @@ typedef struct sse2_qos_pol_action_params_st_
  * element: rnd_type
  *      Rounding type (see sse_qos_round_type_en). Needed when policer values
  *      need to be rounded. Caller can decide on type of rounding used
+ * element: per_worker
+ *      Give each worker thread its own token buckets, refilled from a
+ *      shared credit pool, instead of sharing one policer instance.
+ * element: tolerance_pct
+ *      Per-worker mode only: the share of the burst, in percent, that the
+ *      workers may hold in their private buckets. Zero selects the default.
  */
 typedef struct sse2_qos_pol_cfg_params_st_
 {
@@ -146,6 +152,8 @@ typedef struct sse2_qos_pol_cfg_params_st_
   u8 rfc;			/* sse2_qos_policer_type_en */
   u8 color_aware;
   u8 overwrite_bucket;		/* for debugging purposes */
+  u8 per_worker;
+  u8 tolerance_pct;
   u32 current_bucket;		/* for debugging purposes */
   u32 extended_bucket;		/* for debugging purposes */
   sse2_qos_pol_action_params_st conform_action;
@@ -171,6 +171,7 @@ application_init (application_t * app, u32 api_client_index, u64 * options,
   app->first_segment_manager = segment_manager_index (sm);
   app->api_client_index = api_client_index;
   app->flags = options[APP_OPTIONS_FLAGS];
+  app->tcp_cc_algo = options[APP_OPTIONS_TCP_CC_ALGO];
   app->cb_fns = *cb_fns;
 
   /* Allocate app event queue in the first shared-memory segment */
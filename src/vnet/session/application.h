@@ -61,6 +61,9 @@ typedef struct _application
   /** Flags */
   u32 flags;
 
+  /** TCP congestion control algorithm + 1, 0 for the stack's default */
+  u8 tcp_cc_algo;
+
   /*
    * Binary API interface to external app
    */
@@ -68,8 +71,8 @@ typedef struct _application
   /** Binary API connection index, ~0 if internal */
   u32 api_client_index;
 
-  /** Application listens for events on this svm queue */
-  unix_shared_memory_queue_t *event_queue;
+  /** Application listens for events on this svm ring */
+  svm_ring_t *event_queue;
 
   /*
    * Callbacks: shoulder-taps for the server/client
@@ -242,12 +242,17 @@ vnet_application_attach (vnet_app_attach_args_t * a)
   u8 *seg_name;
   int rv;
 
+  /* Vpp's buffers are not mapped by external apps */
+  if ((a->options[APP_OPTIONS_FLAGS] & APP_OPTIONS_FLAGS_RX_ZERO_COPY)
+      && !(a->options[APP_OPTIONS_FLAGS] & APP_OPTIONS_FLAGS_BUILTIN_APP))
+    return VNET_API_ERROR_INVALID_VALUE;
+
   app = application_new ();
   if ((rv = application_init (app, a->api_client_index, a->options,
 			      a->session_cb_vft)))
     return rv;
 
-  a->app_event_queue_address = pointer_to_uword (app->event_queue);
+  a->app_event_ring_address = pointer_to_uword (app->event_queue);
   sm = segment_manager_get (app->first_segment_manager);
   segment_manager_get_segment_info (sm->segment_indices[0],
 				    &seg_name, &a->segment_size);
@@ -48,7 +48,7 @@ typedef struct _vnet_app_attach_args_t
   u8 *segment_name;
   u32 segment_name_length;
   u32 segment_size;
-  u64 app_event_queue_address;
+  u64 app_event_ring_address;
   u32 app_index;
 } vnet_app_attach_args_t;
 
@@ -76,7 +76,7 @@ typedef struct _vnet_bind_args_t
    */
   char *segment_name;
   u32 segment_name_length;
-  u64 server_event_queue_address;
+  u64 server_event_ring_address;
   u64 handle;
 } vnet_bind_args_t;
 
@@ -126,6 +126,7 @@ typedef enum
   SESSION_OPTIONS_TX_FIFO_SIZE,
   SESSION_OPTIONS_PREALLOCATED_FIFO_PAIRS,
   SESSION_OPTIONS_ACCEPT_COOKIE,
+  APP_OPTIONS_TCP_CC_ALGO,
   SESSION_OPTIONS_N_OPTIONS
 } app_attach_options_index_t;
 
@@ -133,6 +134,7 @@ typedef enum
   _(USE_FIFO, "Use FIFO with redirects")			\
   _(ADD_SEGMENT, "Add segment and signal app if needed")	\
   _(BUILTIN_APP, "Application is builtin")			\
+  _(RX_ZERO_COPY, "Rx data handed over in buffers")		\
 
 typedef enum _app_options
 {
@@ -20,7 +20,7 @@
 #include <vppinfra/elog.h>
 #include <vnet/session/application.h>
 #include <vnet/session/session_debug.h>
-#include <vlibmemory/unix_shared_memory_queue.h>
+#include <svm/svm_ring.h>
 
 vlib_node_registration_t session_queue_node;
 
@@ -137,7 +137,7 @@ session_tx_fifo_read_and_snd_i (vlib_main_t * vm, vlib_node_runtime_t * node,
   transport_proto_vft_t *transport_vft;
   u32 next_index, next0, *to_next, n_left_to_next, bi0;
   vlib_buffer_t *b0;
-  u32 rx_offset = 0, max_dequeue0, n_bytes_per_seg;
+  u32 rx_offset = 0, max_dequeue0, n_bytes_per_seg, gso_size0 = 0;
   u16 snd_mss0, n_bufs_per_seg, n_bufs;
   u8 *data0;
   int i, n_bytes_read;
@@ -191,10 +191,26 @@ session_tx_fifo_read_and_snd_i (vlib_main_t * vm, vlib_node_runtime_t * node,
 
   n_bytes_per_buf = vlib_buffer_free_list_buffer_size
     (vm, VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX);
-  n_bytes_per_seg = MAX_HDRS_LEN + snd_mss0;
-  n_bufs_per_seg = ceil ((double) n_bytes_per_seg / n_bytes_per_buf);
-  n_bufs_per_evt = (ceil ((double) max_len_to_snd0 / n_bytes_per_seg))
-    * n_bufs_per_seg;
+
+  /* If the transport accepts GSO super-packets and a segment fits in a
+   * buffer, chain up to gso_size0 bytes of payload, one segment per
+   * buffer, so they can be segmented without copying the payload */
+  if (transport_vft->send_gso_size
+      && MAX_HDRS_LEN + snd_mss0 <= n_bytes_per_buf)
+    gso_size0 = transport_vft->send_gso_size (tc0);
+
+  if (gso_size0 > snd_mss0)
+    {
+      n_bufs_per_seg = gso_size0 / snd_mss0;
+      n_bufs_per_evt = ceil ((double) max_len_to_snd0 / snd_mss0);
+    }
+  else
+    {
+      n_bytes_per_seg = MAX_HDRS_LEN + snd_mss0;
+      n_bufs_per_seg = ceil ((double) n_bytes_per_seg / n_bytes_per_buf);
+      n_bufs_per_evt = (ceil ((double) max_len_to_snd0 / n_bytes_per_seg))
+	* n_bufs_per_seg;
+    }
   n_frames_per_evt = ceil ((double) n_bufs_per_evt / VLIB_FRAME_SIZE);
 
   deq_per_buf = clib_min (snd_mss0, n_bytes_per_buf);
@@ -236,7 +252,8 @@ session_tx_fifo_read_and_snd_i (vlib_main_t * vm, vlib_node_runtime_t * node,
       svm_fifo_unset_event (s0->server_tx_fifo);
 
       vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
-      while (left_to_snd0 && n_left_to_next >= n_bufs_per_seg)
+      while (left_to_snd0 && n_left_to_next >= n_bufs_per_seg
+	     && n_bufs >= n_bufs_per_seg)
 	{
 	  /*
 	   * Handle first buffer in chain separately
@@ -329,7 +346,7 @@ session_tx_fifo_read_and_snd_i (vlib_main_t * vm, vlib_node_runtime_t * node,
     }
 
   /* If we couldn't dequeue all bytes mark as partially read */
-  if (max_len_to_snd0 < max_dequeue0)
+  if (max_len_to_snd0 < max_dequeue0 || left_to_snd0)
     {
       /* If we don't already have new event */
       if (svm_fifo_set_event (s0->server_tx_fifo))
@@ -404,20 +421,23 @@ dump_thread_0_event_queue (void)
   session_manager_main_t *smm = vnet_get_session_manager_main ();
   vlib_main_t *vm = &vlib_global_main;
   u32 my_thread_index = vm->thread_index;
-  session_fifo_event_t _e, *e = &_e;
+  session_fifo_event_t *e;
   stream_session_t *s0;
-  int i, index;
-  i8 *headp;
+  svm_ring_slot_t *slot;
+  u32 i, n_elts;
 
-  unix_shared_memory_queue_t *q;
+  svm_ring_t *q;
   q = smm->vpp_event_queues[my_thread_index];
 
-  index = q->head;
+  n_elts = svm_ring_elts (q);
 
-  for (i = 0; i < q->cursize; i++)
+  for (i = 0; i < n_elts; i++)
     {
-      headp = (i8 *) (&q->data[0] + q->elsize * index);
-      clib_memcpy (e, headp, q->elsize);
+      /* Stop at the first slot a producer reserved but did not fill */
+      slot = svm_ring_slot (q, q->head + i);
+      if (slot->seq != q->head + i + 1)
+	break;
+      e = (session_fifo_event_t *) slot->data;
 
       switch (e->event_type)
 	{
@@ -447,11 +467,6 @@ dump_thread_0_event_queue (void)
 		   i, e->event_type);
 	  break;
 	}
-
-      index++;
-
-      if (index == q->maxsize)
-	index = 0;
     }
 }
 
@@ -463,7 +478,7 @@ session_queue_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
   session_fifo_event_t *my_pending_event_vector, *e;
   session_fifo_event_t *my_fifo_events;
   u32 n_to_dequeue, n_events;
-  unix_shared_memory_queue_t *q;
+  svm_ring_t *q;
   application_t *app;
   int n_tx_packets = 0;
   u32 my_thread_index = vm->thread_index;
@@ -488,7 +503,7 @@ session_queue_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
   my_fifo_events = smm->free_event_vector[my_thread_index];
 
   /* min number of events we can dequeue without blocking */
-  n_to_dequeue = q->cursize;
+  n_to_dequeue = svm_ring_elts (q);
   my_pending_event_vector = smm->pending_event_vector[my_thread_index];
 
   if (n_to_dequeue == 0 && vec_len (my_pending_event_vector) == 0)
@@ -507,20 +522,12 @@ session_queue_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
       goto skip_dequeue;
     }
 
-  /* See you in the next life, don't be late */
-  if (pthread_mutex_trylock (&q->mutex))
-    return 0;
-
-  for (i = 0; i < n_to_dequeue; i++)
-    {
-      vec_add2 (my_fifo_events, e, 1);
-      unix_shared_memory_queue_sub_raw (q, (u8 *) e);
-    }
-
-  /* The other side of the connection is not polling */
-  if (q->cursize < (q->maxsize / 8))
-    (void) pthread_cond_broadcast (&q->condvar);
-  pthread_mutex_unlock (&q->mutex);
+  /* Producers may still be filling the last slots they reserved, those
+   * are left for the next dispatch */
+  n_events = vec_len (my_fifo_events);
+  vec_add2 (my_fifo_events, e, n_to_dequeue);
+  n_to_dequeue = svm_ring_dequeue_batch (q, e, n_to_dequeue);
+  _vec_len (my_fifo_events) = n_events + n_to_dequeue;
 
   vec_append (my_fifo_events, my_pending_event_vector);
 
@@ -22,6 +22,7 @@
 #include <vnet/dpo/load_balance.h>
 #include <vnet/fib/ip4_fib.h>
 #include <vnet/session/application.h>
+#include <vnet/session/application_interface.h>
 #include <vnet/tcp/tcp.h>
 #include <vnet/session/session_debug.h>
 
@@ -440,8 +441,8 @@ session_enqueue_chain_tail (stream_session_t * s, vlib_buffer_t * b,
   vlib_buffer_t *chain_b;
   u32 chain_bi = b->next_buffer;
   vlib_main_t *vm = vlib_get_main ();
-  u8 *data, len;
-  u16 written = 0;
+  u8 *data;
+  u16 len, written = 0;
   int rv = 0;
 
   do
@@ -476,6 +477,135 @@ session_enqueue_chain_tail (stream_session_t * s, vlib_buffer_t * b,
   return 0;
 }
 
+typedef enum
+{
+  SESSION_RX_COPY,		/**< Copy to the rx fifo */
+  SESSION_RX_ZERO_COPY,		/**< Hand the buffers to the app */
+  SESSION_RX_NO_SPACE,		/**< Beyond the window */
+} session_rx_mode_t;
+
+/**
+ * Hand the buffers of in order data to a zero-copy rx app, unless the
+ * fifo holds data they would have to be read after, or unless the app
+ * holds as many buffers as it may. The data is then copied to the fifo.
+ * Data beyond the window, held bytes included, is not accepted at all.
+ */
+always_inline session_rx_mode_t
+session_rx_mode (stream_session_t * s, transport_connection_t * tc,
+		 vlib_buffer_t * b)
+{
+  session_manager_main_t *smm = &session_manager_main;
+  application_t *app = application_get (s->app_index);
+  session_rx_buffers_t *rxb;
+  u32 n_held, n_buffers = 0, n_bytes = 0;
+
+  if (PREDICT_TRUE (!(app->flags & APP_OPTIONS_FLAGS_RX_ZERO_COPY)))
+    return SESSION_RX_COPY;
+
+  while (1)
+    {
+      n_buffers++;
+      n_bytes += b->current_length;
+      if (!(b->flags & VLIB_BUFFER_NEXT_PRESENT))
+	break;
+      b = vlib_get_buffer (vlib_get_main (), b->next_buffer);
+    }
+
+  /* The fifo does not see the bytes held in buffers, so it would take
+   * more than the window from a peer that ignores it */
+  rxb = stream_session_rx_buffers_get (s);
+  n_held = rxb ? vec_len (rxb->descs) : 0;
+  if (n_held && n_bytes > stream_session_max_rx_enqueue (tc))
+    return SESSION_RX_NO_SPACE;
+
+  if (svm_fifo_max_dequeue (s->server_rx_fifo) != 0
+      || svm_fifo_has_ooo_data (s->server_rx_fifo))
+    return SESSION_RX_COPY;
+
+  /* Nor must a peer sending tiny segments pin the buffer pool */
+  if (n_held + n_buffers > smm->rx_zero_copy_session_buffers
+      || smm->n_rx_held_buffers[s->thread_index] + n_buffers
+      > smm->rx_zero_copy_thread_buffers)
+    return SESSION_RX_COPY;
+
+  return n_bytes <= stream_session_max_rx_enqueue (tc) ?
+    SESSION_RX_ZERO_COPY : SESSION_RX_COPY;
+}
+
+/** Keep a reference to the buffers of a chain for the app */
+static int
+session_enqueue_buffers (stream_session_t * s, vlib_buffer_t * b)
+{
+  session_manager_main_t *smm = &session_manager_main;
+  vlib_main_t *vm = vlib_get_main ();
+  session_rx_buffers_t *rxb;
+  session_rx_desc_t *d;
+  int enqueued = 0;
+  u32 n_held;
+
+  vec_validate (smm->rx_buffers[s->thread_index], s->session_index);
+  rxb = &smm->rx_buffers[s->thread_index][s->session_index];
+  n_held = vec_len (rxb->descs);
+
+  while (1)
+    {
+      /* The transport frees the buffer or, if it sees the reference,
+       * leaves it alone */
+      if (b->current_length)
+	{
+	  b->n_add_refs++;
+	  vec_add2 (rxb->descs, d, 1);
+	  d->data = vlib_buffer_get_current (b);
+	  d->length = b->current_length;
+	  d->buffer_index = vlib_get_buffer_index (vm, b);
+	  enqueued += b->current_length;
+	}
+      if (!(b->flags & VLIB_BUFFER_NEXT_PRESENT))
+	break;
+      b = vlib_get_buffer (vm, b->next_buffer);
+    }
+
+  rxb->n_bytes += enqueued;
+  smm->n_rx_held_buffers[s->thread_index] += vec_len (rxb->descs) - n_held;
+  return enqueued;
+}
+
+/**
+ * Buffers of in order data held by a zero-copy rx app, oldest first.
+ * Their data comes before that of the rx fifo.
+ */
+session_rx_desc_t *
+stream_session_rx_descs (stream_session_t * s)
+{
+  session_rx_buffers_t *rxb = stream_session_rx_buffers_get (s);
+  return rxb ? rxb->descs : 0;
+}
+
+/**
+ * Give back the first n_descs buffers of stream_session_rx_descs. To be
+ * called on the session's thread.
+ */
+void
+stream_session_rx_release (stream_session_t * s, u32 n_descs)
+{
+  session_manager_main_t *smm = &session_manager_main;
+  session_rx_buffers_t *rxb = stream_session_rx_buffers_get (s);
+  vlib_main_t *vm = vlib_get_main ();
+  session_rx_desc_t *d;
+
+  if (!rxb || !n_descs)
+    return;
+
+  ASSERT (n_descs <= vec_len (rxb->descs));
+  for (d = rxb->descs; d < rxb->descs + n_descs; d++)
+    {
+      vlib_buffer_free_no_next (vm, &d->buffer_index, 1);
+      rxb->n_bytes -= d->length;
+    }
+  vec_delete (rxb->descs, n_descs, 0);
+  smm->n_rx_held_buffers[s->thread_index] -= n_descs;
+}
+
 /*
  * Enqueue data for delivery to session peer. Does not notify peer of enqueue
  * event but on request can queue notification events for later delivery by
@@ -494,18 +624,27 @@ int
 stream_session_enqueue_data (transport_connection_t * tc, vlib_buffer_t * b,
 			     u32 offset, u8 queue_event, u8 is_in_order)
 {
+  session_rx_mode_t rx_mode = SESSION_RX_COPY;
   stream_session_t *s;
   int enqueued = 0, rv;
 
   s = stream_session_get (tc->s_index, tc->thread_index);
 
   if (is_in_order)
+    rx_mode = session_rx_mode (s, tc, b);
+
+  if (PREDICT_FALSE (rx_mode == SESSION_RX_NO_SPACE))
+    return 0;
+  else if (PREDICT_FALSE (rx_mode == SESSION_RX_ZERO_COPY))
+    enqueued = session_enqueue_buffers (s, b);
+  else if (is_in_order)
     {
       enqueued =
 	svm_fifo_enqueue_nowait (s->server_rx_fifo, b->current_length,
 				 vlib_buffer_get_current (b));
+      /* The first buffer of the chain may be empty if tcp trimmed it */
       if (PREDICT_FALSE
-	  ((b->flags & VLIB_BUFFER_NEXT_PRESENT) && enqueued > 0))
+	  ((b->flags & VLIB_BUFFER_NEXT_PRESENT) && enqueued >= 0))
 	{
 	  rv = session_enqueue_chain_tail (s, b, 0, 1);
 	  if (rv <= 0)
@@ -599,7 +738,6 @@ stream_session_enqueue_notify (stream_session_t * s, u8 block)
 {
   application_t *app;
   session_fifo_event_t evt;
-  unix_shared_memory_queue_t *q;
   static u32 serial_number;
 
   if (PREDICT_FALSE (s->session_state == SESSION_STATE_CLOSED))
@@ -620,14 +758,9 @@ stream_session_enqueue_notify (stream_session_t * s, u8 block)
       evt.event_type = FIFO_EVENT_APP_RX;
       evt.event_id = serial_number++;
 
-      /* Add event to server's event queue */
-      q = app->event_queue;
-
-      /* Based on request block (or not) for lack of space */
-      if (block || PREDICT_TRUE (q->cursize < q->maxsize))
-	unix_shared_memory_queue_add (app->event_queue, (u8 *) & evt,
-				      0 /* do wait for mutex */ );
-      else
+      /* Add event to server's event queue, based on request block (or
+       * not) for lack of space */
+      if (svm_ring_enqueue (app->event_queue, &evt, !block))
 	{
 	  clib_warning ("fifo full");
 	  return -1;
@@ -760,6 +893,25 @@ stream_session_accept_notify (transport_connection_t * tc)
   server->cb_fns.session_accept_callback (s);
 }
 
+/**
+ * Index of the application that opened a half-open connection, ~0 if
+ * there is none. Valid until the transport notifies the connect.
+ */
+u32
+stream_session_half_open_app_index (transport_connection_t * tc)
+{
+  session_manager_main_t *smm = &session_manager_main;
+  u64 handle;
+
+  handle = stream_session_half_open_lookup (smm, &tc->lcl_ip, &tc->rmt_ip,
+					    tc->lcl_port, tc->rmt_port,
+					    tc->proto);
+  if (handle == HALF_OPEN_LOOKUP_INVALID_VALUE)
+    return ~0;
+
+  return handle >> 32;
+}
+
 /**
  * Notification from transport that connection is being closed.
  *
@@ -789,6 +941,9 @@ stream_session_delete (stream_session_t * s)
   /* Delete from the main lookup table. */
   stream_session_table_del (smm, s);
 
+  /* Give back the buffers the app did not */
+  stream_session_rx_release (s, vec_len (stream_session_rx_descs (s)));
+
   /* Cleanup fifo segments */
   segment_manager_dealloc_fifos (s->svm_segment_index, s->server_rx_fifo,
 				 s->server_tx_fifo);
@@ -976,7 +1131,7 @@ session_send_session_evt_to_thread (u64 session_handle,
 {
   static u16 serial_number = 0;
   session_fifo_event_t evt;
-  unix_shared_memory_queue_t *q;
+  svm_ring_t *q;
 
   /* Fabricate event */
   evt.session_handle = session_handle;
@@ -985,20 +1140,8 @@ session_send_session_evt_to_thread (u64 session_handle,
 
   q = session_manager_get_vpp_event_queue (thread_index);
 
-  /* Based on request block (or not) for lack of space */
-  if (PREDICT_TRUE (q->cursize < q->maxsize))
-    {
-      if (unix_shared_memory_queue_add (q, (u8 *) & evt,
-					1 /* do wait for mutex */ ))
-	{
-	  clib_warning ("failed to enqueue evt");
-	}
-    }
-  else
-    {
-      clib_warning ("queue full");
-      return;
-    }
+  if (svm_ring_enqueue (q, &evt, 1 /* nowait */ ))
+    clib_warning ("queue full");
 }
 
 /**
@@ -1079,10 +1222,7 @@ session_vpp_event_queue_allocate (session_manager_main_t * smm,
 	event_queue_length = smm->configured_event_queue_length;
 
       smm->vpp_event_queues[thread_index] =
-	unix_shared_memory_queue_init
-	(event_queue_length,
-	 sizeof (session_fifo_event_t), 0 /* consumer pid */ ,
-	 0 /* (do not) send signal when queue non-empty */ );
+	svm_ring_init (event_queue_length, sizeof (session_fifo_event_t));
 
       svm_pop_heap (oldheap);
     }
@@ -1109,6 +1249,8 @@ session_manager_main_enable (vlib_main_t * vm)
   vec_validate (smm->sessions, num_threads - 1);
   vec_validate (smm->session_indices_to_enqueue_by_thread, num_threads - 1);
   vec_validate (smm->tx_buffers, num_threads - 1);
+  vec_validate (smm->rx_buffers, num_threads - 1);
+  vec_validate (smm->n_rx_held_buffers, num_threads - 1);
   vec_validate (smm->pending_event_vector, num_threads - 1);
   vec_validate (smm->free_event_vector, num_threads - 1);
   vec_validate (smm->current_enqueue_epoch, num_threads - 1);
@@ -1204,6 +1346,8 @@ session_manager_main_init (vlib_main_t * vm)
   smm->vlib_main = vm;
   smm->vnet_main = vnet_get_main ();
   smm->is_enabled = 0;
+  smm->rx_zero_copy_session_buffers = 64;
+  smm->rx_zero_copy_thread_buffers = 4096;
 
   return 0;
 }
@@ -1224,6 +1368,12 @@ VLIB_INIT_FUNCTION (session_manager_main_init)
 	  else
 	    clib_warning ("event queue length %d too small, ignored", nitems);
 	}
+      else if (unformat (input, "rx-zero-copy-session-buffers %d",
+			 &smm->rx_zero_copy_session_buffers))
+	;
+      else if (unformat (input, "rx-zero-copy-thread-buffers %d",
+			 &smm->rx_zero_copy_thread_buffers))
+	;
       else
 	return clib_error_return (0, "unknown input `%U'",
 				  format_unformat_error, input);
@@ -17,6 +17,7 @@
 
 #include <vnet/session/transport.h>
 #include <vlibmemory/unix_shared_memory_queue.h>
+#include <svm/svm_ring.h>
 #include <vnet/session/session_debug.h>
 #include <vnet/session/segment_manager.h>
 
@@ -153,6 +154,23 @@ typedef struct _stream_session_t
   u64 opaque[2];
 } stream_session_t;
 
+/** A buffer of in order data handed to a zero-copy rx app */
+typedef struct
+{
+  u8 *data;
+  u32 length;
+  u32 buffer_index;
+} session_rx_desc_t;
+
+typedef struct
+{
+  /** Oldest first, the app reads them before the rx fifo */
+  session_rx_desc_t *descs;
+
+  /** Bytes they hold */
+  u32 n_bytes;
+} session_rx_buffers_t;
+
 /* Forward definition */
 typedef struct _session_manager_main session_manager_main_t;
 
@@ -193,6 +211,17 @@ struct _session_manager_main
   /** per-worker tx buffer free lists */
   u32 **tx_buffers;
 
+  /** Per worker-thread, per session buffers held by zero-copy rx apps */
+  session_rx_buffers_t **rx_buffers;
+
+  /** Per worker-thread number of buffers held by zero-copy rx apps */
+  u32 *n_rx_held_buffers;
+
+  /** Max buffers held by zero-copy rx apps per session and per thread,
+   *  beyond which rx data is copied to the fifos */
+  u32 rx_zero_copy_session_buffers;
+  u32 rx_zero_copy_thread_buffers;
+
   /** Per worker-thread vector of partially read events */
   session_fifo_event_t **free_event_vector;
 
@@ -200,7 +229,7 @@ struct _session_manager_main
   session_fifo_event_t **pending_event_vector;
 
   /** vpp fifo event queue */
-  unix_shared_memory_queue_t **vpp_event_queues;
+  svm_ring_t **vpp_event_queues;
 
   /** vpp fifo event queue configured length */
   u32 configured_event_queue_length;
@@ -344,11 +373,28 @@ stream_session_get_index (stream_session_t * s)
   return s - session_manager_main.sessions[s->thread_index];
 }
 
+always_inline session_rx_buffers_t *
+stream_session_rx_buffers_get (stream_session_t * s)
+{
+  session_rx_buffers_t *rxbs;
+
+  rxbs = session_manager_main.rx_buffers[s->thread_index];
+  if (s->session_index >= vec_len (rxbs))
+    return 0;
+  return &rxbs[s->session_index];
+}
+
 always_inline u32
 stream_session_max_rx_enqueue (transport_connection_t * tc)
 {
   stream_session_t *s = stream_session_get (tc->s_index, tc->thread_index);
-  return svm_fifo_max_enqueue (s->server_rx_fifo);
+  session_rx_buffers_t *rxb = stream_session_rx_buffers_get (s);
+  u32 space = svm_fifo_max_enqueue (s->server_rx_fifo);
+
+  /* Buffers held by the app count against the fifo */
+  if (PREDICT_FALSE (rxb != 0 && rxb->n_bytes))
+    return space > rxb->n_bytes ? space - rxb->n_bytes : 0;
+  return space;
 }
 
 always_inline u32
@@ -367,9 +413,12 @@ int
 stream_session_peek_bytes (transport_connection_t * tc, u8 * buffer,
 			   u32 offset, u32 max_bytes);
 u32 stream_session_dequeue_drop (transport_connection_t * tc, u32 max_bytes);
+session_rx_desc_t *stream_session_rx_descs (stream_session_t * s);
+void stream_session_rx_release (stream_session_t * s, u32 n_descs);
 
 int stream_session_connect_notify (transport_connection_t * tc, u8 sst,
 				   u8 is_fail);
+u32 stream_session_half_open_app_index (transport_connection_t * tc);
 void stream_session_init_fifos_pointers (transport_connection_t * tc,
 					 u32 rx_pointer, u32 tx_pointer);
 
@@ -388,6 +437,10 @@ int stream_session_listen (stream_session_t * s, transport_endpoint_t * tep);
 int stream_session_stop_listen (stream_session_t * s);
 void stream_session_disconnect (stream_session_t * s);
 void stream_session_cleanup (stream_session_t * s);
+int stream_session_create_i (segment_manager_t * sm,
+			     transport_connection_t * tc,
+			     stream_session_t ** ret_s);
+void stream_session_delete (stream_session_t * s);
 void session_send_session_evt_to_thread (u64 session_handle,
 					 fifo_event_type_t evt_type,
 					 u32 thread_index);
@@ -402,7 +455,7 @@ transport_proto_vft_t *session_get_transport_vft (u8 type);
 
 clib_error_t *vnet_session_enable_disable (vlib_main_t * vm, u8 is_en);
 
-always_inline unix_shared_memory_queue_t *
+always_inline svm_ring_t *
 session_manager_get_vpp_event_queue (u32 thread_index)
 {
   return session_manager_main.vpp_event_queues[thread_index];
@@ -80,7 +80,8 @@ static int
 send_session_accept_callback (stream_session_t * s)
 {
   vl_api_accept_session_t *mp;
-  unix_shared_memory_queue_t *q, *vpp_queue;
+  unix_shared_memory_queue_t *q;
+  svm_ring_t *vpp_queue;
   application_t *server = application_get (s->app_index);
   transport_connection_t *tc;
   transport_proto_vft_t *tp_vft;
@@ -104,7 +105,7 @@ send_session_accept_callback (stream_session_t * s)
   mp->handle = stream_session_handle (s);
   mp->server_rx_fifo = pointer_to_uword (s->server_rx_fifo);
   mp->server_tx_fifo = pointer_to_uword (s->server_tx_fifo);
-  mp->vpp_event_queue_address = pointer_to_uword (vpp_queue);
+  mp->vpp_event_ring_address = pointer_to_uword (vpp_queue);
   mp->port = tc->rmt_port;
   mp->is_ip4 = tc->is_ip4;
   clib_memcpy (&mp->ip, &tc->rmt_ip, sizeof (tc->rmt_ip));
@@ -158,7 +159,7 @@ send_session_connected_callback (u32 app_index, u32 api_context,
   vl_api_connect_uri_reply_t *mp;
   unix_shared_memory_queue_t *q;
   application_t *app;
-  unix_shared_memory_queue_t *vpp_queue;
+  svm_ring_t *vpp_queue;
 
   app = application_get (app_index);
   q = vl_api_client_index_to_input_queue (app->api_client_index);
@@ -175,7 +176,7 @@ send_session_connected_callback (u32 app_index, u32 api_context,
       mp->server_rx_fifo = pointer_to_uword (s->server_rx_fifo);
       mp->server_tx_fifo = pointer_to_uword (s->server_tx_fifo);
       mp->handle = stream_session_handle (s);
-      mp->vpp_event_queue_address = pointer_to_uword (vpp_queue);
+      mp->vpp_event_ring_address = pointer_to_uword (vpp_queue);
       mp->retval = 0;
     }
   else
@@ -327,7 +328,7 @@ done:
 		    a->segment_name_length);
 	    rmp->segment_name_length = a->segment_name_length;
 	  }
-	rmp->app_event_queue_address = a->app_event_queue_address;
+	rmp->app_event_ring_address = a->app_event_ring_address;
       }
   }));
   /* *INDENT-ON* */
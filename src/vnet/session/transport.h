@@ -87,6 +87,7 @@ typedef struct _transport_proto_vft
     u16 (*send_mss) (transport_connection_t * tc);
     u32 (*send_space) (transport_connection_t * tc);
     u32 (*tx_fifo_offset) (transport_connection_t * tc);
+    u32 (*send_gso_size) (transport_connection_t * tc);	/**< optional */
 
   /*
    * Connection retrieval
@@ -18,6 +18,8 @@
 #include <vnet/vnet.h>
 #include <vnet/plugin/plugin.h>
 #include <vnet/tcp/builtin_client.h>
+#include <vnet/tcp/tcp.h>
+#include <vnet/session/application.h>
 
 #include <vlibapi/api.h>
 #include <vlibmemory/api.h>
@@ -100,8 +102,7 @@ send_test_chunk (tclient_main_t * tm, session_t * s)
 	  evt.event_type = FIFO_EVENT_APP_TX;
 	  evt.event_id = serial_number++;
 
-	  if (unix_shared_memory_queue_add (tm->vpp_event_queue, (u8 *) & evt,
-					    0 /* do wait for mutex */ ))
+	  if (svm_ring_enqueue (tm->vpp_event_queue, &evt, 0 /* wait */ ))
 	    clib_warning ("could not enqueue event");
 	}
     }
@@ -486,6 +487,7 @@ attach_builtin_test_clients_app (void)
   options[SESSION_OPTIONS_RX_FIFO_SIZE] = tm->fifo_size;
   options[SESSION_OPTIONS_TX_FIFO_SIZE] = tm->fifo_size / 2;
   options[APP_OPTIONS_PREALLOC_FIFO_PAIRS] = prealloc_fifos;
+  options[APP_OPTIONS_TCP_CC_ALGO] = tm->tcp_cc_algo;
 
   options[APP_OPTIONS_FLAGS] = APP_OPTIONS_FLAGS_BUILTIN_APP;
 
@@ -554,13 +556,15 @@ test_tcp_clients_command_fn (vlib_main_t * vm,
   u8 *default_connect_uri = (u8 *) "tcp://6.0.1.1/1234", *uri;
   u64 tmp, total_bytes;
   f64 cli_timeout = 20.0, delta;
-  u32 n_clients = 1;
+  u32 n_clients = 1, cc_algo;
+  application_t *app;
   char *transfer_type;
   int i;
 
   tm->bytes_to_send = 8192;
   tm->no_return = 0;
   tm->fifo_size = 64 << 10;
+  tm->tcp_cc_algo = 0;
 
   vec_free (tm->connect_uri);
 
@@ -582,6 +586,9 @@ test_tcp_clients_command_fn (vlib_main_t * vm,
 	tm->no_return = 1;
       else if (unformat (input, "fifo-size %d", &tm->fifo_size))
 	tm->fifo_size <<= 10;
+      else if (unformat (input, "cc-algo %U", unformat_tcp_cc_algo,
+			 &cc_algo))
+	tm->tcp_cc_algo = cc_algo + 1;
       else
 	return clib_error_return (0, "unknown input `%U'",
 				  format_unformat_error, input);
@@ -618,6 +625,8 @@ test_tcp_clients_command_fn (vlib_main_t * vm,
 	  return clib_error_return (0, "app attach failed");
 	}
     }
+  else if ((app = application_get_if_valid (tm->app_index)))
+    app->tcp_cc_algo = tm->tcp_cc_algo;
   tm->test_client_attached = 1;
 
   /* Turn on the builtin client input nodes */
@@ -700,7 +709,7 @@ VLIB_CLI_COMMAND (test_clients_command, static) =
 {
   .path = "test tcp clients",
   .short_help = "test tcp clients [nclients %d]"
-  "[iterations %d] [bytes %d] [uri tcp://6.0.1.1/1234]",
+  "[iterations %d] [bytes %d] [uri tcp://6.0.1.1/1234] [cc-algo <name>]",
   .function = test_tcp_clients_command_fn,
 };
 /* *INDENT-ON* */
@@ -48,8 +48,8 @@ typedef struct
    * Application setup parameters
    */
   unix_shared_memory_queue_t *vl_input_queue;	/**< vpe input queue */
-  unix_shared_memory_queue_t *our_event_queue;	/**< Our event queue */
-  unix_shared_memory_queue_t *vpp_event_queue;	/**< $$$ single thread */
+  svm_ring_t *our_event_queue;			/**< Our event queue */
+  svm_ring_t *vpp_event_queue;			/**< $$$ single thread */
 
   u32 cli_node_index;			/**< cli process node index */
   u32 my_client_index;			/**< loopback API client handle */
@@ -93,6 +93,7 @@ typedef struct
   int i_am_master;
   int drop_packets;		/**< drop all packets */
   u8 prealloc_fifos;		/**< Request fifo preallocation */
+  u8 tcp_cc_algo;		/**< Congestion control algorithm + 1 */
 
   /*
    * Convenience
@@ -45,7 +45,7 @@ typedef enum
 typedef struct
 {
   u8 *rx_buf;
-  unix_shared_memory_queue_t **vpp_queue;
+  svm_ring_t **vpp_queue;
   u64 byte_index;
 
   uword *handler_by_get_request;
@@ -179,9 +179,8 @@ send_data (stream_session_t * s, u8 * data)
 	      evt.event_type = FIFO_EVENT_APP_TX;
 	      evt.event_id = 0;
 
-	      unix_shared_memory_queue_add (hsm->vpp_queue[s->thread_index],
-					    (u8 *) & evt,
-					    0 /* do wait for mutex */ );
+	      svm_ring_enqueue (hsm->vpp_queue[s->thread_index], &evt,
+				0 /* wait */ );
 	    }
 	  delay = 10e-3;
 	}
@@ -428,9 +427,8 @@ http_server_rx_callback (stream_session_t * s)
       evt.rpc_args.fp = alloc_http_process_callback;
       evt.rpc_args.arg = s;
       evt.event_type = FIFO_EVENT_RPC;
-      unix_shared_memory_queue_add
-	(session_manager_get_vpp_event_queue (0 /* main thread */ ),
-	 (u8 *) & evt, 0 /* do wait for mutex */ );
+      svm_ring_enqueue (session_manager_get_vpp_event_queue
+			(0 /* main thread */ ), &evt, 0 /* wait */ );
     }
   else
     alloc_http_process (s);
@@ -17,6 +17,7 @@
 #include <vlibmemory/api.h>
 #include <vnet/session/application.h>
 #include <vnet/session/application_interface.h>
+#include <vnet/tcp/tcp.h>
 
 /* define message IDs */
 #include <vpp/api/vpe_msg_enum.h>
@@ -42,7 +43,7 @@ typedef struct
   /*
    * Server app parameters
    */
-  unix_shared_memory_queue_t **vpp_queue;
+  svm_ring_t **vpp_queue;
   unix_shared_memory_queue_t *vl_input_queue;	/**< Sever's event queue */
 
   u32 app_index;		/**< Server app index */
@@ -53,9 +54,12 @@ typedef struct
    * Config params
    */
   u8 no_echo;			/**< Don't echo traffic */
+  u8 rx_zero_copy;		/**< Read rx data from vpp's buffers */
+  u32 rx_hold;			/**< Buffers to hold on to, zero-copy rx */
   u32 fifo_size;		/**< Fifo size */
   u32 rcv_buffer_size;		/**< Rcv buffer size */
   u32 prealloc_fifos;		/**< Preallocate fifos */
+  u8 tcp_cc_algo;		/**< Congestion control algorithm + 1 */
 
   /*
    * Test state
@@ -164,6 +168,34 @@ builtin_server_rx_callback_no_echo (stream_session_t * s)
   return 0;
 }
 
+/*
+ * If zero-copy rx, the data is in buffers and, if the fifo already held
+ * some when it arrived, after them in the fifo. The newest rx_hold
+ * buffers are held on to, as an app still parsing them would, as long
+ * as they take no more than half the fifo.
+ */
+int
+builtin_server_rx_callback_zero_copy (stream_session_t * s)
+{
+  builtin_server_main_t *bsm = &builtin_server_main;
+  session_rx_desc_t *descs = stream_session_rx_descs (s);
+  u32 n_release = 0, n_bytes = 0, i;
+
+  for (i = vec_len (descs); i > 0; i--)
+    {
+      n_bytes += descs[i - 1].length;
+      if (vec_len (descs) - i >= bsm->rx_hold
+	  || n_bytes > s->server_rx_fifo->nitems / 2)
+	{
+	  n_release = i;
+	  break;
+	}
+    }
+
+  stream_session_rx_release (s, n_release);
+  return builtin_server_rx_callback_no_echo (s);
+}
+
 int
 builtin_server_rx_callback (stream_session_t * s)
 {
@@ -196,17 +228,13 @@ builtin_server_rx_callback (stream_session_t * s)
       /* Program self-tap to retry */
       if (svm_fifo_set_event (rx_fifo))
 	{
-	  unix_shared_memory_queue_t *q;
 	  evt.fifo = rx_fifo;
 	  evt.event_type = FIFO_EVENT_BUILTIN_RX;
 	  evt.event_id = 0;
 
-	  q = bsm->vpp_queue[s->thread_index];
-	  if (PREDICT_FALSE (q->cursize == q->maxsize))
+	  if (svm_ring_enqueue (bsm->vpp_queue[s->thread_index], &evt,
+				1 /* nowait */ ))
 	    clib_warning ("out of event queue space");
-	  else
-	    unix_shared_memory_queue_add (q, (u8 *) & evt,
-					  0 /* don't wait for mutex */ );
 	}
 
       return 0;
@@ -237,8 +265,8 @@ builtin_server_rx_callback (stream_session_t * s)
       evt.event_type = FIFO_EVENT_APP_TX;
       evt.event_id = serial_number++;
 
-      unix_shared_memory_queue_add (bsm->vpp_queue[s->thread_index],
-				    (u8 *) & evt, 0 /* do wait for mutex */ );
+      svm_ring_enqueue (bsm->vpp_queue[s->thread_index], &evt,
+			0 /* wait */ );
     }
 
   if (PREDICT_FALSE (max_enqueue < max_dequeue))
@@ -316,7 +344,10 @@ server_attach ()
   memset (a, 0, sizeof (*a));
   memset (options, 0, sizeof (options));
 
-  if (bsm->no_echo)
+  if (bsm->rx_zero_copy)
+    builtin_session_cb_vft.builtin_server_rx_callback =
+      builtin_server_rx_callback_zero_copy;
+  else if (bsm->no_echo)
     builtin_session_cb_vft.builtin_server_rx_callback =
       builtin_server_rx_callback_no_echo;
   else
@@ -329,8 +360,11 @@ server_attach ()
   a->options[SESSION_OPTIONS_RX_FIFO_SIZE] = bsm->fifo_size;
   a->options[SESSION_OPTIONS_TX_FIFO_SIZE] = bsm->fifo_size;
   a->options[APP_OPTIONS_FLAGS] = APP_OPTIONS_FLAGS_BUILTIN_APP;
+  if (bsm->rx_zero_copy)
+    a->options[APP_OPTIONS_FLAGS] |= APP_OPTIONS_FLAGS_RX_ZERO_COPY;
   a->options[APP_OPTIONS_PREALLOC_FIFO_PAIRS] =
     bsm->prealloc_fifos ? bsm->prealloc_fifos : 1;
+  a->options[APP_OPTIONS_TCP_CC_ALGO] = bsm->tcp_cc_algo;
   a->segment_name = segment_name;
   a->segment_name_length = ARRAY_LEN (segment_name);
 
@@ -434,28 +468,42 @@ server_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
 			  vlib_cli_command_t * cmd)
 {
   builtin_server_main_t *bsm = &builtin_server_main;
+  u32 cc_algo;
   int rv;
 
   bsm->no_echo = 0;
+  bsm->rx_zero_copy = 0;
+  bsm->rx_hold = 0;
   bsm->fifo_size = 64 << 10;
   bsm->rcv_buffer_size = 128 << 10;
   bsm->prealloc_fifos = 0;
+  bsm->tcp_cc_algo = 0;
 
   while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
     {
       if (unformat (input, "no-echo"))
 	bsm->no_echo = 1;
+      else if (unformat (input, "rx-zero-copy hold %d", &bsm->rx_hold))
+	bsm->rx_zero_copy = 1;
+      else if (unformat (input, "rx-zero-copy"))
+	bsm->rx_zero_copy = 1;
       else if (unformat (input, "fifo-size %d", &bsm->fifo_size))
 	bsm->fifo_size <<= 10;
       else if (unformat (input, "rcv-buf-size %d", &bsm->rcv_buffer_size))
 	;
       else if (unformat (input, "prealloc-fifos", &bsm->prealloc_fifos))
 	;
+      else if (unformat (input, "cc-algo %U", unformat_tcp_cc_algo,
+			 &cc_algo))
+	bsm->tcp_cc_algo = cc_algo + 1;
       else
 	return clib_error_return (0, "unknown input `%U'",
 				  format_unformat_error, input);
     }
 
+  if (bsm->rx_zero_copy && !bsm->no_echo)
+    return clib_error_return (0, "rx-zero-copy requires no-echo");
+
   tcp_builtin_server_api_hookup (vm);
   vnet_session_enable_disable (vm, 1 /* turn on TCP, etc. */ );
 
@@ -475,7 +523,9 @@ server_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
 VLIB_CLI_COMMAND (server_create_command, static) =
 {
   .path = "test tcp server",
-  .short_help = "test tcp server",
+  .short_help = "test tcp server [no-echo [rx-zero-copy [hold <n>]]] "
+  "[fifo-size <kb>] [rcv-buf-size <bytes>] [prealloc-fifos <n>] "
+  "[cc-algo <name>]",
   .function = server_create_command_fn,
 };
 /* *INDENT-ON* */
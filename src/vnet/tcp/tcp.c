@@ -17,6 +17,8 @@
 #include <vnet/session/session.h>
 #include <vnet/fib/fib.h>
 #include <vnet/dpo/load_balance.h>
+#include <vnet/adj/adj.h>
+#include <vnet/feature/feature.h>
 #include <math.h>
 
 tcp_main_t tcp_main;
@@ -625,7 +627,8 @@ format_tcp_vars (u8 * s, va_list * args)
   s = format (s, " flight size %u send space %u rcv_wnd_av %d\n",
 	      tcp_flight_size (tc), tcp_available_snd_space (tc),
 	      tcp_rcv_wnd_available (tc));
-  s = format (s, " cong %U ", format_tcp_congestion_status, tc);
+  s = format (s, " cong %U cc %s ", format_tcp_congestion_status, tc,
+	      tc->cc_algo ? tc->cc_algo->name : "none");
   s = format (s, "cwnd %u ssthresh %u rtx_bytes %u bytes_acked %u\n",
 	      tc->cwnd, tc->ssthresh, tc->snd_rxt_bytes, tc->bytes_acked);
   s = format (s, " prev_ssthresh %u snd_congestion %u dupack %u\n",
@@ -865,6 +868,76 @@ tcp_snd_space (tcp_connection_t * tc)
   return 0;
 }
 
+/**
+ * Check that a path leaves through an interface, or is local, such that
+ * the header offsets of a super-packet still hold when it is segmented.
+ * Tunnels push headers in their midchain adjacencies and output features
+ * would see the super-packet.
+ */
+static int
+tcp_dpo_supports_gso (const dpo_id_t * dpo, u32 depth)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_sw_interface_t *sw;
+  ip_adjacency_t *adj;
+  load_balance_t *lb;
+  u32 sw_if_index;
+  int i;
+
+  switch (dpo->dpoi_type)
+    {
+    case DPO_RECEIVE:
+      return 1;
+    case DPO_ADJACENCY:
+      adj = adj_get (dpo->dpoi_index);
+      sw_if_index = adj->rewrite_header.sw_if_index;
+      sw = vnet_get_sw_interface (vnm, sw_if_index);
+      return (adj->lookup_next_index == IP_LOOKUP_NEXT_REWRITE
+	      && !(adj->rewrite_header.flags & VNET_REWRITE_HAS_FEATURES)
+	      && (sw->type == VNET_SW_INTERFACE_TYPE_HARDWARE
+		  || sw->type == VNET_SW_INTERFACE_TYPE_SUB)
+	      && !vnet_have_features (vnm->interface_main.
+				      output_feature_arc_index, sw_if_index));
+    case DPO_LOAD_BALANCE:
+      /* Recursive routes */
+      if (depth == 0)
+	return 0;
+      lb = load_balance_get (dpo->dpoi_index);
+      for (i = 0; i < lb->lb_n_buckets; i++)
+	if (!tcp_dpo_supports_gso (load_balance_get_bucket_i (lb, i),
+				   depth - 1))
+	  return 0;
+      return 1;
+    default:
+      return 0;
+    }
+}
+
+/**
+ * Max payload the session layer may put in a packet. Above snd_mss, the
+ * packet is a GSO super-packet, segmented late. 0 if GSO is off or if
+ * a path to the peer does not support it.
+ */
+u32
+tcp_session_send_gso_size (transport_connection_t * trans_conn)
+{
+  tcp_connection_t *tc = (tcp_connection_t *) trans_conn;
+  const dpo_id_t *dpo;
+  u32 n_segs;
+
+  /* Recovery sends a segment at a time anyway */
+  if (!tcp_main.gso || tcp_in_cong_recovery (tc))
+    return 0;
+
+  /* Look at the current paths, they change under the connection */
+  dpo = fib_entry_contribute_ip_forwarding (tc->c_rmt_fei);
+  if (!tcp_dpo_supports_gso (dpo, 2))
+    return 0;
+
+  n_segs = clib_min (TCP_GSO_MAX_BYTES / tc->snd_mss, TCP_GSO_MAX_SEGS);
+  return n_segs * tc->snd_mss;
+}
+
 u32
 tcp_session_send_space (transport_connection_t * trans_conn)
 {
@@ -903,6 +976,7 @@ const static transport_proto_vft_t tcp4_proto = {
   .send_mss = tcp_session_send_mss,
   .send_space = tcp_session_send_space,
   .tx_fifo_offset = tcp_session_tx_fifo_offset,
+  .send_gso_size = tcp_session_send_gso_size,
   .format_connection = format_tcp_session,
   .format_listener = format_tcp_listener_session,
   .format_half_open = format_tcp_half_open_session,
@@ -921,6 +995,7 @@ const static transport_proto_vft_t tcp6_proto = {
   .send_mss = tcp_session_send_mss,
   .send_space = tcp_session_send_space,
   .tx_fifo_offset = tcp_session_tx_fifo_offset,
+  .send_gso_size = tcp_session_send_gso_size,
   .format_connection = format_tcp_session,
   .format_listener = format_tcp_listener_session,
   .format_half_open = format_tcp_half_open_session,
@@ -1033,6 +1108,23 @@ tcp_initialize_timer_wheels (tcp_main_t * tm)
   /* *INDENT-ON* */
 }
 
+/**
+ * Have ip4-local and ip6-local hand tcp segments to tcp-input, or to
+ * tcp-gro if enabled
+ */
+void
+tcp_register_with_ip (tcp_main_t * tm)
+{
+  /* Both arcs are added the first time, so that toggling gro only
+   * changes the next index the local nodes dispatch tcp to */
+  ip4_register_protocol (IP_PROTOCOL_TCP, tcp4_gro_node.index);
+  ip6_register_protocol (IP_PROTOCOL_TCP, tcp6_gro_node.index);
+  if (tm->gro)
+    return;
+  ip4_register_protocol (IP_PROTOCOL_TCP, tcp4_input_node.index);
+  ip6_register_protocol (IP_PROTOCOL_TCP, tcp6_input_node.index);
+}
+
 clib_error_t *
 tcp_main_enable (vlib_main_t * vm)
 {
@@ -1061,7 +1153,7 @@ tcp_main_enable (vlib_main_t * vm)
   pi->format_header = format_tcp_header;
   pi->unformat_pg_edit = unformat_pg_tcp_header;
 
-  ip4_register_protocol (IP_PROTOCOL_TCP, tcp4_input_node.index);
+  tcp_register_with_ip (tm);
 
   /* Register as transport with URI */
   session_register_transport (SESSION_TYPE_IP4_TCP, &tcp4_proto);
@@ -1090,6 +1182,7 @@ tcp_main_enable (vlib_main_t * vm)
 			 200000 /* $$$$ config parameter nbuckets */ ,
 			 (64 << 20) /*$$$ config parameter table size */ );
 
+  tm->is_enabled = 1;
   return error;
 }
 
@@ -1125,6 +1218,147 @@ tcp_init (vlib_main_t * vm)
 
 VLIB_INIT_FUNCTION (tcp_init);
 
+uword
+unformat_tcp_cc_algo (unformat_input_t * input, va_list * va)
+{
+  tcp_cc_algorithm_type_e *result = va_arg (*va, tcp_cc_algorithm_type_e *);
+  tcp_main_t *tm = vnet_get_tcp_main ();
+  int i;
+
+  for (i = 0; i < vec_len (tm->cc_algos); i++)
+    if (tm->cc_algos[i].name
+	&& unformat (input, (char *) tm->cc_algos[i].name))
+      {
+	*result = i;
+	return 1;
+      }
+  return 0;
+}
+
+static void
+tcp_gso_enable_disable (u8 is_enable)
+{
+  tcp_main.gso = is_enable;
+  vnet_get_main ()->interface_main.gso_enabled = is_enable;
+}
+
+static clib_error_t *
+tcp_config_fn (vlib_main_t * vm, unformat_input_t * input)
+{
+  tcp_main_t *tm = vnet_get_tcp_main ();
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "cc-algo %U", unformat_tcp_cc_algo, &tm->cc_algo))
+	;
+      else if (unformat (input, "gso"))
+	tcp_gso_enable_disable (1);
+      else if (unformat (input, "gro"))
+	tcp_gro_enable_disable (1);
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+  return 0;
+}
+
+VLIB_CONFIG_FUNCTION (tcp_config_fn, "tcp");
+
+static clib_error_t *
+tcp_set_cc_algo_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			    vlib_cli_command_t * cmd)
+{
+  tcp_main_t *tm = vnet_get_tcp_main ();
+  tcp_cc_algorithm_type_e type;
+
+  if (!unformat (input, "%U", unformat_tcp_cc_algo, &type))
+    return clib_error_return (0, "unknown algorithm `%U'",
+			      format_unformat_error, input);
+
+  tm->cc_algo = type;
+  return 0;
+}
+
+/*?
+ * Set the congestion control algorithm of the new connections of the
+ * applications which did not pick one when attaching, with the
+ * APP_OPTIONS_TCP_CC_ALGO option. Existing connections keep theirs.
+ * Also settable at startup with "tcp { cc-algo <name> }".
+ *
+ * @cliexpar
+ * @cliexcmd{set tcp cc-algo cubic}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (tcp_set_cc_algo_command, static) =
+{
+  .path = "set tcp cc-algo",
+  .short_help = "set tcp cc-algo [newreno|cubic|bbr]",
+  .function = tcp_set_cc_algo_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+tcp_show_cc_algo_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			     vlib_cli_command_t * cmd)
+{
+  tcp_main_t *tm = vnet_get_tcp_main ();
+  int i;
+
+  for (i = 0; i < vec_len (tm->cc_algos); i++)
+    if (tm->cc_algos[i].name)
+      vlib_cli_output (vm, "%s%s", tm->cc_algos[i].name,
+		       i == tm->cc_algo ? " (default)" : "");
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (tcp_show_cc_algo_command, static) =
+{
+  .path = "show tcp cc-algo",
+  .short_help = "show tcp cc-algo",
+  .function = tcp_show_cc_algo_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+tcp_gso_command_fn (vlib_main_t * vm, unformat_input_t * input,
+		    vlib_cli_command_t * cmd)
+{
+  u8 is_enable = 1;
+
+  if (unformat (input, "disable"))
+    is_enable = 0;
+  else if (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    return clib_error_return (0, "unknown input `%U'",
+			      format_unformat_error, input);
+
+  vlib_worker_thread_barrier_sync (vm);
+  tcp_gso_enable_disable (is_enable);
+  vlib_worker_thread_barrier_release (vm);
+  return 0;
+}
+
+/*?
+ * Have tcp hand bulk data to ip as GSO super-packets of up to 64
+ * segments, with a single header. Interfaces whose device does not
+ * support TSO segment them in software in interface-output, others
+ * in hardware. Also settable at startup with "tcp { gso }".
+ *
+ * Connections whose peer is reached through a tunnel, or through an
+ * interface with output features, keep sending a segment per packet.
+ *
+ * @cliexpar
+ * @cliexcmd{set tcp gso}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (tcp_gso_command, static) =
+{
+  .path = "set tcp gso",
+  .short_help = "set tcp gso [disable]",
+  .function = tcp_gso_command_fn,
+};
+/* *INDENT-ON* */
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
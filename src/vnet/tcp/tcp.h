@@ -36,6 +36,8 @@
 #define TCP_IW_N_SEGMENTS 	10
 #define TCP_ALWAYS_ACK		1	/**< On/off delayed acks */
 #define TCP_USE_SACKS		1	/**< Disable only for testing */
+#define TCP_GSO_MAX_SEGS	64	/**< Max segments per GSO packet */
+#define TCP_GSO_MAX_BYTES	(65535 - MAX_HDRS_LEN)
 
 /** TCP FSM state definitions as per RFC793. */
 #define foreach_tcp_fsm_state   \
@@ -182,8 +184,14 @@ typedef struct _sack_scoreboard
 typedef enum _tcp_cc_algorithm_type
 {
   TCP_CC_NEWRENO,
+  TCP_CC_CUBIC,
+  TCP_CC_BBR,
+  TCP_CC_LAST,
 } tcp_cc_algorithm_type_e;
 
+/* Sized to the largest algorithm data, bbr_data_t */
+#define TCP_CC_DATA_SZ 19
+
 typedef struct _tcp_cc_algorithm tcp_cc_algorithm_t;
 
 typedef enum _tcp_cc_ack_t
@@ -246,6 +254,7 @@ typedef struct _tcp_connection
   u32 tsecr_last_ack;	/**< Timestamp echoed to us in last healthy ACK */
   u32 snd_congestion;	/**< snd_una_max when congestion is detected */
   tcp_cc_algorithm_t *cc_algo;	/**< Congestion control algorithm */
+  u64 cc_data[TCP_CC_DATA_SZ];	/**< Congestion control algorithm data */
 
   /* RTT and RTO */
   u32 rto;		/**< Retransmission timeout */
@@ -262,6 +271,7 @@ typedef struct _tcp_connection
 
 struct _tcp_cc_algorithm
 {
+  const char *name;
   void (*rcv_ack) (tcp_connection_t * tc);
   void (*rcv_cong_ack) (tcp_connection_t * tc, tcp_cc_ack_t ack);
   void (*congestion) (tcp_connection_t * tc);
@@ -345,9 +355,23 @@ typedef struct _tcp_main
   /* Congestion control algorithms registered */
   tcp_cc_algorithm_t *cc_algos;
 
+  /* Congestion control algorithm of the connections of the apps
+   * which did not pick one */
+  tcp_cc_algorithm_type_e cc_algo;
+
   /* Flag that indicates if stack is on or off */
   u8 is_enabled;
 
+  /* Segments sent go through tcp-impair, see tcp_impair.c */
+  u8 impair;
+
+  /* Send GSO super-packets, segmented by the interface output path or
+   * the NIC */
+  u8 gso;
+
+  /* Segments received go through tcp-gro, see tcp_gro.c */
+  u8 gro;
+
   /* convenience */
   vlib_main_t *vlib_main;
   vnet_main_t *vnet_main;
@@ -360,6 +384,8 @@ extern vlib_node_registration_t tcp4_input_node;
 extern vlib_node_registration_t tcp6_input_node;
 extern vlib_node_registration_t tcp4_output_node;
 extern vlib_node_registration_t tcp6_output_node;
+extern vlib_node_registration_t tcp4_gro_node;
+extern vlib_node_registration_t tcp6_gro_node;
 
 always_inline tcp_main_t *
 vnet_get_tcp_main ()
@@ -376,6 +402,8 @@ tcp_buffer_hdr (vlib_buffer_t * b)
 }
 
 clib_error_t *vnet_tcp_enable_disable (vlib_main_t * vm, u8 is_en);
+void tcp_register_with_ip (tcp_main_t * tm);
+void tcp_gro_enable_disable (u8 is_enable);
 
 always_inline tcp_connection_t *
 tcp_connection_get (u32 conn_index, u32 thread_index)
@@ -422,6 +450,7 @@ void tcp_make_synack (tcp_connection_t * ts, vlib_buffer_t * b);
 void tcp_send_reset (vlib_buffer_t * pkt, u8 is_ip4);
 void tcp_send_syn (tcp_connection_t * tc);
 void tcp_send_fin (tcp_connection_t * tc);
+void tcp_send_ack (tcp_connection_t * tc);
 void tcp_init_mss (tcp_connection_t * tc);
 void tcp_update_snd_mss (tcp_connection_t * tc);
 void tcp_update_rto (tcp_connection_t * tc);
@@ -776,6 +805,16 @@ tcp_cc_algo_get (tcp_cc_algorithm_type_e type)
   return &tm->cc_algos[type];
 }
 
+always_inline void *
+tcp_cc_data (tcp_connection_t * tc)
+{
+  return (void *) tc->cc_data;
+}
+
+uword unformat_tcp_cc_algo (unformat_input_t * input, va_list * va);
+
+void newreno_rcv_cong_ack (tcp_connection_t * tc, tcp_cc_ack_t ack_type);
+
 void tcp_cc_init (tcp_connection_t * tc);
 
 /**
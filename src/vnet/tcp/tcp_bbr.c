@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * BBR congestion control, after draft-cardwell-iccrg-bbr-congestion-control.
+ *
+ * BBR models the path with the bottleneck bandwidth, the max delivery
+ * rate of the last rounds, and the min RTT of the last 10 s, and sizes
+ * the window from their product rather than from losses.
+ *
+ * Differences with the draft: the stack does not pace, so the gains
+ * the draft applies to the pacing rate are applied to the window, and
+ * the delivery rate is sampled once per round trip, as the bytes acked
+ * during the round over its duration, instead of per packet.
+ */
+
+#include <vnet/tcp/tcp.h>
+
+#define BBR_BW_FILTER_LEN	10	/* rounds */
+#define BBR_MIN_RTT_WINDOW	10.0	/* s */
+#define BBR_PROBE_RTT_TIME	0.2	/* s */
+#define BBR_HIGH_GAIN		2.885	/* 2/ln(2) */
+#define BBR_FULL_BW_GROWTH	1.25
+#define BBR_FULL_BW_ROUNDS	3
+#define BBR_MIN_CWND_SEGS	4
+/* for delayed and stretched acks */
+#define BBR_CWND_HEADROOM_SEGS	3
+#define BBR_CYCLE_LEN		8
+
+typedef enum
+{
+  BBR_STATE_STARTUP,
+  BBR_STATE_DRAIN,
+  BBR_STATE_PROBE_BW,
+  BBR_STATE_PROBE_RTT,
+} bbr_state_t;
+
+typedef struct
+{
+  f64 bw[BBR_BW_FILTER_LEN];	/**< Delivery rate of the last rounds, B/s */
+  f64 full_bw;			/**< Bandwidth when startup last grew it */
+  f64 min_rtt;			/**< Min round duration, s */
+  f64 min_rtt_stamp;		/**< When min_rtt was last updated */
+  f64 probe_rtt_done;		/**< End of the current probe rtt */
+  f64 round_start;		/**< Start of the current round */
+  u64 delivered;		/**< Bytes acked since the start */
+  u64 round_delivered;		/**< Bytes acked at the start of the round */
+  u32 round_end;		/**< Round ends when this sequence is acked */
+  u32 round_count;
+  u32 prior_cwnd;		/**< Window before loss or probe rtt */
+  u8 state;			/**< See bbr_state_t */
+  u8 cycle_index;		/**< Position in bbr_cycle_gain */
+  u8 full_bw_count;		/**< Rounds without bandwidth growth */
+  u8 full_bw_reached;
+} bbr_data_t;
+
+STATIC_ASSERT (sizeof (bbr_data_t) <= TCP_CC_DATA_SZ * sizeof (u64),
+	       "bbr data too large");
+STATIC_ASSERT (sizeof (bbr_data_t) > (TCP_CC_DATA_SZ - 1) * sizeof (u64),
+	       "bbr data shrunk, shrink TCP_CC_DATA_SZ");
+
+/* probe for more, drain the queue probing built, then cruise */
+static const f64 bbr_cycle_gain[BBR_CYCLE_LEN] = {
+  1.25, 0.75, 1, 1, 1, 1, 1, 1
+};
+
+static inline f64
+bbr_max_bw (bbr_data_t * bd)
+{
+  f64 bw = 0;
+  int i;
+
+  for (i = 0; i < BBR_BW_FILTER_LEN; i++)
+    bw = clib_max (bw, bd->bw[i]);
+  return bw;
+}
+
+/* gain times the bandwidth delay product, 0 while unknown */
+static inline u32
+bbr_target_cwnd (tcp_connection_t * tc, bbr_data_t * bd, f64 gain)
+{
+  f64 bdp = bbr_max_bw (bd) * bd->min_rtt;
+
+  if (bdp == 0)
+    return 0;
+
+  bdp = gain * bdp + BBR_CWND_HEADROOM_SEGS * tc->snd_mss;
+  return clib_min (bdp, (f64) (u32) ~ 0);
+}
+
+static void
+bbr_enter_probe_bw (bbr_data_t * bd)
+{
+  bd->state = BBR_STATE_PROBE_BW;
+  /* Start anywhere in the cycle but on the drain phase */
+  bd->cycle_index = bd->round_count % BBR_CYCLE_LEN;
+  if (bd->cycle_index == 1)
+    bd->cycle_index = 2;
+}
+
+static void
+bbr_round_end (tcp_connection_t * tc, bbr_data_t * bd, f64 now)
+{
+  f64 round_time = now - bd->round_start, bw;
+  int min_rtt_expired;
+
+  if (round_time > 0 && bd->delivered > bd->round_delivered)
+    {
+      bw = (bd->delivered - bd->round_delivered) / round_time;
+      bd->bw[bd->round_count % BBR_BW_FILTER_LEN] = bw;
+
+      min_rtt_expired = now > bd->min_rtt_stamp + BBR_MIN_RTT_WINDOW;
+      if (bd->min_rtt == 0 || round_time < bd->min_rtt || min_rtt_expired)
+	{
+	  bd->min_rtt = round_time;
+	  bd->min_rtt_stamp = now;
+	}
+      if (min_rtt_expired && bd->state != BBR_STATE_PROBE_RTT)
+	{
+	  bd->prior_cwnd = tc->cwnd;
+	  bd->probe_rtt_done = now + clib_max (BBR_PROBE_RTT_TIME,
+					       bd->min_rtt);
+	  bd->state = BBR_STATE_PROBE_RTT;
+	}
+    }
+
+  bd->round_count++;
+  bd->round_start = now;
+  bd->round_delivered = bd->delivered;
+  bd->round_end = tc->snd_una_max;
+
+  switch (bd->state)
+    {
+    case BBR_STATE_STARTUP:
+      bw = bbr_max_bw (bd);
+      if (bw >= bd->full_bw * BBR_FULL_BW_GROWTH)
+	{
+	  bd->full_bw = bw;
+	  bd->full_bw_count = 0;
+	}
+      else if (++bd->full_bw_count >= BBR_FULL_BW_ROUNDS)
+	{
+	  bd->full_bw_reached = 1;
+	  bd->state = BBR_STATE_DRAIN;
+	}
+      break;
+    case BBR_STATE_DRAIN:
+      if (tcp_flight_size (tc) <= bbr_target_cwnd (tc, bd, 1))
+	bbr_enter_probe_bw (bd);
+      break;
+    case BBR_STATE_PROBE_BW:
+      bd->cycle_index = (bd->cycle_index + 1) % BBR_CYCLE_LEN;
+      break;
+    case BBR_STATE_PROBE_RTT:
+      if (now >= bd->probe_rtt_done)
+	{
+	  bd->min_rtt_stamp = now;
+	  tc->cwnd = clib_max (tc->cwnd, bd->prior_cwnd);
+	  if (bd->full_bw_reached)
+	    bbr_enter_probe_bw (bd);
+	  else
+	    bd->state = BBR_STATE_STARTUP;
+	}
+      break;
+    }
+}
+
+static void
+bbr_update (tcp_connection_t * tc, bbr_data_t * bd)
+{
+  bd->delivered += tc->bytes_acked;
+  /* The first round ends with the first ack, the iss may not be known
+   * at init */
+  if (bd->round_count == 0 || seq_geq (tc->snd_una, bd->round_end))
+    bbr_round_end (tc, bd, vlib_time_now (vlib_get_main ()));
+}
+
+static void
+bbr_set_cwnd (tcp_connection_t * tc, bbr_data_t * bd)
+{
+  u32 min_cwnd = BBR_MIN_CWND_SEGS * tc->snd_mss, target;
+  f64 gain;
+
+  if (bd->state == BBR_STATE_PROBE_RTT)
+    {
+      tc->cwnd = min_cwnd;
+      return;
+    }
+
+  if (bd->state == BBR_STATE_STARTUP)
+    gain = BBR_HIGH_GAIN;
+  else if (bd->state == BBR_STATE_DRAIN)
+    gain = 1;
+  else
+    gain = bbr_cycle_gain[bd->cycle_index];
+
+  target = bbr_target_cwnd (tc, bd, gain);
+
+  /* Grow as in slow start until the model is known */
+  if (target == 0 || tc->cwnd < target)
+    {
+      tc->cwnd += tc->bytes_acked;
+      if (target)
+	tc->cwnd = clib_min (tc->cwnd, target);
+    }
+  else
+    tc->cwnd = target;
+
+  tc->cwnd = clib_max (tc->cwnd, min_cwnd);
+}
+
+static void
+bbr_congestion (tcp_connection_t * tc)
+{
+  bbr_data_t *bd = tcp_cc_data (tc);
+
+  /* No reduction: send at most what left the network while recovering,
+   * and get the window back once recovered */
+  bd->prior_cwnd = tc->cwnd;
+  tc->ssthresh = clib_max (tcp_flight_size (tc), 2 * tc->snd_mss);
+}
+
+static void
+bbr_recovered (tcp_connection_t * tc)
+{
+  bbr_data_t *bd = tcp_cc_data (tc);
+  tc->cwnd = clib_max (tc->ssthresh, bd->prior_cwnd);
+}
+
+static void
+bbr_rcv_ack (tcp_connection_t * tc)
+{
+  bbr_data_t *bd = tcp_cc_data (tc);
+
+  bbr_update (tc, bd);
+  bbr_set_cwnd (tc, bd);
+}
+
+static void
+bbr_rcv_cong_ack (tcp_connection_t * tc, tcp_cc_ack_t ack_type)
+{
+  bbr_data_t *bd = tcp_cc_data (tc);
+
+  bbr_update (tc, bd);
+  newreno_rcv_cong_ack (tc, ack_type);
+}
+
+static void
+bbr_conn_init (tcp_connection_t * tc)
+{
+  bbr_data_t *bd = tcp_cc_data (tc);
+
+  memset (bd, 0, sizeof (*bd));
+  bd->state = BBR_STATE_STARTUP;
+  bd->round_start = bd->min_rtt_stamp = vlib_time_now (vlib_get_main ());
+  tc->ssthresh = tc->snd_wnd;
+  tc->cwnd = tcp_initial_cwnd (tc);
+}
+
+const static tcp_cc_algorithm_t tcp_bbr = {
+  .name = "bbr",
+  .congestion = bbr_congestion,
+  .recovered = bbr_recovered,
+  .rcv_ack = bbr_rcv_ack,
+  .rcv_cong_ack = bbr_rcv_cong_ack,
+  .init = bbr_conn_init
+};
+
+clib_error_t *
+bbr_init (vlib_main_t * vm)
+{
+  clib_error_t *error = 0;
+
+  tcp_cc_algo_register (TCP_CC_BBR, &tcp_bbr);
+
+  return error;
+}
+
+VLIB_INIT_FUNCTION (bbr_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
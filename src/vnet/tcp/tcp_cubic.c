@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * CUBIC congestion control, RFC 8312.
+ *
+ * In congestion avoidance the window grows as a cubic function of the
+ * time elapsed since the last reduction, centred on the window at the
+ * reduction, W_max. The growth does not depend on the RTT, which is
+ * what NewReno lacks on long fat paths. Where NewReno would grow
+ * faster, at short RTTs, the window follows NewReno's estimate.
+ */
+
+#include <vnet/tcp/tcp.h>
+#include <math.h>
+
+#define cubic_beta 0.7
+#define cubic_c 0.4
+#define cubic_west_alpha (3 * (1 - cubic_beta) / (1 + cubic_beta))
+
+typedef struct
+{
+  f64 epoch_start;	/**< Start of the congestion avoidance epoch */
+  f64 K;		/**< Time for the window to get back to W_max */
+  f64 w_max;		/**< Window before the last reduction, segments */
+  f64 cwnd_inc;		/**< Fraction of a byte of window increase */
+} cubic_data_t;
+
+STATIC_ASSERT (sizeof (cubic_data_t) <= TCP_CC_DATA_SZ * sizeof (u64),
+	       "cubic data too large");
+
+static inline f64
+cubic_time_now (void)
+{
+  return vlib_time_now (vlib_get_main ());
+}
+
+static void
+cubic_congestion (tcp_connection_t * tc)
+{
+  cubic_data_t *cd = tcp_cc_data (tc);
+  f64 w = (f64) tc->cwnd / tc->snd_mss;
+
+  /* Fast convergence, RFC 8312 Sec. 4.6: if the window did not get
+   * back to W_max, release some bandwidth for the new flows */
+  if (w < cd->w_max)
+    cd->w_max = w * (1 + cubic_beta) / 2;
+  else
+    cd->w_max = w;
+
+  tc->ssthresh = clib_max (tc->cwnd * cubic_beta, 2 * tc->snd_mss);
+  cd->epoch_start = 0;
+}
+
+static void
+cubic_recovered (tcp_connection_t * tc)
+{
+  tc->cwnd = tc->ssthresh;
+}
+
+static void
+cubic_rcv_ack (tcp_connection_t * tc)
+{
+  cubic_data_t *cd = tcp_cc_data (tc);
+  f64 now, t, rtt, w, w_cubic, w_est, target;
+  u32 inc;
+
+  if (tcp_in_slowstart (tc))
+    {
+      tc->cwnd += clib_min (tc->snd_mss, tc->bytes_acked);
+      return;
+    }
+
+  now = cubic_time_now ();
+  w = (f64) tc->cwnd / tc->snd_mss;
+
+  if (cd->epoch_start == 0)
+    {
+      cd->epoch_start = now;
+      if (w < cd->w_max)
+	cd->K = cbrt ((cd->w_max - w) / cubic_c);
+      else
+	{
+	  cd->K = 0;
+	  cd->w_max = w;
+	}
+    }
+
+  t = now - cd->epoch_start;
+  rtt = clib_max (tc->srtt, 1) * TCP_TICK;
+
+  /* The window one RTT from now, W_cubic(t + RTT) */
+  w_cubic = t + rtt - cd->K;
+  w_cubic = cubic_c * w_cubic * w_cubic * w_cubic + cd->w_max;
+
+  /* NewReno's window, W_est(t) */
+  w_est = cd->w_max * cubic_beta + cubic_west_alpha * t / rtt;
+
+  target = clib_max (w_cubic, w_est);
+  target = clib_min (target, 1.5 * w);
+  if (target <= w)
+    return;
+
+  /* (target - cwnd) / cwnd segments per segment acked */
+  cd->cwnd_inc += (target - w) / w * tc->bytes_acked;
+  if (cd->cwnd_inc >= 1)
+    {
+      inc = cd->cwnd_inc;
+      tc->cwnd += inc;
+      cd->cwnd_inc -= inc;
+    }
+}
+
+static void
+cubic_rcv_cong_ack (tcp_connection_t * tc, tcp_cc_ack_t ack_type)
+{
+  newreno_rcv_cong_ack (tc, ack_type);
+}
+
+static void
+cubic_conn_init (tcp_connection_t * tc)
+{
+  cubic_data_t *cd = tcp_cc_data (tc);
+
+  memset (cd, 0, sizeof (*cd));
+  tc->ssthresh = tc->snd_wnd;
+  tc->cwnd = tcp_initial_cwnd (tc);
+}
+
+const static tcp_cc_algorithm_t tcp_cubic = {
+  .name = "cubic",
+  .congestion = cubic_congestion,
+  .recovered = cubic_recovered,
+  .rcv_ack = cubic_rcv_ack,
+  .rcv_cong_ack = cubic_rcv_cong_ack,
+  .init = cubic_conn_init
+};
+
+clib_error_t *
+cubic_init (vlib_main_t * vm)
+{
+  clib_error_t *error = 0;
+
+  tcp_cc_algo_register (TCP_CC_CUBIC, &tcp_cubic);
+
+  return error;
+}
+
+VLIB_INIT_FUNCTION (cubic_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,499 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Receive offload: when enabled, ip4-local and ip6-local hand tcp
+ * segments to tcp4-gro and tcp6-gro, which merge the in order segments
+ * of a flow found in the same frame into one buffer chain, and pass
+ * the result to tcp-input. tcp-input then does the session lookup, the
+ * ack and the fifo enqueue once for the chain.
+ *
+ * Only pure data segments, ack or ack and psh, with the same ack,
+ * window and options as the first segment of the chain are merged, so
+ * that tcp sees what it would have seen had the peer sent a larger
+ * segment. A segment shorter than the first, or with psh, ends the
+ * chain.
+ */
+
+#include <vnet/tcp/tcp.h>
+
+/* Flows merged in parallel within a frame */
+#define TCP_GRO_MAX_FLOWS	8
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  u64 n_segs;			/**< Segments received */
+  u64 n_pkts;			/**< Packets passed to tcp-input */
+} tcp_gro_stats_t;
+
+typedef struct
+{
+  /** Per thread counters */
+  tcp_gro_stats_t *stats;
+} tcp_gro_main_t;
+
+tcp_gro_main_t tcp_gro_main;
+
+typedef struct
+{
+  vlib_buffer_t *head;
+  vlib_buffer_t *tail;
+  void *ip;			/**< The head's ip header */
+  tcp_header_t *th;		/**< The head's tcp header */
+  u32 next_seq;			/**< Sequence the next segment must start at */
+  u16 seg_len;			/**< Payload of the head */
+  u16 n_segs;
+} tcp_gro_flow_t;
+
+typedef struct
+{
+  u32 n_segs;
+  u32 n_bytes;
+} tcp_gro_trace_t;
+
+static u8 *
+format_tcp_gro_trace (u8 * s, va_list * args)
+{
+  CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
+  CLIB_UNUSED (vlib_node_t * node) = va_arg (*args, vlib_node_t *);
+  tcp_gro_trace_t *t = va_arg (*args, tcp_gro_trace_t *);
+
+  s = format (s, "%d segments merged, %d bytes", t->n_segs, t->n_bytes);
+  return s;
+}
+
+#define foreach_tcp_gro_error				\
+_(SEGMENTS, "segments received")			\
+_(PACKETS, "packets to tcp-input")
+
+typedef enum
+{
+#define _(sym,str) TCP_GRO_ERROR_##sym,
+  foreach_tcp_gro_error
+#undef _
+    TCP_GRO_N_ERROR,
+} tcp_gro_error_t;
+
+static char *tcp_gro_error_strings[] = {
+#define _(sym,string) string,
+  foreach_tcp_gro_error
+#undef _
+};
+
+typedef enum
+{
+  TCP_GRO_NEXT_INPUT,
+  TCP_GRO_N_NEXT,
+} tcp_gro_next_t;
+
+/**
+ * Find the segment's tcp header and payload length if it can be merged:
+ * a single buffer, without ip options, fragments or padding, carrying
+ * data and no other flag than ack and psh.
+ */
+always_inline int
+tcp_gro_segment_mergeable (vlib_buffer_t * b, u8 is_ip4,
+			   tcp_header_t ** th, u16 * payload)
+{
+  ip4_header_t *ip4 = vlib_buffer_get_current (b);
+  ip6_header_t *ip6 = vlib_buffer_get_current (b);
+  int len, hdr_len;
+
+  if (b->flags & VLIB_BUFFER_NEXT_PRESENT)
+    return 0;
+
+  if (is_ip4)
+    {
+      if (ip4->ip_version_and_header_length != 0x45
+	  || ip4_is_fragment (ip4))
+	return 0;
+      *th = ip4_next_header (ip4);
+      len = clib_net_to_host_u16 (ip4->length);
+      hdr_len = sizeof (*ip4);
+    }
+  else
+    {
+      *th = ip6_next_header (ip6);
+      len = clib_net_to_host_u16 (ip6->payload_length) + sizeof (*ip6);
+      hdr_len = sizeof (*ip6);
+    }
+
+  if (((*th)->flags & ~TCP_FLAG_PSH) != TCP_FLAG_ACK
+      || b->current_length != len)
+    return 0;
+
+  hdr_len += tcp_header_bytes (*th);
+  if (len <= hdr_len)
+    return 0;
+
+  *payload = len - hdr_len;
+  return 1;
+}
+
+always_inline tcp_gro_flow_t *
+tcp_gro_flow_find (tcp_gro_flow_t * flows, int n_flows, void *ip,
+		   tcp_header_t * th, u8 is_ip4)
+{
+  tcp_gro_flow_t *f;
+
+  for (f = flows; f < flows + n_flows; f++)
+    {
+      if (f->th->src_port != th->src_port || f->th->dst_port != th->dst_port)
+	continue;
+
+      if (is_ip4)
+	{
+	  ip4_header_t *ip4 = ip, *fip4 = f->ip;
+	  if (ip4->src_address.as_u32 == fip4->src_address.as_u32
+	      && ip4->dst_address.as_u32 == fip4->dst_address.as_u32)
+	    return f;
+	}
+      else
+	{
+	  ip6_header_t *ip6 = ip, *fip6 = f->ip;
+	  if (ip6_address_is_equal (&ip6->src_address, &fip6->src_address)
+	      && ip6_address_is_equal (&ip6->dst_address, &fip6->dst_address))
+	    return f;
+	}
+    }
+  return 0;
+}
+
+always_inline int
+tcp_gro_can_merge (vlib_main_t * vm, tcp_gro_flow_t * f, void *ip,
+		   tcp_header_t * th, u16 payload, u8 is_ip4)
+{
+  int opts_len;
+
+  if (clib_net_to_host_u32 (th->seq_number) != f->next_seq
+      || th->ack_number != f->th->ack_number
+      || th->window != f->th->window
+      || th->data_offset_and_reserved != f->th->data_offset_and_reserved
+      || payload > f->seg_len
+      || vlib_buffer_length_in_chain (vm, f->head) + payload > 65535)
+    return 0;
+
+  if (is_ip4)
+    {
+      ip4_header_t *ip4 = ip, *fip4 = f->ip;
+      if (ip4->tos != fip4->tos || ip4->ttl != fip4->ttl)
+	return 0;
+    }
+  else
+    {
+      ip6_header_t *ip6 = ip, *fip6 = f->ip;
+      if (ip6->ip_version_traffic_class_and_flow_label
+	  != fip6->ip_version_traffic_class_and_flow_label
+	  || ip6->hop_limit != fip6->hop_limit)
+	return 0;
+    }
+
+  /* Timestamps included, tcp would not use the ones of merged segments */
+  opts_len = tcp_header_bytes (th) - sizeof (*th);
+  return opts_len == 0 || !memcmp (th + 1, f->th + 1, opts_len);
+}
+
+always_inline void
+tcp_gro_flow_append (vlib_main_t * vm, tcp_gro_flow_t * f, u32 bi,
+		     vlib_buffer_t * b, tcp_header_t * th, u16 payload)
+{
+  vlib_buffer_advance (b, b->current_length - payload);
+
+  f->tail->next_buffer = bi;
+  f->tail->flags |= VLIB_BUFFER_NEXT_PRESENT;
+  f->tail = b;
+  f->head->total_length_not_including_first_buffer += payload;
+  f->head->flags |= VLIB_BUFFER_TOTAL_LENGTH_VALID;
+  f->th->flags |= th->flags & TCP_FLAG_PSH;
+  f->next_seq += payload;
+  f->n_segs++;
+}
+
+/** Write the merged length to the head's ip header */
+always_inline void
+tcp_gro_flow_flush (vlib_main_t * vm, vlib_node_runtime_t * node,
+		    tcp_gro_flow_t * f, u8 is_ip4)
+{
+  vlib_buffer_t *head = f->head;
+  u32 len;
+
+  if (f->n_segs > 1)
+    {
+      len = vlib_buffer_length_in_chain (vm, head);
+      if (is_ip4)
+	{
+	  ip4_header_t *ip4 = f->ip;
+	  ip4->length = clib_host_to_net_u16 (len);
+	  ip4->checksum = ip4_header_checksum (ip4);
+	}
+      else
+	{
+	  ip6_header_t *ip6 = f->ip;
+	  ip6->payload_length = clib_host_to_net_u16 (len - sizeof (*ip6));
+	}
+      /* Each segment was verified by ipx-local, the sum no longer
+       * matches the chain */
+      head->flags |= IP_BUFFER_L4_CHECKSUM_COMPUTED
+	| IP_BUFFER_L4_CHECKSUM_CORRECT;
+    }
+
+  if (PREDICT_FALSE (head->flags & VLIB_BUFFER_IS_TRACED))
+    {
+      tcp_gro_trace_t *t = vlib_add_trace (vm, node, head, sizeof (*t));
+      t->n_segs = f->n_segs;
+      t->n_bytes = vlib_buffer_length_in_chain (vm, head);
+    }
+}
+
+always_inline uword
+tcp46_gro_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
+		  vlib_frame_t * frame, u8 is_ip4)
+{
+  tcp_gro_stats_t *stats = vec_elt_at_index (tcp_gro_main.stats,
+					     vm->thread_index);
+  tcp_gro_flow_t flows[TCP_GRO_MAX_FLOWS], *f;
+  u32 *from, *to_next, n_left, n_left_to_next, n_out = 0, n;
+  int i, n_flows = 0;
+
+  from = vlib_frame_vector_args (frame);
+
+  /* Segments that start a packet are written back to the frame, in
+   * arrival order, the ones merged into them are not */
+  for (i = 0; i < frame->n_vectors; i++)
+    {
+      u32 bi0 = from[i];
+      vlib_buffer_t *b0 = vlib_get_buffer (vm, bi0);
+      void *ip0 = vlib_buffer_get_current (b0);
+      tcp_header_t *th0;
+      u16 payload0 = 0;
+      int mergeable0;
+
+      mergeable0 = tcp_gro_segment_mergeable (b0, is_ip4, &th0, &payload0);
+      if (!mergeable0)
+	th0 = is_ip4 ? ip4_next_header (ip0) : ip6_next_header (ip0);
+
+      f = tcp_gro_flow_find (flows, n_flows, ip0, th0, is_ip4);
+      if (f)
+	{
+	  if (mergeable0
+	      && tcp_gro_can_merge (vm, f, ip0, th0, payload0, is_ip4))
+	    {
+	      tcp_gro_flow_append (vm, f, bi0, b0, th0, payload0);
+	      if (!(th0->flags & TCP_FLAG_PSH) && payload0 == f->seg_len)
+		continue;
+
+	      /* A short segment or psh ends the chain */
+	      tcp_gro_flow_flush (vm, node, f, is_ip4);
+	      *f = flows[--n_flows];
+	      continue;
+	    }
+
+	  /* Later segments must not be merged ahead of this one */
+	  tcp_gro_flow_flush (vm, node, f, is_ip4);
+	  *f = flows[--n_flows];
+	}
+
+      from[n_out++] = bi0;
+
+      if (mergeable0 && n_flows < TCP_GRO_MAX_FLOWS
+	  && !(th0->flags & TCP_FLAG_PSH))
+	{
+	  f = &flows[n_flows++];
+	  f->head = f->tail = b0;
+	  f->ip = ip0;
+	  f->th = th0;
+	  f->next_seq = clib_net_to_host_u32 (th0->seq_number) + payload0;
+	  f->seg_len = payload0;
+	  f->n_segs = 1;
+	}
+    }
+
+  for (f = flows; f < flows + n_flows; f++)
+    tcp_gro_flow_flush (vm, node, f, is_ip4);
+
+  n_left = n_out;
+  while (n_left > 0)
+    {
+      vlib_get_next_frame (vm, node, TCP_GRO_NEXT_INPUT, to_next,
+			   n_left_to_next);
+      n = clib_min (n_left, n_left_to_next);
+      clib_memcpy (to_next, from, n * sizeof (from[0]));
+      from += n;
+      n_left -= n;
+      vlib_put_next_frame (vm, node, TCP_GRO_NEXT_INPUT, n_left_to_next - n);
+    }
+
+  stats->n_segs += frame->n_vectors;
+  stats->n_pkts += n_out;
+  vlib_node_increment_counter (vm, node->node_index, TCP_GRO_ERROR_SEGMENTS,
+			       frame->n_vectors);
+  vlib_node_increment_counter (vm, node->node_index, TCP_GRO_ERROR_PACKETS,
+			       n_out);
+  return frame->n_vectors;
+}
+
+static uword
+tcp4_gro (vlib_main_t * vm, vlib_node_runtime_t * node, vlib_frame_t * frame)
+{
+  return tcp46_gro_inline (vm, node, frame, 1 /* is_ip4 */ );
+}
+
+static uword
+tcp6_gro (vlib_main_t * vm, vlib_node_runtime_t * node, vlib_frame_t * frame)
+{
+  return tcp46_gro_inline (vm, node, frame, 0 /* is_ip4 */ );
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (tcp4_gro_node) =
+{
+  .function = tcp4_gro,
+  .name = "tcp4-gro",
+  .vector_size = sizeof (u32),
+  .type = VLIB_NODE_TYPE_INTERNAL,
+  .n_errors = TCP_GRO_N_ERROR,
+  .error_strings = tcp_gro_error_strings,
+  .n_next_nodes = TCP_GRO_N_NEXT,
+  .next_nodes = {
+    [TCP_GRO_NEXT_INPUT] = "tcp4-input",
+  },
+  .format_buffer = format_tcp_header,
+  .format_trace = format_tcp_gro_trace,
+};
+/* *INDENT-ON* */
+
+VLIB_NODE_FUNCTION_MULTIARCH (tcp4_gro_node, tcp4_gro);
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (tcp6_gro_node) =
+{
+  .function = tcp6_gro,
+  .name = "tcp6-gro",
+  .vector_size = sizeof (u32),
+  .type = VLIB_NODE_TYPE_INTERNAL,
+  .n_errors = TCP_GRO_N_ERROR,
+  .error_strings = tcp_gro_error_strings,
+  .n_next_nodes = TCP_GRO_N_NEXT,
+  .next_nodes = {
+    [TCP_GRO_NEXT_INPUT] = "tcp6-input",
+  },
+  .format_buffer = format_tcp_header,
+  .format_trace = format_tcp_gro_trace,
+};
+/* *INDENT-ON* */
+
+VLIB_NODE_FUNCTION_MULTIARCH (tcp6_gro_node, tcp6_gro);
+
+void
+tcp_gro_enable_disable (u8 is_enable)
+{
+  tcp_main_t *tm = vnet_get_tcp_main ();
+
+  tm->gro = is_enable;
+  /* Otherwise done when the stack is enabled */
+  if (tm->is_enabled)
+    tcp_register_with_ip (tm);
+}
+
+static clib_error_t *
+tcp_gro_command_fn (vlib_main_t * vm, unformat_input_t * input,
+		    vlib_cli_command_t * cmd)
+{
+  u8 is_enable = 1;
+
+  if (unformat (input, "disable"))
+    is_enable = 0;
+  else if (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    return clib_error_return (0, "unknown input `%U'",
+			      format_unformat_error, input);
+
+  vlib_worker_thread_barrier_sync (vm);
+  tcp_gro_enable_disable (is_enable);
+  vlib_worker_thread_barrier_release (vm);
+  return 0;
+}
+
+/*?
+ * Merge the in order segments of a flow received in the same frame
+ * before tcp-input, which then processes, acks and enqueues them once.
+ * Also settable at startup with "tcp { gro }". "show tcp gro" reports
+ * how many segments were merged.
+ *
+ * @cliexpar
+ * @cliexcmd{set tcp gro}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (tcp_gro_command, static) =
+{
+  .path = "set tcp gro",
+  .short_help = "set tcp gro [disable]",
+  .function = tcp_gro_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+tcp_gro_show_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			 vlib_cli_command_t * cmd)
+{
+  tcp_gro_main_t *tgm = &tcp_gro_main;
+  tcp_gro_stats_t *s;
+  u64 n_segs = 0, n_pkts = 0;
+
+  vlib_cli_output (vm, "%s", tcp_main.gro ? "enabled" : "disabled");
+
+  vec_foreach (s, tgm->stats)
+  {
+    vlib_cli_output (vm, "thread %d: %lld segments, %lld packets, "
+		     "%.2f segments per packet", s - tgm->stats, s->n_segs,
+		     s->n_pkts, s->n_pkts ? (f64) s->n_segs / s->n_pkts : 0);
+    n_segs += s->n_segs;
+    n_pkts += s->n_pkts;
+  }
+
+  if (vec_len (tgm->stats) > 1)
+    vlib_cli_output (vm, "total: %lld segments, %lld packets, "
+		     "%.2f segments per packet", n_segs, n_pkts,
+		     n_pkts ? (f64) n_segs / n_pkts : 0);
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (tcp_gro_show_command, static) =
+{
+  .path = "show tcp gro",
+  .short_help = "show tcp gro",
+  .function = tcp_gro_show_command_fn,
+};
+/* *INDENT-ON* */
+
+clib_error_t *
+tcp_gro_init (vlib_main_t * vm)
+{
+  tcp_gro_main_t *tgm = &tcp_gro_main;
+
+  vec_validate_aligned (tgm->stats, vlib_get_thread_main ()->n_vlib_mains
+			- 1, CLIB_CACHE_LINE_BYTES);
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (tcp_gro_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Path impairment for testing congestion control: when enabled, every
+ * segment tcp sends is dropped with the configured probability, or
+ * else delayed by the configured time before it goes on to the ip
+ * lookup or rewrite node it was bound to.
+ *
+ * The tcp-impair node holds the segments in a per thread fifo, and the
+ * tcp-impair-release input node sends them on when they are due.
+ */
+
+#include <vnet/tcp/tcp.h>
+#include <vppinfra/fifo.h>
+#include <vppinfra/random.h>
+
+typedef struct
+{
+  u32 buffer_index;
+  u32 node_index;		/**< Where the segment was going */
+  f64 deadline;
+} tcp_impair_elt_t;
+
+typedef struct
+{
+  /** Per thread fifos of held segments */
+  tcp_impair_elt_t **held;
+  u32 *seeds;
+
+  f64 delay;
+  /** Drop if random_u32 () < loss_threshold */
+  u32 loss_threshold;
+} tcp_impair_main_t;
+
+tcp_impair_main_t tcp_impair_main;
+
+vlib_node_registration_t tcp_impair_node;
+vlib_node_registration_t tcp_impair_release_node;
+
+#define foreach_tcp_impair_error			\
+_(DELAYED, "segments delayed")				\
+_(DROPPED, "segments dropped")				\
+_(RELEASED, "segments released")
+
+typedef enum
+{
+#define _(sym,str) TCP_IMPAIR_ERROR_##sym,
+  foreach_tcp_impair_error
+#undef _
+    TCP_IMPAIR_N_ERROR,
+} tcp_impair_error_t;
+
+static char *tcp_impair_error_strings[] = {
+#define _(sym,string) string,
+  foreach_tcp_impair_error
+#undef _
+};
+
+typedef enum
+{
+  TCP_IMPAIR_NEXT_DROP,
+  TCP_IMPAIR_N_NEXT,
+} tcp_impair_next_t;
+
+static uword
+tcp_impair_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
+		    vlib_frame_t * frame)
+{
+  tcp_impair_main_t *tim = &tcp_impair_main;
+  u32 thread_index = vm->thread_index;
+  u32 *from = vlib_frame_vector_args (frame), n_left = frame->n_vectors;
+  u32 *seed = vec_elt_at_index (tim->seeds, thread_index);
+  u32 n_delayed = 0;
+  vlib_node_t *tcp4_output, *tcp6_output;
+  tcp_impair_elt_t *e;
+  f64 deadline;
+
+  tcp4_output = vlib_get_node (vm, tcp4_output_node.index);
+  tcp6_output = vlib_get_node (vm, tcp6_output_node.index);
+  deadline = vlib_time_now (vm) + tim->delay;
+
+  while (n_left > 0)
+    {
+      u32 bi0 = from[0];
+      vlib_buffer_t *b0 = vlib_get_buffer (vm, bi0);
+      ip4_header_t *ih0 = vlib_buffer_get_current (b0);
+      tcp_connection_t *tc0;
+      vlib_node_t *output0;
+
+      from += 1;
+      n_left -= 1;
+
+      tc0 = tcp_connection_get (vnet_buffer (b0)->tcp.connection_index,
+				thread_index);
+      if (random_u32 (seed) < tim->loss_threshold || tc0 == 0)
+	{
+	  b0->error = node->errors[TCP_IMPAIR_ERROR_DROPPED];
+	  vlib_set_next_frame_buffer (vm, node, TCP_IMPAIR_NEXT_DROP, bi0);
+	  continue;
+	}
+
+      output0 = (ih0->ip_version_and_header_length & 0xf0) == 0x40 ?
+	tcp4_output : tcp6_output;
+      clib_fifo_add2 (tim->held[thread_index], e);
+      e->buffer_index = bi0;
+      e->node_index = output0->next_nodes[tc0->c_rmt_dpo.dpoi_next_node];
+      e->deadline = deadline;
+      n_delayed++;
+    }
+
+  vlib_node_increment_counter (vm, node->node_index,
+			       TCP_IMPAIR_ERROR_DELAYED, n_delayed);
+  return frame->n_vectors;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (tcp_impair_node) =
+{
+  .function = tcp_impair_node_fn,
+  .name = "tcp-impair",
+  .vector_size = sizeof (u32),
+  .type = VLIB_NODE_TYPE_INTERNAL,
+  .n_errors = TCP_IMPAIR_N_ERROR,
+  .error_strings = tcp_impair_error_strings,
+  .n_next_nodes = TCP_IMPAIR_N_NEXT,
+  .next_nodes = {
+    [TCP_IMPAIR_NEXT_DROP] = "error-drop",
+  },
+};
+/* *INDENT-ON* */
+
+static uword
+tcp_impair_release_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
+			    vlib_frame_t * frame)
+{
+  tcp_impair_main_t *tim = &tcp_impair_main;
+  tcp_impair_elt_t *held = tim->held[vm->thread_index], *e;
+  u32 node_index = ~0, *to = 0, n_released = 0;
+  vlib_frame_t *f = 0;
+  f64 now = vlib_time_now (vm);
+
+  while (clib_fifo_elts (held) > 0)
+    {
+      e = clib_fifo_head (held);
+      if (e->deadline > now)
+	break;
+
+      if (e->node_index != node_index || f->n_vectors == VLIB_FRAME_SIZE)
+	{
+	  if (f)
+	    vlib_put_frame_to_node (vm, node_index, f);
+	  node_index = e->node_index;
+	  f = vlib_get_frame_to_node (vm, node_index);
+	  to = vlib_frame_vector_args (f);
+	}
+      to[f->n_vectors++] = e->buffer_index;
+      clib_fifo_advance_head (held, 1);
+      n_released++;
+    }
+
+  if (f)
+    vlib_put_frame_to_node (vm, node_index, f);
+
+  tim->held[vm->thread_index] = held;
+  vlib_node_increment_counter (vm, node->node_index,
+			       TCP_IMPAIR_ERROR_RELEASED, n_released);
+  return n_released;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (tcp_impair_release_node) =
+{
+  .function = tcp_impair_release_node_fn,
+  .name = "tcp-impair-release",
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_DISABLED,
+  .n_errors = TCP_IMPAIR_N_ERROR,
+  .error_strings = tcp_impair_error_strings,
+};
+/* *INDENT-ON* */
+
+static void
+tcp_impair_enable_disable (vlib_main_t * vm, u8 is_enable)
+{
+  tcp_impair_main_t *tim = &tcp_impair_main;
+  vlib_thread_main_t *vtm = vlib_get_thread_main ();
+  tcp_impair_elt_t *e;
+  int i;
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  vec_validate (tim->held, vtm->n_vlib_mains - 1);
+  if (vec_len (tim->seeds) < vtm->n_vlib_mains)
+    for (i = vec_len (tim->seeds); i < vtm->n_vlib_mains; i++)
+      vec_add1 (tim->seeds, 0xdeadbeef + i);
+
+  /* Held segments are lost, tcp retransmits them */
+  if (!is_enable)
+    for (i = 0; i < vec_len (tim->held); i++)
+      {
+	/* *INDENT-OFF* */
+	clib_fifo_foreach (e, tim->held[i], ({
+	  vlib_buffer_free_one (vm, e->buffer_index);
+	}));
+	/* *INDENT-ON* */
+	clib_fifo_reset (tim->held[i]);
+      }
+
+  for (i = 0; i < vtm->n_vlib_mains; i++)
+    vlib_node_set_state (vlib_mains[i], tcp_impair_release_node.index,
+			 is_enable ? VLIB_NODE_STATE_POLLING :
+			 VLIB_NODE_STATE_DISABLED);
+  tcp_main.impair = is_enable;
+
+  vlib_worker_thread_barrier_release (vm);
+}
+
+static clib_error_t *
+tcp_impair_command_fn (vlib_main_t * vm, unformat_input_t * input,
+		       vlib_cli_command_t * cmd)
+{
+  tcp_impair_main_t *tim = &tcp_impair_main;
+  f64 delay_ms = 0, loss_percent = 0;
+
+  if (unformat (input, "disable"))
+    {
+      tcp_impair_enable_disable (vm, 0);
+      return 0;
+    }
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "delay %f", &delay_ms))
+	;
+      else if (unformat (input, "loss %f", &loss_percent))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (delay_ms < 0 || loss_percent < 0 || loss_percent > 100)
+    return clib_error_return (0, "delay must be positive, loss a percent");
+
+  tim->delay = delay_ms * 1e-3;
+  tim->loss_threshold = loss_percent / 100 * (f64) (u32) ~ 0;
+  tcp_impair_enable_disable (vm, 1);
+  return 0;
+}
+
+/*?
+ * Drop the segments tcp sends with probability loss percent, and
+ * delay the others by delay ms. Both directions of a connection
+ * between two local applications, e.g. "test tcp server" and "test
+ * tcp clients", are impaired, so the RTT grows by twice the delay.
+ *
+ * @cliexpar
+ * @cliexcmd{set tcp impair delay 25 loss 0.1}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (tcp_impair_command, static) =
+{
+  .path = "set tcp impair",
+  .short_help = "set tcp impair [delay <ms>] [loss <percent>] | disable",
+  .function = tcp_impair_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+tcp_impair_show_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			    vlib_cli_command_t * cmd)
+{
+  tcp_impair_main_t *tim = &tcp_impair_main;
+  int i;
+
+  if (!tcp_main.impair)
+    {
+      vlib_cli_output (vm, "disabled");
+      return 0;
+    }
+
+  vlib_cli_output (vm, "delay %.3f ms loss %.3f%%", tim->delay * 1e3,
+		   100.0 * tim->loss_threshold / (f64) (u32) ~ 0);
+  for (i = 0; i < vec_len (tim->held); i++)
+    vlib_cli_output (vm, "thread %d: %d segments held", i,
+		     clib_fifo_elts (tim->held[i]));
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (tcp_impair_show_command, static) =
+{
+  .path = "show tcp impair",
+  .short_help = "show tcp impair",
+  .function = tcp_impair_show_command_fn,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
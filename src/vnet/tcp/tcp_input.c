@@ -17,6 +17,7 @@
 #include <vnet/tcp/tcp_packet.h>
 #include <vnet/tcp/tcp.h>
 #include <vnet/session/session.h>
+#include <vnet/session/application.h>
 #include <math.h>
 
 static char *tcp_error_strings[] = {
@@ -1134,10 +1135,37 @@ partial_ack:
   tcp_fast_retransmit (tc);
 }
 
+/**
+ * The congestion control algorithm the application of the connection
+ * asked for, or the default one. Active opens are still half-open
+ * here, passive ones already have a session.
+ */
+static tcp_cc_algorithm_type_e
+tcp_cc_algo_type (tcp_connection_t * tc)
+{
+  tcp_main_t *tm = vnet_get_tcp_main ();
+  stream_session_t *s;
+  application_t *app;
+  u32 app_index = ~0;
+
+  if (tc->state == TCP_STATE_SYN_SENT)
+    app_index = stream_session_half_open_app_index (&tc->connection);
+  else if ((s = stream_session_get_if_valid (tc->c_s_index,
+					     tc->c_thread_index)))
+    app_index = s->app_index;
+
+  app = app_index != ~0 ? application_get_if_valid (app_index) : 0;
+  if (app && app->tcp_cc_algo && app->tcp_cc_algo <= vec_len (tm->cc_algos)
+      && tm->cc_algos[app->tcp_cc_algo - 1].init)
+    return app->tcp_cc_algo - 1;
+
+  return tm->cc_algo;
+}
+
 void
 tcp_cc_init (tcp_connection_t * tc)
 {
-  tc->cc_algo = tcp_cc_algo_get (TCP_CC_NEWRENO);
+  tc->cc_algo = tcp_cc_algo_get (tcp_cc_algo_type (tc));
   tc->cc_algo->init (tc);
 }
 
@@ -1427,6 +1455,40 @@ tcp_can_delack (tcp_connection_t * tc)
   return 1;
 }
 
+/**
+ * The session keeps a reference to the buffers of in order data it
+ * hands to zero-copy rx apps, those must not be rewritten
+ */
+always_inline int
+tcp_buffer_is_held (vlib_buffer_t * b)
+{
+  return b->n_add_refs != 0;
+}
+
+/**
+ * Drop the first bytes of a chain, e.g., a gro chain, emptying the
+ * buffers they span
+ */
+static void
+tcp_buffer_advance_chain (vlib_buffer_t * b, u32 n_bytes)
+{
+  vlib_main_t *vm = vlib_get_main ();
+  vlib_buffer_t *it = b;
+  u32 n;
+
+  while (n_bytes)
+    {
+      n = clib_min (n_bytes, it->current_length);
+      vlib_buffer_advance (it, n);
+      if (it != b)
+	b->total_length_not_including_first_buffer -= n;
+      n_bytes -= n;
+      if (!(it->flags & VLIB_BUFFER_NEXT_PRESENT))
+	break;
+      it = vlib_get_buffer (vm, it->next_buffer);
+    }
+}
+
 static int
 tcp_segment_rcv (tcp_main_t * tm, tcp_connection_t * tc, vlib_buffer_t * b,
 		 u16 n_data_bytes, u32 * next0)
@@ -1450,7 +1512,10 @@ tcp_segment_rcv (tcp_main_t * tm, tcp_connection_t * tc, vlib_buffer_t * b,
 	  /* Chop off the bytes in the past */
 	  n_bytes_to_drop = tc->rcv_nxt - vnet_buffer (b)->tcp.seq_number;
 	  n_data_bytes -= n_bytes_to_drop;
-	  vlib_buffer_advance (b, n_bytes_to_drop);
+	  if (PREDICT_FALSE (b->flags & VLIB_BUFFER_NEXT_PRESENT))
+	    tcp_buffer_advance_chain (b, n_bytes_to_drop);
+	  else
+	    vlib_buffer_advance (b, n_bytes_to_drop);
 
 	  goto in_order;
 	}
@@ -1496,6 +1561,14 @@ in_order:
       goto done;
     }
 
+  /* A zero-copy rx app holds the buffer, ack from a new one */
+  if (PREDICT_FALSE (tcp_buffer_is_held (b)))
+    {
+      tcp_send_ack (tc);
+      *next0 = TCP_NEXT_DROP;
+      goto done;
+    }
+
   *next0 = tcp_next_output (tc->c_is_ip4);
   tcp_make_ack (tc, b);
 
@@ -2286,8 +2359,16 @@ tcp46_rcv_process_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 	    case TCP_STATE_SYN_RCVD:
 	      /* Send FIN-ACK notify app and enter CLOSE-WAIT */
 	      tcp_connection_timers_reset (tc0);
-	      tcp_make_fin (tc0, b0);
-	      next0 = tcp_next_output (tc0->c_is_ip4);
+	      if (PREDICT_FALSE (tcp_buffer_is_held (b0)))
+		{
+		  tcp_send_fin (tc0);
+		  next0 = TCP_RCV_PROCESS_NEXT_DROP;
+		}
+	      else
+		{
+		  tcp_make_fin (tc0, b0);
+		  next0 = tcp_next_output (tc0->c_is_ip4);
+		}
 	      stream_session_disconnect_notify (&tc0->connection);
 	      tc0->state = TCP_STATE_CLOSE_WAIT;
 	      break;
@@ -2306,6 +2387,12 @@ tcp46_rcv_process_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 	      tc0->state = TCP_STATE_TIME_WAIT;
 	      tcp_connection_timers_reset (tc0);
 	      tcp_timer_set (tc0, TCP_TIMER_WAITCLOSE, TCP_CLOSEWAIT_TIME);
+	      if (PREDICT_FALSE (tcp_buffer_is_held (b0)))
+		{
+		  tcp_send_ack (tc0);
+		  next0 = TCP_RCV_PROCESS_NEXT_DROP;
+		  break;
+		}
 	      tcp_make_ack (tc0, b0);
 	      next0 = tcp_next_output (is_ip4);
 	      break;
@@ -2699,6 +2786,9 @@ tcp46_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 
 	  b0 = vlib_get_buffer (vm, bi0);
 	  vnet_buffer (b0)->tcp.flags = 0;
+	  /* Locally delivered GSO packets end here, the buffer may be
+	   * reused for an ack */
+	  b0->flags &= ~VNET_BUFFER_GSO;
 
 	  /* Checksum computed by ipx_local no need to compute again */
 
@@ -22,14 +22,17 @@ vlib_node_registration_t tcp6_output_node;
 typedef enum _tcp_output_nect
 {
   TCP_OUTPUT_NEXT_DROP,
+  TCP_OUTPUT_NEXT_IMPAIR,
   TCP_OUTPUT_N_NEXT
 } tcp_output_next_t;
 
 #define foreach_tcp4_output_next              	\
   _ (DROP, "error-drop")                        \
+  _ (IMPAIR, "tcp-impair")                      \
 
 #define foreach_tcp6_output_next              	\
   _ (DROP, "error-drop")                        \
+  _ (IMPAIR, "tcp-impair")                      \
 
 static char *tcp_error_strings[] = {
 #define tcp_error(n,s) s,
@@ -456,19 +459,21 @@ do {									\
 always_inline void
 tcp_reuse_buffer (vlib_main_t * vm, vlib_buffer_t * b)
 {
-  vlib_buffer_t *it = b;
-  do
+  /* Control segments fit in one buffer, drop the rest of a gro or gso
+   * chain */
+  if (b->flags & VLIB_BUFFER_NEXT_PRESENT)
     {
-      it->current_data = 0;
-      it->current_length = 0;
-      it->total_length_not_including_first_buffer = 0;
+      vlib_buffer_free_one (vm, b->next_buffer);
+      b->flags &= ~VLIB_BUFFER_NEXT_PRESENT;
     }
-  while ((it->flags & VLIB_BUFFER_NEXT_PRESENT)
-	 && (it = vlib_get_buffer (vm, it->next_buffer)));
+  b->current_data = 0;
+  b->current_length = 0;
+  b->total_length_not_including_first_buffer = 0;
 
   /* Leave enough space for headers */
   vlib_buffer_make_headroom (b, MAX_HDRS_LEN);
   vnet_buffer (b)->tcp.flags = 0;
+  b->flags &= ~VNET_BUFFER_GSO;
 }
 
 /**
@@ -933,6 +938,15 @@ tcp_push_hdr_i (tcp_connection_t * tc, vlib_buffer_t * b,
   ASSERT (opts_write_len == tc->snd_opts_len);
   vnet_buffer (b)->tcp.connection_index = tc->c_c_index;
 
+  /* More than a segment, the session layer built a super-packet */
+  if (PREDICT_FALSE (data_len > tc->snd_mss))
+    {
+      b->flags |= VNET_BUFFER_GSO;
+      vnet_buffer2 (b)->gso.gso_size = tc->snd_mss;
+    }
+  else
+    b->flags &= ~VNET_BUFFER_GSO;
+
   /*
    * Update connection variables
    */
@@ -1046,7 +1060,7 @@ tcp_rtx_timeout_cc (tcp_connection_t * tc)
     tcp_cc_fastrecovery_exit (tc);
 
   /* Start again from the beginning */
-  tc->ssthresh = clib_max (tcp_flight_size (tc) / 2, 2 * tc->snd_mss);
+  tc->cc_algo->congestion (tc);
   tc->cwnd = tcp_loss_wnd (tc);
   tc->snd_congestion = tc->snd_una_max;
 
@@ -1475,7 +1489,8 @@ tcp46_output_inline (vlib_main_t * vm,
 	      ip4_header_t *ih0;
 	      ih0 = vlib_buffer_push_ip4 (vm, b0, &tc0->c_lcl_ip4,
 					  &tc0->c_rmt_ip4, IP_PROTOCOL_TCP);
-	      th0->checksum = ip4_tcp_udp_compute_checksum (vm, b0, ih0);
+	      if (PREDICT_TRUE (!(b0->flags & VNET_BUFFER_GSO)))
+		th0->checksum = ip4_tcp_udp_compute_checksum (vm, b0, ih0);
 	    }
 	  else
 	    {
@@ -1484,9 +1499,24 @@ tcp46_output_inline (vlib_main_t * vm,
 
 	      ih0 = vlib_buffer_push_ip6 (vm, b0, &tc0->c_lcl_ip6,
 					  &tc0->c_rmt_ip6, IP_PROTOCOL_TCP);
-	      th0->checksum = ip6_tcp_udp_icmp_compute_checksum (vm, b0, ih0,
-								 &bogus);
-	      ASSERT (!bogus);
+	      if (PREDICT_TRUE (!(b0->flags & VNET_BUFFER_GSO)))
+		{
+		  th0->checksum =
+		    ip6_tcp_udp_icmp_compute_checksum (vm, b0, ih0, &bogus);
+		  ASSERT (!bogus);
+		}
+	    }
+
+	  /* The checksums are computed per segment, when segmenting. If
+	   * the packet is delivered locally, there's nothing to check */
+	  if (PREDICT_FALSE (b0->flags & VNET_BUFFER_GSO))
+	    {
+	      vnet_buffer2 (b0)->gso.l3_hdr_offset = b0->current_data;
+	      vnet_buffer2 (b0)->gso.l4_hdr_offset =
+		(u8 *) th0 - b0->data;
+	      th0->checksum = 0;
+	      b0->flags |= IP_BUFFER_L4_CHECKSUM_COMPUTED
+		| IP_BUFFER_L4_CHECKSUM_CORRECT;
 	    }
 
 	  /* Filter out DUPACKs if there are no OOO segments left */
@@ -1548,6 +1578,9 @@ tcp46_output_inline (vlib_main_t * vm,
 	  next0 = tc0->c_rmt_dpo.dpoi_next_node;
 	  vnet_buffer (b0)->ip.adj_index[VLIB_TX] = tc0->c_rmt_dpo.dpoi_index;
 
+	  if (PREDICT_FALSE (tcp_main.impair))
+	    next0 = TCP_OUTPUT_NEXT_IMPAIR;
+
 	  b0->flags |= VNET_BUFFER_LOCALLY_ORIGINATED;
 	done:
 	  b0->error = node->errors[error0];
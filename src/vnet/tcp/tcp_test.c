@@ -13,6 +13,7 @@
  * limitations under the License.
  */
 #include <vnet/tcp/tcp.h>
+#include <vnet/session/application_interface.h>
 
 #define TCP_TEST_I(_cond, _comment, _args...)			\
 ({								\
@@ -1319,6 +1320,369 @@ tcp_test_session (vlib_main_t * vm, unformat_input_t * input)
   return rv;
 }
 
+static int
+tcp_test_zero_copy_rx_cb (stream_session_t * s)
+{
+  return 0;
+}
+
+static int
+tcp_test_zero_copy_accept_cb (stream_session_t * s)
+{
+  return 0;
+}
+
+static void
+tcp_test_zero_copy_disconnect_cb (stream_session_t * s)
+{
+}
+
+static int
+tcp_test_zero_copy_connected_cb (u32 app_index, u32 api_context,
+				 stream_session_t * s, u8 code)
+{
+  return 0;
+}
+
+/* *INDENT-OFF* */
+static session_cb_vft_t tcp_test_zero_copy_cb_vft = {
+  .session_accept_callback = tcp_test_zero_copy_accept_cb,
+  .session_disconnect_callback = tcp_test_zero_copy_disconnect_cb,
+  .session_connected_callback = tcp_test_zero_copy_connected_cb,
+  .session_reset_callback = tcp_test_zero_copy_disconnect_cb,
+  .builtin_server_rx_callback = tcp_test_zero_copy_rx_cb,
+};
+/* *INDENT-ON* */
+
+static vlib_buffer_t *
+tcp_test_zero_copy_buffer (vlib_main_t * vm, u32 bi, u16 length, u32 next)
+{
+  vlib_buffer_t *b = vlib_get_buffer (vm, bi);
+
+  b->current_data = 0;
+  b->current_length = length;
+  b->n_add_refs = 0;
+  b->flags = 0;
+  memset (vlib_buffer_get_current (b), bi, length);
+  if (next != ~0)
+    {
+      b->flags |= VLIB_BUFFER_NEXT_PRESENT;
+      b->next_buffer = next;
+    }
+  return b;
+}
+
+/*
+ * Zero-copy rx: an app holding buffers across several frames, the
+ * window they take and the fallbacks to copying or to refusing data
+ */
+static int
+tcp_test_zero_copy (vlib_main_t * vm, unformat_input_t * input)
+{
+  session_manager_main_t *smm = vnet_get_session_manager_main ();
+  vnet_app_attach_args_t _a, *a = &_a;
+  vnet_app_detach_args_t _da, *da = &_da;
+  u64 options[SESSION_OPTIONS_N_OPTIONS];
+  transport_connection_t _tc, *tc = &_tc;
+  u32 bis[6], n_held, fifo_size = 4096, session_buffers;
+  vlib_buffer_t *b[6];
+  session_rx_desc_t *descs;
+  session_rx_buffers_t *rxb;
+  u8 segment_name[128];
+  stream_session_t *s;
+  application_t *app;
+  int rv;
+
+  vnet_session_enable_disable (vm, 1);
+
+  memset (a, 0, sizeof (*a));
+  memset (options, 0, sizeof (options));
+  a->api_client_index = ~0;
+  a->session_cb_vft = &tcp_test_zero_copy_cb_vft;
+  a->options = options;
+  a->options[SESSION_OPTIONS_SEGMENT_SIZE] = 2 << 20;
+  a->options[SESSION_OPTIONS_RX_FIFO_SIZE] = fifo_size;
+  a->options[SESSION_OPTIONS_TX_FIFO_SIZE] = fifo_size;
+  a->options[APP_OPTIONS_FLAGS] = APP_OPTIONS_FLAGS_BUILTIN_APP
+    | APP_OPTIONS_FLAGS_RX_ZERO_COPY;
+  a->segment_name = segment_name;
+  a->segment_name_length = ARRAY_LEN (segment_name);
+  rv = vnet_application_attach (a);
+  TCP_TEST ((rv == 0), "attach zero-copy app: %d", rv);
+  app = application_get (a->app_index);
+
+  /* Sessions of the app's first segment manager go with it on detach */
+  app->connects_seg_manager = app->first_segment_manager;
+  app->first_segment_manager = ~0;
+
+  memset (tc, 0, sizeof (*tc));
+  tc->proto = SESSION_TYPE_IP4_TCP;
+  tc->lcl_ip.ip4.as_u32 = clib_host_to_net_u32 (0x06000101);
+  tc->rmt_ip.ip4.as_u32 = clib_host_to_net_u32 (0x06000102);
+  tc->lcl_port = clib_host_to_net_u16 (4321);
+  tc->rmt_port = clib_host_to_net_u16 (14321);
+  tc->is_ip4 = 1;
+  rv = stream_session_create_i (application_get_connect_segment_manager
+				(app), tc, &s);
+  TCP_TEST ((rv == 0), "create session: %d", rv);
+  s->app_index = app->index;
+  s->session_state = SESSION_STATE_READY;
+  fifo_size = s->server_rx_fifo->nitems;
+
+  TCP_TEST ((vlib_buffer_alloc (vm, bis, ARRAY_LEN (bis))
+	     == ARRAY_LEN (bis)), "alloc buffers");
+  n_held = smm->n_rx_held_buffers[s->thread_index];
+
+  /* Frame 1: one buffer, held */
+  b[0] = tcp_test_zero_copy_buffer (vm, bis[0], 1000, ~0);
+  rv = stream_session_enqueue_data (tc, b[0], 0, 0, 1);
+  TCP_TEST ((rv == 1000), "enqueued %d expected 1000", rv);
+  descs = stream_session_rx_descs (s);
+  rxb = stream_session_rx_buffers_get (s);
+  TCP_TEST ((vec_len (descs) == 1 && descs[0].buffer_index == bis[0]
+	     && descs[0].length == 1000
+	     && descs[0].data == vlib_buffer_get_current (b[0])),
+	    "buffer handed to the app");
+  TCP_TEST ((b[0]->n_add_refs == 1), "buffer referenced");
+  TCP_TEST ((svm_fifo_max_dequeue (s->server_rx_fifo) == 0),
+	    "nothing copied to the fifo");
+  TCP_TEST ((stream_session_max_rx_enqueue (tc) == fifo_size - 1000),
+	    "window %u expected %u", stream_session_max_rx_enqueue (tc),
+	    fifo_size - 1000);
+
+  /* The transport is done with it, the app is not */
+  vlib_buffer_free (vm, &bis[0], 1);
+  TCP_TEST ((b[0]->n_add_refs == 0), "buffer still held");
+
+  /* Frame 2: a chain, held too */
+  b[1] = tcp_test_zero_copy_buffer (vm, bis[1], 500, bis[2]);
+  b[2] = tcp_test_zero_copy_buffer (vm, bis[2], 700, ~0);
+  b[1]->total_length_not_including_first_buffer = 700;
+  b[1]->flags |= VLIB_BUFFER_TOTAL_LENGTH_VALID;
+  rv = stream_session_enqueue_data (tc, b[1], 0, 0, 1);
+  TCP_TEST ((rv == 1200), "enqueued %d expected 1200", rv);
+  descs = stream_session_rx_descs (s);
+  TCP_TEST ((vec_len (descs) == 3 && descs[1].buffer_index == bis[1]
+	     && descs[2].buffer_index == bis[2]), "chain handed to the app");
+  TCP_TEST ((rxb->n_bytes == 2200), "app holds %u bytes expected 2200",
+	    rxb->n_bytes);
+  TCP_TEST ((smm->n_rx_held_buffers[s->thread_index] == n_held + 3),
+	    "thread holds %u buffers expected %u",
+	    smm->n_rx_held_buffers[s->thread_index], n_held + 3);
+  TCP_TEST ((stream_session_max_rx_enqueue (tc) == fifo_size - 2200),
+	    "window %u expected %u", stream_session_max_rx_enqueue (tc),
+	    fifo_size - 2200);
+  vlib_buffer_free (vm, &bis[1], 1);
+  TCP_TEST ((b[1]->n_add_refs == 0 && b[2]->n_add_refs == 0),
+	    "chain still held");
+
+  /* The app is done with the oldest */
+  stream_session_rx_release (s, 1);
+  descs = stream_session_rx_descs (s);
+  TCP_TEST ((vec_len (descs) == 2 && descs[0].buffer_index == bis[1]),
+	    "oldest released");
+  TCP_TEST ((rxb->n_bytes == 1200), "app holds %u bytes expected 1200",
+	    rxb->n_bytes);
+  TCP_TEST ((stream_session_max_rx_enqueue (tc) == fifo_size - 1200),
+	    "window %u expected %u", stream_session_max_rx_enqueue (tc),
+	    fifo_size - 1200);
+
+  /* Frame 3: beyond the window, refused */
+  b[3] = tcp_test_zero_copy_buffer (vm, bis[3], 2000, bis[4]);
+  b[4] = tcp_test_zero_copy_buffer (vm, bis[4], fifo_size - 3200 + 1, ~0);
+  rv = stream_session_enqueue_data (tc, b[3], 0, 0, 1);
+  TCP_TEST ((rv == 0), "enqueued %d beyond the window", rv);
+  TCP_TEST ((vec_len (stream_session_rx_descs (s)) == 2
+	     && b[3]->n_add_refs == 0
+	     && svm_fifo_max_dequeue (s->server_rx_fifo) == 0),
+	    "nothing held or copied");
+  vlib_buffer_free (vm, &bis[3], 1);
+
+  /* Frame 4: the app holds as many buffers as it may, copied */
+  session_buffers = smm->rx_zero_copy_session_buffers;
+  smm->rx_zero_copy_session_buffers = 2;
+  b[5] = tcp_test_zero_copy_buffer (vm, bis[5], 100, ~0);
+  rv = stream_session_enqueue_data (tc, b[5], 0, 0, 1);
+  smm->rx_zero_copy_session_buffers = session_buffers;
+  TCP_TEST ((rv == 100), "enqueued %d expected 100", rv);
+  TCP_TEST ((vec_len (stream_session_rx_descs (s)) == 2
+	     && b[5]->n_add_refs == 0
+	     && svm_fifo_max_dequeue (s->server_rx_fifo) == 100),
+	    "copied to the fifo");
+  TCP_TEST ((stream_session_max_rx_enqueue (tc) == fifo_size - 1300),
+	    "window %u expected %u", stream_session_max_rx_enqueue (tc),
+	    fifo_size - 1300);
+
+  /* Frame 5: in order data follows the fifo's, copied */
+  rv = stream_session_enqueue_data (tc, b[5], 0, 0, 1);
+  TCP_TEST ((rv == 100 && vec_len (stream_session_rx_descs (s)) == 2
+	     && svm_fifo_max_dequeue (s->server_rx_fifo) == 200),
+	    "copied after the fifo's data");
+  vlib_buffer_free (vm, &bis[5], 1);
+
+  stream_session_rx_release (s, 2);
+  TCP_TEST ((vec_len (stream_session_rx_descs (s)) == 0
+	     && rxb->n_bytes == 0), "all released");
+  TCP_TEST ((smm->n_rx_held_buffers[s->thread_index] == n_held),
+	    "thread holds %u buffers expected %u",
+	    smm->n_rx_held_buffers[s->thread_index], n_held);
+  TCP_TEST ((stream_session_max_rx_enqueue (tc) == fifo_size - 200),
+	    "window %u expected %u", stream_session_max_rx_enqueue (tc),
+	    fifo_size - 200);
+
+  stream_session_delete (s);
+  da->app_index = a->app_index;
+  vnet_application_detach (da);
+  return 0;
+}
+
+/*
+ * Build a GSO super-packet as tcp and the session layer do: ethernet,
+ * ip4 and tcp headers and a segment of payload in the head buffer, a
+ * segment of payload in each of the chained ones.
+ */
+static vlib_buffer_t *
+tcp_test_gso_packet (vlib_main_t * vm, u32 * bis, u16 * lengths,
+		     u32 n_bufs, u16 mss, u32 seq, u16 l3_offset)
+{
+  vlib_buffer_t *b, *prev = 0, *b0 = 0;
+  ip4_header_t *ip4;
+  tcp_header_t *th;
+  u16 hdr_len = l3_offset + sizeof (*ip4) + sizeof (*th);
+  u32 i;
+
+  for (i = 0; i < n_bufs; i++)
+    {
+      b = vlib_get_buffer (vm, bis[i]);
+      b->current_data = 0;
+      b->current_length = lengths[i] + (i ? 0 : hdr_len);
+      b->flags = 0;
+      b->n_add_refs = 0;
+      memset (b->data + (i ? 0 : hdr_len), 0xa0 + i, lengths[i]);
+      if (prev)
+	{
+	  prev->flags |= VLIB_BUFFER_NEXT_PRESENT;
+	  prev->next_buffer = bis[i];
+	  b0->total_length_not_including_first_buffer += lengths[i];
+	}
+      else
+	{
+	  b0 = b;
+	  b0->total_length_not_including_first_buffer = 0;
+	}
+      prev = b;
+    }
+
+  memset (b0->data, 0xee, l3_offset);
+  ip4 = (ip4_header_t *) (b0->data + l3_offset);
+  memset (ip4, 0, sizeof (*ip4));
+  ip4->ip_version_and_header_length = 0x45;
+  ip4->ttl = 64;
+  ip4->protocol = IP_PROTOCOL_TCP;
+  ip4->fragment_id = clib_host_to_net_u16 (100);
+  ip4->src_address.as_u32 = clib_host_to_net_u32 (0x06000101);
+  ip4->dst_address.as_u32 = clib_host_to_net_u32 (0x06000102);
+
+  th = (tcp_header_t *) (ip4 + 1);
+  memset (th, 0, sizeof (*th));
+  th->src_port = clib_host_to_net_u16 (1234);
+  th->dst_port = clib_host_to_net_u16 (11234);
+  th->seq_number = clib_host_to_net_u32 (seq);
+  th->ack_number = clib_host_to_net_u32 (1);
+  th->data_offset_and_reserved = (sizeof (*th) / 4) << 4;
+  th->flags = TCP_FLAG_ACK | TCP_FLAG_PSH;
+  th->window = clib_host_to_net_u16 (1000);
+
+  b0->flags |= VNET_BUFFER_GSO | VLIB_BUFFER_TOTAL_LENGTH_VALID;
+  vnet_buffer2 (b0)->gso.gso_size = mss;
+  vnet_buffer2 (b0)->gso.l3_hdr_offset = l3_offset;
+  vnet_buffer2 (b0)->gso.l4_hdr_offset = l3_offset + sizeof (*ip4);
+  return b0;
+}
+
+/*
+ * Software segmentation of GSO super-packets in interface-output
+ */
+static int
+tcp_test_gso (vlib_main_t * vm, unformat_input_t * input)
+{
+  u16 lengths[] = { 1000, 1000, 500 }, l3_offset = 14;
+  u16 hdr_len = l3_offset + sizeof (ip4_header_t) + sizeof (tcp_header_t);
+  u32 bis[ARRAY_LEN (lengths)], *segs = 0, seq = 1 << 31, flags, i;
+  vlib_buffer_t *b;
+  ip4_header_t *ip4;
+  tcp_header_t *th;
+
+  TCP_TEST ((vlib_buffer_alloc (vm, bis, ARRAY_LEN (bis))
+	     == ARRAY_LEN (bis)), "alloc buffers");
+
+  b = tcp_test_gso_packet (vm, bis, lengths, ARRAY_LEN (bis), 1000, seq,
+			   l3_offset);
+  TCP_TEST ((vnet_gso_segment_buffer (vm, bis[0], b, &segs) == 1),
+	    "segmented");
+  TCP_TEST ((vec_len (segs) == ARRAY_LEN (lengths)),
+	    "%u segments expected %u", vec_len (segs), ARRAY_LEN (lengths));
+
+  for (i = 0; i < vec_len (segs); i++)
+    {
+      TCP_TEST ((segs[i] == bis[i]), "segment %u in order", i);
+      b = vlib_get_buffer (vm, segs[i]);
+      ip4 = vlib_buffer_get_current (b) + l3_offset;
+      th = (tcp_header_t *) (ip4 + 1);
+      TCP_TEST ((!(b->flags & (VNET_BUFFER_GSO | VLIB_BUFFER_NEXT_PRESENT))),
+		"segment %u is a single plain buffer", i);
+      TCP_TEST ((b->current_length == hdr_len + lengths[i]),
+		"segment %u length %u expected %u", i, b->current_length,
+		hdr_len + lengths[i]);
+      TCP_TEST ((*(u8 *) vlib_buffer_get_current (b) == 0xee),
+		"segment %u l2 header copied", i);
+      TCP_TEST ((*((u8 *) (th + 1)) == 0xa0 + i
+		 && *((u8 *) (th + 1) + lengths[i] - 1) == 0xa0 + i),
+		"segment %u payload in place", i);
+      TCP_TEST ((clib_net_to_host_u16 (ip4->length)
+		 == b->current_length - l3_offset),
+		"segment %u ip length %u", i,
+		clib_net_to_host_u16 (ip4->length));
+      TCP_TEST ((clib_net_to_host_u16 (ip4->fragment_id) == 100 + i),
+		"segment %u ip id %u", i,
+		clib_net_to_host_u16 (ip4->fragment_id));
+      TCP_TEST ((ip4_header_checksum_is_valid (ip4)),
+		"segment %u ip checksum", i);
+      TCP_TEST ((clib_net_to_host_u32 (th->seq_number) == seq + i * 1000),
+		"segment %u seq %u expected %u", i,
+		clib_net_to_host_u32 (th->seq_number) - seq, i * 1000);
+      TCP_TEST (((th->flags & TCP_FLAG_PSH) == (i == vec_len (segs) - 1
+						? TCP_FLAG_PSH : 0)),
+		"segment %u psh only on the last", i);
+
+      /* Validate as tcp-input would, at the ip header */
+      vlib_buffer_advance (b, l3_offset);
+      b->flags &= ~(IP_BUFFER_L4_CHECKSUM_COMPUTED
+		    | IP_BUFFER_L4_CHECKSUM_CORRECT);
+      flags = ip4_tcp_udp_validate_checksum (vm, b);
+      vlib_buffer_advance (b, -l3_offset);
+      TCP_TEST ((flags & IP_BUFFER_L4_CHECKSUM_CORRECT),
+		"segment %u tcp checksum", i);
+    }
+  vlib_buffer_free (vm, segs, vec_len (segs));
+  vec_reset_length (segs);
+
+  /* Headers that do not fit the chained buffers' pre-data */
+  TCP_TEST ((vlib_buffer_alloc (vm, bis, ARRAY_LEN (bis))
+	     == ARRAY_LEN (bis)), "alloc buffers");
+  l3_offset = VLIB_BUFFER_PRE_DATA_SIZE;
+  b = tcp_test_gso_packet (vm, bis, lengths, ARRAY_LEN (bis), 1000, seq,
+			   l3_offset);
+  TCP_TEST ((vnet_gso_segment_buffer (vm, bis[0], b, &segs) == 0
+	     && vec_len (segs) == 0), "headers too long, not segmented");
+  TCP_TEST (((b->flags & VNET_BUFFER_GSO)
+	     && (b->flags & VLIB_BUFFER_NEXT_PRESENT)), "packet left alone");
+  vlib_buffer_free (vm, bis, 1);
+
+  vec_free (segs);
+  return 0;
+}
+
 static clib_error_t *
 tcp_test (vlib_main_t * vm,
 	  unformat_input_t * input, vlib_cli_command_t * cmd_arg)
@@ -1339,6 +1703,14 @@ tcp_test (vlib_main_t * vm,
 	{
 	  res = tcp_test_session (vm, input);
 	}
+      else if (unformat (input, "zero-copy"))
+	{
+	  res = tcp_test_zero_copy (vm, input);
+	}
+      else if (unformat (input, "gso"))
+	{
+	  res = tcp_test_gso (vm, input);
+	}
       else
 	break;
     }
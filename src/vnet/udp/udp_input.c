@@ -232,7 +232,6 @@ udp4_uri_input_node_fn (vlib_main_t * vm,
   for (i = 0; i < vec_len (session_indices_to_enqueue); i++)
     {
       session_fifo_event_t evt;
-      unix_shared_memory_queue_t *q;
       stream_session_t *s0;
       application_t *server0;
 
@@ -257,17 +256,9 @@ udp4_uri_input_node_fn (vlib_main_t * vm,
 	  evt.event_type = FIFO_EVENT_APP_RX;
 	  evt.event_id = serial_number++;
 
-	  /* Add event to server's event queue */
-	  q = server0->event_queue;
-
-	  /* Don't block for lack of space */
-	  if (PREDICT_TRUE (q->cursize < q->maxsize))
-	    {
-	      unix_shared_memory_queue_add (server0->event_queue,
-					    (u8 *) & evt,
-					    0 /* do wait for mutex */ );
-	    }
-	  else
+	  /* Add event to server's event queue, don't block for lack of
+	   * space */
+	  if (svm_ring_enqueue (server0->event_queue, &evt, 1 /* nowait */ ))
 	    {
 	      vlib_node_increment_counter (vm, udp4_uri_input_node.index,
 					   SESSION_ERROR_FIFO_FULL, 1);
@@ -2049,6 +2049,7 @@ vpe_api_hookup (vlib_main_t * vm)
    * Thread-safe API messages
    */
   am->is_mp_safe[VL_API_IP_ADD_DEL_ROUTE] = 1;
+  am->is_mp_safe[VL_API_CLASSIFY_ADD_DEL_SESSION] = 1;
   am->is_mp_safe[VL_API_GET_NODE_GRAPH] = 1;
 
   /*
@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * vpp_get_stats: read the counters from the vpp stats segment.
+ *
+ * The segment is mapped read-only; vpp does no work for us.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <vppinfra/clib.h>
+#include <vppinfra/vec.h>
+#include <vppinfra/format.h>
+#include <vppinfra/mem.h>
+#include <vpp/stats/stat_segment.h>
+
+/* the mapped segment, to sanity check the pointers read from it */
+static uword segment_start, segment_end;
+
+/*
+ * A vector read while vpp reallocates it may be garbage; the snapshot
+ * is retried in that case, but it must not crash us in the meantime.
+ */
+static inline int
+stat_vec_ok (void *v)
+{
+  uword p = pointer_to_uword (v);
+  return p == 0 || (p > segment_start + sizeof (vec_header_t)
+		    && p < segment_end
+		    && p + vec_len (v) * sizeof (u64) <= segment_end);
+}
+
+static stat_segment_shared_header_t *
+stat_segment_map (char *name, int timeout_in_seconds)
+{
+  ssvm_shared_header_t *sh;
+  struct stat st;
+  void *va;
+  int fd;
+
+  if ((fd = shm_open (name, O_RDONLY, 0)) < 0)
+    {
+      clib_unix_warning ("open stats segment '%s'", name);
+      return 0;
+    }
+  if (fstat (fd, &st) < 0 || st.st_size == 0)
+    {
+      clib_warning ("stats segment '%s' is empty", name);
+      close (fd);
+      return 0;
+    }
+
+  sh = mmap (0, MMAP_PAGESIZE, PROT_READ, MAP_SHARED, fd, 0);
+  if (sh == MAP_FAILED)
+    {
+      clib_unix_warning ("mmap");
+      close (fd);
+      return 0;
+    }
+  while (!sh->ready && timeout_in_seconds-- > 0)
+    sleep (1);
+  if (!sh->ready)
+    {
+      clib_warning ("stats segment '%s' not ready", name);
+      goto fail;
+    }
+
+  /*
+   * The segment holds pointers, so it must be mapped at the address
+   * vpp uses. Only ask for it, never clobber an existing mapping.
+   */
+  va = mmap (uword_to_pointer (sh->ssvm_va, void *), sh->ssvm_size,
+	     PROT_READ, MAP_SHARED, fd, 0);
+  if (va == MAP_FAILED)
+    {
+      clib_unix_warning ("mmap");
+      goto fail;
+    }
+  if (pointer_to_uword (va) != sh->ssvm_va)
+    {
+      clib_warning ("could not map the stats segment at 0x%llx",
+		    sh->ssvm_va);
+      munmap (va, sh->ssvm_size);
+      goto fail;
+    }
+  munmap (sh, MMAP_PAGESIZE);
+  close (fd);
+  sh = va;
+  segment_start = pointer_to_uword (va);
+  segment_end = segment_start + sh->ssvm_size;
+  return sh->opaque[STAT_SEGMENT_OPAQUE_HEADER];
+
+fail:
+  munmap (sh, MMAP_PAGESIZE);
+  close (fd);
+  return 0;
+}
+
+static int
+name_matches (char *name, u8 ** patterns)
+{
+  u8 **pattern;
+
+  if (vec_len (patterns) == 0)
+    return 1;
+  vec_foreach (pattern, patterns)
+    if (strstr (name, (char *) *pattern))
+    return 1;
+  return 0;
+}
+
+/*
+ * Snapshot one entry into a formatted string. Retried
+ * if vpp changes the segment while we read.
+ */
+static u8 *
+format_stat_entry (u8 * s, va_list * args)
+{
+  stat_segment_shared_header_t *shared_header =
+    va_arg (*args, stat_segment_shared_header_t *);
+  stat_segment_directory_entry_t *ep =
+    va_arg (*args, stat_segment_directory_entry_t *);
+  u32 s_len = vec_len (s);
+  u64 epoch;
+  int i, k;
+
+  do
+    {
+      if (s)
+	_vec_len (s) = s_len;
+      epoch = stat_segment_access_start (shared_header);
+
+      switch (ep->type)
+	{
+	case STAT_DIR_TYPE_SCALAR_VALUE:
+	  s = format (s, "%.2f %s\n", ep->value, ep->name);
+	  break;
+
+	case STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE:
+	  {
+	    counter_t **counters = ep->data;
+	    if (!stat_vec_ok (counters))
+	      break;
+	    for (i = 0; i < vec_len (counters); i++)
+	      if (!stat_vec_ok (counters[i]))
+		counters = 0;
+	    for (k = 0; counters && k < vec_len (counters[0]); k++)
+	      {
+		counter_t sum = 0;
+		for (i = 0; i < vec_len (counters); i++)
+		  if (k < vec_len (counters[i]))
+		    sum += counters[i][k];
+		s = format (s, "[%d]: %llu %s\n", k, sum, ep->name);
+	      }
+	  }
+	  break;
+
+	case STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED:
+	  {
+	    vlib_counter_t **counters = ep->data;
+	    if (!stat_vec_ok (counters))
+	      break;
+	    for (i = 0; i < vec_len (counters); i++)
+	      if (!stat_vec_ok (counters[i]))
+		counters = 0;
+	    for (k = 0; counters && k < vec_len (counters[0]); k++)
+	      {
+		vlib_counter_t sum = { 0 };
+		for (i = 0; i < vec_len (counters); i++)
+		  if (k < vec_len (counters[i]))
+		    {
+		      sum.packets += counters[i][k].packets;
+		      sum.bytes += counters[i][k].bytes;
+		    }
+		s = format (s, "[%d]: %llu packets, %llu bytes %s\n", k,
+			    sum.packets, sum.bytes, ep->name);
+	      }
+	  }
+	  break;
+
+	case STAT_DIR_TYPE_ERROR_INDEX:
+	  {
+	    u64 sum = 0;
+	    if (!stat_vec_ok (shared_header->error_vector))
+	      break;
+	    for (i = 0; i < vec_len (shared_header->error_vector); i++)
+	      if (stat_vec_ok (shared_header->error_vector[i])
+		  && ep->index < vec_len (shared_header->error_vector[i]))
+		sum += shared_header->error_vector[i][ep->index];
+	    s = format (s, "%llu %s\n", sum, ep->name);
+	  }
+	  break;
+
+	case STAT_DIR_TYPE_NAME_VECTOR:
+	  {
+	    u8 **names = ep->data;
+	    if (!stat_vec_ok (names))
+	      break;
+	    for (k = 0; k < vec_len (names); k++)
+	      if (stat_vec_ok (names[k]))
+		s = format (s, "[%d]: %s %s\n", k, names[k], ep->name);
+	  }
+	  break;
+
+	default:
+	  s = format (s, "unknown type %d %s\n", ep->type, ep->name);
+	  break;
+	}
+    }
+  while (!stat_segment_access_end (shared_header, epoch));
+
+  return s;
+}
+
+static void
+stat_segment_dump (stat_segment_shared_header_t * shared_header,
+		   u8 ** patterns, int ls)
+{
+  stat_segment_directory_entry_t *ep;
+  u8 *s = 0;
+  u64 epoch;
+  int i, n;
+
+  /* the directory itself may be reallocated while we walk it */
+  do
+    {
+      vec_reset_length (s);
+      epoch = stat_segment_access_start (shared_header);
+      if (!stat_vec_ok (shared_header->directory_vector))
+	continue;
+      n = vec_len (shared_header->directory_vector);
+      for (i = 0; i < n; i++)
+	{
+	  ep = vec_elt_at_index (shared_header->directory_vector, i);
+	  if (!name_matches (ep->name, patterns))
+	    continue;
+	  if (ls)
+	    s = format (s, "%s\n", ep->name);
+	  else
+	    s = format (s, "%U", format_stat_entry, shared_header, ep);
+	}
+    }
+  while (!stat_segment_access_end (shared_header, epoch));
+
+  fformat (stdout, "%v", s);
+  vec_free (s);
+}
+
+int
+main (int argc, char **argv)
+{
+  unformat_input_t input;
+  stat_segment_shared_header_t *shared_header;
+  u8 *name = 0, *pattern, **patterns = 0;
+  int interval = 0, ls = 0;
+
+  clib_mem_init (0, 64 << 20);
+  unformat_init_command_line (&input, argv);
+
+  while (unformat_check_input (&input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (&input, "name %s", &name))
+	vec_add1 (name, 0);
+      else if (unformat (&input, "interval %d", &interval))
+	;
+      else if (unformat (&input, "ls"))
+	ls = 1;
+      else if (unformat (&input, "dump"))
+	ls = 0;
+      else if (unformat (&input, "%s", &pattern))
+	{
+	  vec_add1 (pattern, 0);
+	  vec_add1 (patterns, pattern);
+	}
+      else
+	{
+	  fformat (stderr, "usage: vpp_get_stats [name <segment-name>] "
+		   "[interval <nn>] [ls | dump] [<pattern> ...]\n");
+	  exit (1);
+	}
+    }
+
+  if (name == 0)
+    name = format (0, "%s%c", STAT_SEGMENT_DEFAULT_NAME, 0);
+
+  shared_header = stat_segment_map ((char *) name, 3 /* seconds */ );
+  if (shared_header == 0)
+    exit (1);
+
+  do
+    {
+      stat_segment_dump (shared_header, patterns, ls);
+      if (interval)
+	sleep (interval);
+    }
+  while (interval);
+
+  exit (0);
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
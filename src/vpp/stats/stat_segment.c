@@ -0,0 +1,499 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vlib/vlib.h>
+#include <vlibmemory/api.h>
+#include <vpp/stats/stat_segment.h>
+
+stat_segment_main_t stat_segment_main;
+
+/*
+ * Create the segment. Called on the first use of the segment heap,
+ * i.e. after the early config (statseg, api-segment prefix) is known.
+ */
+static int
+stat_segment_create (stat_segment_main_t * sm)
+{
+  api_main_t *am = &api_main;
+  ssvm_private_t *ssvm = &sm->ssvm;
+  stat_segment_shared_header_t *shared_header;
+  void *oldheap;
+  int rv;
+
+  if (sm->shared_header)
+    return 0;
+  if (sm->init_failed)
+    return -1;
+
+  if (sm->size == 0)
+    sm->size = STAT_SEGMENT_DEFAULT_SIZE;
+  if (sm->name == 0)
+    {
+      /* Several instances with different api-segment prefixes coexist */
+      if (am->root_path)
+	sm->name = format (0, "%s-%s%c", am->root_path,
+			   STAT_SEGMENT_DEFAULT_NAME, 0);
+      else
+	sm->name = format (0, "%s%c", STAT_SEGMENT_DEFAULT_NAME, 0);
+    }
+
+  ssvm->ssvm_size = sm->size;
+  ssvm->i_am_master = 1;
+  ssvm->my_pid = getpid ();
+  ssvm->name = sm->name;
+  ssvm->requested_va = 0;
+
+  if ((rv = ssvm_master_init (ssvm, 0 /* master_index */ )))
+    {
+      clib_warning ("stats segment '%s' create failed: %d", sm->name, rv);
+      sm->init_failed = 1;
+      return rv;
+    }
+
+  clib_spinlock_init (&sm->lock);
+
+  oldheap = ssvm_push_heap (ssvm->sh);
+  shared_header = clib_mem_alloc (sizeof (*shared_header));
+  memset (shared_header, 0, sizeof (*shared_header));
+  shared_header->directory_by_name = hash_create_string (0, sizeof (uword));
+  ssvm_pop_heap (oldheap);
+
+  ssvm->sh->opaque[STAT_SEGMENT_OPAQUE_HEADER] = shared_header;
+  sm->shared_header = shared_header;
+  CLIB_MEMORY_BARRIER ();
+  ssvm->sh->ready = 1;
+  return 0;
+}
+
+/*
+ * Find or add a directory entry, with the segment heap pushed
+ * and the epoch odd.
+ */
+static stat_segment_directory_entry_t *
+stat_segment_get_entry (stat_segment_shared_header_t * shared_header,
+			char *name, stat_directory_type_t type)
+{
+  stat_segment_directory_entry_t *ep;
+  uword *p;
+  u8 *key;
+
+  p = hash_get_mem (shared_header->directory_by_name, name);
+  if (p)
+    return vec_elt_at_index (shared_header->directory_vector, p[0]);
+
+  vec_add2 (shared_header->directory_vector, ep, 1);
+  memset (ep, 0, sizeof (*ep));
+  ep->type = type;
+  strncpy (ep->name, name, STAT_SEGMENT_NAME_MAX - 1);
+
+  key = format (0, "%s%c", name, 0);
+  hash_set_mem (shared_header->directory_by_name, key,
+		ep - shared_header->directory_vector);
+  return ep;
+}
+
+void *
+vlib_stats_push_heap (void)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  void *oldheap;
+
+  if (stat_segment_create (sm))
+    return 0;
+
+  clib_spinlock_lock (&sm->lock);
+  /* the readers must not trust what they see from now on */
+  sm->shared_header->epoch++;
+  CLIB_MEMORY_BARRIER ();
+
+  oldheap = ssvm_push_heap (sm->ssvm.sh);
+  ASSERT (oldheap);
+  return oldheap;
+}
+
+static void
+stat_segment_pop_heap (stat_segment_main_t * sm, void *oldheap)
+{
+  ssvm_pop_heap (oldheap);
+  CLIB_MEMORY_BARRIER ();
+  sm->shared_header->epoch++;
+  clib_spinlock_unlock (&sm->lock);
+}
+
+void
+vlib_stats_pop_heap (void *cm_arg, void *oldheap, stat_directory_type_t type)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  stat_segment_directory_entry_t *ep;
+  char *name;
+  void *data;
+
+  if (type == STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE)
+    {
+      vlib_simple_counter_main_t *cm = cm_arg;
+      name = cm->stat_segment_name;
+      data = cm->counters;
+    }
+  else
+    {
+      vlib_combined_counter_main_t *cm = cm_arg;
+      ASSERT (type == STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED);
+      name = cm->stat_segment_name;
+      data = cm->counters;
+    }
+
+  /* the vector may have moved, point the entry to the current one */
+  ep = stat_segment_get_entry (sm->shared_header, name, type);
+  ep->data = data;
+
+  stat_segment_pop_heap (sm, oldheap);
+}
+
+void
+vlib_stats_pop_heap2 (u64 * error_vector, u32 thread_index, void *oldheap)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  stat_segment_shared_header_t *shared_header = sm->shared_header;
+
+  vec_validate (shared_header->error_vector, thread_index);
+  shared_header->error_vector[thread_index] = error_vector;
+
+  stat_segment_pop_heap (sm, oldheap);
+}
+
+void
+vlib_stats_register_error_index (u8 * name, u64 index)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  stat_segment_directory_entry_t *ep;
+  void *oldheap;
+
+  if (!(oldheap = vlib_stats_push_heap ()))
+    return;
+
+  ep = stat_segment_get_entry (sm->shared_header, (char *) name,
+			       STAT_DIR_TYPE_ERROR_INDEX);
+  ep->index = index;
+
+  stat_segment_pop_heap (sm, oldheap);
+}
+
+clib_error_t *
+stat_segment_register_scalar (char *name, u32 * index)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  stat_segment_directory_entry_t *ep;
+  void *oldheap;
+
+  if (!(oldheap = vlib_stats_push_heap ()))
+    return clib_error_return (0, "no stats segment");
+
+  ep = stat_segment_get_entry (sm->shared_header, name,
+			       STAT_DIR_TYPE_SCALAR_VALUE);
+  *index = ep - sm->shared_header->directory_vector;
+
+  stat_segment_pop_heap (sm, oldheap);
+  return 0;
+}
+
+void
+stat_segment_set_scalar (u32 index, f64 value)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+
+  if (sm->shared_header == 0 || index == ~0)
+    return;
+  /* a single aligned store, no need to bump the epoch */
+  sm->shared_header->directory_vector[index].value = value;
+}
+
+/*
+ * Refresh the node names vector if nodes have been added since.
+ */
+static void
+stat_segment_update_node_names (stat_segment_main_t * sm, vlib_main_t * vm)
+{
+  vlib_node_main_t *nm = &vm->node_main;
+  stat_segment_directory_entry_t *ep;
+  void *oldheap;
+  int i;
+
+  if (vec_len (sm->node_names) == vec_len (nm->nodes))
+    return;
+
+  if (!(oldheap = vlib_stats_push_heap ()))
+    return;
+
+  for (i = vec_len (sm->node_names); i < vec_len (nm->nodes); i++)
+    vec_add1 (sm->node_names, format (0, "%v%c", nm->nodes[i]->name, 0));
+
+  ep = stat_segment_get_entry (sm->shared_header, "/sys/node/names",
+			       STAT_DIR_TYPE_NAME_VECTOR);
+  ep->data = sm->node_names;
+
+  stat_segment_pop_heap (sm, oldheap);
+}
+
+/*
+ * Copy the node runtime stats of all the threads into the segment.
+ * Runs in the main thread, so it can not race the node additions,
+ * which happen there under the worker barrier.
+ */
+static void
+stat_segment_update_node_counters (stat_segment_main_t * sm,
+				   vlib_main_t * vm)
+{
+  vlib_node_main_t *nm = &vm->node_main;
+  int i, j, n_nodes = vec_len (nm->nodes);
+  f64 vector_rate = 0;
+
+  stat_segment_update_node_names (sm, vm);
+
+  for (i = 0; i < STAT_SEGMENT_N_NODE_COUNTERS; i++)
+    vlib_validate_simple_counter (&sm->node_counters[i], n_nodes - 1);
+
+  for (j = 0; j < vec_len (vlib_mains); j++)
+    {
+      vlib_main_t *stat_vm = vlib_mains[j];
+      vlib_node_main_t *stat_nm;
+
+      if (!stat_vm)
+	continue;
+      stat_nm = &stat_vm->node_main;
+      vector_rate += vlib_last_vectors_per_main_loop_as_f64 (stat_vm);
+
+      for (i = 0; i < n_nodes && i < vec_len (stat_nm->nodes); i++)
+	{
+	  vlib_node_t *n = stat_nm->nodes[i];
+	  vlib_node_runtime_t *r;
+	  u64 suspends = n->stats_total.suspends;
+
+	  if (n->type == VLIB_NODE_TYPE_PROCESS)
+	    {
+	      vlib_process_t *p;
+	      if (j != 0)
+		continue;
+	      p = vlib_get_process_from_node (stat_vm, n);
+	      r = &p->node_runtime;
+	      suspends += p->n_suspends;
+	    }
+	  else
+	    r = vec_elt_at_index (stat_nm->nodes_by_type[n->type],
+				  n->runtime_index);
+
+	  sm->node_counters[STAT_SEGMENT_NODE_COUNTER_CLOCKS].counters[j][i] =
+	    n->stats_total.clocks + r->clocks_since_last_overflow;
+	  sm->node_counters[STAT_SEGMENT_NODE_COUNTER_VECTORS].counters[j][i] =
+	    n->stats_total.vectors + r->vectors_since_last_overflow;
+	  sm->node_counters[STAT_SEGMENT_NODE_COUNTER_CALLS].counters[j][i] =
+	    n->stats_total.calls + r->calls_since_last_overflow;
+	  sm->node_counters[STAT_SEGMENT_NODE_COUNTER_SUSPENDS].counters[j][i] =
+	    suspends;
+	}
+    }
+
+  stat_segment_set_scalar (sm->vector_rate_index, vector_rate);
+  stat_segment_set_scalar (sm->last_update_index, unix_time_now ());
+}
+
+/*
+ * Copy the barrier stats of each call site into the segment.
+ * The call sites are never deleted, their indices are stable.
+ */
+static void
+stat_segment_update_barrier_counters (stat_segment_main_t * sm,
+				      vlib_main_t * vm)
+{
+  vlib_barrier_main_t *bm = &vlib_barrier_main;
+  f64 usec_per_clock = vm->clib_time.seconds_per_clock * 1e6;
+  stat_segment_directory_entry_t *ep;
+  vlib_barrier_site_t *site;
+  void *oldheap;
+  int i, n_sites = pool_len (bm->sites);
+
+  if (n_sites == 0)
+    return;
+
+  if (vec_len (sm->barrier_names) < n_sites)
+    {
+      if (!(oldheap = vlib_stats_push_heap ()))
+	return;
+      for (i = vec_len (sm->barrier_names); i < n_sites; i++)
+	vec_add1 (sm->barrier_names,
+		  format (0, "%s%c", bm->sites[i].caller, 0));
+      ep = stat_segment_get_entry (sm->shared_header, "/sys/barrier/names",
+				   STAT_DIR_TYPE_NAME_VECTOR);
+      ep->data = sm->barrier_names;
+      stat_segment_pop_heap (sm, oldheap);
+    }
+
+  for (i = 0; i < STAT_SEGMENT_N_BARRIER_COUNTERS; i++)
+    vlib_validate_simple_counter (&sm->barrier_counters[i], n_sites - 1);
+
+  for (i = 0; i < n_sites; i++)
+    {
+      site = pool_elt_at_index (bm->sites, i);
+
+      sm->barrier_counters[STAT_SEGMENT_BARRIER_COUNTER_COUNT].counters[0][i] =
+	site->count;
+      sm->barrier_counters[STAT_SEGMENT_BARRIER_COUNTER_WAIT].counters[0][i] =
+	site->wait_clocks * usec_per_clock;
+      sm->barrier_counters[STAT_SEGMENT_BARRIER_COUNTER_HOLD].counters[0][i] =
+	site->hold_clocks * usec_per_clock;
+      sm->barrier_counters[STAT_SEGMENT_BARRIER_COUNTER_RELEASE].counters[0]
+	[i] = site->release_clocks * usec_per_clock;
+    }
+}
+
+static uword
+stat_segment_collector_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+				vlib_frame_t * f)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+
+  while (1)
+    {
+      vlib_process_suspend (vm, sm->update_interval);
+      if (sm->shared_header)
+	{
+	  stat_segment_update_node_counters (sm, vm);
+	  stat_segment_update_barrier_counters (sm, vm);
+	}
+    }
+  return 0;			/* or not */
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (stat_segment_collector, static) =
+{
+  .function = stat_segment_collector_process,
+  .name = "statseg-collector-process",
+  .type = VLIB_NODE_TYPE_PROCESS,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+stat_segment_init (vlib_main_t * vm)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  clib_error_t *error;
+
+  if (sm->update_interval == 0)
+    sm->update_interval = STAT_SEGMENT_DEFAULT_UPDATE_INTERVAL;
+
+#define _(E,f,s) sm->node_counters[STAT_SEGMENT_NODE_COUNTER_##E]	\
+    .stat_segment_name = s;
+  foreach_stat_segment_node_counter
+#undef _
+#define _(E,f,s) sm->barrier_counters[STAT_SEGMENT_BARRIER_COUNTER_##E]	\
+    .stat_segment_name = s;
+  foreach_stat_segment_barrier_counter
+#undef _
+  sm->last_update_index = sm->vector_rate_index = ~0;
+
+  if ((error = stat_segment_register_scalar ("/sys/last_update",
+					     &sm->last_update_index)))
+    {
+      /* vpp runs without the stats segment */
+      clib_error_report (error);
+      return 0;
+    }
+  return stat_segment_register_scalar ("/sys/vector_rate",
+				       &sm->vector_rate_index);
+}
+
+VLIB_INIT_FUNCTION (stat_segment_init);
+
+static clib_error_t *
+statseg_config (vlib_main_t * vm, unformat_input_t * input)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  u8 *name;
+  uword size;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "name %s", &name))
+	{
+	  vec_add1 (name, 0);
+	  sm->name = name;
+	}
+      else if (unformat (input, "size %U", unformat_memory_size, &size))
+	sm->size = size;
+      else if (unformat (input, "update-interval %f", &sm->update_interval))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+  return 0;
+}
+
+VLIB_EARLY_CONFIG_FUNCTION (statseg_config, "statseg");
+
+static clib_error_t *
+show_stat_segment_command_fn (vlib_main_t * vm,
+			      unformat_input_t * input,
+			      vlib_cli_command_t * cmd)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  stat_segment_shared_header_t *shared_header = sm->shared_header;
+  stat_segment_directory_entry_t *ep;
+  int verbose = 0;
+  static char *type_names[] = {
+    [STAT_DIR_TYPE_ILLEGAL] = "illegal",
+    [STAT_DIR_TYPE_SCALAR_VALUE] = "scalar",
+    [STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE] = "simple counters",
+    [STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED] = "combined counters",
+    [STAT_DIR_TYPE_ERROR_INDEX] = "error",
+    [STAT_DIR_TYPE_NAME_VECTOR] = "names",
+  };
+
+  if (unformat (input, "verbose"))
+    verbose = 1;
+
+  if (!shared_header)
+    return clib_error_return (0, "no stats segment");
+
+  vlib_cli_output (vm, "segment '%s' size %U at %p, %u entries, epoch %lu",
+		   sm->name, format_memory_size, sm->size, sm->ssvm.sh,
+		   vec_len (shared_header->directory_vector),
+		   shared_header->epoch);
+  vlib_cli_output (vm, "%U", format_mheap, sm->ssvm.sh->heap, 0);
+
+  if (!verbose)
+    return 0;
+
+  vec_foreach (ep, shared_header->directory_vector)
+    vlib_cli_output (vm, "%-60s %s", ep->name, type_names[ep->type]);
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_stat_segment_command, static) =
+{
+  .path = "show statistics segment",
+  .short_help = "show statistics segment [verbose]",
+  .function = show_stat_segment_command_fn,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * The stats segment: a shared memory segment which external readers
+ * map read-only to access the counters of vpp directly.
+ *
+ * The counter vectors of the named counter collections, the error
+ * counters and the node runtime stats live in the segment heap. The
+ * directory (name -> type and data) lives there as well. The counter
+ * values are updated in place by the data plane, without any locking;
+ * the readers see them at any frequency at no cost to vpp. The node
+ * runtime stats are private to each thread, so a process copies them,
+ * and the worker barrier stats, into the segment every update-interval
+ * (1 second by default).
+ *
+ * Whenever vpp changes the directory or reallocates a vector in the
+ * segment, it makes the epoch odd for the duration of the change.
+ * A reader takes a consistent snapshot with:
+ *
+ *   do {
+ *     epoch = stat_segment_access_start (shared_header);
+ *     ... read ...
+ *   } while (!stat_segment_access_end (shared_header, epoch));
+ *
+ * The segment is mapped at the same address in all the processes,
+ * so the pointers in it can be followed as is.
+ */
+
+#ifndef included_stat_segment_h
+#define included_stat_segment_h
+
+#include <vppinfra/clib.h>
+#include <vppinfra/vec.h>
+#include <vppinfra/hash.h>
+#include <vppinfra/lock.h>
+#include <vppinfra/serialize.h>
+#include <svm/ssvm.h>
+#include <vlib/counter.h>
+
+#define STAT_SEGMENT_DEFAULT_NAME "vpp-stats"
+#define STAT_SEGMENT_DEFAULT_SIZE (64ULL << 20)
+#define STAT_SEGMENT_DEFAULT_UPDATE_INTERVAL 1.0
+
+/* ssvm_shared_header_t opaque slot of the stats segment header */
+#define STAT_SEGMENT_OPAQUE_HEADER 0
+
+#define STAT_SEGMENT_NAME_MAX 128
+
+#define foreach_stat_segment_node_counter	\
+_(CLOCKS, clocks, "/sys/node/clocks")		\
+_(VECTORS, vectors, "/sys/node/vectors")	\
+_(CALLS, calls, "/sys/node/calls")		\
+_(SUSPENDS, suspends, "/sys/node/suspends")
+
+typedef enum
+{
+#define _(E,n,s) STAT_SEGMENT_NODE_COUNTER_##E,
+  foreach_stat_segment_node_counter
+#undef _
+    STAT_SEGMENT_N_NODE_COUNTERS,
+} stat_segment_node_counter_t;
+
+/* per worker barrier call site, thread 0 only; see show barrier */
+#define foreach_stat_segment_barrier_counter		\
+_(COUNT, count, "/sys/barrier/count")			\
+_(WAIT, wait, "/sys/barrier/wait-us")			\
+_(HOLD, hold, "/sys/barrier/hold-us")			\
+_(RELEASE, release, "/sys/barrier/release-us")
+
+typedef enum
+{
+#define _(E,n,s) STAT_SEGMENT_BARRIER_COUNTER_##E,
+  foreach_stat_segment_barrier_counter
+#undef _
+    STAT_SEGMENT_N_BARRIER_COUNTERS,
+} stat_segment_barrier_counter_t;
+
+typedef struct
+{
+  stat_directory_type_t type;
+  union
+  {
+    u64 index;			/* STAT_DIR_TYPE_ERROR_INDEX */
+    f64 value;			/* STAT_DIR_TYPE_SCALAR_VALUE */
+    void *data;			/* the vectors */
+  };
+  char name[STAT_SEGMENT_NAME_MAX];
+} stat_segment_directory_entry_t;
+
+typedef struct
+{
+  /* odd while the directory or a vector is being changed */
+  volatile u64 epoch;
+
+  /* the directory, in the order of registration */
+  stat_segment_directory_entry_t *directory_vector;
+
+  /* name -> index into the directory vector */
+  uword *directory_by_name;
+
+  /* per-thread error counter vectors, see STAT_DIR_TYPE_ERROR_INDEX */
+  u64 **error_vector;
+} stat_segment_shared_header_t;
+
+typedef struct
+{
+  /* config */
+  u8 *name;
+  u64 size;
+  f64 update_interval;
+
+  ssvm_private_t ssvm;
+  stat_segment_shared_header_t *shared_header;
+  clib_spinlock_t lock;
+  u8 init_failed;
+
+  /* node runtime stats, [thread][node index] */
+  vlib_simple_counter_main_t node_counters[STAT_SEGMENT_N_NODE_COUNTERS];
+  u8 **node_names;
+
+  /* barrier stats, [0][call site index] */
+  vlib_simple_counter_main_t
+    barrier_counters[STAT_SEGMENT_N_BARRIER_COUNTERS];
+  u8 **barrier_names;
+
+  /* the scalars, indices into the directory */
+  u32 last_update_index;
+  u32 vector_rate_index;
+} stat_segment_main_t;
+
+extern stat_segment_main_t stat_segment_main;
+
+/* Reader side */
+
+static inline u64
+stat_segment_access_start (stat_segment_shared_header_t * shared_header)
+{
+  u64 epoch;
+
+  while ((epoch = shared_header->epoch) & 1)
+    ;
+  CLIB_MEMORY_BARRIER ();
+  return epoch;
+}
+
+static inline int
+stat_segment_access_end (stat_segment_shared_header_t * shared_header,
+			 u64 epoch)
+{
+  CLIB_MEMORY_BARRIER ();
+  return shared_header->epoch == epoch;
+}
+
+static inline stat_segment_directory_entry_t *
+stat_segment_lookup (stat_segment_shared_header_t * shared_header,
+		     char *name)
+{
+  uword *p = hash_get_mem (shared_header->directory_by_name, name);
+  return p ? vec_elt_at_index (shared_header->directory_vector, p[0]) : 0;
+}
+
+/* Writer side */
+
+clib_error_t *stat_segment_register_scalar (char *name, u32 * index);
+void stat_segment_set_scalar (u32 index, f64 value);
+
+#endif /* included_stat_segment_h */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
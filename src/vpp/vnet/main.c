@@ -289,10 +289,23 @@ os_exit (int code)
   exit (code);
 }
 
+/* the API message which is about to take the barrier */
+static const char *vl_msg_api_barrier_context;
+
+void
+vl_msg_api_barrier_trace_context (const char *context)
+{
+  vl_msg_api_barrier_context = context;
+}
+
 void
 vl_msg_api_barrier_sync (void)
 {
-  vlib_worker_thread_barrier_sync (vlib_get_main ());
+  const char *caller = vl_msg_api_barrier_context;
+
+  vl_msg_api_barrier_context = 0;
+  vlib_worker_thread_barrier_sync_int (vlib_get_main (),
+				       caller ? caller : __FUNCTION__);
 }
 
 void
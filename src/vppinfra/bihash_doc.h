@@ -38,6 +38,13 @@
     backing pages.  We use an additional log2_pages' worth of bits
     from h(k) to compute the offset of the page which will contain the
     (key,value) pair we're trying to find.
+
+    Writers lock individual buckets with a compare-and-swap on the
+    bucket word, so several threads may add or delete keys
+    concurrently as long as they hit different buckets. A small lock
+    protects the private heap and the freelists. Readers never take
+    a lock: a writer points the bucket at a per-thread working copy
+    while it modifies the backing pages.
 */
 
 /** template key/value backing page structure */
@@ -58,8 +65,10 @@ typedef struct clib_bihash_value
     struct
     {
       u32 offset;  /**< backing page offset in the clib memory heap */
-      u8 pad[3];   /**< log2 (size of the packing page block) */
-      u8 log2_pages;
+      u8 linear_search; /**< bucket has unresolvable collisions */
+      u8 lock;     /**< writer lock bit, ignored by readers */
+      u8 pad[1];
+      u8 log2_pages; /**< log2 (size of the packing page block) */
     };
     u64 as_u64;
   };
@@ -69,10 +78,9 @@ typedef struct clib_bihash_value
 typedef struct
 {
   clib_bihash_bucket_t *buckets;  /**< Hash bucket vector, power-of-two in size */
-  volatile u32 *writer_lock;  /**< Writer lock, in its own cache line */
+  volatile u32 *alloc_lock;  /**< Heap / freelist lock, in its own cache line */
     BVT (clib_bihash_value) ** working_copies;
-					    /**< Working copies (various sizes), to avoid locking against readers */
-  clib_bihash_bucket_t saved_bucket; /**< Saved bucket pointer */
+					    /**< Per-thread working copies (various sizes), to avoid locking against readers */
   u32 nbuckets;			     /**< Number of hash buckets */
   u32 log2_nbuckets;		     /**< lg(nbuckets) */
   u8 *name;			     /**< hash table name */
@@ -127,6 +135,22 @@ int clib_bihash_add_del (clib_bihash * h, clib_bihash_kv * add_v, int is_add);
 int clib_bihash_search (clib_bihash * h,
 			clib_bihash_kv * search_v, clib_bihash_kv * return_v);
 
+/** Search a bi-hash table for a batch of keys
+
+    Hashes a batch of keys and prefetches their buckets, then
+    prefetches the value pages, then compares the keys, so that the
+    cache misses for the whole batch overlap.
+
+    @param h - the bi-hash table to search
+    @param kvp - vector of n_keys (key,value) pairs, replaced by the
+    matching (key,value) pair on success
+    @param n_keys - number of keys to look up
+    @param results - set to 0 on success, < 0 on error, per key
+*/
+void clib_bihash_search_inline_batch (clib_bihash * h,
+				      clib_bihash_kv * kvp, u32 n_keys,
+				      int *results);
+
 
 /** Visit active (key,value) pairs in a bi-hash table
 
@@ -30,8 +30,9 @@ void BV (clib_bihash_init)
 
   oldheap = clib_mem_set_heap (h->mheap);
   vec_validate_aligned (h->buckets, nbuckets - 1, CLIB_CACHE_LINE_BYTES);
-  h->writer_lock = clib_mem_alloc_aligned (CLIB_CACHE_LINE_BYTES,
-					   CLIB_CACHE_LINE_BYTES);
+  h->alloc_lock = clib_mem_alloc_aligned (CLIB_CACHE_LINE_BYTES,
+					  CLIB_CACHE_LINE_BYTES);
+  h->alloc_lock[0] = 0;
 
   clib_mem_set_heap (oldheap);
 }
@@ -42,6 +43,28 @@ void BV (clib_bihash_free) (BVT (clib_bihash) * h)
   memset (h, 0, sizeof (*h));
 }
 
+/*
+ * The private heap, the freelists and the working copy vector are
+ * shared by all writers. Bucket contents are protected by the
+ * per-bucket lock, so this lock is only held across (de)allocation.
+ */
+static inline void
+BV (alloc_lock) (BVT (clib_bihash) * h)
+{
+  while (__sync_lock_test_and_set (h->alloc_lock, 1))
+#if __x86_64__
+    __builtin_ia32_pause ()
+#endif
+      ;
+}
+
+static inline void
+BV (alloc_unlock) (BVT (clib_bihash) * h)
+{
+  CLIB_MEMORY_BARRIER ();
+  h->alloc_lock[0] = 0;
+}
+
 static
 BVT (clib_bihash_value) *
 BV (value_alloc) (BVT (clib_bihash) * h, u32 log2_pages)
@@ -49,7 +72,7 @@ BV (value_alloc) (BVT (clib_bihash) * h, u32 log2_pages)
   BVT (clib_bihash_value) * rv = 0;
   void *oldheap;
 
-  ASSERT (h->writer_lock[0]);
+  BV (alloc_lock) (h);
   if (log2_pages >= vec_len (h->freelists) || h->freelists[log2_pages] == 0)
     {
       oldheap = clib_mem_set_heap (h->mheap);
@@ -64,6 +87,7 @@ BV (value_alloc) (BVT (clib_bihash) * h, u32 log2_pages)
   h->freelists[log2_pages] = rv->next_free;
 
 initialize:
+  BV (alloc_unlock) (h);
   ASSERT (rv);
   /*
    * Latest gcc complains that the length arg is zero
@@ -78,15 +102,21 @@ static void
 BV (value_free) (BVT (clib_bihash) * h, BVT (clib_bihash_value) * v,
 		 u32 log2_pages)
 {
-  ASSERT (h->writer_lock[0]);
+  BV (alloc_lock) (h);
 
   ASSERT (vec_len (h->freelists) > log2_pages);
 
   v->next_free = h->freelists[log2_pages];
   h->freelists[log2_pages] = v;
+
+  BV (alloc_unlock) (h);
 }
 
-static inline void
+/*
+ * Called with the bucket locked. Returns this thread's working copy,
+ * which the bucket points at until the caller restores or replaces it.
+ */
+static inline BVT (clib_bihash_value) *
 BV (make_working_copy) (BVT (clib_bihash) * h, clib_bihash_bucket_t * b)
 {
   BVT (clib_bihash_value) * v;
@@ -96,25 +126,24 @@ BV (make_working_copy) (BVT (clib_bihash) * h, clib_bihash_bucket_t * b)
   u32 thread_index = os_get_thread_index ();
   int log2_working_copy_length;
 
+  /*
+   * working_copies are per-cpu so that near-simultaneous
+   * updates from multiple threads will not result in sporadic, spurious
+   * lookup failures. Another writer may grow the vectors, so they are
+   * only touched under the allocator lock.
+   */
+  BV (alloc_lock) (h);
+  oldheap = clib_mem_set_heap (h->mheap);
+
   if (thread_index >= vec_len (h->working_copies))
     {
-      oldheap = clib_mem_set_heap (h->mheap);
       vec_validate (h->working_copies, thread_index);
       vec_validate_init_empty (h->working_copy_lengths, thread_index, ~0);
-      clib_mem_set_heap (oldheap);
     }
 
-  /*
-   * working_copies are per-cpu so that near-simultaneous
-   * updates from multiple threads will not result in sporadic, spurious
-   * lookup failures.
-   */
   working_copy = h->working_copies[thread_index];
   log2_working_copy_length = h->working_copy_lengths[thread_index];
 
-  h->saved_bucket.as_u64 = b->as_u64;
-  oldheap = clib_mem_set_heap (h->mheap);
-
   if (b->log2_pages > log2_working_copy_length)
     {
       if (working_copy)
@@ -128,6 +157,7 @@ BV (make_working_copy) (BVT (clib_bihash) * h, clib_bihash_bucket_t * b)
     }
 
   clib_mem_set_heap (oldheap);
+  BV (alloc_unlock) (h);
 
   v = BV (clib_bihash_get_value) (h, b->offset);
 
@@ -136,7 +166,7 @@ BV (make_working_copy) (BVT (clib_bihash) * h, clib_bihash_bucket_t * b)
   working_bucket.offset = BV (clib_bihash_get_offset) (h, working_copy);
   CLIB_MEMORY_BARRIER ();
   b->as_u64 = working_bucket.as_u64;
-  h->working_copies[thread_index] = working_copy;
+  return working_copy;
 }
 
 static
@@ -235,13 +265,12 @@ int BV (clib_bihash_add_del)
   (BVT (clib_bihash) * h, BVT (clib_bihash_kv) * add_v, int is_add)
 {
   u32 bucket_index;
-  clib_bihash_bucket_t *b, tmp_b;
+  clib_bihash_bucket_t *b, tmp_b, saved_b;
   BVT (clib_bihash_value) * v, *new_v, *save_new_v, *working_copy;
   int rv = 0;
   int i, limit;
   u64 hash, new_hash;
   u32 new_log2_pages, old_log2_pages;
-  u32 thread_index = os_get_thread_index ();
   int mark_bucket_linear;
   int resplit_once;
 
@@ -252,10 +281,7 @@ int BV (clib_bihash_add_del)
 
   hash >>= h->log2_nbuckets;
 
-  tmp_b.linear_search = 0;
-
-  while (__sync_lock_test_and_set (h->writer_lock, 1))
-    ;
+  clib_bihash_lock_bucket (b);
 
   /* First elt in the bucket? */
   if (b->offset == 0)
@@ -271,14 +297,17 @@ int BV (clib_bihash_add_del)
       *v->kvp = *add_v;
       tmp_b.as_u64 = 0;
       tmp_b.offset = BV (clib_bihash_get_offset) (h, v);
+      tmp_b.lock = 1;
 
+      CLIB_MEMORY_BARRIER ();
       b->as_u64 = tmp_b.as_u64;
       goto unlock;
     }
 
-  BV (make_working_copy) (h, b);
+  saved_b.as_u64 = b->as_u64;
+  working_copy = BV (make_working_copy) (h, b);
 
-  v = BV (clib_bihash_get_value) (h, h->saved_bucket.offset);
+  v = BV (clib_bihash_get_value) (h, saved_b.offset);
 
   limit = BIHASH_KVP_PER_PAGE;
   v += (b->linear_search == 0) ? hash & ((1 << b->log2_pages) - 1) : 0;
@@ -298,7 +327,7 @@ int BV (clib_bihash_add_del)
 	      clib_memcpy (&(v->kvp[i]), add_v, sizeof (*add_v));
 	      CLIB_MEMORY_BARRIER ();
 	      /* Restore the previous (k,v) pairs */
-	      b->as_u64 = h->saved_bucket.as_u64;
+	      b->as_u64 = saved_b.as_u64;
 	      goto unlock;
 	    }
 	}
@@ -308,7 +337,7 @@ int BV (clib_bihash_add_del)
 	    {
 	      clib_memcpy (&(v->kvp[i]), add_v, sizeof (*add_v));
 	      CLIB_MEMORY_BARRIER ();
-	      b->as_u64 = h->saved_bucket.as_u64;
+	      b->as_u64 = saved_b.as_u64;
 	      goto unlock;
 	    }
 	}
@@ -322,20 +351,19 @@ int BV (clib_bihash_add_del)
 	    {
 	      memset (&(v->kvp[i]), 0xff, sizeof (*(add_v)));
 	      CLIB_MEMORY_BARRIER ();
-	      b->as_u64 = h->saved_bucket.as_u64;
+	      b->as_u64 = saved_b.as_u64;
 	      goto unlock;
 	    }
 	}
       rv = -3;
-      b->as_u64 = h->saved_bucket.as_u64;
+      b->as_u64 = saved_b.as_u64;
       goto unlock;
     }
 
-  old_log2_pages = h->saved_bucket.log2_pages;
+  old_log2_pages = saved_b.log2_pages;
   new_log2_pages = old_log2_pages + 1;
   mark_bucket_linear = 0;
 
-  working_copy = h->working_copies[thread_index];
   resplit_once = 0;
 
   new_v = BV (split_and_rehash) (h, working_copy, old_log2_pages,
@@ -392,21 +420,23 @@ int BV (clib_bihash_add_del)
 
 expand_ok:
   /* Keep track of the number of linear-scan buckets */
-  if (tmp_b.linear_search ^ mark_bucket_linear)
-    h->linear_buckets += (mark_bucket_linear == 1) ? 1 : -1;
+  if (saved_b.linear_search ^ mark_bucket_linear)
+    __sync_fetch_and_add (&h->linear_buckets,
+			  (mark_bucket_linear == 1) ? 1 : -1);
 
+  tmp_b.as_u64 = 0;
   tmp_b.log2_pages = new_log2_pages;
   tmp_b.offset = BV (clib_bihash_get_offset) (h, save_new_v);
   tmp_b.linear_search = mark_bucket_linear;
+  tmp_b.lock = 1;
 
   CLIB_MEMORY_BARRIER ();
   b->as_u64 = tmp_b.as_u64;
-  v = BV (clib_bihash_get_value) (h, h->saved_bucket.offset);
+  v = BV (clib_bihash_get_value) (h, saved_b.offset);
   BV (value_free) (h, v, old_log2_pages);
 
 unlock:
-  CLIB_MEMORY_BARRIER ();
-  h->writer_lock[0] = 0;
+  clib_bihash_unlock_bucket (b);
   return rv;
 }
 
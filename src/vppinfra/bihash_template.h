@@ -62,23 +62,55 @@ typedef struct
     {
       u32 offset;
       u8 linear_search;
-      u8 pad[2];
+      u8 lock;
+      u8 pad[1];
       u8 log2_pages;
     };
     u64 as_u64;
   };
 } clib_bihash_bucket_t;
+
+/*
+ * Writers serialize on a per-bucket lock bit, so that threads which
+ * modify disjoint buckets don't contend. Readers never look at the
+ * lock bit.
+ */
+static inline void
+clib_bihash_lock_bucket (clib_bihash_bucket_t * b)
+{
+  clib_bihash_bucket_t unlocked_bucket, locked_bucket;
+
+  while (1)
+    {
+      unlocked_bucket.as_u64 = b->as_u64;
+      unlocked_bucket.lock = 0;
+      locked_bucket.as_u64 = unlocked_bucket.as_u64;
+      locked_bucket.lock = 1;
+      if (__sync_bool_compare_and_swap (&b->as_u64, unlocked_bucket.as_u64,
+					locked_bucket.as_u64))
+	break;
+#if __x86_64__
+      __builtin_ia32_pause ();
+#endif
+    }
+}
+
+static inline void
+clib_bihash_unlock_bucket (clib_bihash_bucket_t * b)
+{
+  CLIB_MEMORY_BARRIER ();
+  b->lock = 0;
+}
 #endif /* __defined_clib_bihash_bucket_t__ */
 
 typedef struct
 {
   BVT (clib_bihash_value) * values;
   clib_bihash_bucket_t *buckets;
-  volatile u32 *writer_lock;
+  volatile u32 *alloc_lock;
 
     BVT (clib_bihash_value) ** working_copies;
   int *working_copy_lengths;
-  clib_bihash_bucket_t saved_bucket;
 
   u32 nbuckets;
   u32 log2_nbuckets;
@@ -208,6 +240,85 @@ static inline int BV (clib_bihash_search_inline_2)
   return -1;
 }
 
+#ifndef BIHASH_SEARCH_BATCH_SIZE
+#define BIHASH_SEARCH_BATCH_SIZE 16
+#endif
+
+/*
+ * Search for n_keys keys at once. The hashes are computed and the
+ * buckets prefetched for a batch of keys, then the value pages for
+ * the whole batch are prefetched, and only then are the keys
+ * compared. On a hit, kvp[i] is replaced with the matching (key,value)
+ * pair and results[i] is set to 0; on a miss results[i] is set to -1.
+ */
+static inline void BV (clib_bihash_search_inline_batch)
+  (const BVT (clib_bihash) * h, BVT (clib_bihash_kv) * kvp, u32 n_keys,
+   int *results)
+{
+  u64 hashes[BIHASH_SEARCH_BATCH_SIZE];
+  BVT (clib_bihash_value) * values[BIHASH_SEARCH_BATCH_SIZE];
+  clib_bihash_bucket_t buckets[BIHASH_SEARCH_BATCH_SIZE];
+  clib_bihash_bucket_t *b;
+  u32 n_this_batch;
+  int i, j, limit;
+
+  while (n_keys > 0)
+    {
+      n_this_batch = clib_min (n_keys, BIHASH_SEARCH_BATCH_SIZE);
+
+      /* Stage 1: hash the keys, prefetch the buckets */
+      for (i = 0; i < n_this_batch; i++)
+	{
+	  hashes[i] = BV (clib_bihash_hash) (&kvp[i]);
+	  b = &h->buckets[hashes[i] & (h->nbuckets - 1)];
+	  CLIB_PREFETCH (b, sizeof (*b), LOAD);
+	}
+
+      /* Stage 2: read the buckets, prefetch the value pages */
+      for (i = 0; i < n_this_batch; i++)
+	{
+	  buckets[i].as_u64 =
+	    h->buckets[hashes[i] & (h->nbuckets - 1)].as_u64;
+	  if (buckets[i].offset == 0)
+	    {
+	      values[i] = 0;
+	      continue;
+	    }
+	  values[i] = BV (clib_bihash_get_value) (h, buckets[i].offset);
+	  if (PREDICT_TRUE (buckets[i].linear_search == 0))
+	    values[i] += (hashes[i] >> h->log2_nbuckets)
+	      & ((1 << buckets[i].log2_pages) - 1);
+	  CLIB_PREFETCH (values[i], sizeof (*values[i]), LOAD);
+	}
+
+      /* Stage 3: compare */
+      for (i = 0; i < n_this_batch; i++)
+	{
+	  results[i] = -1;
+	  if (values[i] == 0)
+	    continue;
+
+	  limit = BIHASH_KVP_PER_PAGE;
+	  if (PREDICT_FALSE (buckets[i].linear_search))
+	    limit <<= buckets[i].log2_pages;
+
+	  for (j = 0; j < limit; j++)
+	    {
+	      if (BV (clib_bihash_key_compare)
+		  (values[i]->kvp[j].key, kvp[i].key))
+		{
+		  kvp[i] = values[i]->kvp[j];
+		  results[i] = 0;
+		  break;
+		}
+	    }
+	}
+
+      kvp += n_this_batch;
+      results += n_this_batch;
+      n_keys -= n_this_batch;
+    }
+}
 
 #endif /* __included_bihash_template_h__ */
 
@@ -25,9 +25,19 @@
  * Order is important for runtime selection, as 1st match wins...
  */
 
+#define CLIB_MARCH_AVX2_TARGET "avx2,bmi,bmi2,fma,lzcnt,popcnt,movbe"
+#define CLIB_MARCH_AVX512_TARGET \
+  "avx512f,avx512bw,avx512cd,avx512dq,avx512vl," CLIB_MARCH_AVX2_TARGET
+
+/*
+ * The targets are instruction sets, not "arch=": changing the tuning
+ * as well would stop gcc from inlining the always_inline node bodies
+ * into the clones.
+ */
 #if __x86_64__ && CLIB_DEBUG == 0
 #define foreach_march_variant(macro, x) \
-  macro(avx2,  x, "arch=core-avx2")
+  macro(avx512, x, CLIB_MARCH_AVX512_TARGET) \
+  macro(avx2,  x, CLIB_MARCH_AVX2_TARGET)
 #else
 #define foreach_march_variant(macro, x)
 #endif
@@ -41,7 +51,7 @@
 
 
 #define CLIB_MULTIARCH_ARCH_CHECK(arch, fn, tgt)			\
-  if (clib_cpu_supports_ ## arch())					\
+  if (clib_cpu_march_supports_ ## arch())				\
     return & fn ## _ ##arch;
 
 #define CLIB_MULTIARCH_SELECT_FN(fn,...)                               \
@@ -55,13 +65,24 @@
 #define foreach_x86_64_flags \
 _ (sse3,     1, ecx, 0)   \
 _ (ssse3,    1, ecx, 9)   \
+_ (fma,      1, ecx, 12)  \
 _ (sse41,    1, ecx, 19)  \
 _ (sse42,    1, ecx, 20)  \
+_ (movbe,    1, ecx, 22)  \
+_ (popcnt,   1, ecx, 23)  \
+_ (osxsave,  1, ecx, 27)  \
 _ (avx,      1, ecx, 28)  \
+_ (bmi,      7, ebx, 3)   \
 _ (avx2,     7, ebx, 5)   \
+_ (bmi2,     7, ebx, 8)   \
 _ (avx512f,  7, ebx, 16)  \
+_ (avx512dq, 7, ebx, 17)  \
+_ (avx512cd, 7, ebx, 28)  \
+_ (avx512bw, 7, ebx, 30)  \
+_ (avx512vl, 7, ebx, 31)  \
 _ (aes,      1, ecx, 25)  \
 _ (sha,      7, ebx, 29)  \
+_ (lzcnt,    0x80000001, ecx, 5) \
 _ (invariant_tsc, 0x80000007, edx, 8)
 
 #if defined(__x86_64__)
@@ -87,17 +108,63 @@ clib_cpu_supports_ ## flag()						\
   u32 __attribute__((unused)) eax, ebx = 0, ecx = 0, edx  = 0;		\
   clib_get_cpuid (func, &eax, &ebx, &ecx, &edx);			\
 									\
-  return ((reg & (1 << bit)) != 0);					\
+  return ((reg & (1U << bit)) != 0);					\
 }
 foreach_x86_64_flags
 #undef _
+
+/* The register state the OS saves, hence lets us use */
+static inline u64
+clib_cpu_xcr0 (void)
+{
+  u32 lo, hi;
+
+  if (!clib_cpu_supports_osxsave ())
+    return 0;
+  asm volatile ("xgetbv":"=a" (lo), "=d" (hi):"c" (0));
+  return ((u64) hi << 32) | lo;
+}
 #else
 
 #define _(flag, func, reg, bit) \
 static inline int clib_cpu_supports_ ## flag() { return 0; }
 foreach_x86_64_flags
 #undef _
+
+static inline u64
+clib_cpu_xcr0 (void)
+{
+  return 0;
+}
 #endif
+
+/* XCR0: sse, avx, then the avx512 opmask, zmm0-15 upper halves, zmm16-31 */
+#define CLIB_CPU_XCR0_AVX	0x06
+#define CLIB_CPU_XCR0_AVX512	0xe6
+
+/* Can the avx2 variants run: every feature of CLIB_MARCH_AVX2_TARGET,
+   and ymm state saved by the OS */
+static inline int
+clib_cpu_march_supports_avx2 (void)
+{
+  return clib_cpu_supports_avx2 () && clib_cpu_supports_bmi ()
+    && clib_cpu_supports_bmi2 () && clib_cpu_supports_fma ()
+    && clib_cpu_supports_lzcnt () && clib_cpu_supports_popcnt ()
+    && clib_cpu_supports_movbe ()
+    && (clib_cpu_xcr0 () & CLIB_CPU_XCR0_AVX) == CLIB_CPU_XCR0_AVX;
+}
+
+/* Can the avx512 variants run: skylake server and later, with zmm and
+   opmask state saved by the OS */
+static inline int
+clib_cpu_march_supports_avx512 (void)
+{
+  return clib_cpu_march_supports_avx2 ()
+    && clib_cpu_supports_avx512f () && clib_cpu_supports_avx512bw ()
+    && clib_cpu_supports_avx512cd () && clib_cpu_supports_avx512dq ()
+    && clib_cpu_supports_avx512vl ()
+    && (clib_cpu_xcr0 () & CLIB_CPU_XCR0_AVX512) == CLIB_CPU_XCR0_AVX512;
+}
 #endif
   format_function_t format_cpu_uarch;
 format_function_t format_cpu_model_name;
@@ -15,6 +15,7 @@
 #include <vppinfra/time.h>
 #include <vppinfra/cache.h>
 #include <vppinfra/error.h>
+#include <pthread.h>
 
 #include <vppinfra/bihash_8_8.h>
 #include <vppinfra/bihash_template.h>
@@ -30,11 +31,16 @@ typedef struct
   int careful_delete_tests;
   int verbose;
   int non_random_keys;
+  u32 max_threads;
   uword *key_hash;
   u64 *keys;
     BVT (clib_bihash) hash;
   clib_time_t clib_time;
 
+  /* multi-writer test */
+  volatile u32 threads_ready;
+  volatile u32 threads_go;
+
   unformat_input_t *input;
 
 } test_main_t;
@@ -84,19 +90,11 @@ test_bihash_vec64 (test_main_t * tm)
   return 0;
 }
 
-static clib_error_t *
-test_bihash (test_main_t * tm)
+static void
+test_bihash_pick_keys (test_main_t * tm)
 {
-  int i, j;
   uword *p;
-  uword total_searches;
-  f64 before, delta;
-  BVT (clib_bihash) * h;
-  BVT (clib_bihash_kv) kv;
-
-  h = &tm->hash;
-
-  BV (clib_bihash_init) (h, "test", tm->nbuckets, 3ULL << 30);
+  int i;
 
   fformat (stdout, "Pick %lld unique %s keys...\n",
 	   tm->nitems, tm->non_random_keys ? "non-random" : "random");
@@ -121,6 +119,228 @@ test_bihash (test_main_t * tm)
       hash_set (tm->key_hash, rndkey, i + 1);
       vec_add1 (tm->keys, rndkey);
     }
+}
+
+typedef struct
+{
+  test_main_t *tm;
+  void *heap;
+  u32 thread_index;
+  u32 first_key;
+  u32 n_keys;
+  f64 elapsed;
+} test_bihash_thread_args_t;
+
+static void *
+test_bihash_writer_thread_fn (void *arg)
+{
+  test_bihash_thread_args_t *a = arg;
+  test_main_t *tm = a->tm;
+  BVT (clib_bihash) * h = &tm->hash;
+  BVT (clib_bihash_kv) kv;
+  u64 before;
+  int i;
+
+  __os_thread_index = a->thread_index;
+  clib_mem_set_per_cpu_heap (a->heap);
+
+  __sync_fetch_and_add (&tm->threads_ready, 1);
+  while (tm->threads_go == 0)
+    ;
+
+  before = clib_cpu_time_now ();
+
+  for (i = a->first_key; i < a->first_key + a->n_keys; i++)
+    {
+      kv.key = tm->keys[i];
+      kv.value = i + 1;
+      BV (clib_bihash_add_del) (h, &kv, 1 /* is_add */ );
+    }
+
+  a->elapsed = (clib_cpu_time_now () - before)
+    * tm->clib_time.seconds_per_clock;
+  return 0;
+}
+
+static clib_error_t *
+test_bihash_threads (test_main_t * tm)
+{
+  BVT (clib_bihash) * h = &tm->hash;
+  BVT (clib_bihash_kv) kv;
+  test_bihash_thread_args_t *args = 0;
+  pthread_t *threads = 0;
+  u32 n_threads, keys_per_thread;
+  f64 before, delta;
+  int i, n_errors;
+
+  if (tm->max_threads >= CLIB_MAX_MHEAPS)
+    return clib_error_return (0, "max threads is %d", CLIB_MAX_MHEAPS - 1);
+
+  test_bihash_pick_keys (tm);
+
+  vec_validate (args, tm->max_threads - 1);
+  vec_validate (threads, tm->max_threads - 1);
+
+  for (n_threads = 1; n_threads <= tm->max_threads; n_threads++)
+    {
+      BV (clib_bihash_init) (h, "test", tm->nbuckets, 3ULL << 30);
+
+      keys_per_thread = tm->nitems / n_threads;
+      tm->threads_ready = 0;
+      tm->threads_go = 0;
+
+      for (i = 0; i < n_threads; i++)
+	{
+	  args[i].tm = tm;
+	  args[i].heap = clib_mem_get_heap ();
+	  args[i].thread_index = i + 1;
+	  args[i].first_key = i * keys_per_thread;
+	  args[i].n_keys = keys_per_thread;
+	  if (pthread_create (&threads[i], NULL /* attr */ ,
+			      test_bihash_writer_thread_fn, &args[i]))
+	    return clib_error_return_unix (0, "pthread_create");
+	}
+
+      while (tm->threads_ready < n_threads)
+	;
+
+      before = clib_time_now (&tm->clib_time);
+      tm->threads_go = 1;
+
+      for (i = 0; i < n_threads; i++)
+	pthread_join (threads[i], NULL /* retval */ );
+
+      delta = clib_time_now (&tm->clib_time) - before;
+
+      n_errors = 0;
+      for (i = 0; i < n_threads * keys_per_thread; i++)
+	{
+	  kv.key = tm->keys[i];
+	  if (BV (clib_bihash_search) (h, &kv, &kv) < 0
+	      || kv.value != (u64) (i + 1))
+	    n_errors++;
+	}
+
+      fformat (stdout, "%d writer thread%s: %.f inserts per second",
+	       n_threads, n_threads > 1 ? "s" : "",
+	       (f64) (n_threads * keys_per_thread) / delta);
+      for (i = 0; i < n_threads; i++)
+	fformat (stdout, "%s%.f", i ? ", " : " (per thread ",
+		 (f64) keys_per_thread / args[i].elapsed);
+      fformat (stdout, ")\n");
+
+      if (n_errors)
+	clib_warning ("%d keys missing after %d thread insert",
+		      n_errors, n_threads);
+
+      if (tm->verbose > 1)
+	fformat (stdout, "%U", BV (format_bihash), h, 0 /* verbose */ );
+
+      BV (clib_bihash_free) (h);
+    }
+
+  vec_free (args);
+  vec_free (threads);
+  return 0;
+}
+
+static clib_error_t *
+test_bihash_batch (test_main_t * tm)
+{
+  BVT (clib_bihash) * h = &tm->hash;
+  BVT (clib_bihash_kv) kv, *kvs = 0;
+  int *results = 0;
+  u32 *table_sizes = 0;
+  u32 n_items, n_searches, n_misses;
+  f64 before, single_delta, batch_delta;
+  int i, j, k;
+
+  test_bihash_pick_keys (tm);
+
+  vec_validate (kvs, tm->nitems - 1);
+  vec_validate (results, tm->nitems - 1);
+
+  /*
+   * Grow the table 4x at a time, so that the small tables fit
+   * in the LLC and the large ones don't.
+   */
+  for (n_items = 1 << 10; n_items < tm->nitems; n_items <<= 2)
+    vec_add1 (table_sizes, n_items);
+  vec_add1 (table_sizes, tm->nitems);
+
+  for (k = 0; k < vec_len (table_sizes); k++)
+    {
+      n_items = table_sizes[k];
+      BV (clib_bihash_init) (h, "test", clib_max (n_items >> 2, 1),
+			     3ULL << 30);
+
+      for (i = 0; i < n_items; i++)
+	{
+	  kv.key = tm->keys[i];
+	  kv.value = i + 1;
+	  BV (clib_bihash_add_del) (h, &kv, 1 /* is_add */ );
+	}
+
+      n_searches = clib_max (tm->search_iter, 1) * tm->nitems;
+      n_misses = 0;
+
+      before = clib_time_now (&tm->clib_time);
+      for (i = 0; i < n_searches; i++)
+	{
+	  kv.key = tm->keys[i % n_items];
+	  if (BV (clib_bihash_search_inline) (h, &kv) < 0)
+	    n_misses++;
+	}
+      single_delta = clib_time_now (&tm->clib_time) - before;
+
+      before = clib_time_now (&tm->clib_time);
+      for (i = 0; i < n_searches; i += n_items)
+	{
+	  u32 n_this_pass = clib_min (n_items, n_searches - i);
+
+	  for (j = 0; j < n_this_pass; j++)
+	    kvs[j].key = tm->keys[j];
+	  BV (clib_bihash_search_inline_batch) (h, kvs, n_this_pass,
+						results);
+	  for (j = 0; j < n_this_pass; j++)
+	    if (results[j] < 0 || kvs[j].value != (u64) (j + 1))
+	      n_misses++;
+	}
+      batch_delta = clib_time_now (&tm->clib_time) - before;
+
+      fformat (stdout, "%10d items, %8.2f MB: %.f searches/sec, "
+	       "%.f batch searches/sec\n", n_items,
+	       (f64) mheap_bytes (h->mheap) / (1 << 20),
+	       (f64) n_searches / single_delta,
+	       (f64) n_searches / batch_delta);
+
+      if (n_misses)
+	clib_warning ("%d searches failed unexpectedly", n_misses);
+
+      BV (clib_bihash_free) (h);
+    }
+
+  vec_free (kvs);
+  vec_free (results);
+  vec_free (table_sizes);
+  return 0;
+}
+
+static clib_error_t *
+test_bihash (test_main_t * tm)
+{
+  int i, j;
+  uword *p;
+  uword total_searches;
+  f64 before, delta;
+  BVT (clib_bihash) * h;
+  BVT (clib_bihash_kv) kv;
+
+  h = &tm->hash;
+
+  BV (clib_bihash_init) (h, "test", tm->nbuckets, 3ULL << 30);
+
+  test_bihash_pick_keys (tm);
 
   fformat (stdout, "Add items...\n");
   for (i = 0; i < tm->nitems; i++)
@@ -242,6 +462,7 @@ test_bihash_main (test_main_t * tm)
   unformat_input_t *i = tm->input;
   clib_error_t *error;
   int test_vec64 = 0;
+  int test_batch = 0;
 
   while (unformat_check_input (i) != UNFORMAT_END_OF_INPUT)
     {
@@ -262,6 +483,10 @@ test_bihash_main (test_main_t * tm)
 	;
       else if (unformat (i, "vec64"))
 	test_vec64 = 1;
+      else if (unformat (i, "threads %d", &tm->max_threads))
+	;
+      else if (unformat (i, "batch"))
+	test_batch = 1;
       else if (unformat (i, "verbose"))
 	tm->verbose = 1;
       else
@@ -271,6 +496,10 @@ test_bihash_main (test_main_t * tm)
 
   if (test_vec64)
     error = test_bihash_vec64 (tm);
+  else if (tm->max_threads)
+    error = test_bihash_threads (tm);
+  else if (test_batch)
+    error = test_bihash_batch (tm);
   else
     error = test_bihash (tm);
 
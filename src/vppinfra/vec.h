@@ -161,7 +161,6 @@ _vec_resize_will_expand (void *v,
 			 uword data_bytes, uword header_bytes,
 			 uword data_align)
 {
-  vec_header_t *vh = _vec_find (v);
   uword new_data_bytes, aligned_header_bytes;
 
   aligned_header_bytes = vec_header_bytes (header_bytes);
@@ -177,10 +176,7 @@ _vec_resize_will_expand (void *v,
 
       /* Typically we'll not need to resize. */
       if (new_data_bytes <= clib_mem_size (p))
-	{
-	  vh->len += length_increment;
-	  return 0;
-	}
+	return 0;
     }
   return 1;
 }
@@ -1123,5 +1123,62 @@ class TestACLplugin(VppTestCase):
 
         self.logger.info("ACLP_TEST_FINISH_0023")
 
+    def test_0024_hash_lookup_benchmark(self):
+        """ hash lookup benchmark CLI on synthetic rule sets"""
+        self.logger.info("ACLP_TEST_START_0024")
+
+        # The benchmark needs an interface without input ACLs
+        self.api_acl_interface_set_acl_list(sw_if_index=self.pg1.sw_if_index,
+                                            count=0, n_input=0, acls=[])
+        reply = self.vapi.cli("test acl-plugin hash-lookup pg1 rules 100 "
+                              "rules 1000 packets 1000 iterations 2")
+        self.logger.info(reply)
+        self.assertIn("100 rules", reply)
+        self.assertIn("1000 rules", reply)
+        self.assertIn("lookups/sec by hit rate", reply)
+
+        # The temporary ACLs are gone again
+        reply = self.vapi.cli("show acl-plugin acl")
+        self.assertNotIn("hash-lookup-test", reply)
+
+        self.logger.info("ACLP_TEST_FINISH_0024")
+
+    def test_0025_tree_lookup_port_permit_deny(self):
+        """ decision tree lookup: deny one TCP port, permit the rest
+        """
+        self.logger.info("ACLP_TEST_START_0025")
+
+        self.vapi.cli("set acl-plugin use-tree-acl-matching 1")
+        port = random.randint(0, 65535)
+        rules = []
+        rules.append(self.create_rule(self.IPV4, self.DENY, port,
+                                      self.proto[self.IP][self.TCP]))
+        rules.append(self.create_rule(self.IPV6, self.DENY, port,
+                                      self.proto[self.IP][self.TCP]))
+        rules.append(self.create_rule(self.IPV4, self.PERMIT,
+                                      self.PORTS_ALL, 0))
+        rules.append(self.create_rule(self.IPV6, self.PERMIT,
+                                      self.PORTS_ALL, 0))
+        self.apply_rules(rules, "tree deny ip4/ip6 tcp "+str(port))
+
+        # The tree is built in the background
+        reply = self.vapi.cli("show acl-plugin tables tree")
+        for i in range(10):
+            if "stale" not in reply:
+                break
+            self.sleep(0.1, "wait for the tree rebuild")
+            reply = self.vapi.cli("show acl-plugin tables tree")
+        self.logger.info(reply)
+        self.assertIn("Decision tree ACL matching: enabled", reply)
+        self.assertIn("active", reply)
+
+        self.run_verify_negat_test(self.IP, self.IPRANDOM,
+                                   self.proto[self.IP][self.TCP], port)
+        self.run_verify_test(self.IP, self.IPRANDOM,
+                             self.proto[self.IP][self.UDP], port)
+
+        self.vapi.cli("set acl-plugin use-tree-acl-matching 0")
+        self.logger.info("ACLP_TEST_FINISH_0025")
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -974,5 +974,128 @@ class TestIPVlan0(VppTestCase):
         self.send_and_expect(self.pg0, pkts, self.pg1)
 
 
+class TestIPSubIfInput(VppTestCase):
+    """ IPv4 sub-interface input """
+
+    def setUp(self):
+        super(TestIPSubIfInput, self).setUp()
+
+        self.create_pg_interfaces(range(3))
+
+        for i in self.pg_interfaces[:2]:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+        self.sub_if = VppDot1QSubint(self, self.pg0, 100)
+        self.sub_if.admin_up()
+        self.sub_if.config_ip4()
+        self.sub_if.resolve_arp()
+
+        # pg2 has no IPv4 config, its untagged traffic is routed only
+        # once it is received on the untagged sub-interface
+        self.pg2.admin_up()
+        r = self.vapi.create_subif(self.pg2.sw_if_index, 1, 0, 0,
+                                   no_tags=1, exact_match=1)
+        self.untagged_sw_if_index = r.sw_if_index
+        self.untagged_ip4 = "10.10.10.1"
+        self.untagged_ip4n = socket.inet_pton(socket.AF_INET,
+                                              self.untagged_ip4)
+        self.vapi.sw_interface_set_flags(self.untagged_sw_if_index, 1)
+        self.vapi.sw_interface_add_del_address(self.untagged_sw_if_index,
+                                               self.untagged_ip4n, 24)
+
+    def tearDown(self):
+        super(TestIPSubIfInput, self).tearDown()
+        self.vapi.sw_interface_add_del_address(self.untagged_sw_if_index,
+                                               self.untagged_ip4n, 24,
+                                               is_add=0)
+        self.vapi.delete_subif(self.untagged_sw_if_index)
+        self.sub_if.unconfig_ip4()
+        self.sub_if.remove_vpp_config()
+        for i in self.pg_interfaces:
+            if i.has_ip4_config:
+                i.unconfig_ip4()
+            i.admin_down()
+
+    def create_packet(self, src_if, tagged=False, src_ip=None):
+        if src_ip is None:
+            src_ip = src_if.remote_ip4
+        p = (Ether(src=src_if.remote_mac, dst=src_if.local_mac) /
+             IP(src=src_ip, dst=self.pg1.remote_ip4) /
+             UDP(sport=1234, dport=1234) /
+             Raw('\xa5' * 100))
+        if tagged:
+            p = self.sub_if.add_dot1_layer(p)
+        return p
+
+    def send(self, src_if, pkts):
+        src_if.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+
+    def test_ip_sub_if_runs(self):
+        """ IP runs of untagged and tagged packets """
+
+        u = self.create_packet(self.pg0)
+        t = self.create_packet(self.sub_if, tagged=True)
+
+        #
+        # Runs of untagged and tagged packets on the same port, each
+        # received on its own interface, an odd number of them
+        #
+        pkts = [u, u, u, t, t, u, t]
+        self.send(self.pg0, pkts)
+        self.pg1.get_capture(len(pkts))
+
+        # a single tagged packet
+        self.send(self.pg0, [t])
+        self.pg1.get_capture(1)
+
+        #
+        # The tagged packets of a down sub-interface are dropped,
+        # wherever they are in the frame
+        #
+        self.sub_if.admin_down()
+
+        self.send(self.pg0, [u, t, u])
+        self.pg1.get_capture(2)
+
+        self.send(self.pg0, [t])
+        self.pg1.assert_nothing_captured(remark="sub-interface is down")
+
+        self.sub_if.admin_up()
+        self.send(self.pg0, [t])
+        self.pg1.get_capture(1)
+
+    def test_ip_untagged_sub_if(self):
+        """ IP untagged sub-interface """
+
+        p = self.create_packet(self.pg2, src_ip="10.10.10.2")
+
+        #
+        # Untagged packets are received on the untagged sub-interface,
+        # as single packets and as a frame with an odd tail
+        #
+        self.send(self.pg2, [p])
+        self.pg1.get_capture(1)
+
+        self.send(self.pg2, [p] * 3)
+        self.pg1.get_capture(3)
+
+        #
+        # and are dropped when it is down
+        #
+        self.vapi.sw_interface_set_flags(self.untagged_sw_if_index, 0)
+
+        self.send(self.pg2, [p])
+        self.pg1.assert_nothing_captured(remark="sub-interface is down")
+
+        self.send(self.pg2, [p] * 3)
+        self.pg1.assert_nothing_captured(remark="sub-interface is down")
+
+        self.vapi.sw_interface_set_flags(self.untagged_sw_if_index, 1)
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -0,0 +1,162 @@
+#!/usr/bin/env python
+
+import unittest
+from random import shuffle
+
+from framework import VppTestCase, VppTestRunner
+
+from scapy.packet import Raw
+from scapy.layers.l2 import Ether
+from scapy.layers.inet import IP, UDP, fragment
+from scapy.layers.inet6 import IPv6, IPv6ExtHdrFragment, fragment6
+
+
+class TestIPReassembly(VppTestCase):
+    """ IPv4 and IPv6 Reassembly Test Case """
+
+    def setUp(self):
+        super(TestIPReassembly, self).setUp()
+
+        self.create_pg_interfaces(range(2))
+
+        for i in self.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+            i.config_ip6()
+            i.resolve_ndp()
+
+        self.vapi.cli("set interface reassembly pg0")
+        self.vapi.cli("set ip reassembly timeout 200")
+
+    def tearDown(self):
+        super(TestIPReassembly, self).tearDown()
+        self.logger.info(self.vapi.cli("show ip reassembly verbose"))
+        self.vapi.cli("set interface reassembly pg0 disable")
+        for i in self.pg_interfaces:
+            i.unconfig_ip4()
+            i.unconfig_ip6()
+            i.admin_down()
+
+    def create_ip4_datagrams(self, count, size):
+        return [(Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4,
+                    id=1000 + i) /
+                 UDP(sport=1234, dport=5678) /
+                 Raw(chr(i % 256) * size)) for i in range(count)]
+
+    def create_ip6_datagrams(self, count, size):
+        return [(Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+                 IPv6(src=self.pg0.remote_ip6, dst=self.pg1.remote_ip6) /
+                 IPv6ExtHdrFragment(id=1000 + i) /
+                 UDP(sport=1234, dport=5678) /
+                 Raw(chr(i % 256) * size)) for i in range(count)]
+
+    def fragment4(self, datagrams, fragsize):
+        frags = []
+        for p in datagrams:
+            frags.extend(Ether(src=p[Ether].src, dst=p[Ether].dst) / f
+                         for f in fragment(p[IP], fragsize=fragsize))
+        return frags
+
+    def fragment6(self, datagrams, fragsize):
+        frags = []
+        for p in datagrams:
+            frags.extend(Ether(src=p[Ether].src, dst=p[Ether].dst) / f
+                         for f in fragment6(p[IPv6], fragsize))
+        return frags
+
+    def send_and_expect(self, frags, count):
+        self.pg0.add_stream(frags)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        return self.pg1.get_capture(count)
+
+    def send_and_assert_nothing(self, frags):
+        self.pg0.add_stream(frags)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg1.assert_nothing_captured()
+
+    def verify_ip4(self, datagrams, rx):
+        sent = dict((p[IP].id, p) for p in datagrams)
+        for p in rx:
+            self.assertEqual(p[IP].flags & 1, 0)
+            self.assertEqual(p[IP].frag, 0)
+            self.assertEqual(p[Raw].load, sent[p[IP].id][Raw].load)
+            del sent[p[IP].id]
+        self.assertEqual(len(sent), 0)
+
+    def verify_ip6(self, datagrams, rx):
+        loads = sorted(p[Raw].load for p in datagrams)
+        for p in rx:
+            self.assertFalse(p.haslayer(IPv6ExtHdrFragment))
+            self.assertEqual(p[IPv6].nh, 17)
+        self.assertEqual(sorted(p[Raw].load for p in rx), loads)
+
+    def test_ip4_in_order(self):
+        """ IPv4 fragments in order """
+        datagrams = self.create_ip4_datagrams(10, 1000)
+        rx = self.send_and_expect(self.fragment4(datagrams, 200), 10)
+        self.verify_ip4(datagrams, rx)
+
+    def test_ip4_shuffled(self):
+        """ IPv4 fragments of interleaved datagrams, in random order """
+        datagrams = self.create_ip4_datagrams(50, 1400)
+        frags = self.fragment4(datagrams, 128)
+        shuffle(frags)
+        rx = self.send_and_expect(frags, 50)
+        self.verify_ip4(datagrams, rx)
+
+    def test_ip4_duplicate(self):
+        """ IPv4 duplicate fragments """
+        datagrams = self.create_ip4_datagrams(5, 1000)
+        frags = self.fragment4(datagrams, 200)
+        rx = self.send_and_expect(frags[:3] + frags, 5)
+        self.verify_ip4(datagrams, rx)
+
+    def test_ip4_overlap(self):
+        """ IPv4 overlapping fragments are dropped """
+        datagrams = self.create_ip4_datagrams(1, 1000)
+        frags = self.fragment4(datagrams, 200)
+        overlap = self.fragment4(datagrams, 400)[1]
+        self.send_and_assert_nothing(frags[:2] + [overlap] + frags[2:])
+
+    def test_ip4_timeout(self):
+        """ IPv4 incomplete datagrams time out """
+        datagrams = self.create_ip4_datagrams(5, 1000)
+        frags = self.fragment4(datagrams, 200)
+        self.send_and_assert_nothing([f for f in frags if f[IP].flags & 1])
+        self.sleep(.5, "wait for the reassemblies to time out")
+        self.send_and_assert_nothing(
+            [f for f in frags if not f[IP].flags & 1])
+
+    def test_ip4_after_idle(self):
+        """ IPv4 reassembly does not time out at once after idling """
+        datagrams = self.create_ip4_datagrams(5, 1000)
+        frags = self.fragment4(datagrams, 200)
+        self.sleep(1, "let the timer wheel idle past the timeout")
+        # the rest follows well within the timeout
+        self.pg0.add_stream([f for f in frags if f[IP].flags & 1])
+        self.pg_start()
+        rx = self.send_and_expect(
+            [f for f in frags if not f[IP].flags & 1], 5)
+        self.verify_ip4(datagrams, rx)
+
+    def test_ip6_in_order(self):
+        """ IPv6 fragments in order """
+        datagrams = self.create_ip6_datagrams(10, 1000)
+        rx = self.send_and_expect(self.fragment6(datagrams, 300), 10)
+        self.verify_ip6(datagrams, rx)
+
+    def test_ip6_shuffled(self):
+        """ IPv6 fragments of interleaved datagrams, in random order """
+        datagrams = self.create_ip6_datagrams(50, 1400)
+        frags = self.fragment6(datagrams, 200)
+        shuffle(frags)
+        rx = self.send_and_expect(frags, 50)
+        self.verify_ip6(datagrams, rx)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
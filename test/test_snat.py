@@ -2637,6 +2637,184 @@ class TestDeterministicNAT(MethodHolder):
             self.clear_snat()
 
 
+class TestSNATPerWorker(MethodHolder):
+    """ SNAT Per-worker Tables Test Cases """
+
+    @classmethod
+    def setUpConstants(cls):
+        super(TestSNATPerWorker, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["cpu", "{", "workers", "2", "}"])
+        cls.vpp_cmdline.extend(["snat", "{", "per-worker", "tables", "}"])
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestSNATPerWorker, cls).setUpClass()
+
+        try:
+            cls.tcp_port_in = 6303
+            cls.udp_port_in = 6304
+            cls.icmp_id_in = 6305
+            cls.snat_addr = '10.0.0.3'
+            cls.n_workers = 2
+
+            cls.create_pg_interfaces(range(2))
+            cls.interfaces = list(cls.pg_interfaces)
+
+            for i in cls.interfaces:
+                i.admin_up()
+                i.config_ip4()
+                i.resolve_arp()
+
+        except Exception:
+            super(TestSNATPerWorker, cls).tearDownClass()
+            raise
+
+    def port_slice(self, port):
+        """
+        Index of the worker port slice an outside port belongs to,
+        as snat_port_owner_thread computes it
+
+        :param port: Outside port number
+        """
+        first = 1024 // 64
+        n_words = (1 << 16) // 64 - first
+        w = port // 64
+        if w < first:
+            return 0
+        for i in range(self.n_workers - 1, 0, -1):
+            if first + (i * n_words) // self.n_workers <= w:
+                return i
+        return 0
+
+    def snat_add_address(self, ip, is_add=1):
+        """
+        Add/delete S-NAT address
+
+        :param ip: IP address
+        :param is_add: 1 if add, 0 if delete (Default add)
+        """
+        snat_addr = socket.inet_pton(socket.AF_INET, ip)
+        self.vapi.snat_add_address_range(snat_addr, snat_addr, is_add)
+
+    def test_per_worker_port_range(self):
+        """ SNAT per-worker tables allocate ports from the rx worker slice """
+
+        self.snat_add_address(self.snat_addr)
+        self.vapi.snat_interface_add_del_feature(self.pg0.sw_if_index)
+        self.vapi.snat_interface_add_del_feature(self.pg1.sw_if_index,
+                                                 is_inside=0)
+
+        # in2out, packet generator streams run on the first worker
+        pkts = self.create_stream_in(self.pg0, self.pg1)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        self.verify_capture_out(capture)
+        for port in [self.tcp_port_out, self.udp_port_out, self.icmp_id_out]:
+            self.assertTrue(port >= 1024)
+            self.assertEqual(self.port_slice(port), 0)
+
+        # out2in
+        pkts = self.create_stream_out(self.pg1)
+        self.pg1.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg0.get_capture(len(pkts))
+        self.verify_capture_in(capture, self.pg0)
+
+    def test_per_worker_static_handoff(self):
+        """ SNAT per-worker tables hand static mappings to the port owner """
+
+        # outside ports in the second worker's slice
+        self.tcp_port_out = 40000
+        self.udp_port_out = 40001
+        self.icmp_id_out = 40002
+        for port in [self.tcp_port_out, self.udp_port_out, self.icmp_id_out]:
+            self.assertEqual(self.port_slice(port), 1)
+
+        l_ip = self.pg0.remote_ip4n
+        e_ip = socket.inet_pton(socket.AF_INET, self.snat_addr)
+        self.snat_add_address(self.snat_addr)
+        for proto, port_in, port_out in \
+                [(IP_PROTOS.tcp, self.tcp_port_in, self.tcp_port_out),
+                 (IP_PROTOS.udp, self.udp_port_in, self.udp_port_out),
+                 (IP_PROTOS.icmp, self.icmp_id_in, self.icmp_id_out)]:
+            self.vapi.snat_add_static_mapping(l_ip, e_ip,
+                                              local_port=port_in,
+                                              external_port=port_out,
+                                              addr_only=0,
+                                              protocol=proto)
+        self.vapi.snat_interface_add_del_feature(self.pg0.sw_if_index)
+        self.vapi.snat_interface_add_del_feature(self.pg1.sw_if_index,
+                                                 is_inside=0)
+
+        # in2out, handed off from the first worker to the owner
+        pkts = self.create_stream_in(self.pg0, self.pg1)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        self.verify_capture_out(capture, same_port=True)
+        self.assertEqual(self.tcp_port_out, 40000)
+
+        # out2in, handed off to the owner which has the sessions
+        pkts = self.create_stream_out(self.pg1)
+        self.pg1.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg0.get_capture(len(pkts))
+        self.verify_capture_in(capture, self.pg0)
+
+        # in2out again, no second session on the rx worker
+        pkts = self.create_stream_in(self.pg0, self.pg1)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg1.get_capture(len(pkts))
+
+        sessions = self.vapi.snat_user_session_dump(l_ip, 0)
+        self.assertEqual(len(sessions), 3)
+        for session in sessions:
+            self.assertTrue(session.is_static)
+            self.assertEqual(session.inside_ip_address[0:4], l_ip)
+            self.assertEqual(self.port_slice(session.outside_port), 1)
+            self.assertEqual(session.total_pkts, 3)
+
+    def clear_snat(self):
+        """
+        Clear SNAT configuration.
+        """
+        interfaces = self.vapi.snat_interface_dump()
+        for intf in interfaces:
+            self.vapi.snat_interface_add_del_feature(intf.sw_if_index,
+                                                     intf.is_inside,
+                                                     is_add=0)
+
+        static_mappings = self.vapi.snat_static_mapping_dump()
+        for sm in static_mappings:
+            self.vapi.snat_add_static_mapping(sm.local_ip_address,
+                                              sm.external_ip_address,
+                                              local_port=sm.local_port,
+                                              external_port=sm.external_port,
+                                              addr_only=sm.addr_only,
+                                              vrf_id=sm.vrf_id,
+                                              protocol=sm.protocol,
+                                              is_add=0)
+
+        adresses = self.vapi.snat_address_dump()
+        for addr in adresses:
+            self.vapi.snat_add_address_range(addr.ip_address,
+                                             addr.ip_address,
+                                             is_add=0)
+
+    def tearDown(self):
+        super(TestSNATPerWorker, self).tearDown()
+        if not self.vpp_dead:
+            self.logger.info(self.vapi.cli("show snat verbose"))
+            self.clear_snat()
+
+
 class TestNAT64(MethodHolder):
     """ NAT64 Test Cases """
 
@@ -0,0 +1,135 @@
+#!/usr/bin/env python
+
+import re
+import unittest
+
+from scapy.layers.l2 import Ether
+from scapy.layers.inet import IP, TCP
+from scapy.packet import Raw
+
+from framework import VppTestCase, VppTestRunner
+
+
+class TestTCP(VppTestCase):
+    """ TCP Test Case """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestTCP, cls).setUpClass()
+
+    def setUp(self):
+        super(TestTCP, self).setUp()
+
+    def tearDown(self):
+        super(TestTCP, self).tearDown()
+
+    def run_unittest(self, test):
+        error = self.vapi.cli("test tcp %s" % test)
+
+        if error:
+            self.logger.critical(error)
+        self.assertEqual(error.find("failed"), -1)
+
+    def test_tcp_sack(self):
+        """ TCP SACK Unit Tests """
+        self.run_unittest("sack")
+
+    def test_tcp_zero_copy(self):
+        """ TCP zero-copy rx Unit Tests """
+        self.run_unittest("zero-copy")
+
+    def test_tcp_gso(self):
+        """ TCP GSO software segmentation Unit Tests """
+        self.run_unittest("gso")
+
+
+class TestTCPGRO(VppTestCase):
+    """ TCP GRO Test Case """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestTCPGRO, cls).setUpClass()
+
+        cls.create_pg_interfaces(range(1))
+        cls.pg0.admin_up()
+        cls.pg0.config_ip4()
+        cls.pg0.resolve_arp()
+
+        cls.vapi.cli("set tcp gro")
+        cls.vapi.cli("session enable")
+
+    def setUp(self):
+        super(TestTCPGRO, self).setUp()
+        self.seq = 1000
+
+    def tearDown(self):
+        super(TestTCPGRO, self).tearDown()
+        if not self.vpp_dead:
+            self.logger.info(self.vapi.cli("show tcp gro"))
+
+    def gro_counters(self):
+        """ Return the segments and packets counted by tcp-gro """
+        out = self.vapi.cli("show tcp gro")
+        m = re.search(r"thread 0: (\d+) segments, (\d+) packets", out)
+        return int(m.group(1)), int(m.group(2))
+
+    def segment(self, flags="A", ack=1, window=8192, options=[], tos=0,
+                ttl=64, size=100, seq=None):
+        """ A data segment, the next in sequence unless seq is given """
+        if seq is None:
+            seq = self.seq
+            self.seq += size
+        return (Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+                IP(src=self.pg0.remote_ip4, dst=self.pg0.local_ip4,
+                   tos=tos, ttl=ttl) /
+                TCP(sport=10000, dport=20000, flags=flags, seq=seq, ack=ack,
+                    window=window, options=options) /
+                Raw('\xa5' * size))
+
+    def verify_merge(self, pkts, n_expected):
+        """ Send the segments in one frame, check tcp-input got n_expected
+        packets for them """
+        n_segs, n_pkts = self.gro_counters()
+
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+
+        n_segs2, n_pkts2 = self.gro_counters()
+        self.assertEqual(n_segs2 - n_segs, len(pkts))
+        self.assertEqual(n_pkts2 - n_pkts, n_expected)
+
+    def test_gro_in_order(self):
+        """ TCP GRO merges in order segments """
+        self.verify_merge([self.segment() for i in range(4)], 1)
+
+    def test_gro_psh(self):
+        """ TCP GRO ends the chain at a segment with PSH """
+        pkts = [self.segment(), self.segment(flags="PA"),
+                self.segment(), self.segment()]
+        self.verify_merge(pkts, 2)
+
+    def test_gro_short(self):
+        """ TCP GRO ends the chain at a short segment """
+        pkts = [self.segment(), self.segment(size=50),
+                self.segment(), self.segment()]
+        self.verify_merge(pkts, 2)
+
+    def test_gro_mismatch(self):
+        """ TCP GRO merges only segments with the same headers """
+        # The odd segment cannot join the first, the next cannot join it
+        for odd in [dict(ack=2), dict(window=4096),
+                    dict(options=[('NOP', None), ('NOP', None),
+                                  ('Timestamp', (1, 2))]),
+                    dict(tos=4), dict(ttl=63)]:
+            pkts = [self.segment(), self.segment(**odd),
+                    self.segment(), self.segment()]
+            self.verify_merge(pkts, 3)
+
+    def test_gro_out_of_order(self):
+        """ TCP GRO passes out of order segments unmerged """
+        seqs = [self.seq + i * 100 for i in [0, 2, 1, 3]]
+        self.verify_merge([self.segment(seq=s) for s in seqs], 4)
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)